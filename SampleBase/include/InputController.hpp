@@ -96,6 +96,14 @@ public:
         return (GetKeyState(Key) & INPUT_KEY_STATE_FLAG_KEY_IS_DOWN) != 0;
     }
 
+    // Overrides the current state, e.g. when replaying recorded input
+    void SetState(const MouseState& Mouse, const INPUT_KEY_STATE_FLAGS* pKeys)
+    {
+        m_MouseState = Mouse;
+        for (Uint32 i = 0; i < static_cast<Uint32>(InputKeys::TotalKeys); ++i)
+            m_Keys[i] = pKeys[i];
+    }
+
     void ClearState()
     {
         m_MouseState.WheelDelta = 0;
@@ -174,6 +182,8 @@ protected:
 
             void ClearState(){}
 
+            void SetState(const MouseState& Mouse, const INPUT_KEY_STATE_FLAGS* pKeys){m_MouseState = Mouse;}
+
         private:
             MouseState m_MouseState;
         };
@@ -0,0 +1,109 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicTypes.h"
+#include "InputController.hpp"
+
+namespace Diligent
+{
+
+/// Input controller state snapshot that is recorded to and replayed from an input stream.
+struct InputStreamFrame
+{
+    Uint32                FrameIndex = 0;
+    MouseState            Mouse;
+    INPUT_KEY_STATE_FLAGS Keys[static_cast<size_t>(InputKeys::TotalKeys)] = {};
+};
+
+/// Input stream header. Replaying the stream with the same seed and
+/// time step reproduces the recorded run exactly.
+struct InputStreamHeader
+{
+    static constexpr Uint32 Magic   = 0x52494744; // 'DGIR'
+    static constexpr Uint32 Version = 1;
+
+    Uint32 RandomSeed    = 0;
+    double FixedTimeStep = 0;
+};
+
+/// Records the input controller state every frame and writes it to a compact binary file.
+
+/// A frame record is only written when the state differs from the state the controller
+/// will have in the next frame if no input events arrive, so idle frames take no space.
+class InputStreamRecorder
+{
+public:
+    InputStreamRecorder(std::string FilePath, const InputStreamHeader& Header);
+    ~InputStreamRecorder();
+
+    // clang-format off
+    InputStreamRecorder           (const InputStreamRecorder&) = delete;
+    InputStreamRecorder& operator=(const InputStreamRecorder&) = delete;
+    // clang-format on
+
+    void RecordFrame(Uint32 FrameIndex, InputController& Controller);
+
+    bool Save();
+
+private:
+    const std::string m_FilePath;
+    std::vector<Uint8> m_Data;
+    InputStreamFrame   m_ExpectedState;
+    Uint32             m_NumRecords = 0;
+    bool               m_IsSaved    = false;
+};
+
+/// Replays the input stream recorded by InputStreamRecorder.
+
+/// The live input is ignored: every frame, the controller state is overwritten
+/// with the recorded one.
+class InputStreamPlayer
+{
+public:
+    /// Loads the stream from the file. Throws an exception if the file can't be read.
+    explicit InputStreamPlayer(const char* FilePath);
+
+    const InputStreamHeader& GetHeader() const { return m_Header; }
+
+    void PlayFrame(Uint32 FrameIndex, InputController& Controller);
+
+    bool IsFinished() const { return m_NextRecord >= m_Records.size(); }
+
+private:
+    InputStreamHeader             m_Header;
+    std::vector<InputStreamFrame> m_Records;
+    size_t                        m_NextRecord = 0;
+    InputStreamFrame              m_State;
+};
+
+} // namespace Diligent
@@ -0,0 +1,87 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "BasicTypes.h"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+/// Sorts the values by integer keys using a stable LSD radix sort.
+
+/// The keys are processed in 8-bit digits, so keys that fit into a single byte are sorted
+/// with one counting pass, and passes whose digit is the same for all keys are skipped.
+/// GetKey(Value) must return a Uint32 key that is less than 2^NumKeyBits.
+/// Scratch is used as the temporary storage and is resized as needed. Keeping it
+/// between the calls avoids allocations when the same number of values is sorted every frame.
+template <typename ValueType, typename KeyFuncType>
+void RadixSort(std::vector<ValueType>& Values, std::vector<ValueType>& Scratch, Uint32 NumKeyBits, const KeyFuncType& GetKey)
+{
+    VERIFY(NumKeyBits > 0 && NumKeyBits <= 32, "The number of key bits (", NumKeyBits, ") must be in range [1, 32]");
+
+    if (Values.size() < 2)
+        return;
+
+    constexpr Uint32 DigitBits  = 8;
+    constexpr Uint32 NumBuckets = 1u << DigitBits;
+
+    Scratch.resize(Values.size());
+    for (Uint32 Shift = 0; Shift < NumKeyBits; Shift += DigitBits)
+    {
+        std::array<size_t, NumBuckets> Offsets = {};
+        for (const auto& Value : Values)
+        {
+            const Uint32 Key = GetKey(Value);
+            VERIFY(NumKeyBits == 32 || Key < (1u << NumKeyBits), "The key (", Key, ") does not fit into ", NumKeyBits, " bits");
+            ++Offsets[(Key >> Shift) & (NumBuckets - 1)];
+        }
+
+        // The pass would not change the order
+        if (Offsets[(GetKey(Values.front()) >> Shift) & (NumBuckets - 1)] == Values.size())
+            continue;
+
+        size_t Offset = 0;
+        for (auto& BucketOffset : Offsets)
+        {
+            const size_t Count = BucketOffset;
+            BucketOffset       = Offset;
+            Offset += Count;
+        }
+
+        for (const auto& Value : Values)
+            Scratch[Offsets[(GetKey(Value) >> Shift) & (NumBuckets - 1)]++] = Value;
+        Values.swap(Scratch);
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,54 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+// SIMD instruction sets available to the CPU kernels of the samples at compile time:
+//
+//   SAMPLES_USE_SSE2     - SSE2 (x86-64, or x86 compiled with SSE2 enabled)
+//   SAMPLES_USE_AVX2     - AVX2, only defined together with SAMPLES_USE_SSE2
+//   SAMPLES_USE_NEON     - NEON (32-bit ARM or AArch64)
+//   SAMPLES_USE_NEON_A64 - AArch64 NEON, only defined together with SAMPLES_USE_NEON.
+//                          Instructions such as vdivq_f32, vsqrtq_f32 and vrndnq_f32 require it.
+//
+// SSE2 and NEON are never enabled at the same time. Undefined macros evaluate to 0 in #if
+// expressions, so kernels are selected with #if SAMPLES_USE_AVX2 ... #elif SAMPLES_USE_SSE2 ...
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SAMPLES_USE_SSE2 1
+#    if defined(__AVX2__)
+#        include <immintrin.h>
+#        define SAMPLES_USE_AVX2 1
+#    endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define SAMPLES_USE_NEON 1
+#    if defined(__aarch64__) || defined(_M_ARM64)
+#        define SAMPLES_USE_NEON_A64 1
+#    endif
+#endif
@@ -40,10 +40,15 @@
 #include "SampleBase.hpp"
 #include "ScreenCapture.hpp"
 #include "Image.h"
+#include "InputStream.hpp"
+#include "TimelineProfiler.hpp"
 
 namespace Diligent
 {
 
+class ScreenCaptureEncoder;
+class TaskScheduler;
+
 class ImGuiImplDiligent;
 
 class SampleApp : public NativeAppBase
@@ -71,10 +76,7 @@ public:
         return m_GoldenImgMode;
     }
 
-    virtual int GetExitCode() const override final
-    {
-        return m_ExitCode;
-    }
+    virtual int GetExitCode() const override final;
 
     virtual bool IsReady() const override final
     {
@@ -104,7 +106,13 @@ protected:
         m_pSwapChain->SetWindowedMode();
     }
 
+    CommandLineStatus RunHeadlessBenchmark();
+    void              WriteBenchmarkReport();
+    CommandLineStatus RunScalingBenchmark();
+    void              WriteScalingReport(const std::vector<SampleBase::ScalingBenchmarkParam>& Params);
+
     void CompareGoldenImage(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
+    void SaveGoldenImageDiff(const std::string& GoldenImageFileName, const std::vector<Uint8>& HeatMap);
     void SaveScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
 
     RENDER_DEVICE_TYPE                         m_DeviceType = RENDER_DEVICE_TYPE_UNDEFINED;
@@ -133,6 +141,10 @@ protected:
     bool         m_bForceNonSeprblProgs = false;
     bool         m_bBreakOnError        = true;
     double       m_CurrentTime          = 0;
+    Uint32       m_FrameIndex           = 0;
+    // When positive, every frame advances the time by this value instead of the wall-clock time
+    double       m_FixedTimeStep        = 0;
+    Uint32       m_RandomSeed           = std::mt19937::default_seed;
     Uint32       m_MaxFrameLatency      = SwapChainDesc{}.BufferCount;
 
     // We will need this when we have to recreate the swap chain (on Android)
@@ -142,17 +154,65 @@ protected:
     {
         bool              AllowCapture = false;
         std::string       Directory;
-        std::string       FileName        = "frame";
-        double            CaptureFPS      = 30;
-        double            LastCaptureTime = -1e+10;
-        Uint32            FramesToCapture = 0;
-        Uint32            CurrentFrame    = 0;
-        IMAGE_FILE_FORMAT FileFormat      = IMAGE_FILE_FORMAT_PNG;
-        int               JpegQuality     = 95;
-        bool              KeepAlpha       = false;
+        std::string       FileName          = "frame";
+        double            CaptureFPS        = 30;
+        double            LastCaptureTime   = -1e+10;
+        Uint32            FramesToCapture   = 0;
+        Uint32            CurrentFrame      = 0;
+        IMAGE_FILE_FORMAT FileFormat        = IMAGE_FILE_FORMAT_PNG;
+        int               JpegQuality       = 95;
+        bool              KeepAlpha         = false;
+        // Write all frames into a single raw video file instead of individual images
+        bool              RawVideo          = false;
+        // Delta-compress raw video frames against the previous frame
+        bool              RawVideoDelta     = false;
+        // The number of threads that encode and write the captured frames (0 - choose automatically)
+        Uint32            NumEncoderThreads = 0;
 
     } m_ScreenCaptureInfo;
-    std::unique_ptr<ScreenCapture> m_pScreenCapture;
+    std::unique_ptr<ScreenCapture>        m_pScreenCapture;
+    std::unique_ptr<ScreenCaptureEncoder> m_pCaptureEncoder;
+
+    std::unique_ptr<InputStreamRecorder> m_pInputRecorder;
+    std::unique_ptr<InputStreamPlayer>   m_pInputPlayer;
+
+    std::unique_ptr<TimelineProfiler> m_pProfiler;
+
+    // Compares the golden images. Created on first use and kept alive, so that
+    // the worker threads are not respawned for every validated frame.
+    std::unique_ptr<TaskScheduler> m_pImageDiffScheduler;
+
+    struct BenchmarkInfo
+    {
+        bool        Headless        = false;
+        Uint32      NumFrames       = 100;
+        Uint32      NumWarmupFrames = 10;
+        std::string OutputFile      = "benchmark.json";
+
+        struct FrameTiming
+        {
+            double Update  = 0;
+            double Render  = 0;
+            double Present = 0;
+        };
+        std::vector<FrameTiming> FrameTimings;
+
+        // Sweep the parameters returned by SampleBase::GetScalingBenchmarkParams()
+        bool Scaling = false;
+        // Overrides the values of the swept parameters, e.g. "threads=1,2,4;quads=1000,10000"
+        std::string ScalingParams;
+
+        // Timings of one configuration of the scaling benchmark averaged over all frames, in seconds
+        struct ScalingResult
+        {
+            std::vector<int>    Config;
+            double              FrameTime   = 0;
+            double              RecordTime  = 0;
+            double              ExecuteTime = 0;
+            std::vector<double> ThreadRecordTime;
+        };
+        std::vector<ScalingResult> ScalingResults;
+    } m_BenchmarkInfo;
 
     std::unique_ptr<ImGuiImplDiligent> m_pImGui;
 
@@ -28,6 +28,8 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <random>
 
 #include "EngineFactory.h"
 #include "RefCntAutoPtr.hpp"
@@ -53,6 +55,7 @@ struct SampleInitInfo
     Uint32             NumDeferredCtx  = 0;
     ISwapChain*        pSwapChain      = nullptr;
     ImGuiImplDiligent* pImGui          = nullptr;
+    Uint32             RandomSeed      = std::mt19937::default_seed;
 };
 
 struct DesiredApplicationSettings
@@ -190,7 +193,44 @@ public:
         m_pSwapChain = pNewSwapChain;
     }
 
+    /// Parameter that is swept by the thread scaling benchmark
+    struct ScalingBenchmarkParam
+    {
+        std::string      Name;
+        std::vector<int> Values;
+    };
+
+    /// Multithreaded command recording timings of the last frame, in seconds
+    struct ThreadingStats
+    {
+        /// Time every thread spent recording commands, including finishing its command list.
+        /// Thread 0 is the main thread that records commands into the immediate context.
+        std::vector<double> ThreadRecordTime;
+
+        /// Time from the start of recording until all threads have finished
+        double RecordTime = 0;
+
+        /// Time spent in ExecuteCommandLists()
+        double ExecuteTime = 0;
+    };
+
+    /// Returns the parameters that the thread scaling benchmark (--bench_scaling) sweeps.
+    /// The parameter named "threads" is the total number of recording threads, which
+    /// is used to compute the parallel efficiency. Samples that do not support the benchmark return an empty list.
+    virtual std::vector<ScalingBenchmarkParam> GetScalingBenchmarkParams() const { return {}; }
+
+    /// Switches the sample to the given configuration of the scaling benchmark.
+    /// Values are given in the order of the parameters returned by GetScalingBenchmarkParams().
+    virtual void SetScalingBenchmarkConfig(const std::vector<int>& Values) {}
+
+    /// Returns the recording timings of the last frame, or null if the sample does not collect them.
+    virtual const ThreadingStats* GetThreadingStats() const { return nullptr; }
+
 protected:
+    // Returns the "threads" scaling benchmark parameter with values from 1 to the smaller of
+    // MaxThreads and the number of hardware threads
+    static ScalingBenchmarkParam GetThreadsBenchmarkParam(int MaxThreads);
+
     // Returns projection matrix adjusted to the current screen orientation
     float4x4 GetAdjustedProjectionMatrix(float FOV, float NearPlane, float FarPlane) const;
 
@@ -212,6 +252,10 @@ protected:
     // Pixel shader output needs to be manually converted to gamma space
     bool m_ConvertPSOutputToGamma = false;
 
+    // Seed that samples should use to initialize random number generators,
+    // so that runs with the same seed produce identical scenes
+    Uint32 m_RandomSeed = std::mt19937::default_seed;
+
     InputController m_InputController;
 };
 
@@ -0,0 +1,183 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "BasicTypes.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent
+{
+
+/// Buffer that streams the data written by the CPU to the GPU from multiple contexts.
+
+/// When the device can write to unified memory (Direct3D12 and Vulkan), the buffer is a single
+/// persistently mapped ring shared by all contexts. Every context takes chunks of the ring with
+/// an atomic bump allocator and sub-allocates from its chunk without any synchronization. The data
+/// of a frame is protected by the fence value signaled by FinishFrame() and the space is reused
+/// when the GPU passes that value, so the buffer is never discarded or renamed by the driver.
+///
+/// Otherwise, every context maps the dynamic buffer with MAP_FLAG_NO_OVERWRITE and discards it
+/// with MAP_FLAG_DISCARD when it runs out of space.
+class StreamingBuffer
+{
+public:
+    struct CreateInfo
+    {
+        const char* Name        = "Streaming buffer";
+        BIND_FLAGS  BindFlags   = BIND_NONE;
+        Uint32      Size        = 0;
+        Uint32      NumContexts = 1;
+
+        /// The size of the chunks that the contexts take from the ring.
+        Uint32 ChunkSize = 64 << 10;
+
+        /// Whether to use the persistently mapped ring if the device supports it.
+        bool UseRing = true;
+    };
+
+    /// pContext is the immediate context that signals the fence.
+    StreamingBuffer(IRenderDevice* pDevice, IDeviceContext* pContext, const CreateInfo& CI);
+    ~StreamingBuffer();
+
+    // clang-format off
+    StreamingBuffer           (const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+    // clang-format on
+
+    static constexpr Uint32 InvalidOffset = ~Uint32{0};
+
+    /// Allocates Size bytes for the context and returns the offset of the region in the buffer.
+    /// A context must only be used by one thread at a time. The ring waits for the GPU when it is full
+    /// and returns InvalidOffset if the region does not fit into the ring together with the current frame.
+    Uint32 Allocate(IDeviceContext* pCtx, Uint32 Size, Uint32 CtxNum, Uint32 Alignment = 16);
+
+    /// Returns the CPU address of the buffer start for the context.
+    Uint8* GetMappedCPUAddress(Uint32 CtxNum) const
+    {
+        return m_pRingData != nullptr ? m_pRingData : m_Contexts[CtxNum].pMappedData;
+    }
+
+    /// Ends writing the last allocation. The dynamic buffer is unmapped unless persistent mapping is allowed.
+    void Release(Uint32 CtxNum);
+
+    /// Ends using the context until the next allocation. The dynamic buffer is unmapped and discarded by the next allocation.
+    void Flush(Uint32 CtxNum);
+
+    /// Signals the fence that protects the data of the current frame. Must be called after all commands
+    /// that use the data are submitted to the immediate context, while no other thread uses the buffer.
+    void FinishFrame();
+
+    /// In Direct3D12 and Vulkan, the dynamic buffer does not need to be unmapped before it is used by the GPU.
+    void AllowPersistentMapping(bool AllowMapping) { m_AllowPersistentMap = AllowMapping; }
+
+    bool     IsRing() const { return m_pRingData != nullptr; }
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+
+    struct FrameStats
+    {
+        Uint64 Size        = 0; // bytes allocated by all contexts
+        Uint32 NumWraps    = 0; // times the ring wrapped around
+        Uint32 NumStalls   = 0; // times a context waited for the GPU to free ring space
+        Uint32 NumDiscards = 0; // times the dynamic buffer was discarded
+        Uint32 NumFailures = 0; // allocations that did not fit into the buffer
+    };
+    /// Returns the statistics of the last finished frame.
+    const FrameStats& GetFrameStats() const { return m_LastFrameStats; }
+
+private:
+    bool AcquireChunk(Uint32 CtxNum, Uint64 MinSize);
+    bool WaitForSpace(Uint64 End);
+    void ReleaseCompletedFrames(Uint64 CompletedValue);
+    void FlushRingRange(Uint64 Start, Uint64 End);
+
+    // Chunks are aligned to satisfy the alignment of any allocation and
+    // the atom size of non-coherent memory flushes.
+    static constexpr Uint32 ChunkAlignment = 256;
+
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+    RefCntAutoPtr<IBuffer>        m_pBuffer;
+    RefCntAutoPtr<IFence>         m_pFence;
+    Uint64                        m_FenceValue = 0;
+
+    const Uint32 m_Size;
+    const Uint32 m_ChunkSize;
+    Uint8*       m_pRingData          = nullptr;
+    bool         m_AllowPersistentMap = false;
+
+    // Ring positions grow monotonically, the offset in the buffer is the position modulo the size.
+    std::atomic<Uint64> m_Head{0}; // the end of the last chunk
+    std::atomic<Uint64> m_Tail{0}; // the end of the last frame completed by the GPU
+    Uint64              m_FrameStart = 0;
+
+    std::atomic<Uint32> m_NumWraps{0};
+    std::atomic<Uint32> m_NumStalls{0};
+
+    struct PendingFrame
+    {
+        Uint64 FenceValue = 0;
+        Uint64 End        = 0;
+    };
+    static constexpr Uint32 MaxPendingFrames = 8;
+
+    // Protects the pending frames and serializes the waits for the fence
+    std::mutex                                 m_FramesMtx;
+    std::array<PendingFrame, MaxPendingFrames> m_PendingFrames;
+    Uint32                                     m_FirstPendingFrame = 0;
+    Uint32                                     m_NumPendingFrames  = 0;
+
+    // The states are aligned to two cache lines, so that the threads
+    // that use different contexts never write to the same line.
+    // The vector storage relies on the C++17 aligned operator new.
+    struct alignas(128) ContextData
+    {
+        // Ring mode
+        Uint64 ChunkPos = 0;
+        Uint64 ChunkEnd = 0;
+
+        // Dynamic buffer mode
+        IDeviceContext* pMappedCtx  = nullptr;
+        Uint8*          pMappedData = nullptr;
+        Uint32          CurrOffset  = 0;
+        Uint32          NumDiscards = 0;
+
+        Uint64 FrameSize   = 0;
+        Uint32 NumFailures = 0;
+    };
+    std::vector<ContextData> m_Contexts;
+
+    FrameStats m_LastFrameStats;
+};
+
+} // namespace Diligent
@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Work-stealing task scheduler shared by the multithreaded samples.
+
+/// Every thread owns a task deque. A thread pushes and pops its own tasks at the back
+/// of the deque and, when it runs out of work, steals tasks from the front of the other
+/// threads' deques. Idle worker threads sleep on a condition variable instead of spinning.
+///
+/// Thread 0 is the thread that created the scheduler. It does not run a loop, but executes
+/// tasks while it waits in Wait(), ParallelFor() or RunOnAllThreads(). Worker threads have
+/// indices 1 to NumWorkers. Every task receives the index of the thread that runs it, which
+/// the samples use to pick a device context: thread 0 records commands into the immediate
+/// context, and thread i into deferred context i-1. A deferred context is thus never used by
+/// two threads, and tasks that must run on the thread that owns the context (e.g. FinishFrame()
+/// in Metal) are pinned to that thread with the Affinity parameter.
+///
+/// Several schedulers may exist at the same time (e.g. one per subsystem), and the same thread
+/// may be thread 0 of more than one of them. Every scheduler reports its own thread indices.
+class TaskScheduler
+{
+public:
+    static constexpr Uint32 AnyThread = ~0u;
+
+    class Task;
+    using TaskHandle = std::shared_ptr<Task>;
+    using TaskFunc   = std::function<void(Uint32 ThreadId)>;
+    using RangeFunc  = std::function<void(Uint32 ThreadId, Uint32 Begin, Uint32 End)>;
+
+    explicit TaskScheduler(Uint32 NumWorkers);
+    ~TaskScheduler();
+
+    // clang-format off
+    TaskScheduler           (const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    // clang-format on
+
+    /// Returns the total number of threads, including thread 0.
+    Uint32 GetNumThreads() const { return static_cast<Uint32>(m_Queues.size()); }
+
+    /// Returns the index of the calling thread, or AnyThread if the thread does not belong to this scheduler.
+    Uint32 GetCurrentThreadId() const;
+
+    /// Submits a task that will run once all Dependencies are complete.
+    /// If Affinity is not AnyThread, the task only runs on that thread and is never stolen.
+    TaskHandle Submit(TaskFunc Func, const std::vector<TaskHandle>& Dependencies = {}, Uint32 Affinity = AnyThread);
+
+    /// Waits for the task to complete. Threads of this scheduler execute other tasks while waiting.
+    void Wait(const TaskHandle& pTask);
+
+    static bool IsComplete(const TaskHandle& pTask);
+
+    /// Splits [Begin, End) into chunks of GrainSize elements, runs Func for every chunk
+    /// in parallel and waits for all chunks to complete. When called from a thread that does
+    /// not belong to the scheduler, all chunks are executed by the threads of the scheduler.
+    void ParallelFor(Uint32 Begin, Uint32 End, Uint32 GrainSize, const RangeFunc& Func);
+
+    /// Runs Func once on every thread and waits for all of them to complete.
+    /// Must be called from thread 0.
+    void RunOnAllThreads(const TaskFunc& Func);
+
+    /// Callbacks that let a profiler trace the scheduler threads. The scheduler does not depend
+    /// on the profiler, so that it can be used by tools that do not use the graphics engine.
+    struct ProfilerCallbacks
+    {
+        /// Called by every worker thread when it starts.
+        void (*OnWorkerThreadStart)(Uint32 ThreadId);
+
+        /// Called before and after every task. The value returned by OnTaskBegin is passed to OnTaskEnd.
+        Uint64 (*OnTaskBegin)();
+        void (*OnTaskEnd)(Uint64 BeginValue);
+    };
+
+    /// Sets the callbacks used by all schedulers, or removes them if pCallbacks is null.
+    /// The callbacks must remain valid until they are removed.
+    static void SetProfilerCallbacks(const ProfilerCallbacks* pCallbacks);
+
+private:
+    struct ThreadQueue;
+
+    void       WorkerThreadFunc(Uint32 ThreadId);
+    TaskHandle FindTask(Uint32 ThreadId);
+    void       Enqueue(TaskHandle pTask, Uint32 ThreadId);
+    void       Execute(TaskHandle pTask, Uint32 ThreadId);
+    void       Notify();
+
+    // The thread that created the scheduler (thread 0)
+    const std::thread::id m_OwnerThreadId;
+
+    std::vector<std::unique_ptr<ThreadQueue>> m_Queues;
+    std::vector<std::thread>                  m_WorkerThreads;
+
+    // Incremented every time a task is queued or completed, so that
+    // sleeping threads can tell that there is something to do
+    std::atomic<Uint64>     m_Epoch{0};
+    std::mutex              m_SleepMtx;
+    std::condition_variable m_SleepCV;
+    Uint32                  m_NumSleepers = 0;
+    bool                    m_Stop        = false;
+};
+
+/// Runs Func for [Begin, End) in parallel if the scheduler is available, and
+/// as a single range on the calling thread with thread index 0 otherwise.
+inline void ParallelFor(TaskScheduler* pScheduler, Uint32 Begin, Uint32 End, Uint32 GrainSize, const TaskScheduler::RangeFunc& Func)
+{
+    if (pScheduler != nullptr)
+        pScheduler->ParallelFor(Begin, End, GrainSize, Func);
+    else if (Begin < End)
+        Func(0, Begin, End);
+}
+
+} // namespace Diligent
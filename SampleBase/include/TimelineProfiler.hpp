@@ -0,0 +1,185 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "BasicTypes.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent
+{
+
+/// Hierarchical CPU/GPU timeline profiler that exports traces in the Chrome trace event format.
+
+/// The trace can be opened in https://ui.perfetto.dev or chrome://tracing and shows every thread
+/// and every immediate context as a separate track, so that command recording on worker threads
+/// can be compared with the execution on the queues.
+///
+/// CPU scopes are recorded by every thread into its own event buffer. A buffer has a single writer
+/// and is only read when the trace is exported, so recording a scope does not take any locks.
+/// GPU scopes are measured with timestamp queries and are resolved by EndFrame() once the queries
+/// are available. GPU timestamps are mapped to the CPU clock assuming that a command never starts
+/// before it is recorded, so the GPU tracks are aligned with the CPU tracks only approximately.
+///
+/// There is at most one profiler at a time. When no profiler exists, all scopes are no-ops.
+/// Scope names are not copied and must be string literals or other strings that outlive the profiler.
+class TimelineProfiler
+{
+public:
+    /// Creates the profiler and makes it the current one.
+    explicit TimelineProfiler(std::string TracePath);
+    ~TimelineProfiler();
+
+    // clang-format off
+    TimelineProfiler           (const TimelineProfiler&) = delete;
+    TimelineProfiler& operator=(const TimelineProfiler&) = delete;
+    // clang-format on
+
+    /// Returns the current profiler or null if profiling is disabled.
+    static TimelineProfiler* Get() { return sm_pProfiler.load(std::memory_order_acquire); }
+
+    /// Enables GPU scopes. Immediate contexts whose queues do not support timestamp queries are ignored.
+    void InitializeGpuQueries(IRenderDevice* pDevice);
+
+    /// Sets the name of the calling thread's track.
+    void SetThreadName(const char* Name);
+
+    /// Records a CPU event on the calling thread's track. Times are returned by GetTime().
+    void AddCpuEvent(const char* Name, Uint64 BeginTime, Uint64 EndTime);
+
+    void BeginGpuScope(IDeviceContext* pContext, const char* Name);
+    void EndGpuScope(IDeviceContext* pContext);
+
+    /// Resolves the GPU queries that are available. Must be called once per frame
+    /// from the thread that uses the immediate contexts.
+    void EndFrame();
+
+    /// Writes all events recorded so far. If Path is null, the path given to the constructor is used.
+    bool WriteTrace(const char* Path = nullptr);
+
+    /// Returns the time in nanoseconds since the profiler was created.
+    Uint64 GetTime() const
+    {
+        return static_cast<Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count());
+    }
+
+    /// Records the time between construction and destruction as a CPU event.
+    class CpuScope
+    {
+    public:
+        explicit CpuScope(const char* Name) :
+            m_pProfiler{TimelineProfiler::Get()},
+            m_Name{Name},
+            m_BeginTime{m_pProfiler != nullptr ? m_pProfiler->GetTime() : 0}
+        {}
+
+        ~CpuScope()
+        {
+            if (m_pProfiler != nullptr)
+                m_pProfiler->AddCpuEvent(m_Name, m_BeginTime, m_pProfiler->GetTime());
+        }
+
+        // clang-format off
+        CpuScope           (const CpuScope&) = delete;
+        CpuScope& operator=(const CpuScope&) = delete;
+        // clang-format on
+
+    private:
+        TimelineProfiler* const m_pProfiler;
+        const char* const       m_Name;
+        const Uint64            m_BeginTime;
+    };
+
+    /// Measures the commands recorded into an immediate context between construction and destruction.
+    class GpuScope
+    {
+    public:
+        GpuScope(IDeviceContext* pContext, const char* Name) :
+            m_pProfiler{TimelineProfiler::Get()},
+            m_pContext{pContext}
+        {
+            if (m_pProfiler != nullptr)
+                m_pProfiler->BeginGpuScope(m_pContext, Name);
+        }
+
+        ~GpuScope()
+        {
+            if (m_pProfiler != nullptr)
+                m_pProfiler->EndGpuScope(m_pContext);
+        }
+
+        // clang-format off
+        GpuScope           (const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+        // clang-format on
+
+    private:
+        TimelineProfiler* const m_pProfiler;
+        IDeviceContext* const   m_pContext;
+    };
+
+private:
+    struct Event
+    {
+        const char* Name      = nullptr;
+        Uint64      BeginTime = 0;
+        Uint64      EndTime   = 0;
+    };
+
+    struct ThreadBuffer;
+    struct GpuQueue;
+
+    ThreadBuffer* GetThreadBuffer();
+    GpuQueue*     FindGpuQueue(IDeviceContext* pContext);
+
+    static std::atomic<TimelineProfiler*> sm_pProfiler;
+
+    const std::chrono::steady_clock::time_point m_StartTime = std::chrono::steady_clock::now();
+    const std::string                           m_TracePath;
+    const Uint64                                m_Generation;
+
+    // Thread buffers are only added while the profiler exists, the mutex protects the list and the thread names
+    std::mutex                                 m_ThreadsMtx;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_Threads;
+    std::atomic<Uint64>                        m_NumDroppedEvents{0};
+
+    // GPU queues are used by the render thread only, the mutex synchronizes them with WriteTrace()
+    std::mutex                             m_GpuMtx;
+    RefCntAutoPtr<IRenderDevice>           m_pDevice;
+    std::vector<std::unique_ptr<GpuQueue>> m_GpuQueues;
+};
+
+} // namespace Diligent
@@ -52,6 +52,12 @@ public:
             InputControllerBase::ClearState();
         }
 
+        void SetState(const MouseState& Mouse, const INPUT_KEY_STATE_FLAGS* pKeys)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            InputControllerBase::SetState(Mouse, pKeys);
+        }
+
         void OnKeyDown(InputKeys Key)
         {
             std::lock_guard<std::mutex> lock(mtx);
@@ -124,6 +130,11 @@ public:
         m_SharedState->ClearState();
     }
 
+    void SetState(const MouseState& Mouse, const INPUT_KEY_STATE_FLAGS* pKeys)
+    {
+        m_SharedState->SetState(Mouse, pKeys);
+    }
+
 private:
     std::shared_ptr<SharedControllerState> m_SharedState{new SharedControllerState};
 };
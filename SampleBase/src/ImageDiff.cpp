@@ -0,0 +1,469 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "ImageDiff.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "SIMDSupport.hpp"
+
+#include "Errors.hpp"
+#include "TaskScheduler.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct RowDiff
+{
+    size_t NumDiffPixels = 0;
+    size_t NumBadPixels  = 0;
+    int    MaxDiff       = 0;
+
+    void operator+=(const RowDiff& rhs)
+    {
+        NumDiffPixels += rhs.NumDiffPixels;
+        NumBadPixels += rhs.NumBadPixels;
+        MaxDiff = std::max(MaxDiff, rhs.MaxDiff);
+    }
+};
+
+const Uint8* GetRow(const ImageDiffSource& Src, Uint32 Height, Uint32 Row)
+{
+    const size_t SrcRow = Src.FlipY ? Height - 1 - Row : Row;
+    return Src.pData + SrcRow * Src.Stride;
+}
+
+// Returns the row in RGBA order. If the source is not RGBA, the row is converted into the scratch buffer.
+const Uint8* GetRGBARow(const ImageDiffSource& Src, Uint32 Width, Uint32 Height, Uint32 Row, std::vector<Uint8>& Scratch)
+{
+    const Uint8* pRow = GetRow(Src, Height, Row);
+    if (Src.NumComponents == 4 && !Src.IsBGR)
+        return pRow;
+
+    Scratch.resize(size_t{Width} * 4);
+
+    const Uint32 NumComp = Src.NumComponents;
+    const Uint32 R       = Src.IsBGR ? 2 : 0;
+    const Uint32 B       = Src.IsBGR ? 0 : 2;
+    for (size_t x = 0; x < Width; ++x)
+    {
+        const Uint8* pSrc = pRow + x * NumComp;
+        Uint8*       pDst = &Scratch[x * 4];
+
+        pDst[0] = pSrc[R];
+        pDst[1] = pSrc[1];
+        pDst[2] = pSrc[B];
+        pDst[3] = 0;
+    }
+    return Scratch.data();
+}
+
+inline int GetPixelDiff(const Uint8* p1, const Uint8* p2)
+{
+    const auto DiffR = std::abs(int{p1[0]} - int{p2[0]});
+    const auto DiffG = std::abs(int{p1[1]} - int{p2[1]});
+    const auto DiffB = std::abs(int{p1[2]} - int{p2[2]});
+    return std::max(std::max(DiffR, DiffG), DiffB);
+}
+
+void DiffPixelsScalar(const Uint8* pRow1, const Uint8* pRow2, Uint32 Start, Uint32 End, int Tolerance, RowDiff& Diff)
+{
+    for (size_t x = Start; x < End; ++x)
+    {
+        const auto PixelDiff = GetPixelDiff(pRow1 + x * 4, pRow2 + x * 4);
+        if (PixelDiff > Tolerance)
+            ++Diff.NumBadPixels;
+        else if (PixelDiff != 0)
+            ++Diff.NumDiffPixels;
+        Diff.MaxDiff = std::max(Diff.MaxDiff, PixelDiff);
+    }
+}
+
+#if SAMPLES_USE_SSE2
+
+template <size_t N>
+Uint32 HorizontalSum(const Uint32 (&Lanes)[N])
+{
+    Uint32 Sum = 0;
+    for (auto Lane : Lanes)
+        Sum += Lane;
+    return Sum;
+}
+
+template <size_t N>
+int HorizontalMax(const Uint32 (&Lanes)[N])
+{
+    Uint32 Max = 0;
+    for (auto Lane : Lanes)
+        Max = std::max(Max, Lane);
+    return static_cast<int>(Max);
+}
+
+#endif
+
+#if SAMPLES_USE_AVX2
+
+// Processes 8 RGBA pixels per iteration
+void DiffRowRGBA(const Uint8* pRow1, const Uint8* pRow2, Uint32 Width, int Tolerance, RowDiff& Diff)
+{
+    const __m256i RGBMask  = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i ByteMask = _mm256_set1_epi32(0xFF);
+    const __m256i Tol      = _mm256_set1_epi32(Tolerance);
+    const __m256i Zero     = _mm256_setzero_si256();
+
+    __m256i NumBad  = Zero;
+    __m256i NumDiff = Zero;
+    __m256i MaxDiff = Zero;
+
+    Uint32 x = 0;
+    for (; x + 8 <= Width; x += 8)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRow1 + x * 4));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRow2 + x * 4));
+
+        // |a - b| for every channel, alpha is masked out
+        __m256i d = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+        d         = _mm256_and_si256(d, RGBMask);
+
+        // Maximum channel difference in the low byte of every pixel
+        __m256i m = _mm256_max_epu8(d, _mm256_srli_epi32(d, 8));
+        m         = _mm256_max_epu8(m, _mm256_srli_epi32(d, 16));
+        m         = _mm256_and_si256(m, ByteMask);
+
+        MaxDiff = _mm256_max_epi32(MaxDiff, m);
+
+        const __m256i IsBad  = _mm256_cmpgt_epi32(m, Tol);
+        const __m256i IsDiff = _mm256_andnot_si256(IsBad, _mm256_cmpgt_epi32(m, Zero));
+        // Comparison results are -1 for true
+        NumBad  = _mm256_sub_epi32(NumBad, IsBad);
+        NumDiff = _mm256_sub_epi32(NumDiff, IsDiff);
+    }
+
+    Uint32 Lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(Lanes), NumBad);
+    Diff.NumBadPixels += HorizontalSum(Lanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(Lanes), NumDiff);
+    Diff.NumDiffPixels += HorizontalSum(Lanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(Lanes), MaxDiff);
+    Diff.MaxDiff = std::max(Diff.MaxDiff, HorizontalMax(Lanes));
+
+    DiffPixelsScalar(pRow1, pRow2, x, Width, Tolerance, Diff);
+}
+
+#elif SAMPLES_USE_SSE2
+
+// Processes 4 RGBA pixels per iteration
+void DiffRowRGBA(const Uint8* pRow1, const Uint8* pRow2, Uint32 Width, int Tolerance, RowDiff& Diff)
+{
+    const __m128i RGBMask  = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i ByteMask = _mm_set1_epi32(0xFF);
+    const __m128i Tol      = _mm_set1_epi32(Tolerance);
+    const __m128i Zero     = _mm_setzero_si128();
+
+    __m128i NumBad  = Zero;
+    __m128i NumDiff = Zero;
+    __m128i MaxDiff = Zero;
+
+    Uint32 x = 0;
+    for (; x + 4 <= Width; x += 4)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 4));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow2 + x * 4));
+
+        // |a - b| for every channel, alpha is masked out
+        __m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        d         = _mm_and_si128(d, RGBMask);
+
+        // Maximum channel difference in the low byte of every pixel
+        __m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+        m         = _mm_max_epu8(m, _mm_srli_epi32(d, 16));
+        m         = _mm_and_si128(m, ByteMask);
+
+        // Only the low byte is non-zero, so byte-wise max is equivalent to 32-bit max
+        MaxDiff = _mm_max_epu8(MaxDiff, m);
+
+        const __m128i IsBad  = _mm_cmpgt_epi32(m, Tol);
+        const __m128i IsDiff = _mm_andnot_si128(IsBad, _mm_cmpgt_epi32(m, Zero));
+        // Comparison results are -1 for true
+        NumBad  = _mm_sub_epi32(NumBad, IsBad);
+        NumDiff = _mm_sub_epi32(NumDiff, IsDiff);
+    }
+
+    Uint32 Lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Lanes), NumBad);
+    Diff.NumBadPixels += HorizontalSum(Lanes);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Lanes), NumDiff);
+    Diff.NumDiffPixels += HorizontalSum(Lanes);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Lanes), MaxDiff);
+    Diff.MaxDiff = std::max(Diff.MaxDiff, HorizontalMax(Lanes));
+
+    DiffPixelsScalar(pRow1, pRow2, x, Width, Tolerance, Diff);
+}
+
+#elif SAMPLES_USE_NEON
+
+// Processes 16 RGBA pixels per iteration
+void DiffRowRGBA(const Uint8* pRow1, const Uint8* pRow2, Uint32 Width, int Tolerance, RowDiff& Diff)
+{
+    const uint8x16_t Tol = vdupq_n_u8(static_cast<Uint8>(std::min(std::max(Tolerance, 0), 255)));
+
+    uint16x8_t NumBad  = vdupq_n_u16(0);
+    uint16x8_t NumDiff = vdupq_n_u16(0);
+    uint8x16_t MaxDiff = vdupq_n_u8(0);
+
+    Uint32 x = 0;
+    for (; x + 16 <= Width; x += 16)
+    {
+        // De-interleave the channels
+        const uint8x16x4_t a = vld4q_u8(pRow1 + x * 4);
+        const uint8x16x4_t b = vld4q_u8(pRow2 + x * 4);
+
+        uint8x16_t d = vabdq_u8(a.val[0], b.val[0]);
+        d            = vmaxq_u8(d, vabdq_u8(a.val[1], b.val[1]));
+        d            = vmaxq_u8(d, vabdq_u8(a.val[2], b.val[2]));
+
+        MaxDiff = vmaxq_u8(MaxDiff, d);
+
+        const uint8x16_t IsBad  = vcgtq_u8(d, Tol);
+        const uint8x16_t IsDiff = vbicq_u8(vtstq_u8(d, d), IsBad);
+        // Every 16-bit lane accumulates at most 2 per iteration, which can't overflow for any realistic width
+        NumBad  = vpadalq_u8(NumBad, vshrq_n_u8(IsBad, 7));
+        NumDiff = vpadalq_u8(NumDiff, vshrq_n_u8(IsDiff, 7));
+    }
+
+    Uint16 Counts[8];
+    vst1q_u16(Counts, NumBad);
+    for (auto Count : Counts)
+        Diff.NumBadPixels += Count;
+    vst1q_u16(Counts, NumDiff);
+    for (auto Count : Counts)
+        Diff.NumDiffPixels += Count;
+
+    Uint8 MaxDiffs[16];
+    vst1q_u8(MaxDiffs, MaxDiff);
+    for (auto Max : MaxDiffs)
+        Diff.MaxDiff = std::max(Diff.MaxDiff, int{Max});
+
+    DiffPixelsScalar(pRow1, pRow2, x, Width, Tolerance, Diff);
+}
+
+#else
+
+void DiffRowRGBA(const Uint8* pRow1, const Uint8* pRow2, Uint32 Width, int Tolerance, RowDiff& Diff)
+{
+    DiffPixelsScalar(pRow1, pRow2, 0, Width, Tolerance, Diff);
+}
+
+#endif
+
+Uint32 GetNumThreads(const ImageDiffAttribs& Attribs)
+{
+    return Attribs.pScheduler != nullptr ? Attribs.pScheduler->GetNumThreads() : 1;
+}
+
+// Splits the items into a few chunks per thread so that the work is balanced
+// while every chunk is still large enough to amortize the scheduling cost.
+Uint32 GetGrainSize(Uint32 NumItems, Uint32 NumThreads, Uint32 MinGrainSize)
+{
+    return std::max(NumItems / (NumThreads * 4), MinGrainSize);
+}
+
+} // namespace
+
+void ComputeImageDiff(const ImageDiffAttribs& Attribs, ImageDiffInfo& Info)
+{
+    DEV_CHECK_ERR(Attribs.Image1.pData != nullptr && Attribs.Image2.pData != nullptr, "Image data must not be null");
+    DEV_CHECK_ERR((Attribs.Image1.NumComponents == 3 || Attribs.Image1.NumComponents == 4) &&
+                      (Attribs.Image2.NumComponents == 3 || Attribs.Image2.NumComponents == 4),
+                  "Only 3- and 4-component images are supported");
+
+    const Uint32 NumThreads = GetNumThreads(Attribs);
+
+    std::vector<RowDiff> ThreadDiffs(NumThreads);
+    ParallelFor(Attribs.pScheduler, 0, Attribs.Height, GetGrainSize(Attribs.Height, NumThreads, 16),
+                [&](Uint32 ThreadId, Uint32 StartRow, Uint32 EndRow) {
+                    std::vector<Uint8> Scratch1, Scratch2;
+
+                    RowDiff& Diff = ThreadDiffs[ThreadId];
+                    for (Uint32 row = StartRow; row < EndRow; ++row)
+                    {
+                        const Uint8* pRow1 = GetRGBARow(Attribs.Image1, Attribs.Width, Attribs.Height, row, Scratch1);
+                        const Uint8* pRow2 = GetRGBARow(Attribs.Image2, Attribs.Width, Attribs.Height, row, Scratch2);
+                        DiffRowRGBA(pRow1, pRow2, Attribs.Width, Attribs.Tolerance, Diff);
+                    }
+                });
+
+    RowDiff TotalDiff;
+    for (const auto& Diff : ThreadDiffs)
+        TotalDiff += Diff;
+
+    Info.NumDiffPixels = TotalDiff.NumDiffPixels;
+    Info.NumBadPixels  = TotalDiff.NumBadPixels;
+    Info.MaxDiff       = TotalDiff.MaxDiff;
+}
+
+void ComputeImageDiffQuality(const ImageDiffAttribs& Attribs, ImageDiffQuality& Quality, std::vector<Uint8>* pHeatMap)
+{
+    static constexpr Uint32 SSIMBlockSize = 8;
+
+    const Uint32 Width  = Attribs.Width;
+    const Uint32 Height = Attribs.Height;
+    if (Width == 0 || Height == 0)
+    {
+        Quality = {};
+        return;
+    }
+
+    if (pHeatMap != nullptr)
+        pHeatMap->resize(size_t{Width} * size_t{Height} * 4);
+
+    struct ThreadData
+    {
+        double SumSqError = 0;
+        double SumSSIM    = 0;
+        size_t NumBlocks  = 0;
+    };
+
+    const Uint32 NumBlockRows = (Height + SSIMBlockSize - 1) / SSIMBlockSize;
+    const Uint32 NumBlockCols = (Width + SSIMBlockSize - 1) / SSIMBlockSize;
+    const Uint32 NumThreads   = GetNumThreads(Attribs);
+
+    std::vector<ThreadData> Data(NumThreads);
+    ParallelFor(Attribs.pScheduler, 0, NumBlockRows, GetGrainSize(NumBlockRows, NumThreads, 4),
+                [&](Uint32 ThreadId, Uint32 StartBlockRow, Uint32 EndBlockRow) {
+                    std::vector<Uint8> Scratch1, Scratch2;
+
+                    // Per-block sums of luminance values, their squares and products
+                    struct BlockStats
+                    {
+                        double Sum1   = 0;
+                        double Sum2   = 0;
+                        double SumSq1 = 0;
+                        double SumSq2 = 0;
+                        double Sum12  = 0;
+                        Uint32 Count  = 0;
+                    };
+                    std::vector<BlockStats> Blocks(NumBlockCols);
+
+                    ThreadData& TD = Data[ThreadId];
+                    for (Uint32 BlockRow = StartBlockRow; BlockRow < EndBlockRow; ++BlockRow)
+                    {
+                        std::fill(Blocks.begin(), Blocks.end(), BlockStats{});
+
+                        const Uint32 EndRow = std::min((BlockRow + 1) * SSIMBlockSize, Height);
+                        for (Uint32 row = BlockRow * SSIMBlockSize; row < EndRow; ++row)
+                        {
+                            const Uint8* pRow1 = GetRGBARow(Attribs.Image1, Width, Height, row, Scratch1);
+                            const Uint8* pRow2 = GetRGBARow(Attribs.Image2, Width, Height, row, Scratch2);
+
+                            Uint8* pHeatMapRow = pHeatMap != nullptr ? &(*pHeatMap)[size_t{row} * Width * 4] : nullptr;
+                            for (Uint32 x = 0; x < Width; ++x)
+                            {
+                                const Uint8* p1 = pRow1 + x * 4;
+                                const Uint8* p2 = pRow2 + x * 4;
+                                for (Uint32 c = 0; c < 3; ++c)
+                                {
+                                    const int Err = int{p1[c]} - int{p2[c]};
+                                    TD.SumSqError += Err * Err;
+                                }
+
+                                const double Y1 = 0.299 * p1[0] + 0.587 * p1[1] + 0.114 * p1[2];
+                                const double Y2 = 0.299 * p2[0] + 0.587 * p2[1] + 0.114 * p2[2];
+
+                                BlockStats& Block = Blocks[x / SSIMBlockSize];
+                                Block.Sum1 += Y1;
+                                Block.Sum2 += Y2;
+                                Block.SumSq1 += Y1 * Y1;
+                                Block.SumSq2 += Y2 * Y2;
+                                Block.Sum12 += Y1 * Y2;
+                                ++Block.Count;
+
+                                if (pHeatMapRow != nullptr)
+                                {
+                                    Uint8*    pDst = pHeatMapRow + x * 4;
+                                    const int Diff = GetPixelDiff(p1, p2);
+                                    if (Diff == 0)
+                                    {
+                                        const auto Gray = static_cast<Uint8>(Y2 * 0.25);
+                                        pDst[0] = pDst[1] = pDst[2] = Gray;
+                                    }
+                                    else if (Diff <= Attribs.Tolerance)
+                                    {
+                                        pDst[0] = 255;
+                                        pDst[1] = 255;
+                                        pDst[2] = 0;
+                                    }
+                                    else
+                                    {
+                                        pDst[0] = static_cast<Uint8>(128 + Diff / 2);
+                                        pDst[1] = 0;
+                                        pDst[2] = 0;
+                                    }
+                                    pDst[3] = 255;
+                                }
+                            }
+                        }
+
+                        constexpr double C1 = (0.01 * 255) * (0.01 * 255);
+                        constexpr double C2 = (0.03 * 255) * (0.03 * 255);
+                        for (const auto& Block : Blocks)
+                        {
+                            const double N     = Block.Count;
+                            const double Mean1 = Block.Sum1 / N;
+                            const double Mean2 = Block.Sum2 / N;
+                            const double Var1  = std::max(Block.SumSq1 / N - Mean1 * Mean1, 0.0);
+                            const double Var2  = std::max(Block.SumSq2 / N - Mean2 * Mean2, 0.0);
+                            const double Cov   = Block.Sum12 / N - Mean1 * Mean2;
+
+                            TD.SumSSIM += ((2 * Mean1 * Mean2 + C1) * (2 * Cov + C2)) /
+                                ((Mean1 * Mean1 + Mean2 * Mean2 + C1) * (Var1 + Var2 + C2));
+                            ++TD.NumBlocks;
+                        }
+                    }
+                });
+
+    ThreadData Total;
+    for (const auto& TD : Data)
+    {
+        Total.SumSqError += TD.SumSqError;
+        Total.SumSSIM += TD.SumSSIM;
+        Total.NumBlocks += TD.NumBlocks;
+    }
+
+    const double MSE = Total.SumSqError / (static_cast<double>(Width) * static_cast<double>(Height) * 3.0);
+
+    Quality.PSNR = MSE > 0 ? 10.0 * std::log10(255.0 * 255.0 / MSE) : std::numeric_limits<double>::infinity();
+    Quality.SSIM = Total.NumBlocks > 0 ? Total.SumSSIM / static_cast<double>(Total.NumBlocks) : 1.0;
+}
+
+} // namespace Diligent
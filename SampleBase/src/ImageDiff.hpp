@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+class TaskScheduler;
+
+/// 8-bit-per-channel image that takes part in the comparison.
+struct ImageDiffSource
+{
+    const Uint8* pData = nullptr;
+
+    /// Row stride in bytes
+    size_t Stride = 0;
+
+    /// 3 (RGB) or 4 (RGBA) components. Alpha is ignored.
+    Uint32 NumComponents = 4;
+
+    /// Whether the red and blue channels are swapped (BGR/BGRA formats)
+    bool IsBGR = false;
+
+    /// Whether the rows are stored bottom to top (e.g. OpenGL captures)
+    bool FlipY = false;
+};
+
+struct ImageDiffAttribs
+{
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+
+    ImageDiffSource Image1;
+    ImageDiffSource Image2;
+
+    /// Maximum per-channel difference that is considered acceptable
+    int Tolerance = 0;
+
+    /// Optional scheduler to process the rows in parallel.
+    /// If null, the images are compared on the calling thread.
+    TaskScheduler* pScheduler = nullptr;
+};
+
+struct ImageDiffInfo
+{
+    /// Number of pixels that differ by no more than the tolerance
+    size_t NumDiffPixels = 0;
+
+    /// Number of pixels that differ by more than the tolerance
+    size_t NumBadPixels = 0;
+
+    /// Maximum per-channel difference
+    int MaxDiff = 0;
+};
+
+/// Compares two images using the fastest SIMD kernel available for the target
+/// (AVX2, SSE2, NEON, or scalar). The rows are processed in parallel if Attribs.pScheduler is set.
+void ComputeImageDiff(const ImageDiffAttribs& Attribs, ImageDiffInfo& Info);
+
+struct ImageDiffQuality
+{
+    /// Peak signal-to-noise ratio over RGB channels, in dB. Infinity if the images are identical.
+    double PSNR = 0;
+
+    /// Mean structural similarity of the luminance computed over 8x8 blocks.
+    double SSIM = 0;
+};
+
+/// Computes the image quality metrics and optionally the RGBA8 difference heat map
+/// (Width x Height, tightly packed). Image2 is treated as the reference image.
+///
+/// In the heat map, identical pixels show the dimmed reference image, pixels that differ
+/// within the tolerance are yellow, and pixels that exceed the tolerance are red with the
+/// intensity proportional to the difference.
+void ComputeImageDiffQuality(const ImageDiffAttribs& Attribs, ImageDiffQuality& Quality, std::vector<Uint8>* pHeatMap);
+
+} // namespace Diligent
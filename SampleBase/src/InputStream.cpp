@@ -0,0 +1,206 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "InputStream.hpp"
+
+#include <cstring>
+
+#include "FileWrapper.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 NumKeys = static_cast<Uint32>(InputKeys::TotalKeys);
+
+// Frame index, mouse position, wheel delta, button flags and key states
+constexpr size_t FrameRecordSize = sizeof(Uint32) + sizeof(Float32) * 3 + sizeof(Uint8) + NumKeys;
+
+template <typename T>
+void WriteValue(std::vector<Uint8>& Data, const T& Value)
+{
+    const auto Offset = Data.size();
+    Data.resize(Offset + sizeof(T));
+    memcpy(&Data[Offset], &Value, sizeof(T));
+}
+
+template <typename T>
+T ReadValue(const Uint8*& pData)
+{
+    T Value;
+    memcpy(&Value, pData, sizeof(T));
+    pData += sizeof(T);
+    return Value;
+}
+
+void ReadControllerState(InputController& Controller, InputStreamFrame& State)
+{
+    State.Mouse = Controller.GetMouseState();
+    for (Uint32 i = 0; i < NumKeys; ++i)
+        State.Keys[i] = Controller.GetKeyState(static_cast<InputKeys>(i));
+}
+
+// Emulates InputControllerBase::ClearState() that is called at the end of every frame
+void ClearFrameState(InputStreamFrame& State)
+{
+    State.Mouse.WheelDelta = 0;
+    for (auto& Key : State.Keys)
+        Key &= ~INPUT_KEY_STATE_FLAG_KEY_WAS_DOWN;
+}
+
+bool operator==(const InputStreamFrame& lhs, const InputStreamFrame& rhs)
+{
+    // clang-format off
+    return lhs.Mouse.PosX        == rhs.Mouse.PosX        &&
+           lhs.Mouse.PosY        == rhs.Mouse.PosY        &&
+           lhs.Mouse.WheelDelta  == rhs.Mouse.WheelDelta  &&
+           lhs.Mouse.ButtonFlags == rhs.Mouse.ButtonFlags &&
+           memcmp(lhs.Keys, rhs.Keys, sizeof(lhs.Keys)) == 0;
+    // clang-format on
+}
+
+} // namespace
+
+InputStreamRecorder::InputStreamRecorder(std::string FilePath, const InputStreamHeader& Header) :
+    m_FilePath{std::move(FilePath)}
+{
+    WriteValue(m_Data, Uint32{InputStreamHeader::Magic});
+    WriteValue(m_Data, Uint32{InputStreamHeader::Version});
+    WriteValue(m_Data, NumKeys);
+    WriteValue(m_Data, Header.RandomSeed);
+    WriteValue(m_Data, Header.FixedTimeStep);
+}
+
+InputStreamRecorder::~InputStreamRecorder()
+{
+    if (!m_IsSaved)
+        Save();
+}
+
+void InputStreamRecorder::RecordFrame(Uint32 FrameIndex, InputController& Controller)
+{
+    InputStreamFrame State;
+    ReadControllerState(Controller, State);
+
+    // Always record the first frame
+    if (m_NumRecords == 0 || !(State == m_ExpectedState))
+    {
+        WriteValue(m_Data, FrameIndex);
+        WriteValue(m_Data, State.Mouse.PosX);
+        WriteValue(m_Data, State.Mouse.PosY);
+        WriteValue(m_Data, State.Mouse.WheelDelta);
+        WriteValue(m_Data, static_cast<Uint8>(State.Mouse.ButtonFlags));
+        for (auto Key : State.Keys)
+            WriteValue(m_Data, static_cast<Uint8>(Key));
+        ++m_NumRecords;
+    }
+
+    m_ExpectedState = State;
+    ClearFrameState(m_ExpectedState);
+}
+
+bool InputStreamRecorder::Save()
+{
+    m_IsSaved = true;
+
+    FileWrapper pFile{m_FilePath.c_str(), EFileAccessMode::Overwrite};
+    if (!pFile || !pFile->Write(m_Data.data(), m_Data.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write input stream to file '", m_FilePath, "'.");
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("Recorded ", m_NumRecords, " input frames to '", m_FilePath, "' (", m_Data.size(), " bytes).");
+    return true;
+}
+
+
+InputStreamPlayer::InputStreamPlayer(const char* FilePath)
+{
+    FileWrapper pFile{FilePath};
+    if (!pFile)
+        LOG_ERROR_AND_THROW("Failed to open input stream file '", FilePath, "'.");
+
+    std::vector<Uint8> Data(pFile->GetSize());
+    if (!pFile->Read(Data.data(), Data.size()))
+        LOG_ERROR_AND_THROW("Failed to read input stream file '", FilePath, "'.");
+
+    constexpr size_t HeaderSize = sizeof(Uint32) * 4 + sizeof(double);
+    if (Data.size() < HeaderSize)
+        LOG_ERROR_AND_THROW("Input stream file '", FilePath, "' is too small.");
+
+    const Uint8* pData       = Data.data();
+    const Uint8* pEnd        = pData + Data.size();
+    const auto   Magic       = ReadValue<Uint32>(pData);
+    const auto   Version     = ReadValue<Uint32>(pData);
+    const auto   FileNumKeys = ReadValue<Uint32>(pData);
+    if (Magic != InputStreamHeader::Magic)
+        LOG_ERROR_AND_THROW("'", FilePath, "' is not a valid input stream file.");
+    if (Version != InputStreamHeader::Version)
+        LOG_ERROR_AND_THROW("Input stream version ", Version, " is not supported. Expected version: ", Uint32{InputStreamHeader::Version}, ".");
+    if (FileNumKeys != NumKeys)
+        LOG_ERROR_AND_THROW("Input stream has been recorded with ", FileNumKeys, " keys, while ", NumKeys, " are expected.");
+
+    m_Header.RandomSeed    = ReadValue<Uint32>(pData);
+    m_Header.FixedTimeStep = ReadValue<double>(pData);
+
+    if ((pEnd - pData) % FrameRecordSize != 0)
+        LOG_ERROR_AND_THROW("Input stream file '", FilePath, "' is corrupted.");
+
+    m_Records.resize((pEnd - pData) / FrameRecordSize);
+    for (auto& Record : m_Records)
+    {
+        Record.FrameIndex        = ReadValue<Uint32>(pData);
+        Record.Mouse.PosX        = ReadValue<Float32>(pData);
+        Record.Mouse.PosY        = ReadValue<Float32>(pData);
+        Record.Mouse.WheelDelta  = ReadValue<Float32>(pData);
+        Record.Mouse.ButtonFlags = static_cast<MouseState::BUTTON_FLAGS>(ReadValue<Uint8>(pData));
+        for (auto& Key : Record.Keys)
+            Key = static_cast<INPUT_KEY_STATE_FLAGS>(ReadValue<Uint8>(pData));
+    }
+    VERIFY_EXPR(pData == pEnd);
+
+    LOG_INFO_MESSAGE("Loaded ", m_Records.size(), " input frames from '", FilePath, "'.");
+}
+
+void InputStreamPlayer::PlayFrame(Uint32 FrameIndex, InputController& Controller)
+{
+    if (m_NextRecord < m_Records.size() && m_Records[m_NextRecord].FrameIndex <= FrameIndex)
+    {
+        VERIFY(m_Records[m_NextRecord].FrameIndex == FrameIndex, "Input stream frame ", m_Records[m_NextRecord].FrameIndex, " has been skipped");
+        m_State = m_Records[m_NextRecord++];
+    }
+
+    Controller.SetState(m_State.Mouse, m_State.Keys);
+    ClearFrameState(m_State);
+}
+
+} // namespace Diligent
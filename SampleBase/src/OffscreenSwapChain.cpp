@@ -0,0 +1,177 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "OffscreenSwapChain.hpp"
+
+#include "SwapChainBase.hpp"
+#include "RefCountedObjectImpl.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "Fence.h"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+class OffscreenSwapChain final : public SwapChainBase<ISwapChain>
+{
+public:
+    using TBase = SwapChainBase<ISwapChain>;
+
+    OffscreenSwapChain(IReferenceCounters*  pRefCounters,
+                       IRenderDevice*       pDevice,
+                       IDeviceContext*      pContext,
+                       const SwapChainDesc& SCDesc) :
+        TBase{pRefCounters, pDevice, pContext, SCDesc}
+    {
+        if (m_SwapChainDesc.PreTransform == SURFACE_TRANSFORM_OPTIMAL)
+            m_SwapChainDesc.PreTransform = SURFACE_TRANSFORM_IDENTITY;
+        m_SwapChainDesc.BufferCount = std::max(m_SwapChainDesc.BufferCount, 1u);
+
+        FenceDesc Desc;
+        Desc.Name = "Offscreen swap chain frame fence";
+        pDevice->CreateFence(Desc, &m_pFrameFence);
+        VERIFY_EXPR(m_pFrameFence);
+
+        CreateBuffers();
+    }
+
+    virtual void DILIGENT_CALL_TYPE Present(Uint32 SyncInterval) override final
+    {
+        auto pContext = m_wpDeviceContext.Lock();
+        if (!pContext)
+        {
+            LOG_ERROR_MESSAGE("Immediate context has been released");
+            return;
+        }
+
+        ++m_FrameNumber;
+        pContext->EnqueueSignal(m_pFrameFence, m_FrameNumber);
+        pContext->Flush();
+        pContext->FinishFrame();
+
+        // Do not let the CPU run more than BufferCount frames ahead of the GPU,
+        // which is what a real swap chain would do.
+        if (m_FrameNumber > m_SwapChainDesc.BufferCount)
+            m_pFrameFence->Wait(m_FrameNumber - m_SwapChainDesc.BufferCount);
+    }
+
+    virtual void DILIGENT_CALL_TYPE Resize(Uint32 NewWidth, Uint32 NewHeight, SURFACE_TRANSFORM NewPreTransform) override final
+    {
+        if (TBase::Resize(NewWidth, NewHeight, NewPreTransform))
+        {
+            if (auto pContext = m_wpDeviceContext.Lock())
+            {
+                // Make sure the old buffers are not in use
+                pContext->Flush();
+                m_pFrameFence->Wait(m_FrameNumber);
+            }
+            CreateBuffers();
+        }
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetFullscreenMode(const DisplayModeAttribs& DisplayMode) override final
+    {
+        LOG_WARNING_MESSAGE("Full screen mode is not supported by the offscreen swap chain");
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetWindowedMode() override final
+    {
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetMaximumFrameLatency(Uint32 MaxLatency) override final
+    {
+        m_SwapChainDesc.BufferCount = std::max(MaxLatency, 1u);
+    }
+
+    virtual ITextureView* DILIGENT_CALL_TYPE GetCurrentBackBufferRTV() override final { return m_pRTV; }
+    virtual ITextureView* DILIGENT_CALL_TYPE GetDepthBufferDSV() override final { return m_pDSV; }
+
+private:
+    void CreateBuffers()
+    {
+        m_pRTV.Release();
+        m_pDSV.Release();
+
+        if (m_SwapChainDesc.Width == 0 || m_SwapChainDesc.Height == 0)
+            return;
+
+        TextureDesc TexDesc;
+        TexDesc.Name      = "Offscreen back buffer";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Width     = m_SwapChainDesc.Width;
+        TexDesc.Height    = m_SwapChainDesc.Height;
+        TexDesc.Format    = m_SwapChainDesc.ColorBufferFormat;
+        TexDesc.BindFlags = BIND_RENDER_TARGET;
+        if (m_SwapChainDesc.Usage & SWAP_CHAIN_USAGE_SHADER_RESOURCE)
+            TexDesc.BindFlags |= BIND_SHADER_RESOURCE;
+
+        RefCntAutoPtr<ITexture> pBackBuffer;
+        m_pRenderDevice->CreateTexture(TexDesc, nullptr, &pBackBuffer);
+        if (!pBackBuffer)
+            LOG_ERROR_AND_THROW("Failed to create offscreen back buffer");
+        m_pRTV = pBackBuffer->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+
+        if (m_SwapChainDesc.DepthBufferFormat != TEX_FORMAT_UNKNOWN)
+        {
+            TexDesc.Name      = "Offscreen depth buffer";
+            TexDesc.Format    = m_SwapChainDesc.DepthBufferFormat;
+            TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+
+            RefCntAutoPtr<ITexture> pDepthBuffer;
+            m_pRenderDevice->CreateTexture(TexDesc, nullptr, &pDepthBuffer);
+            if (!pDepthBuffer)
+                LOG_ERROR_AND_THROW("Failed to create offscreen depth buffer");
+            m_pDSV = pDepthBuffer->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+        }
+    }
+
+    RefCntAutoPtr<IFence>       m_pFrameFence;
+    Uint64                      m_FrameNumber = 0;
+    RefCntAutoPtr<ITextureView> m_pRTV;
+    RefCntAutoPtr<ITextureView> m_pDSV;
+};
+
+} // namespace
+
+void CreateOffscreenSwapChain(IRenderDevice*       pDevice,
+                              IDeviceContext*      pContext,
+                              const SwapChainDesc& SCDesc,
+                              ISwapChain**         ppSwapChain)
+{
+    DEV_CHECK_ERR(pDevice != nullptr && pContext != nullptr, "Device and context must not be null");
+    DEV_CHECK_ERR(ppSwapChain != nullptr && *ppSwapChain == nullptr, "ppSwapChain must not be null and must point to null");
+
+    RefCntAutoPtr<ISwapChain> pSwapChain{MakeNewRCObj<OffscreenSwapChain>()(pDevice, pContext, SCDesc)};
+    *ppSwapChain = pSwapChain.Detach();
+}
+
+} // namespace Diligent
@@ -0,0 +1,161 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "RawVideoWriter.hpp"
+
+#include <cstring>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+RawVideoWriter::RawVideoWriter(const char* FilePath, bool UseDeltaCompression, Uint32 KeyFrameInterval) :
+    m_FilePath{FilePath},
+    m_File{FilePath, EFileAccessMode::Overwrite},
+    m_UseDeltaCompression{UseDeltaCompression},
+    m_KeyFrameInterval{KeyFrameInterval}
+{
+    if (!m_File)
+        LOG_ERROR_AND_THROW("Failed to create raw video file '", FilePath, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
+}
+
+bool RawVideoWriter::WriteHeader(Uint32 Width, Uint32 Height, TEXTURE_FORMAT Format, bool FlipY)
+{
+    m_Header.Width  = Width;
+    m_Header.Height = Height;
+    m_Header.Format = Format;
+    m_Header.Flags  = RawVideoHeader::FLAG_NONE;
+    if (FlipY)
+        m_Header.Flags |= RawVideoHeader::FLAG_FLIPY;
+    if (m_UseDeltaCompression)
+        m_Header.Flags |= RawVideoHeader::FLAG_DELTA;
+
+    const Uint32 Magic   = RawVideoHeader::Magic;
+    const Uint32 Version = RawVideoHeader::Version;
+    return (m_File->Write(&Magic, sizeof(Magic)) &&
+            m_File->Write(&Version, sizeof(Version)) &&
+            m_File->Write(&m_Header, sizeof(m_Header)));
+}
+
+namespace
+{
+
+// Encodes Curr XOR Prev as a sequence of (NumZeroWords, NumLiteralWords, Literals...) records.
+// Returns false as soon as the encoded data becomes larger than MaxWords.
+bool EncodeDeltaRLE(const Uint32* pCurr, const Uint32* pPrev, size_t NumWords, size_t MaxWords, std::vector<Uint32>& EncodedData)
+{
+    EncodedData.clear();
+
+    size_t i = 0;
+    while (i < NumWords)
+    {
+        const size_t ZeroStart = i;
+        // Skip unchanged blocks quickly; most of the frame is typically the same
+        constexpr size_t BlockSize = 16;
+        while (i + BlockSize <= NumWords && memcmp(pCurr + i, pPrev + i, BlockSize * sizeof(Uint32)) == 0)
+            i += BlockSize;
+        while (i < NumWords && pCurr[i] == pPrev[i])
+            ++i;
+        const size_t NumZeros = i - ZeroStart;
+
+        // Do not break literal runs on single unchanged words as this costs two extra words
+        const size_t LiteralStart = i;
+        while (i < NumWords && !(pCurr[i] == pPrev[i] && (i + 1 == NumWords || pCurr[i + 1] == pPrev[i + 1])))
+            ++i;
+        const size_t NumLiterals = i - LiteralStart;
+
+        if (EncodedData.size() + 2 + NumLiterals > MaxWords)
+            return false;
+
+        EncodedData.push_back(static_cast<Uint32>(NumZeros));
+        EncodedData.push_back(static_cast<Uint32>(NumLiterals));
+        for (size_t j = LiteralStart; j < i; ++j)
+            EncodedData.push_back(pCurr[j] ^ pPrev[j]);
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool RawVideoWriter::WriteFrame(Uint32                    FrameId,
+                                Uint32                    Width,
+                                Uint32                    Height,
+                                TEXTURE_FORMAT            Format,
+                                bool                      FlipY,
+                                const std::vector<Uint8>& Pixels)
+{
+    if (!m_HeaderWritten)
+    {
+        if (!WriteHeader(Width, Height, Format, FlipY))
+            return false;
+        m_HeaderWritten = true;
+    }
+    else if (m_Header.Width != Width || m_Header.Height != Height || m_Header.Format != static_cast<Uint32>(Format))
+    {
+        LOG_ERROR_MESSAGE("Frame ", FrameId, " size or format does not match the first frame in raw video file '", m_FilePath,
+                          "'. Frames of different sizes can't be stored in the same file.");
+        return false;
+    }
+
+    RawVideoFrameHeader FrameHeader;
+    FrameHeader.FrameId     = FrameId;
+    FrameHeader.Encoding    = RawVideoFrameHeader::ENCODING_RAW;
+    FrameHeader.PayloadSize = static_cast<Uint32>(Pixels.size());
+
+    const void* pPayload = Pixels.data();
+
+    const bool IsKeyFrame = m_KeyFrameInterval == 0 || (m_NumFrames % m_KeyFrameInterval) == 0;
+    if (m_UseDeltaCompression && !IsKeyFrame && m_PrevFrame.size() == Pixels.size() && (Pixels.size() % sizeof(Uint32)) == 0)
+    {
+        const size_t NumWords = Pixels.size() / sizeof(Uint32);
+        if (EncodeDeltaRLE(reinterpret_cast<const Uint32*>(Pixels.data()), reinterpret_cast<const Uint32*>(m_PrevFrame.data()),
+                           NumWords, NumWords, m_EncodedData))
+        {
+            FrameHeader.Encoding    = RawVideoFrameHeader::ENCODING_DELTA_RLE;
+            FrameHeader.PayloadSize = static_cast<Uint32>(m_EncodedData.size() * sizeof(Uint32));
+            pPayload                = m_EncodedData.data();
+        }
+    }
+
+    if (!m_File->Write(&FrameHeader, sizeof(FrameHeader)) ||
+        (FrameHeader.PayloadSize > 0 && !m_File->Write(pPayload, FrameHeader.PayloadSize)))
+    {
+        LOG_ERROR_MESSAGE("Failed to write frame ", FrameId, " to raw video file '", m_FilePath, "'.");
+        return false;
+    }
+
+    if (m_UseDeltaCompression)
+        m_PrevFrame = Pixels;
+    ++m_NumFrames;
+
+    return true;
+}
+
+} // namespace Diligent
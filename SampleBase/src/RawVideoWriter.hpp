@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "GraphicsTypes.h"
+#include "FileWrapper.hpp"
+
+namespace Diligent
+{
+
+/// Writes captured frames into a single raw video file.
+
+/// The file starts with a RawVideoHeader followed by the frames. Every frame starts
+/// with a RawVideoFrameHeader followed by PayloadSize bytes of data. The pixels of
+/// each frame are tightly packed rows in the texture format given by the file header.
+///
+/// When delta compression is enabled, every frame except the key frames is stored
+/// as the XOR of its 32-bit words with the previous frame, run-length encoded as a
+/// sequence of (Uint32 NumZeroWords, Uint32 NumLiteralWords, NumLiteralWords x Uint32)
+/// records. Frames that would not get smaller are stored uncompressed.
+struct RawVideoHeader
+{
+    static constexpr Uint32 Magic   = 0x56524744; // 'DGRV'
+    static constexpr Uint32 Version = 1;
+
+    enum FLAGS : Uint32
+    {
+        FLAG_NONE  = 0u,
+        FLAG_FLIPY = 1u << 0u, // Rows are stored bottom to top
+        FLAG_DELTA = 1u << 1u, // Frames may be delta-compressed
+    };
+
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+    Uint32 Format = TEX_FORMAT_UNKNOWN; // TEXTURE_FORMAT
+    Uint32 Flags  = FLAG_NONE;
+};
+
+struct RawVideoFrameHeader
+{
+    enum ENCODING : Uint32
+    {
+        ENCODING_RAW       = 0,
+        ENCODING_DELTA_RLE = 1
+    };
+
+    Uint32 FrameId     = 0;
+    Uint32 Encoding    = ENCODING_RAW;
+    Uint32 PayloadSize = 0;
+};
+
+class RawVideoWriter
+{
+public:
+    /// Creates the file. Throws an exception if the file can't be created.
+    ///
+    /// KeyFrameInterval - the number of frames between the frames that are always
+    ///                    stored uncompressed, so that a reader can seek to them.
+    RawVideoWriter(const char* FilePath, bool UseDeltaCompression, Uint32 KeyFrameInterval = 60);
+
+    /// Writes the frame. All frames must have the same size and format.
+    /// Returns false if the file could not be written.
+    bool WriteFrame(Uint32                    FrameId,
+                    Uint32                    Width,
+                    Uint32                    Height,
+                    TEXTURE_FORMAT            Format,
+                    bool                      FlipY,
+                    const std::vector<Uint8>& Pixels);
+
+    const std::string& GetFilePath() const { return m_FilePath; }
+
+private:
+    bool WriteHeader(Uint32 Width, Uint32 Height, TEXTURE_FORMAT Format, bool FlipY);
+
+    const std::string m_FilePath;
+    FileWrapper       m_File;
+
+    const bool   m_UseDeltaCompression;
+    const Uint32 m_KeyFrameInterval;
+
+    RawVideoHeader m_Header;
+    bool           m_HeaderWritten = false;
+    Uint32         m_NumFrames     = 0;
+
+    std::vector<Uint8>  m_PrevFrame;
+    std::vector<Uint32> m_EncodedData;
+};
+
+} // namespace Diligent
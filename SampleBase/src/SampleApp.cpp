@@ -29,6 +29,8 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
+#include <thread>
 
 #include "PlatformDefinitions.h"
 #include "SampleApp.hpp"
@@ -39,6 +41,11 @@
 #include "FileWrapper.hpp"
 #include "CommandLineParser.hpp"
 #include "GraphicsAccessories.hpp"
+#include "Timer.hpp"
+#include "OffscreenSwapChain.hpp"
+#include "ImageDiff.hpp"
+#include "TaskScheduler.hpp"
+#include "ScreenCaptureEncoder.hpp"
 
 #if D3D11_SUPPORTED
 #    include "EngineFactoryD3D11.h"
@@ -84,9 +91,22 @@ SampleApp::SampleApp() :
 
 SampleApp::~SampleApp()
 {
+    // Wait for all pending screen captures to be written
+    m_pCaptureEncoder.reset();
+
     m_pImGui.reset();
     m_TheSample.reset();
 
+    if (m_pProfiler)
+    {
+        // Wait for the GPU to make all timestamp queries available
+        for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
+            m_pDeviceContexts[q]->WaitForIdle();
+        m_pProfiler->EndFrame();
+        m_pProfiler->WriteTrace();
+        m_pProfiler.reset();
+    }
+
     if (!m_pDeviceContexts.empty())
     {
         for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
@@ -520,10 +540,54 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
             m_ScreenCaptureInfo.FramesToCapture = 1;
         }
 
+        if (m_ScreenCaptureInfo.RawVideo && m_GoldenImgMode != GoldenImageMode::None)
+        {
+            LOG_WARNING_MESSAGE("Raw video capture is not supported in golden image modes. Falling back to png.");
+            m_ScreenCaptureInfo.RawVideo   = false;
+            m_ScreenCaptureInfo.FileFormat = IMAGE_FILE_FORMAT_PNG;
+        }
+
         m_pScreenCapture.reset(new ScreenCapture(m_pDevice));
+
+        if (m_ScreenCaptureInfo.RawVideo)
+        {
+            std::string FilePath = m_ScreenCaptureInfo.Directory;
+            if (!FilePath.empty() && FilePath.back() != '/')
+                FilePath.push_back('/');
+            FilePath += m_ScreenCaptureInfo.FileName;
+            FilePath += ".raw";
+
+            try
+            {
+                std::unique_ptr<RawVideoWriter> pVideoWriter{new RawVideoWriter{FilePath.c_str(), m_ScreenCaptureInfo.RawVideoDelta}};
+                // Frames are copied into the queue, so a few frames of latency are enough to hide the disk stalls
+                m_pCaptureEncoder.reset(new ScreenCaptureEncoder{std::move(pVideoWriter), 4});
+            }
+            catch (...)
+            {
+                m_pScreenCapture.reset();
+                m_ExitCode = 6;
+            }
+            return;
+        }
+
+        Uint32 NumThreads = m_ScreenCaptureInfo.NumEncoderThreads;
+        if (NumThreads == 0)
+            NumThreads = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), 4u);
+        // Allow two frames per thread to be in flight before Present() blocks
+        m_pCaptureEncoder.reset(new ScreenCaptureEncoder{NumThreads, NumThreads * 2});
     }
 }
 
+int SampleApp::GetExitCode() const
+{
+    // Does not wait for the encoder: Present() flushes it once the last requested
+    // frame has been queued, so that write errors are reported before the exit.
+    if (m_ExitCode == 0 && m_pCaptureEncoder)
+        return m_pCaptureEncoder->GetErrorCode();
+    return m_ExitCode;
+}
+
 void SampleApp::InitializeSample()
 {
 #if PLATFORM_WIN32
@@ -563,6 +627,10 @@ void SampleApp::InitializeSample()
     InitInfo.NumDeferredCtx = static_cast<Uint32>(m_pDeviceContexts.size()) - m_NumImmediateContexts;
     InitInfo.pSwapChain     = m_pSwapChain;
     InitInfo.pImGui         = m_pImGui.get();
+    InitInfo.RandomSeed     = m_RandomSeed;
+    if (m_pProfiler)
+        m_pProfiler->InitializeGpuQueries(m_pDevice);
+
     m_TheSample->Initialize(InitInfo);
 
     m_TheSample->WindowResize(SCDesc.Width, SCDesc.Height);
@@ -631,6 +699,12 @@ void SampleApp::UpdateAdaptersDialog()
 
         ImGui::Checkbox("VSync", &m_bVSync);
 
+        if (m_pProfiler)
+        {
+            if (ImGui::Button("Save trace"))
+                m_pProfiler->WriteTrace();
+        }
+
         if (m_pDevice->GetDeviceInfo().IsD3DDevice())
         {
             // clang-format off
@@ -783,18 +857,38 @@ SampleApp::CommandLineStatus SampleApp::ProcessCommandLine(int argc, const char*
     ArgsParser.Parse("capture_fps", m_ScreenCaptureInfo.CaptureFPS);
     ArgsParser.Parse("capture_frames", m_ScreenCaptureInfo.FramesToCapture);
 
-    {
-        const std::vector<std::pair<const char*, IMAGE_FILE_FORMAT>> FileFmtEnumVals =
-            {
-                {"jpeg", IMAGE_FILE_FORMAT_JPEG},
-                {"jpg", IMAGE_FILE_FORMAT_JPEG},
-                {"png", IMAGE_FILE_FORMAT_PNG} //
-            };
-        ArgsParser.ParseEnum("capture_format", '\0', FileFmtEnumVals, m_ScreenCaptureInfo.FileFormat);
-    }
+    ArgsParser.Parse("capture_format", '\0',
+                     [&](const char* ArgVal) {
+                         m_ScreenCaptureInfo.RawVideo      = false;
+                         m_ScreenCaptureInfo.RawVideoDelta = false;
+                         if (StrCmpNoCase(ArgVal, "jpeg") == 0 || StrCmpNoCase(ArgVal, "jpg") == 0)
+                         {
+                             m_ScreenCaptureInfo.FileFormat = IMAGE_FILE_FORMAT_JPEG;
+                         }
+                         else if (StrCmpNoCase(ArgVal, "png") == 0)
+                         {
+                             m_ScreenCaptureInfo.FileFormat = IMAGE_FILE_FORMAT_PNG;
+                         }
+                         else if (StrCmpNoCase(ArgVal, "raw") == 0)
+                         {
+                             m_ScreenCaptureInfo.RawVideo = true;
+                         }
+                         else if (StrCmpNoCase(ArgVal, "raw_delta") == 0)
+                         {
+                             m_ScreenCaptureInfo.RawVideo      = true;
+                             m_ScreenCaptureInfo.RawVideoDelta = true;
+                         }
+                         else
+                         {
+                             LOG_ERROR_MESSAGE("Unknown capture format: '", ArgVal, "'. Allowed values: jpg, jpeg, png, raw, raw_delta");
+                             return false;
+                         }
+                         return true;
+                     });
 
     ArgsParser.Parse("capture_quality", m_ScreenCaptureInfo.JpegQuality);
     ArgsParser.Parse("capture_alpha", m_ScreenCaptureInfo.KeepAlpha);
+    ArgsParser.Parse("capture_threads", m_ScreenCaptureInfo.NumEncoderThreads);
     ArgsParser.Parse("width", 'w', m_InitialWindowWidth);
     ArgsParser.Parse("height", 'h', m_InitialWindowHeight);
     ArgsParser.Parse("validation", m_ValidationLevel);
@@ -833,6 +927,82 @@ SampleApp::CommandLineStatus SampleApp::ProcessCommandLine(int argc, const char*
     ArgsParser.Parse("non_separable_progs", m_bForceNonSeprblProgs);
     ArgsParser.Parse("break_on_error", m_bBreakOnError);
 
+    ArgsParser.Parse("headless", m_BenchmarkInfo.Headless);
+    if (ArgsParser.Parse("bench_frames", m_BenchmarkInfo.NumFrames))
+        m_BenchmarkInfo.Headless = true;
+    ArgsParser.Parse("bench_warmup", m_BenchmarkInfo.NumWarmupFrames);
+    ArgsParser.Parse("bench_output", m_BenchmarkInfo.OutputFile);
+    if (ArgsParser.Parse("bench_scaling", m_BenchmarkInfo.Scaling) && m_BenchmarkInfo.Scaling)
+        m_BenchmarkInfo.Headless = true;
+    ArgsParser.Parse("bench_params", m_BenchmarkInfo.ScalingParams);
+
+    const bool FixedTimeStepSpecified = ArgsParser.Parse("fixed_dt", m_FixedTimeStep);
+    const bool RandomSeedSpecified    = ArgsParser.Parse("seed", m_RandomSeed);
+    if (m_FixedTimeStep < 0)
+    {
+        LOG_ERROR_MESSAGE("Fixed time step (", m_FixedTimeStep, ") must not be negative");
+        return CommandLineStatus::Error;
+    }
+
+    {
+        std::string ReplayInputPath;
+        if (ArgsParser.Parse("replay_input", ReplayInputPath))
+        {
+            try
+            {
+                m_pInputPlayer = std::make_unique<InputStreamPlayer>(ReplayInputPath.c_str());
+            }
+            catch (...)
+            {
+                return CommandLineStatus::Error;
+            }
+
+            // Use the recorded settings unless they are explicitly overridden
+            const auto& Header = m_pInputPlayer->GetHeader();
+            if (!FixedTimeStepSpecified)
+                m_FixedTimeStep = Header.FixedTimeStep;
+            if (!RandomSeedSpecified)
+                m_RandomSeed = Header.RandomSeed;
+        }
+    }
+
+    {
+        std::string RecordInputPath;
+        if (ArgsParser.Parse("record_input", RecordInputPath))
+        {
+            if (m_pInputPlayer)
+            {
+                LOG_ERROR_MESSAGE("Input can't be recorded and replayed at the same time");
+                return CommandLineStatus::Error;
+            }
+
+            InputStreamHeader Header;
+            Header.RandomSeed    = m_RandomSeed;
+            Header.FixedTimeStep = m_FixedTimeStep;
+            m_pInputRecorder     = std::make_unique<InputStreamRecorder>(std::move(RecordInputPath), Header);
+        }
+    }
+
+    {
+        std::string TracePath;
+        if (ArgsParser.Parse("trace", TracePath))
+        {
+            try
+            {
+                m_pProfiler = std::make_unique<TimelineProfiler>(std::move(TracePath));
+            }
+            catch (...)
+            {
+                return CommandLineStatus::Error;
+            }
+            m_pProfiler->SetThreadName("Main thread");
+        }
+    }
+
+    if ((m_pInputPlayer || m_pInputRecorder) && m_FixedTimeStep == 0)
+    {
+        LOG_WARNING_MESSAGE("Input is recorded or replayed with the wall-clock time step. Use --fixed_dt to make the replay deterministic.");
+    }
 
     if (m_DeviceType == RENDER_DEVICE_TYPE_UNDEFINED)
     {
@@ -853,7 +1023,597 @@ SampleApp::CommandLineStatus SampleApp::ProcessCommandLine(int argc, const char*
         }
     }
 
-    return m_TheSample->ProcessCommandLine(ArgsParser.ArgC(), ArgsParser.ArgV());
+    const auto SampleCmdLineStatus = m_TheSample->ProcessCommandLine(ArgsParser.ArgC(), ArgsParser.ArgV());
+    if (SampleCmdLineStatus != CommandLineStatus::OK || !m_BenchmarkInfo.Headless)
+        return SampleCmdLineStatus;
+
+    return RunHeadlessBenchmark();
+}
+
+// Command line example to run the headless benchmark:
+//
+//     --mode vk --adapter sw --headless 1 --bench_frames 500 --bench_warmup 20 --fixed_dt 0.01 --bench_output Tutorial01.csv -w 1024 -h 768
+//
+// The application does not create a window in this mode: the benchmark runs from ProcessCommandLine() and
+// the method returns CommandLineStatus::Help to make the native application exit once it is done.
+SampleApp::CommandLineStatus SampleApp::RunHeadlessBenchmark()
+{
+    if (m_DeviceType == RENDER_DEVICE_TYPE_GL || m_DeviceType == RENDER_DEVICE_TYPE_GLES)
+    {
+#if VULKAN_SUPPORTED
+        LOG_WARNING_MESSAGE("OpenGL requires a window and can't be used in headless mode. Switching to Vulkan.");
+        m_DeviceType = RENDER_DEVICE_TYPE_VULKAN;
+#else
+        LOG_ERROR_MESSAGE("OpenGL requires a window and can't be used in headless mode. Please select another device type.");
+        return CommandLineStatus::Error;
+#endif
+    }
+
+    if (m_BenchmarkInfo.NumFrames == 0)
+    {
+        LOG_ERROR_MESSAGE("Number of benchmark frames must not be zero");
+        return CommandLineStatus::Error;
+    }
+
+    // Always use the fixed time step so that every run simulates identical frames
+    if (m_FixedTimeStep == 0)
+        m_FixedTimeStep = 1.0 / 60.0;
+
+    try
+    {
+        m_SwapChainInitDesc.Width  = m_InitialWindowWidth > 0 ? static_cast<Uint32>(m_InitialWindowWidth) : 1024;
+        m_SwapChainInitDesc.Height = m_InitialWindowHeight > 0 ? static_cast<Uint32>(m_InitialWindowHeight) : 768;
+
+        InitializeDiligentEngine(nullptr);
+        CreateOffscreenSwapChain(m_pDevice, GetImmediateContext(), m_SwapChainInitDesc, &m_pSwapChain);
+
+        const auto& SCDesc = m_pSwapChain->GetDesc();
+        m_pImGui.reset(new ImGuiImplDiligent{ImGuiDiligentCreateInfo{m_pDevice, SCDesc}});
+        InitializeSample();
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize the sample in headless mode");
+        return CommandLineStatus::Error;
+    }
+
+    if (m_BenchmarkInfo.Scaling)
+        return RunScalingBenchmark();
+
+    LOG_INFO_MESSAGE("Running headless benchmark: ", m_BenchmarkInfo.NumWarmupFrames, " warm-up + ", m_BenchmarkInfo.NumFrames,
+                     " frames, time step: ", m_FixedTimeStep, " s");
+
+    const Uint32 TotalFrames = m_BenchmarkInfo.NumWarmupFrames + m_BenchmarkInfo.NumFrames;
+    m_BenchmarkInfo.FrameTimings.clear();
+    m_BenchmarkInfo.FrameTimings.reserve(m_BenchmarkInfo.NumFrames);
+
+    Timer FrameTimer;
+    for (Uint32 Frame = 0; Frame < TotalFrames; ++Frame)
+    {
+        BenchmarkInfo::FrameTiming Timing;
+
+        FrameTimer.Restart();
+        Update(Frame * m_FixedTimeStep, m_FixedTimeStep);
+        Timing.Update = FrameTimer.GetElapsedTime();
+
+        FrameTimer.Restart();
+        Render();
+        Timing.Render = FrameTimer.GetElapsedTime();
+
+        FrameTimer.Restart();
+        Present();
+        Timing.Present = FrameTimer.GetElapsedTime();
+
+        if (Frame >= m_BenchmarkInfo.NumWarmupFrames)
+            m_BenchmarkInfo.FrameTimings.push_back(Timing);
+    }
+    GetImmediateContext()->WaitForIdle();
+
+    WriteBenchmarkReport();
+
+    return GetExitCode() == 0 ? CommandLineStatus::Help : CommandLineStatus::Error;
+}
+
+namespace
+{
+
+struct FrameTimeStats
+{
+    double Min    = 0;
+    double Median = 0;
+    double P99    = 0;
+    double Mean   = 0;
+};
+
+FrameTimeStats ComputeFrameTimeStats(std::vector<double> Times)
+{
+    FrameTimeStats Stats;
+    if (Times.empty())
+        return Stats;
+
+    std::sort(Times.begin(), Times.end());
+
+    Stats.Min    = Times.front();
+    Stats.Median = Times[Times.size() / 2];
+    Stats.P99    = Times[std::min(Times.size() - 1, (Times.size() * 99) / 100)];
+    for (auto Time : Times)
+        Stats.Mean += Time;
+    Stats.Mean /= static_cast<double>(Times.size());
+
+    return Stats;
+}
+
+// Returns the string as a JSON string literal
+std::string ToJsonString(const char* Str)
+{
+    std::stringstream ss;
+    ss << '"';
+    for (const char* c = Str != nullptr ? Str : ""; *c != '\0'; ++c)
+    {
+        switch (*c)
+        {
+            // clang-format off
+            case '"':  ss << "\\\""; break;
+            case '\\': ss << "\\\\"; break;
+            case '\b': ss << "\\b";  break;
+            case '\f': ss << "\\f";  break;
+            case '\n': ss << "\\n";  break;
+            case '\r': ss << "\\r";  break;
+            case '\t': ss << "\\t";  break;
+            // clang-format on
+
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20)
+                    ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*c) << std::dec << std::setfill(' ');
+                else
+                    ss << *c;
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+} // namespace
+
+void SampleApp::WriteBenchmarkReport()
+{
+    const auto& Timings = m_BenchmarkInfo.FrameTimings;
+
+    // All times are reported in milliseconds
+    std::vector<double> UpdateTimes(Timings.size());
+    std::vector<double> RenderTimes(Timings.size());
+    std::vector<double> PresentTimes(Timings.size());
+    std::vector<double> TotalTimes(Timings.size());
+    for (size_t i = 0; i < Timings.size(); ++i)
+    {
+        UpdateTimes[i]  = Timings[i].Update * 1000.0;
+        RenderTimes[i]  = Timings[i].Render * 1000.0;
+        PresentTimes[i] = Timings[i].Present * 1000.0;
+        TotalTimes[i]   = UpdateTimes[i] + RenderTimes[i] + PresentTimes[i];
+    }
+
+    // clang-format off
+    const std::pair<const char*, FrameTimeStats> AllStats[] =
+    {
+        {"update",  ComputeFrameTimeStats(UpdateTimes)},
+        {"render",  ComputeFrameTimeStats(RenderTimes)},
+        {"present", ComputeFrameTimeStats(PresentTimes)},
+        {"total",   ComputeFrameTimeStats(TotalTimes)},
+    };
+    const std::pair<const char*, double FrameTimeStats::*> StatMembers[] =
+    {
+        {"min",    &FrameTimeStats::Min},
+        {"median", &FrameTimeStats::Median},
+        {"p99",    &FrameTimeStats::P99},
+        {"mean",   &FrameTimeStats::Mean},
+    };
+    // clang-format on
+
+    for (const auto& Stats : AllStats)
+    {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << std::setw(8) << Stats.first << " (ms):";
+        for (const auto& Member : StatMembers)
+            ss << ' ' << Member.first << ' ' << Stats.second.*Member.second;
+        LOG_INFO_MESSAGE(ss.str());
+    }
+
+    if (m_BenchmarkInfo.OutputFile.empty())
+        return;
+
+    const auto& OutFile = m_BenchmarkInfo.OutputFile;
+    const bool  IsCSV   = OutFile.size() >= 4 && StrCmpNoCase(OutFile.c_str() + OutFile.size() - 4, ".csv") == 0;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(4);
+    if (IsCSV)
+    {
+        ss << "frame,update,render,present,total\n";
+        for (size_t i = 0; i < Timings.size(); ++i)
+            ss << i << ',' << UpdateTimes[i] << ',' << RenderTimes[i] << ',' << PresentTimes[i] << ',' << TotalTimes[i] << '\n';
+
+        for (const auto& Member : StatMembers)
+        {
+            ss << Member.first;
+            for (const auto& Stats : AllStats)
+                ss << ',' << Stats.second.*Member.second;
+            ss << '\n';
+        }
+    }
+    else
+    {
+        const auto& SCDesc = m_pSwapChain->GetDesc();
+        ss << "{\n"
+           << "  \"sample\": " << ToJsonString(m_TheSample->GetSampleName()) << ",\n"
+           << "  \"device\": " << ToJsonString(GetRenderDeviceTypeString(m_DeviceType)) << ",\n"
+           << "  \"adapter\": " << ToJsonString(m_AdapterAttribs.Description) << ",\n"
+           << "  \"width\": " << SCDesc.Width << ",\n"
+           << "  \"height\": " << SCDesc.Height << ",\n"
+           << "  \"time_step\": " << m_FixedTimeStep << ",\n"
+           << "  \"seed\": " << m_RandomSeed << ",\n"
+           << "  \"warmup_frames\": " << m_BenchmarkInfo.NumWarmupFrames << ",\n"
+           << "  \"frames\": " << Timings.size() << ",\n"
+           << "  \"summary_ms\": {\n";
+        for (size_t i = 0; i < _countof(AllStats); ++i)
+        {
+            ss << "    \"" << AllStats[i].first << "\": {";
+            for (size_t m = 0; m < _countof(StatMembers); ++m)
+                ss << (m > 0 ? ", " : "") << '"' << StatMembers[m].first << "\": " << AllStats[i].second.*StatMembers[m].second;
+            ss << (i + 1 < _countof(AllStats) ? "},\n" : "}\n");
+        }
+        ss << "  },\n"
+           << "  \"frame_times_ms\": [\n";
+        for (size_t i = 0; i < Timings.size(); ++i)
+        {
+            ss << "    {\"update\": " << UpdateTimes[i] << ", \"render\": " << RenderTimes[i] << ", \"present\": " << PresentTimes[i]
+               << (i + 1 < Timings.size() ? "},\n" : "}\n");
+        }
+        ss << "  ]\n"
+           << "}\n";
+    }
+
+    const auto Report = ss.str();
+
+    FileWrapper pFile(OutFile.c_str(), EFileAccessMode::Overwrite);
+    if (pFile && pFile->Write(Report.data(), Report.size()))
+    {
+        LOG_INFO_MESSAGE("Benchmark results are written to '", OutFile, "'.");
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to write benchmark results to '", OutFile, "'.");
+        m_ExitCode = 7;
+    }
+}
+
+namespace
+{
+
+// Parses the overrides of the scaling benchmark parameters in the form "name1=v1,v2,...;name2=v1,..."
+bool ParseScalingParams(const std::string& Str, std::vector<SampleBase::ScalingBenchmarkParam>& Params)
+{
+    std::stringstream ParamsStream{Str};
+    std::string       ParamStr;
+    while (std::getline(ParamsStream, ParamStr, ';'))
+    {
+        if (ParamStr.empty())
+            continue;
+
+        const auto EqPos = ParamStr.find('=');
+        const auto Name  = ParamStr.substr(0, EqPos);
+
+        auto ParamIt = std::find_if(Params.begin(), Params.end(), [&Name](const SampleBase::ScalingBenchmarkParam& Param) { return Param.Name == Name; });
+        if (ParamIt == Params.end())
+        {
+            LOG_ERROR_MESSAGE("Unknown scaling benchmark parameter '", Name, "'");
+            return false;
+        }
+
+        std::vector<int> Values;
+        if (EqPos != std::string::npos)
+        {
+            std::stringstream ValuesStream{ParamStr.substr(EqPos + 1)};
+            std::string       ValueStr;
+            while (std::getline(ValuesStream, ValueStr, ','))
+            {
+                char*      pEnd  = nullptr;
+                const auto Value = std::strtol(ValueStr.c_str(), &pEnd, 10);
+                if (ValueStr.empty() || *pEnd != '\0' || Value <= 0)
+                {
+                    LOG_ERROR_MESSAGE("Invalid value '", ValueStr, "' of scaling benchmark parameter '", Name, "'");
+                    return false;
+                }
+                Values.push_back(static_cast<int>(Value));
+            }
+        }
+        if (Values.empty())
+        {
+            LOG_ERROR_MESSAGE("No values are specified for scaling benchmark parameter '", Name, "'");
+            return false;
+        }
+        ParamIt->Values = std::move(Values);
+    }
+    return true;
+}
+
+} // namespace
+
+// Command line example to run the thread scaling benchmark:
+//
+//     --mode d3d12 --bench_scaling 1 --bench_frames 200 --bench_params "threads=1,2,4,8;batch=10" --bench_output Tutorial09_Scaling.csv
+//
+// The benchmark runs every combination of the parameter values returned by the sample for the
+// given number of frames. The thread count changes fastest so that the configurations that only
+// differ in the number of threads are reported next to each other.
+SampleApp::CommandLineStatus SampleApp::RunScalingBenchmark()
+{
+    auto Params = m_TheSample->GetScalingBenchmarkParams();
+    if (Params.empty())
+    {
+        LOG_ERROR_MESSAGE(m_TheSample->GetSampleName(), " does not support the thread scaling benchmark");
+        m_ExitCode = 8;
+        return CommandLineStatus::Error;
+    }
+    if (!ParseScalingParams(m_BenchmarkInfo.ScalingParams, Params))
+    {
+        m_ExitCode = 8;
+        return CommandLineStatus::Error;
+    }
+
+    // Parameters in the order of iteration: the last one changes fastest
+    std::vector<size_t> IterOrder;
+    for (size_t i = 0; i < Params.size(); ++i)
+    {
+        if (Params[i].Values.empty())
+        {
+            LOG_ERROR_MESSAGE("Scaling benchmark parameter '", Params[i].Name, "' has no values");
+            m_ExitCode = 8;
+            return CommandLineStatus::Error;
+        }
+        if (Params[i].Name != "threads")
+            IterOrder.push_back(i);
+    }
+    for (size_t i = 0; i < Params.size(); ++i)
+    {
+        if (Params[i].Name == "threads")
+            IterOrder.push_back(i);
+    }
+
+    size_t NumConfigs = 1;
+    for (const auto& Param : Params)
+        NumConfigs *= Param.Values.size();
+
+    LOG_INFO_MESSAGE("Running thread scaling benchmark: ", NumConfigs, " configurations, ", m_BenchmarkInfo.NumWarmupFrames, " warm-up + ",
+                     m_BenchmarkInfo.NumFrames, " frames each");
+
+    const Uint32 FramesPerConfig = m_BenchmarkInfo.NumWarmupFrames + m_BenchmarkInfo.NumFrames;
+
+    m_BenchmarkInfo.ScalingResults.clear();
+    m_BenchmarkInfo.ScalingResults.reserve(NumConfigs);
+
+    std::vector<size_t> ValueIdx(Params.size());
+    Uint32              TotalFrames = 0;
+    Timer               FrameTimer;
+    for (size_t ConfigIdx = 0; ConfigIdx < NumConfigs; ++ConfigIdx)
+    {
+        BenchmarkInfo::ScalingResult Result;
+        Result.Config.resize(Params.size());
+        for (size_t i = 0; i < Params.size(); ++i)
+            Result.Config[i] = Params[i].Values[ValueIdx[i]];
+
+        m_TheSample->SetScalingBenchmarkConfig(Result.Config);
+
+        for (Uint32 Frame = 0; Frame < FramesPerConfig; ++Frame, ++TotalFrames)
+        {
+            FrameTimer.Restart();
+            Update(TotalFrames * m_FixedTimeStep, m_FixedTimeStep);
+            Render();
+            Present();
+            const auto FrameTime = FrameTimer.GetElapsedTime();
+
+            if (Frame < m_BenchmarkInfo.NumWarmupFrames)
+                continue;
+
+            Result.FrameTime += FrameTime;
+            if (const auto* pStats = m_TheSample->GetThreadingStats())
+            {
+                Result.RecordTime += pStats->RecordTime;
+                Result.ExecuteTime += pStats->ExecuteTime;
+                if (Result.ThreadRecordTime.size() < pStats->ThreadRecordTime.size())
+                    Result.ThreadRecordTime.resize(pStats->ThreadRecordTime.size());
+                for (size_t t = 0; t < pStats->ThreadRecordTime.size(); ++t)
+                    Result.ThreadRecordTime[t] += pStats->ThreadRecordTime[t];
+            }
+        }
+
+        const double NumFrames = static_cast<double>(m_BenchmarkInfo.NumFrames);
+        Result.FrameTime /= NumFrames;
+        Result.RecordTime /= NumFrames;
+        Result.ExecuteTime /= NumFrames;
+        for (auto& ThreadTime : Result.ThreadRecordTime)
+            ThreadTime /= NumFrames;
+        m_BenchmarkInfo.ScalingResults.emplace_back(std::move(Result));
+
+        // Advance to the next configuration
+        for (auto it = IterOrder.rbegin(); it != IterOrder.rend(); ++it)
+        {
+            if (++ValueIdx[*it] < Params[*it].Values.size())
+                break;
+            ValueIdx[*it] = 0;
+        }
+    }
+    GetImmediateContext()->WaitForIdle();
+
+    WriteScalingReport(Params);
+
+    return GetExitCode() == 0 ? CommandLineStatus::Help : CommandLineStatus::Error;
+}
+
+void SampleApp::WriteScalingReport(const std::vector<SampleBase::ScalingBenchmarkParam>& Params)
+{
+    const auto& Results = m_BenchmarkInfo.ScalingResults;
+
+    size_t ThreadsIdx = Params.size();
+    for (size_t i = 0; i < Params.size(); ++i)
+    {
+        if (Params[i].Name == "threads")
+            ThreadsIdx = i;
+    }
+
+    // The speedup of every configuration is computed relative to the configuration that
+    // has the same values of all other parameters and the smallest number of threads.
+    // Recording time is used when the sample reports it, and the frame time otherwise.
+    const auto GetScaledTime = [](const BenchmarkInfo::ScalingResult& Result) {
+        return Result.RecordTime > 0 ? Result.RecordTime : Result.FrameTime;
+    };
+    std::vector<double> Speedup(Results.size(), 1.0);
+    std::vector<double> Efficiency(Results.size(), 1.0);
+    if (ThreadsIdx < Params.size())
+    {
+        for (size_t r = 0; r < Results.size(); ++r)
+        {
+            const auto* pBase = &Results[r];
+            for (const auto& Other : Results)
+            {
+                bool SameParams = Other.Config[ThreadsIdx] < pBase->Config[ThreadsIdx];
+                for (size_t i = 0; i < Params.size() && SameParams; ++i)
+                    SameParams = (i == ThreadsIdx || Other.Config[i] == Results[r].Config[i]);
+                if (SameParams)
+                    pBase = &Other;
+            }
+
+            const auto Time = GetScaledTime(Results[r]);
+            if (Time > 0)
+                Speedup[r] = GetScaledTime(*pBase) / Time;
+            Efficiency[r] = Speedup[r] * pBase->Config[ThreadsIdx] / Results[r].Config[ThreadsIdx];
+        }
+    }
+
+    // All times are reported in milliseconds
+    const auto GetThreadTimeStats = [](const BenchmarkInfo::ScalingResult& Result, double& Avg, double& Max) {
+        Avg = 0;
+        Max = 0;
+        for (auto Time : Result.ThreadRecordTime)
+        {
+            Avg += Time;
+            Max = std::max(Max, Time);
+        }
+        if (!Result.ThreadRecordTime.empty())
+            Avg /= static_cast<double>(Result.ThreadRecordTime.size());
+        Avg *= 1000.0;
+        Max *= 1000.0;
+    };
+
+    {
+        std::stringstream ss;
+        ss << "Thread scaling results (ms):\n";
+        for (const auto& Param : Params)
+            ss << std::setw(9) << Param.Name;
+        ss << "     frame    record   execute  thrd avg  thrd max   speedup  effcy\n";
+        for (size_t r = 0; r < Results.size(); ++r)
+        {
+            const auto& Result = Results[r];
+
+            double ThreadAvg = 0, ThreadMax = 0;
+            GetThreadTimeStats(Result, ThreadAvg, ThreadMax);
+
+            for (auto Value : Result.Config)
+                ss << std::setw(9) << Value;
+            ss << std::fixed << std::setprecision(3)
+               << std::setw(10) << Result.FrameTime * 1000.0
+               << std::setw(10) << Result.RecordTime * 1000.0
+               << std::setw(10) << Result.ExecuteTime * 1000.0
+               << std::setw(10) << ThreadAvg
+               << std::setw(10) << ThreadMax
+               << std::setw(10) << Speedup[r]
+               << std::setprecision(2) << std::setw(7) << Efficiency[r] << '\n';
+        }
+        LOG_INFO_MESSAGE(ss.str());
+    }
+
+    if (m_BenchmarkInfo.OutputFile.empty())
+        return;
+
+    const auto& OutFile = m_BenchmarkInfo.OutputFile;
+    const bool  IsCSV   = OutFile.size() >= 4 && StrCmpNoCase(OutFile.c_str() + OutFile.size() - 4, ".csv") == 0;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(4);
+    if (IsCSV)
+    {
+        for (const auto& Param : Params)
+            ss << Param.Name << ',';
+        ss << "frame,record,execute,thread_record_avg,thread_record_max,speedup,efficiency,thread_record\n";
+        for (size_t r = 0; r < Results.size(); ++r)
+        {
+            const auto& Result = Results[r];
+
+            double ThreadAvg = 0, ThreadMax = 0;
+            GetThreadTimeStats(Result, ThreadAvg, ThreadMax);
+
+            for (auto Value : Result.Config)
+                ss << Value << ',';
+            ss << Result.FrameTime * 1000.0 << ',' << Result.RecordTime * 1000.0 << ',' << Result.ExecuteTime * 1000.0 << ','
+               << ThreadAvg << ',' << ThreadMax << ',' << Speedup[r] << ',' << Efficiency[r] << ',';
+            // Per-thread times are separated by semicolons to keep them in one column
+            for (size_t t = 0; t < Result.ThreadRecordTime.size(); ++t)
+                ss << (t > 0 ? ";" : "") << Result.ThreadRecordTime[t] * 1000.0;
+            ss << '\n';
+        }
+    }
+    else
+    {
+        const auto& SCDesc = m_pSwapChain->GetDesc();
+        ss << "{\n"
+           << "  \"sample\": " << ToJsonString(m_TheSample->GetSampleName()) << ",\n"
+           << "  \"device\": " << ToJsonString(GetRenderDeviceTypeString(m_DeviceType)) << ",\n"
+           << "  \"adapter\": " << ToJsonString(m_AdapterAttribs.Description) << ",\n"
+           << "  \"width\": " << SCDesc.Width << ",\n"
+           << "  \"height\": " << SCDesc.Height << ",\n"
+           << "  \"time_step\": " << m_FixedTimeStep << ",\n"
+           << "  \"seed\": " << m_RandomSeed << ",\n"
+           << "  \"warmup_frames\": " << m_BenchmarkInfo.NumWarmupFrames << ",\n"
+           << "  \"frames\": " << m_BenchmarkInfo.NumFrames << ",\n"
+           << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+           << "  \"results_ms\": [\n";
+        for (size_t r = 0; r < Results.size(); ++r)
+        {
+            const auto& Result = Results[r];
+
+            double ThreadAvg = 0, ThreadMax = 0;
+            GetThreadTimeStats(Result, ThreadAvg, ThreadMax);
+
+            ss << "    {";
+            for (size_t i = 0; i < Params.size(); ++i)
+                ss << ToJsonString(Params[i].Name.c_str()) << ": " << Result.Config[i] << ", ";
+            ss << "\"frame\": " << Result.FrameTime * 1000.0
+               << ", \"record\": " << Result.RecordTime * 1000.0
+               << ", \"execute\": " << Result.ExecuteTime * 1000.0
+               << ", \"thread_record_avg\": " << ThreadAvg
+               << ", \"thread_record_max\": " << ThreadMax
+               << ", \"speedup\": " << Speedup[r]
+               << ", \"efficiency\": " << Efficiency[r]
+               << ", \"thread_record\": [";
+            for (size_t t = 0; t < Result.ThreadRecordTime.size(); ++t)
+                ss << (t > 0 ? ", " : "") << Result.ThreadRecordTime[t] * 1000.0;
+            ss << (r + 1 < Results.size() ? "]},\n" : "]}\n");
+        }
+        ss << "  ]\n"
+           << "}\n";
+    }
+
+    const auto Report = ss.str();
+
+    FileWrapper pFile(OutFile.c_str(), EFileAccessMode::Overwrite);
+    if (pFile && pFile->Write(Report.data(), Report.size()))
+    {
+        LOG_INFO_MESSAGE("Scaling benchmark results are written to '", OutFile, "'.");
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to write scaling benchmark results to '", OutFile, "'.");
+        m_ExitCode = 7;
+    }
 }
 
 void SampleApp::WindowResize(int width, int height)
@@ -870,8 +1630,16 @@ void SampleApp::WindowResize(int width, int height)
 
 void SampleApp::Update(double CurrTime, double ElapsedTime)
 {
+    if (m_FixedTimeStep > 0)
+    {
+        // Ignore the wall-clock time to simulate identical frames in every run
+        CurrTime    = m_FrameIndex * m_FixedTimeStep;
+        ElapsedTime = m_FixedTimeStep;
+    }
     m_CurrentTime = CurrTime;
 
+    TimelineProfiler::CpuScope ProfilerScope{"Update"};
+
     UpdateAppSettings(false);
 
     if (m_pImGui)
@@ -885,9 +1653,17 @@ void SampleApp::Update(double CurrTime, double ElapsedTime)
     }
     if (m_pDevice)
     {
+        // Note that only the input controller state is recorded and replayed, but not the UI input
+        auto& Controller = m_TheSample->GetInputController();
+        if (m_pInputPlayer)
+            m_pInputPlayer->PlayFrame(m_FrameIndex, Controller);
+        else if (m_pInputRecorder)
+            m_pInputRecorder->RecordFrame(m_FrameIndex, Controller);
+
         m_TheSample->Update(CurrTime, ElapsedTime);
-        m_TheSample->GetInputController().ClearState();
+        Controller.ClearState();
     }
+    ++m_FrameIndex;
 }
 
 void SampleApp::Render()
@@ -895,9 +1671,13 @@ void SampleApp::Render()
     if (m_NumImmediateContexts == 0 || !m_pSwapChain)
         return;
 
+    TimelineProfiler::CpuScope ProfilerScope{"Render"};
+
     auto* pCtx = GetImmediateContext();
     pCtx->ClearStats();
 
+    TimelineProfiler::GpuScope GpuProfilerScope{pCtx, "Render"};
+
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
     auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
     pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
@@ -945,42 +1725,80 @@ void SampleApp::CompareGoldenImage(const std::string& FileName, ScreenCapture::C
         m_ExitCode = 4;
         return;
     }
+    if (GoldenImgDesc.ComponentType != VT_UINT8 || GoldenImgDesc.NumComponents < 3)
+    {
+        LOG_ERROR_MESSAGE("Golden image must be an 8-bit RGB or RGBA image");
+        m_ExitCode = 11;
+        return;
+    }
 
     auto* const pCtx = GetImmediateContext();
 
     MappedTextureSubresource TexData;
     pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
-    auto CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
-                                                  reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
-                                                  TexDesc.Format, TEX_FORMAT_RGBA8_UNORM,
-                                                  /*KeepAlpha = */ false,
-                                                  /*FlipY = */ m_pDevice->GetDeviceInfo().IsGLDevice());
-    pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
 
-    auto* pGoldenImgPixels = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    ImageDiffAttribs DiffAttribs;
+    DiffAttribs.Width     = TexDesc.Width;
+    DiffAttribs.Height    = TexDesc.Height;
+    DiffAttribs.Tolerance = m_GoldenImgPixelTolerance;
 
+    if (!m_pImageDiffScheduler)
+    {
+        const Uint32 NumWorkers = std::max(std::thread::hardware_concurrency(), 1u) - 1u;
+        m_pImageDiffScheduler.reset(new TaskScheduler{NumWorkers});
+    }
+    DiffAttribs.pScheduler = m_pImageDiffScheduler.get();
 
-    size_t NumBadPixels  = 0;
-    size_t NumDiffPixels = 0;
-    int    MaxDiff       = 0;
-    for (size_t row = 0; row < TexDesc.Height; ++row)
+    // Compare the mapped data directly when the format is RGBA8 or BGRA8, which is the case
+    // for the vast majority of swap chains. Other formats are converted to RGB8 first.
+    std::vector<Uint8> CapturedPixels;
+    switch (TexDesc.Format)
     {
-        for (size_t col = 0; col < TexDesc.Width; ++col)
-        {
-            const auto* SrcPixel = &CapturedPixels[(col + row * size_t{TexDesc.Width}) * 3u];
-            const auto* DstPixel = pGoldenImgPixels + row * size_t{GoldenImgDesc.RowStride} + col * size_t{GoldenImgDesc.NumComponents};
-
-            const auto DiffR = std::abs(int{SrcPixel[0]} - int{DstPixel[0]});
-            const auto DiffG = std::abs(int{SrcPixel[1]} - int{DstPixel[1]});
-            const auto DiffB = std::abs(int{SrcPixel[2]} - int{DstPixel[2]});
-            const auto Diff  = std::max(std::max(DiffR, DiffG), DiffB);
-            if (Diff > m_GoldenImgPixelTolerance)
-                ++NumBadPixels;
-            else if (Diff != 0)
-                ++NumDiffPixels;
-            MaxDiff = std::max(MaxDiff, Diff);
-        }
+        case TEX_FORMAT_RGBA8_UNORM:
+        case TEX_FORMAT_RGBA8_UNORM_SRGB:
+        case TEX_FORMAT_BGRA8_UNORM:
+        case TEX_FORMAT_BGRA8_UNORM_SRGB:
+            DiffAttribs.Image1.pData         = reinterpret_cast<const Uint8*>(TexData.pData);
+            DiffAttribs.Image1.Stride        = static_cast<size_t>(TexData.Stride);
+            DiffAttribs.Image1.NumComponents = 4;
+            DiffAttribs.Image1.IsBGR         = (TexDesc.Format == TEX_FORMAT_BGRA8_UNORM || TexDesc.Format == TEX_FORMAT_BGRA8_UNORM_SRGB);
+            DiffAttribs.Image1.FlipY         = m_pDevice->GetDeviceInfo().IsGLDevice();
+            break;
+
+        default:
+            CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
+                                                     reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
+                                                     TexDesc.Format, TEX_FORMAT_RGBA8_UNORM,
+                                                     /*KeepAlpha = */ false,
+                                                     /*FlipY = */ m_pDevice->GetDeviceInfo().IsGLDevice());
+
+            DiffAttribs.Image1.pData         = CapturedPixels.data();
+            DiffAttribs.Image1.Stride        = size_t{TexDesc.Width} * 3u;
+            DiffAttribs.Image1.NumComponents = 3;
+            break;
+    }
+
+    DiffAttribs.Image2.pData         = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    DiffAttribs.Image2.Stride        = GoldenImgDesc.RowStride;
+    DiffAttribs.Image2.NumComponents = GoldenImgDesc.NumComponents;
+
+    ImageDiffInfo Diff;
+    ComputeImageDiff(DiffAttribs, Diff);
+
+    const size_t NumBadPixels  = Diff.NumBadPixels;
+    const size_t NumDiffPixels = Diff.NumDiffPixels;
+    const int    MaxDiff       = Diff.MaxDiff;
+
+    ImageDiffQuality   Quality;
+    std::vector<Uint8> HeatMap;
+    if (NumBadPixels > 0)
+    {
+        // Do the more expensive analysis only when the validation fails
+        ComputeImageDiffQuality(DiffAttribs, Quality, &HeatMap);
     }
+
+    pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
+
     if (NumBadPixels == 0)
     {
         if (NumDiffPixels == 0)
@@ -1004,52 +1822,77 @@ void SampleApp::CompareGoldenImage(const std::string& FileName, ScreenCapture::C
             LOG_ERROR_MESSAGE(GetAppTitle(), ": golden image validation FAILED: ", NumBadPixels, " inconsistent pixels and ", NumDiffPixels,
                               " differing pixels within the threshold (", m_GoldenImgPixelTolerance, ") are found. Maximum difference: ", MaxDiff, '.');
         }
+        LOG_ERROR_MESSAGE(GetAppTitle(), ": PSNR: ", Quality.PSNR, " dB, SSIM: ", Quality.SSIM, '.');
+
+        SaveGoldenImageDiff(FileName, HeatMap);
     }
 
     m_ExitCode = NumBadPixels > 0 ? 10 : 0;
 }
 
+void SampleApp::SaveGoldenImageDiff(const std::string& GoldenImageFileName, const std::vector<Uint8>& HeatMap)
+{
+    // frame.png -> frame_diff.png
+    std::string FileName = GoldenImageFileName;
+    {
+        const auto ExtPos = FileName.find_last_of('.');
+        const auto DirPos = FileName.find_last_of("/\\");
+        if (ExtPos != std::string::npos && (DirPos == std::string::npos || ExtPos > DirPos))
+            FileName.erase(ExtPos);
+        FileName += "_diff.png";
+    }
+
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+
+    Image::EncodeInfo Info;
+    Info.Width      = SCDesc.Width;
+    Info.Height     = SCDesc.Height;
+    Info.TexFormat  = TEX_FORMAT_RGBA8_UNORM;
+    Info.KeepAlpha  = false;
+    Info.pData      = HeatMap.data();
+    Info.Stride     = SCDesc.Width * 4;
+    Info.FileFormat = IMAGE_FILE_FORMAT_PNG;
+
+    RefCntAutoPtr<IDataBlob> pEncodedImage;
+    Image::Encode(Info, &pEncodedImage);
+
+    FileWrapper pFile(FileName.c_str(), EFileAccessMode::Overwrite);
+    if (pFile && pEncodedImage && pFile->Write(pEncodedImage->GetConstDataPtr(), pEncodedImage->GetSize()))
+    {
+        LOG_INFO_MESSAGE("Golden image difference is saved to '", FileName, "'.");
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to save golden image difference to '", FileName, "'.");
+    }
+}
+
 void SampleApp::SaveScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture)
 {
+    VERIFY_EXPR(m_pCaptureEncoder);
     auto* const pCtx = GetImmediateContext();
 
     MappedTextureSubresource TexData;
     pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
     const auto& TexDesc = Capture.pTexture->GetDesc();
 
-    Image::EncodeInfo Info;
+    ScreenCaptureEncoder::FrameInfo Info;
+    Info.FileName    = FileName;
+    Info.Id          = Capture.Id;
     Info.Width       = TexDesc.Width;
     Info.Height      = TexDesc.Height;
-    Info.TexFormat   = TexDesc.Format;
+    Info.Format      = TexDesc.Format;
     Info.KeepAlpha   = m_ScreenCaptureInfo.KeepAlpha;
     Info.FlipY       = m_pDevice->GetDeviceInfo().IsGLDevice();
-    Info.pData       = TexData.pData;
-    Info.Stride      = static_cast<Uint32>(TexData.Stride);
     Info.FileFormat  = m_ScreenCaptureInfo.FileFormat;
     Info.JpegQuality = m_ScreenCaptureInfo.JpegQuality;
+    // The pixels are copied, so the staging texture can be recycled as soon as this function returns.
+    // Encoding and writing the file is done by the encoder threads.
+    m_pCaptureEncoder->EnqueueFrame(TexData.pData, TexData.Stride, std::move(Info));
 
-    RefCntAutoPtr<IDataBlob> pEncodedImage;
-    Image::Encode(Info, &pEncodedImage);
     pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
 
-    FileWrapper pFile(FileName.c_str(), EFileAccessMode::Overwrite);
-    if (pFile)
-    {
-        auto res = pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize());
-        if (!res)
-        {
-            LOG_ERROR_MESSAGE("Failed to write screen capture file '", FileName, "'.");
-            m_ExitCode = 5;
-        }
-        pFile.Close();
-    }
-    else
-    {
-        LOG_ERROR_MESSAGE("Failed to create screen capture file '", FileName, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
-        m_ExitCode = 6;
-    }
-
-    // Do NOT set exit code to 0! We must not clear the previous error code.
+    // Write errors are reported by GetExitCode()
 }
 
 void SampleApp::Present()
@@ -1057,6 +1900,8 @@ void SampleApp::Present()
     if (!m_pSwapChain)
         return;
 
+    TimelineProfiler::CpuScope ProfilerScope{"Present"};
+
     auto* const pCtx = GetImmediateContext();
 
     if (m_pScreenCapture && m_ScreenCaptureInfo.FramesToCapture > 0)
@@ -1087,11 +1932,15 @@ void SampleApp::Present()
 
     m_pSwapChain->Present(m_bVSync ? 1 : 0);
 
+    if (m_pProfiler)
+        m_pProfiler->EndFrame();
+
     if (m_pScreenCapture)
     {
         while (auto Capture = m_pScreenCapture->GetCapture())
         {
             std::string FileName;
+            if (!m_ScreenCaptureInfo.RawVideo)
             {
                 std::stringstream FileNameSS;
                 if (!m_ScreenCaptureInfo.Directory.empty())
@@ -1121,7 +1970,15 @@ void SampleApp::Present()
                 SaveScreenCapture(FileName, Capture);
             }
 
+            const bool IsLastFrame = m_ScreenCaptureInfo.FramesToCapture == 0 && Capture.Id + 1 == m_ScreenCaptureInfo.CurrentFrame;
             m_pScreenCapture->RecycleStagingTexture(std::move(Capture.pTexture));
+
+            if (IsLastFrame && m_pCaptureEncoder)
+            {
+                // All requested frames have been queued. Wait until they are written
+                // so that GetExitCode() reports the write errors.
+                m_pCaptureEncoder->WaitIdle();
+            }
         }
     }
 }
@@ -25,6 +25,9 @@
  *  of the possibility of such damages.
  */
 
+#include <algorithm>
+#include <thread>
+
 #include "PlatformDefinitions.h"
 #include "SampleBase.hpp"
 #include "Errors.hpp"
@@ -179,7 +182,8 @@ void SampleBase::Initialize(const SampleInitInfo& InitInfo)
     m_pDeferredContexts.resize(InitInfo.NumDeferredCtx);
     for (Uint32 ctx = 0; ctx < InitInfo.NumDeferredCtx; ++ctx)
         m_pDeferredContexts[ctx] = InitInfo.ppContexts[InitInfo.NumImmediateCtx + ctx];
-    m_pImGui = InitInfo.pImGui;
+    m_pImGui     = InitInfo.pImGui;
+    m_RandomSeed = InitInfo.RandomSeed;
     ImGui::StyleColorsDiligent();
 
     const auto& SCDesc = m_pSwapChain->GetDesc();
@@ -189,4 +193,15 @@ void SampleBase::Initialize(const SampleInitInfo& InitInfo)
                                 SCDesc.ColorBufferFormat == TEX_FORMAT_BGRA8_UNORM);
 }
 
+SampleBase::ScalingBenchmarkParam SampleBase::GetThreadsBenchmarkParam(int MaxThreads)
+{
+    const int NumHardwareThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+    ScalingBenchmarkParam Param;
+    Param.Name = "threads";
+    for (int NumThreads = 1; NumThreads <= std::min(MaxThreads, NumHardwareThreads); ++NumThreads)
+        Param.Values.push_back(NumThreads);
+    return Param;
+}
+
 } // namespace Diligent
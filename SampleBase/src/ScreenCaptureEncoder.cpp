@@ -0,0 +1,191 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "ScreenCaptureEncoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GraphicsAccessories.hpp"
+#include "FileWrapper.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "DataBlob.h"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+ScreenCaptureEncoder::ScreenCaptureEncoder(Uint32 NumThreads, Uint32 MaxFramesInFlight) :
+    m_MaxFramesInFlight{std::max(MaxFramesInFlight, 1u)}
+{
+    NumThreads = std::max(NumThreads, 1u);
+    m_WorkerThreads.reserve(NumThreads);
+    for (Uint32 i = 0; i < NumThreads; ++i)
+        m_WorkerThreads.emplace_back(&ScreenCaptureEncoder::WorkerThreadFunc, this);
+}
+
+ScreenCaptureEncoder::ScreenCaptureEncoder(std::unique_ptr<RawVideoWriter> pVideoWriter, Uint32 MaxFramesInFlight) :
+    m_pVideoWriter{std::move(pVideoWriter)},
+    m_MaxFramesInFlight{std::max(MaxFramesInFlight, 1u)}
+{
+    VERIFY_EXPR(m_pVideoWriter);
+    m_WorkerThreads.emplace_back(&ScreenCaptureEncoder::WorkerThreadFunc, this);
+}
+
+ScreenCaptureEncoder::~ScreenCaptureEncoder()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_Stop = true;
+    }
+    m_FrameQueuedCV.notify_all();
+
+    // Workers drain the queue before exiting
+    for (auto& Thread : m_WorkerThreads)
+        Thread.join();
+}
+
+void ScreenCaptureEncoder::EnqueueFrame(const void* pData, size_t Stride, FrameInfo Info)
+{
+    const auto   ElementSize = GetTextureFormatAttribs(Info.Format).GetElementSize();
+    const size_t RowSize     = size_t{Info.Width} * ElementSize;
+
+    Frame NewFrame;
+    {
+        std::unique_lock<std::mutex> Lock{m_Mtx};
+        // Back-pressure: wait until a worker is done with one of the frames
+        m_FrameDoneCV.wait(Lock, [this] { return m_NumFramesInFlight < m_MaxFramesInFlight; });
+        ++m_NumFramesInFlight;
+
+        if (!m_BufferPool.empty())
+        {
+            NewFrame.Pixels = std::move(m_BufferPool.back());
+            m_BufferPool.pop_back();
+        }
+    }
+
+    NewFrame.Info   = std::move(Info);
+    NewFrame.Stride = RowSize;
+    NewFrame.Pixels.resize(RowSize * NewFrame.Info.Height);
+    // Copy the pixels outside of the lock so that the workers are not blocked
+    for (size_t row = 0; row < NewFrame.Info.Height; ++row)
+        memcpy(&NewFrame.Pixels[row * RowSize], static_cast<const Uint8*>(pData) + row * Stride, RowSize);
+
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_Queue.emplace_back(std::move(NewFrame));
+    }
+    m_FrameQueuedCV.notify_one();
+}
+
+void ScreenCaptureEncoder::WaitIdle()
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    m_FrameDoneCV.wait(Lock, [this] { return m_NumFramesInFlight == 0; });
+}
+
+void ScreenCaptureEncoder::WorkerThreadFunc()
+{
+    for (;;)
+    {
+        Frame CurrFrame;
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_FrameQueuedCV.wait(Lock, [this] { return m_Stop || !m_Queue.empty(); });
+            if (m_Queue.empty())
+            {
+                VERIFY_EXPR(m_Stop);
+                return;
+            }
+            CurrFrame = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        WriteFrame(CurrFrame);
+
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_BufferPool.emplace_back(std::move(CurrFrame.Pixels));
+            --m_NumFramesInFlight;
+        }
+        // Both the producer and WaitIdle() may be waiting
+        m_FrameDoneCV.notify_all();
+    }
+}
+
+void ScreenCaptureEncoder::WriteFrame(const Frame& Frame)
+{
+    const auto& FrameInfo = Frame.Info;
+
+    if (m_pVideoWriter)
+    {
+        VERIFY(m_WorkerThreads.size() == 1, "Raw video frames must be written by a single thread");
+        if (!m_pVideoWriter->WriteFrame(FrameInfo.Id, FrameInfo.Width, FrameInfo.Height, FrameInfo.Format, FrameInfo.FlipY, Frame.Pixels))
+            m_ErrorCode.store(5);
+        return;
+    }
+
+    Image::EncodeInfo Info;
+    Info.Width       = FrameInfo.Width;
+    Info.Height      = FrameInfo.Height;
+    Info.TexFormat   = FrameInfo.Format;
+    Info.KeepAlpha   = FrameInfo.KeepAlpha;
+    Info.FlipY       = FrameInfo.FlipY;
+    Info.pData       = Frame.Pixels.data();
+    Info.Stride      = static_cast<Uint32>(Frame.Stride);
+    Info.FileFormat  = FrameInfo.FileFormat;
+    Info.JpegQuality = FrameInfo.JpegQuality;
+
+    RefCntAutoPtr<IDataBlob> pEncodedImage;
+    Image::Encode(Info, &pEncodedImage);
+    if (!pEncodedImage)
+    {
+        LOG_ERROR_MESSAGE("Failed to encode screen capture '", FrameInfo.FileName, "'.");
+        m_ErrorCode.store(5);
+        return;
+    }
+
+    FileWrapper pFile(FrameInfo.FileName.c_str(), EFileAccessMode::Overwrite);
+    if (pFile)
+    {
+        auto res = pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize());
+        if (!res)
+        {
+            LOG_ERROR_MESSAGE("Failed to write screen capture file '", FrameInfo.FileName, "'.");
+            m_ErrorCode.store(5);
+        }
+        pFile.Close();
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to create screen capture file '", FrameInfo.FileName, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
+        m_ErrorCode.store(6);
+    }
+}
+
+} // namespace Diligent
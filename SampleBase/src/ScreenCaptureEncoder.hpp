@@ -0,0 +1,121 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#include "GraphicsTypes.h"
+#include "Image.h"
+#include "RawVideoWriter.hpp"
+
+namespace Diligent
+{
+
+/// Encodes and writes screen captures on background threads.
+
+/// The pixels are copied into pooled buffers so that the staging texture can be
+/// recycled immediately. When the maximum number of frames is in flight, EnqueueFrame()
+/// blocks until a worker finishes a frame, which keeps the memory usage bounded.
+/// Frames are either encoded as individual image files or appended to a raw video file.
+class ScreenCaptureEncoder
+{
+public:
+    struct FrameInfo
+    {
+        std::string       FileName; // Ignored when writing a raw video
+        Uint32            Id          = 0;
+        Uint32            Width       = 0;
+        Uint32            Height      = 0;
+        TEXTURE_FORMAT    Format      = TEX_FORMAT_UNKNOWN;
+        bool              FlipY       = false;
+        bool              KeepAlpha   = false;
+        IMAGE_FILE_FORMAT FileFormat  = IMAGE_FILE_FORMAT_PNG;
+        int               JpegQuality = 95;
+    };
+
+    /// NumThreads        - the number of worker threads.
+    /// MaxFramesInFlight - the maximum number of frames that are queued or being encoded.
+    ScreenCaptureEncoder(Uint32 NumThreads, Uint32 MaxFramesInFlight);
+
+    /// Appends all frames to the raw video. The frames must be written in order,
+    /// so a single worker thread is used.
+    ScreenCaptureEncoder(std::unique_ptr<RawVideoWriter> pVideoWriter, Uint32 MaxFramesInFlight);
+    ~ScreenCaptureEncoder();
+
+    // clang-format off
+    ScreenCaptureEncoder           (const ScreenCaptureEncoder&) = delete;
+    ScreenCaptureEncoder& operator=(const ScreenCaptureEncoder&) = delete;
+    // clang-format on
+
+    /// Copies the pixels and queues the frame for encoding.
+    void EnqueueFrame(const void* pData, size_t Stride, FrameInfo Info);
+
+    /// Waits until all queued frames are written.
+    void WaitIdle();
+
+    /// Returns the exit code of the last failed write (5 - failed to write the file,
+    /// 6 - failed to create the file), or 0 if all frames have been written successfully.
+    int GetErrorCode() const { return m_ErrorCode.load(); }
+
+private:
+    struct Frame
+    {
+        FrameInfo          Info;
+        std::vector<Uint8> Pixels;
+        size_t             Stride = 0;
+    };
+
+    void WorkerThreadFunc();
+    void WriteFrame(const Frame& Frame);
+
+    std::unique_ptr<RawVideoWriter> m_pVideoWriter;
+    std::vector<std::thread>        m_WorkerThreads;
+
+    std::mutex              m_Mtx;
+    std::condition_variable m_FrameQueuedCV;
+    std::condition_variable m_FrameDoneCV;
+
+    std::deque<Frame>               m_Queue;
+    std::vector<std::vector<Uint8>> m_BufferPool;
+
+    const Uint32 m_MaxFramesInFlight;
+    Uint32       m_NumFramesInFlight = 0;
+    bool         m_Stop              = false;
+
+    std::atomic<int> m_ErrorCode{0};
+};
+
+} // namespace Diligent
@@ -0,0 +1,305 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "StreamingBuffer.hpp"
+
+#include <algorithm>
+
+#include "Align.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+StreamingBuffer::StreamingBuffer(IRenderDevice* pDevice, IDeviceContext* pContext, const CreateInfo& CI) :
+    m_pContext{pContext},
+    m_Size{AlignUp(CI.Size, ChunkAlignment)},
+    m_ChunkSize{std::min(AlignUp(std::max(CI.ChunkSize, 1u), ChunkAlignment), m_Size)},
+    m_Contexts(CI.NumContexts)
+{
+    const auto& DeviceInfo = pDevice->GetDeviceInfo();
+
+    const bool UseRing =
+        CI.UseRing &&
+        (DeviceInfo.Type == RENDER_DEVICE_TYPE_D3D12 || DeviceInfo.Type == RENDER_DEVICE_TYPE_VULKAN) &&
+        (pDevice->GetAdapterInfo().Memory.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) != 0;
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = CI.Name;
+    BuffDesc.Usage          = UseRing ? USAGE_UNIFIED : USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = CI.BindFlags;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    BuffDesc.Size           = m_Size;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+    if (!m_pBuffer)
+        LOG_ERROR_AND_THROW("Failed to create streaming buffer '", CI.Name, "'");
+
+    if (UseRing)
+    {
+        FenceDesc FenceCI;
+        FenceCI.Name = "Streaming buffer fence";
+        FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+        pDevice->CreateFence(FenceCI, &m_pFence);
+
+        // Unified memory stays mapped for the lifetime of the buffer. The fence protects the regions that are in use.
+        PVoid pData = nullptr;
+        m_pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_NO_OVERWRITE, pData);
+        m_pRingData = static_cast<Uint8*>(pData);
+        if (m_pRingData == nullptr)
+            LOG_ERROR_AND_THROW("Failed to map streaming buffer '", CI.Name, "'");
+    }
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    if (m_pRingData != nullptr)
+    {
+        m_pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+    }
+    else
+    {
+        for (Uint32 CtxNum = 0; CtxNum < m_Contexts.size(); ++CtxNum)
+            Flush(CtxNum);
+    }
+}
+
+void StreamingBuffer::ReleaseCompletedFrames(Uint64 CompletedValue)
+{
+    while (m_NumPendingFrames > 0)
+    {
+        const auto& Frame = m_PendingFrames[m_FirstPendingFrame];
+        if (Frame.FenceValue > CompletedValue)
+            break;
+
+        m_Tail.store(Frame.End, std::memory_order_relaxed);
+        m_FirstPendingFrame = (m_FirstPendingFrame + 1) % MaxPendingFrames;
+        --m_NumPendingFrames;
+    }
+}
+
+bool StreamingBuffer::WaitForSpace(Uint64 End)
+{
+    std::lock_guard<std::mutex> Lock{m_FramesMtx};
+
+    ReleaseCompletedFrames(m_pFence->GetCompletedValue());
+    while (End > m_Tail.load(std::memory_order_relaxed) + m_Size)
+    {
+        // The data of the current frame can not be released until the frame is submitted
+        if (m_NumPendingFrames == 0)
+            return false;
+
+        m_NumStalls.fetch_add(1, std::memory_order_relaxed);
+        const Uint64 FenceValue = m_PendingFrames[m_FirstPendingFrame].FenceValue;
+        m_pFence->Wait(FenceValue);
+        ReleaseCompletedFrames(FenceValue);
+    }
+    return true;
+}
+
+bool StreamingBuffer::AcquireChunk(Uint32 CtxNum, Uint64 MinSize)
+{
+    const Uint64 ChunkSize = std::max(Uint64{m_ChunkSize}, AlignUp(MinSize, Uint64{ChunkAlignment}));
+    if (ChunkSize > m_Size)
+        return false;
+
+    Uint64 Head = m_Head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        // Chunks never cross the end of the buffer; the tail of the buffer is skipped instead.
+        Uint64 Start = Head;
+        if (Start % m_Size + ChunkSize > m_Size)
+            Start += m_Size - Start % m_Size;
+
+        const Uint64 End = Start + ChunkSize;
+        if (End > m_Tail.load(std::memory_order_relaxed) + m_Size)
+        {
+            if (!WaitForSpace(End))
+                return false;
+            Head = m_Head.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        // Chunks are only handed out by advancing the head, so no other context can get an overlapping region.
+        if (m_Head.compare_exchange_weak(Head, End, std::memory_order_relaxed))
+        {
+            if (Start % m_Size == 0 && Start > 0)
+                m_NumWraps.fetch_add(1, std::memory_order_relaxed);
+
+            auto& Ctx    = m_Contexts[CtxNum];
+            Ctx.ChunkPos = Start;
+            Ctx.ChunkEnd = End;
+            return true;
+        }
+    }
+}
+
+Uint32 StreamingBuffer::Allocate(IDeviceContext* pCtx, Uint32 Size, Uint32 CtxNum, Uint32 Alignment)
+{
+    VERIFY(IsPowerOfTwo(Alignment) && Alignment <= ChunkAlignment, "Alignment must be a power of two not greater than ", Uint32{ChunkAlignment});
+
+    auto& Ctx = m_Contexts[CtxNum];
+    if (m_pRingData != nullptr)
+    {
+        Uint64 Start = AlignUp(Ctx.ChunkPos, Uint64{Alignment});
+        if (Start + Size > Ctx.ChunkEnd)
+        {
+            if (!AcquireChunk(CtxNum, Size))
+            {
+                ++Ctx.NumFailures;
+                return InvalidOffset;
+            }
+            Start = Ctx.ChunkPos;
+        }
+        Ctx.ChunkPos = Start + Size;
+        Ctx.FrameSize += Size;
+        return static_cast<Uint32>(Start % m_Size);
+    }
+
+    if (Size > m_Size)
+    {
+        ++Ctx.NumFailures;
+        return InvalidOffset;
+    }
+
+    // Check if there is enough space in the buffer
+    Uint32 Offset = AlignUp(Ctx.CurrOffset, Alignment);
+    if (Offset + Size > m_Size)
+    {
+        // Unmap the buffer
+        Flush(CtxNum);
+        Offset = 0;
+    }
+
+    if (Ctx.pMappedData == nullptr)
+    {
+        // If current offset is zero, we are mapping the buffer for the first time after it has been flushed. Use MAP_FLAG_DISCARD flag.
+        // Otherwise use MAP_FLAG_NO_OVERWRITE flag.
+        const MAP_FLAGS MapFlags = Ctx.CurrOffset == 0 ? MAP_FLAG_DISCARD : MAP_FLAG_NO_OVERWRITE;
+        if (MapFlags == MAP_FLAG_DISCARD)
+            ++Ctx.NumDiscards;
+
+        PVoid pData = nullptr;
+        pCtx->MapBuffer(m_pBuffer, MAP_WRITE, MapFlags, pData);
+        Ctx.pMappedCtx  = pCtx;
+        Ctx.pMappedData = static_cast<Uint8*>(pData);
+    }
+
+    Ctx.CurrOffset = Offset + Size;
+    Ctx.FrameSize += Size;
+    return Offset;
+}
+
+void StreamingBuffer::Release(Uint32 CtxNum)
+{
+    auto& Ctx = m_Contexts[CtxNum];
+    if (!m_AllowPersistentMap && Ctx.pMappedData != nullptr)
+    {
+        Ctx.pMappedCtx->UnmapBuffer(m_pBuffer, MAP_WRITE);
+        Ctx.pMappedCtx  = nullptr;
+        Ctx.pMappedData = nullptr;
+    }
+}
+
+void StreamingBuffer::Flush(Uint32 CtxNum)
+{
+    auto& Ctx = m_Contexts[CtxNum];
+    if (Ctx.pMappedData != nullptr)
+    {
+        Ctx.pMappedCtx->UnmapBuffer(m_pBuffer, MAP_WRITE);
+        Ctx.pMappedCtx  = nullptr;
+        Ctx.pMappedData = nullptr;
+    }
+    Ctx.CurrOffset = 0;
+}
+
+void StreamingBuffer::FlushRingRange(Uint64 Start, Uint64 End)
+{
+    // Host-coherent memory does not need to be flushed
+    if ((m_pBuffer->GetMemoryProperties() & MEMORY_PROPERTY_HOST_COHERENT) != 0 || Start == End)
+        return;
+
+    const Uint64 Offset = Start % m_Size;
+    const Uint64 Size   = End - Start;
+    if (Offset + Size <= m_Size)
+    {
+        m_pBuffer->FlushMappedRange(Offset, Size);
+    }
+    else
+    {
+        m_pBuffer->FlushMappedRange(Offset, m_Size - Offset);
+        m_pBuffer->FlushMappedRange(0, Offset + Size - m_Size);
+    }
+}
+
+void StreamingBuffer::FinishFrame()
+{
+    FrameStats Stats;
+    for (auto& Ctx : m_Contexts)
+    {
+        Stats.Size += Ctx.FrameSize;
+        Stats.NumDiscards += Ctx.NumDiscards;
+        Stats.NumFailures += Ctx.NumFailures;
+        Ctx.FrameSize   = 0;
+        Ctx.NumDiscards = 0;
+        Ctx.NumFailures = 0;
+
+        // Chunks are not shared between frames, so that the space can be released as soon as the frame is completed
+        Ctx.ChunkPos = 0;
+        Ctx.ChunkEnd = 0;
+    }
+
+    if (m_pRingData != nullptr)
+    {
+        const Uint64 Head = m_Head.load(std::memory_order_relaxed);
+        if (Head != m_FrameStart)
+        {
+            FlushRingRange(m_FrameStart, Head);
+            m_pContext->EnqueueSignal(m_pFence, ++m_FenceValue);
+
+            std::lock_guard<std::mutex> Lock{m_FramesMtx};
+            if (m_NumPendingFrames == MaxPendingFrames)
+            {
+                const Uint64 FenceValue = m_PendingFrames[m_FirstPendingFrame].FenceValue;
+                m_pFence->Wait(FenceValue);
+                ReleaseCompletedFrames(FenceValue);
+            }
+
+            auto& Frame      = m_PendingFrames[(m_FirstPendingFrame + m_NumPendingFrames) % MaxPendingFrames];
+            Frame.FenceValue = m_FenceValue;
+            Frame.End        = Head;
+            ++m_NumPendingFrames;
+            m_FrameStart = Head;
+        }
+
+        Stats.NumWraps  = m_NumWraps.exchange(0, std::memory_order_relaxed);
+        Stats.NumStalls = m_NumStalls.exchange(0, std::memory_order_relaxed);
+    }
+
+    m_LastFrameStats = Stats;
+}
+
+} // namespace Diligent
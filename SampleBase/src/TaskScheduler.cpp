@@ -0,0 +1,348 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "TaskScheduler.hpp"
+
+#include <deque>
+#include <algorithm>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+class TaskScheduler::Task
+{
+public:
+    TaskFunc Func;
+    Uint32   Affinity = AnyThread;
+
+    // One extra dependency is held while the task is being submitted
+    std::atomic<int>  NumPendingDeps{1};
+    std::atomic<bool> Complete{false};
+
+    std::mutex              Mtx;
+    std::vector<TaskHandle> Dependents;
+};
+
+struct TaskScheduler::ThreadQueue
+{
+    std::mutex             Mtx;
+    std::deque<TaskHandle> Tasks;
+    // Tasks that can only be executed by this thread
+    std::deque<TaskHandle> PinnedTasks;
+};
+
+namespace
+{
+
+// A worker thread belongs to exactly one scheduler for its whole lifetime
+thread_local const TaskScheduler* t_pWorkerScheduler = nullptr;
+thread_local Uint32               t_WorkerThreadId   = TaskScheduler::AnyThread;
+
+std::atomic<const TaskScheduler::ProfilerCallbacks*> g_pProfilerCallbacks{nullptr};
+
+} // namespace
+
+TaskScheduler::TaskScheduler(Uint32 NumWorkers) :
+    m_OwnerThreadId{std::this_thread::get_id()}
+{
+    m_Queues.resize(size_t{NumWorkers} + 1);
+    for (auto& Queue : m_Queues)
+        Queue.reset(new ThreadQueue);
+
+    m_WorkerThreads.reserve(NumWorkers);
+    for (Uint32 i = 0; i < NumWorkers; ++i)
+        m_WorkerThreads.emplace_back(&TaskScheduler::WorkerThreadFunc, this, i + 1);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_SleepMtx};
+        m_Stop = true;
+    }
+    m_SleepCV.notify_all();
+
+    for (auto& Thread : m_WorkerThreads)
+        Thread.join();
+
+#ifdef DILIGENT_DEBUG
+    for (const auto& Queue : m_Queues)
+        VERIFY(Queue->Tasks.empty() && Queue->PinnedTasks.empty(), "Destroying the task scheduler with pending tasks");
+#endif
+}
+
+void TaskScheduler::SetProfilerCallbacks(const ProfilerCallbacks* pCallbacks)
+{
+    g_pProfilerCallbacks.store(pCallbacks, std::memory_order_release);
+}
+
+Uint32 TaskScheduler::GetCurrentThreadId() const
+{
+    // The thread that creates the schedulers may own several of them at the same time,
+    // so thread 0 is identified by the owner id rather than by the thread-local state.
+    if (std::this_thread::get_id() == m_OwnerThreadId)
+        return 0;
+
+    return t_pWorkerScheduler == this ? t_WorkerThreadId : AnyThread;
+}
+
+void TaskScheduler::WorkerThreadFunc(Uint32 ThreadId)
+{
+    t_pWorkerScheduler = this;
+    t_WorkerThreadId   = ThreadId;
+
+    if (const auto* pCallbacks = g_pProfilerCallbacks.load(std::memory_order_acquire))
+        pCallbacks->OnWorkerThreadStart(ThreadId);
+
+    for (;;)
+    {
+        // Read the epoch before looking for work: if a task is queued after this point,
+        // the epoch will change and the thread will not fall asleep.
+        const auto Epoch = m_Epoch.load();
+        if (auto pTask = FindTask(ThreadId))
+        {
+            Execute(std::move(pTask), ThreadId);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock{m_SleepMtx};
+        if (m_Stop)
+            return;
+        ++m_NumSleepers;
+        m_SleepCV.wait(Lock, [&]() { return m_Stop || m_Epoch.load() != Epoch; });
+        --m_NumSleepers;
+    }
+}
+
+TaskScheduler::TaskHandle TaskScheduler::FindTask(Uint32 ThreadId)
+{
+    VERIFY_EXPR(ThreadId < m_Queues.size());
+    {
+        auto& Queue = *m_Queues[ThreadId];
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        if (!Queue.PinnedTasks.empty())
+        {
+            auto pTask = std::move(Queue.PinnedTasks.front());
+            Queue.PinnedTasks.pop_front();
+            return pTask;
+        }
+        // Own tasks are executed in LIFO order as they are most likely to be in cache
+        if (!Queue.Tasks.empty())
+        {
+            auto pTask = std::move(Queue.Tasks.back());
+            Queue.Tasks.pop_back();
+            return pTask;
+        }
+    }
+
+    // Steal the oldest task from other threads
+    const auto NumQueues = m_Queues.size();
+    for (size_t i = 1; i < NumQueues; ++i)
+    {
+        auto& Queue = *m_Queues[(ThreadId + i) % NumQueues];
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        if (!Queue.Tasks.empty())
+        {
+            auto pTask = std::move(Queue.Tasks.front());
+            Queue.Tasks.pop_front();
+            return pTask;
+        }
+    }
+
+    return {};
+}
+
+void TaskScheduler::Notify()
+{
+    std::lock_guard<std::mutex> Lock{m_SleepMtx};
+    m_Epoch.fetch_add(1);
+    if (m_NumSleepers > 0)
+        m_SleepCV.notify_all();
+}
+
+void TaskScheduler::Enqueue(TaskHandle pTask, Uint32 ThreadId)
+{
+    if (pTask->Affinity != AnyThread)
+    {
+        VERIFY(pTask->Affinity < m_Queues.size(), "Task affinity is out of range");
+        auto& Queue = *m_Queues[pTask->Affinity];
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        Queue.PinnedTasks.emplace_back(std::move(pTask));
+    }
+    else
+    {
+        // Tasks submitted by external threads go to thread 0's queue where workers can steal them
+        auto& Queue = *m_Queues[ThreadId != AnyThread ? ThreadId : 0];
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        Queue.Tasks.emplace_back(std::move(pTask));
+    }
+    Notify();
+}
+
+void TaskScheduler::Execute(TaskHandle pTask, Uint32 ThreadId)
+{
+    VERIFY_EXPR(pTask->Affinity == AnyThread || pTask->Affinity == ThreadId);
+    if (const auto* pCallbacks = g_pProfilerCallbacks.load(std::memory_order_acquire))
+    {
+        const Uint64 BeginValue = pCallbacks->OnTaskBegin();
+        pTask->Func(ThreadId);
+        pCallbacks->OnTaskEnd(BeginValue);
+    }
+    else
+    {
+        pTask->Func(ThreadId);
+    }
+    // Release the resources captured by the function
+    pTask->Func = nullptr;
+
+    std::vector<TaskHandle> Dependents;
+    {
+        std::lock_guard<std::mutex> Lock{pTask->Mtx};
+        pTask->Complete.store(true);
+        Dependents.swap(pTask->Dependents);
+    }
+
+    for (auto& pDependent : Dependents)
+    {
+        if (pDependent->NumPendingDeps.fetch_sub(1) == 1)
+            Enqueue(std::move(pDependent), ThreadId);
+    }
+
+    // Wake up threads waiting for this task
+    Notify();
+}
+
+TaskScheduler::TaskHandle TaskScheduler::Submit(TaskFunc Func, const std::vector<TaskHandle>& Dependencies, Uint32 Affinity)
+{
+    auto pTask      = std::make_shared<Task>();
+    pTask->Func     = std::move(Func);
+    pTask->Affinity = Affinity;
+
+    for (const auto& pDependency : Dependencies)
+    {
+        if (!pDependency)
+            continue;
+
+        std::lock_guard<std::mutex> Lock{pDependency->Mtx};
+        if (!pDependency->Complete.load())
+        {
+            pTask->NumPendingDeps.fetch_add(1);
+            pDependency->Dependents.push_back(pTask);
+        }
+    }
+
+    // Release the submission reference
+    if (pTask->NumPendingDeps.fetch_sub(1) == 1)
+        Enqueue(pTask, GetCurrentThreadId());
+
+    return pTask;
+}
+
+bool TaskScheduler::IsComplete(const TaskHandle& pTask)
+{
+    return !pTask || pTask->Complete.load();
+}
+
+void TaskScheduler::Wait(const TaskHandle& pTask)
+{
+    const auto ThreadId = GetCurrentThreadId();
+    while (!IsComplete(pTask))
+    {
+        const auto Epoch = m_Epoch.load();
+        if (ThreadId != AnyThread)
+        {
+            if (auto pOtherTask = FindTask(ThreadId))
+            {
+                Execute(std::move(pOtherTask), ThreadId);
+                continue;
+            }
+        }
+
+        std::unique_lock<std::mutex> Lock{m_SleepMtx};
+        ++m_NumSleepers;
+        m_SleepCV.wait(Lock, [&]() { return IsComplete(pTask) || m_Epoch.load() != Epoch; });
+        --m_NumSleepers;
+    }
+}
+
+void TaskScheduler::ParallelFor(Uint32 Begin, Uint32 End, Uint32 GrainSize, const RangeFunc& Func)
+{
+    if (End <= Begin)
+        return;
+
+    GrainSize = std::max(GrainSize, 1u);
+
+    const auto ThreadId  = GetCurrentThreadId();
+    const auto NumChunks = (End - Begin + GrainSize - 1) / GrainSize;
+    // Only the threads of this scheduler run the chunks inline. Other threads have no thread index,
+    // so they always queue the chunks and wait for the threads of the scheduler to execute them.
+    if (ThreadId != AnyThread && (NumChunks == 1 || m_WorkerThreads.empty()))
+    {
+        for (Uint32 ChunkStart = Begin; ChunkStart < End; ChunkStart += std::min(GrainSize, End - ChunkStart))
+            Func(ThreadId, ChunkStart, std::min(ChunkStart + GrainSize, End));
+        return;
+    }
+    VERIFY(ThreadId != AnyThread || !m_WorkerThreads.empty(),
+           "Without worker threads, the chunks queued by a thread that does not belong to the scheduler only run when thread 0 waits");
+
+    std::vector<TaskHandle> Chunks;
+    Chunks.reserve(NumChunks);
+    for (Uint32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+    {
+        const auto ChunkStart = Begin + Chunk * GrainSize;
+        const auto ChunkEnd   = std::min(ChunkStart + GrainSize, End);
+        Chunks.emplace_back(Submit([&Func, ChunkStart, ChunkEnd](Uint32 ExecThreadId) { Func(ExecThreadId, ChunkStart, ChunkEnd); }));
+    }
+
+    // The calling thread pops the chunks from the back of its queue while waiting
+    for (auto it = Chunks.rbegin(); it != Chunks.rend(); ++it)
+        Wait(*it);
+}
+
+void TaskScheduler::RunOnAllThreads(const TaskFunc& Func)
+{
+    VERIFY(GetCurrentThreadId() == 0, "RunOnAllThreads must be called from the thread that created the scheduler");
+
+    std::vector<TaskHandle> Tasks;
+    Tasks.reserve(m_WorkerThreads.size());
+    for (Uint32 ThreadId = 1; ThreadId < GetNumThreads(); ++ThreadId)
+        Tasks.emplace_back(Submit(Func, {}, ThreadId));
+
+    Func(0);
+
+    for (const auto& pTask : Tasks)
+        Wait(pTask);
+}
+
+} // namespace Diligent
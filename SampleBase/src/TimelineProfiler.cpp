@@ -0,0 +1,446 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "TimelineProfiler.hpp"
+
+#include <array>
+#include <deque>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "Errors.hpp"
+#include "FileWrapper.hpp"
+#include "TaskScheduler.hpp"
+
+namespace Diligent
+{
+
+std::atomic<TimelineProfiler*> TimelineProfiler::sm_pProfiler{nullptr};
+
+namespace
+{
+
+// Incremented for every profiler, so that a thread never uses a buffer of a destroyed profiler
+// that happened to have the same address
+std::atomic<Uint64> g_ProfilerGeneration{0};
+
+struct ThreadBufferCache
+{
+    Uint64 Generation = 0;
+    void*  pBuffer    = nullptr;
+};
+thread_local ThreadBufferCache t_ThreadBuffer;
+
+void WriteJsonString(std::ostream& os, const char* Str)
+{
+    os << '"';
+    for (const char* c = Str != nullptr ? Str : ""; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            os << '\\' << *c;
+        else if (static_cast<unsigned char>(*c) < 0x20)
+            os << ' ';
+        else
+            os << *c;
+    }
+    os << '"';
+}
+
+// Writes a complete event; times are in nanoseconds and the trace uses microseconds
+void WriteCompleteEvent(std::ostream& os, const char* Name, Uint32 Pid, Uint32 Tid, double BeginTime, double EndTime)
+{
+    os << ",\n{\"ph\":\"X\",\"pid\":" << Pid << ",\"tid\":" << Tid << ",\"ts\":" << BeginTime * 1e-3 << ",\"dur\":" << std::max(EndTime - BeginTime, 0.0) * 1e-3 << ",\"name\":";
+    WriteJsonString(os, Name);
+    os << '}';
+}
+
+void WriteTrackName(std::ostream& os, const char* MetadataName, Uint32 Pid, Uint32 Tid, const char* Name)
+{
+    os << ",\n{\"ph\":\"M\",\"pid\":" << Pid << ",\"tid\":" << Tid << ",\"name\":\"" << MetadataName << "\",\"args\":{\"name\":";
+    WriteJsonString(os, Name);
+    os << "}}";
+}
+
+constexpr Uint32 CpuPid = 1;
+constexpr Uint32 GpuPid = 2;
+
+// Names the tracks of the task scheduler threads and records every task as a CPU event
+const TaskScheduler::ProfilerCallbacks TaskSchedulerCallbacks = {
+    [](Uint32 ThreadId) {
+        if (auto* pProfiler = TimelineProfiler::Get())
+            pProfiler->SetThreadName(("Task worker " + std::to_string(ThreadId)).c_str());
+    },
+    []() -> Uint64 {
+        auto* pProfiler = TimelineProfiler::Get();
+        return pProfiler != nullptr ? pProfiler->GetTime() : 0;
+    },
+    [](Uint64 BeginTime) {
+        if (auto* pProfiler = TimelineProfiler::Get())
+            pProfiler->AddCpuEvent("Task", BeginTime, pProfiler->GetTime());
+    },
+};
+
+} // namespace
+
+// Events are written to fixed-size chunks. Only the owning thread appends events; the number of events
+// in a chunk and the link to the next chunk are published with release stores, so WriteTrace() can read
+// the buffer while the thread keeps recording.
+struct TimelineProfiler::ThreadBuffer
+{
+    static constexpr Uint32 ChunkSize    = 4096;
+    static constexpr Uint32 MaxNumChunks = 256;
+
+    struct Chunk
+    {
+        std::array<Event, ChunkSize> Events;
+        std::atomic<Uint32>          NumEvents{0};
+        std::atomic<Chunk*>          pNext{nullptr};
+    };
+
+    ThreadBuffer(Uint32 _ThreadIndex) :
+        ThreadIndex{_ThreadIndex},
+        pFirstChunk{new Chunk},
+        pLastChunk{pFirstChunk.get()}
+    {}
+
+    ~ThreadBuffer()
+    {
+        for (Chunk* pChunk = pFirstChunk->pNext.load(); pChunk != nullptr;)
+        {
+            Chunk* pNext = pChunk->pNext.load();
+            delete pChunk;
+            pChunk = pNext;
+        }
+    }
+
+    // Returns false if the buffer is full
+    bool AddEvent(const Event& Evt)
+    {
+        Uint32 NumEvents = pLastChunk->NumEvents.load(std::memory_order_relaxed);
+        if (NumEvents == ChunkSize)
+        {
+            if (NumChunks == MaxNumChunks)
+                return false;
+
+            Chunk* pNewChunk = new Chunk;
+            pLastChunk->pNext.store(pNewChunk, std::memory_order_release);
+            pLastChunk = pNewChunk;
+            ++NumChunks;
+            NumEvents = 0;
+        }
+
+        pLastChunk->Events[NumEvents] = Evt;
+        pLastChunk->NumEvents.store(NumEvents + 1, std::memory_order_release);
+        return true;
+    }
+
+    const Uint32 ThreadIndex;
+    std::string  Name; // protected by m_ThreadsMtx
+
+    std::unique_ptr<Chunk> pFirstChunk;
+    Chunk*                 pLastChunk = nullptr; // used by the owning thread only
+    Uint32                 NumChunks  = 1;       // used by the owning thread only
+};
+
+struct TimelineProfiler::GpuQueue
+{
+    static constexpr size_t MaxPendingScopes = 1024;
+    static constexpr size_t MaxEvents        = 256 * 1024;
+
+    struct Scope
+    {
+        const char*           Name = nullptr;
+        RefCntAutoPtr<IQuery> pBeginQuery;
+        RefCntAutoPtr<IQuery> pEndQuery;
+        Uint64                CpuTime = 0; // time when the scope was recorded
+    };
+
+    RefCntAutoPtr<IDeviceContext> pContext;
+    Uint32                        TrackId   = 0;
+    bool                          Supported = false;
+
+    std::vector<Scope>                 OpenScopes;
+    std::deque<Scope>                  PendingScopes;
+    std::vector<RefCntAutoPtr<IQuery>> FreeQueries;
+
+    // Resolved events in GPU time; CPU time = GPU time + CpuTimeOffset.
+    // Only the last MaxEvents events are kept, so that long sessions do not grow the queue.
+    std::deque<Event> Events;
+    Int64             CpuTimeOffset = 0;
+    bool              HasTimeOffset = false;
+};
+
+TimelineProfiler::TimelineProfiler(std::string TracePath) :
+    m_TracePath{std::move(TracePath)},
+    m_Generation{++g_ProfilerGeneration}
+{
+    TimelineProfiler* pExpected = nullptr;
+    if (!sm_pProfiler.compare_exchange_strong(pExpected, this))
+        LOG_ERROR_AND_THROW("Only one timeline profiler can exist at a time");
+
+    TaskScheduler::SetProfilerCallbacks(&TaskSchedulerCallbacks);
+}
+
+TimelineProfiler::~TimelineProfiler()
+{
+    TaskScheduler::SetProfilerCallbacks(nullptr);
+    sm_pProfiler.store(nullptr);
+}
+
+TimelineProfiler::ThreadBuffer* TimelineProfiler::GetThreadBuffer()
+{
+    if (t_ThreadBuffer.Generation == m_Generation)
+        return static_cast<ThreadBuffer*>(t_ThreadBuffer.pBuffer);
+
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+    m_Threads.emplace_back(new ThreadBuffer{static_cast<Uint32>(m_Threads.size())});
+    t_ThreadBuffer.Generation = m_Generation;
+    t_ThreadBuffer.pBuffer    = m_Threads.back().get();
+    return m_Threads.back().get();
+}
+
+void TimelineProfiler::SetThreadName(const char* Name)
+{
+    ThreadBuffer* pBuffer = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+    pBuffer->Name = Name;
+}
+
+void TimelineProfiler::AddCpuEvent(const char* Name, Uint64 BeginTime, Uint64 EndTime)
+{
+    if (!GetThreadBuffer()->AddEvent({Name, BeginTime, EndTime}))
+        m_NumDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TimelineProfiler::InitializeGpuQueries(IRenderDevice* pDevice)
+{
+    std::lock_guard<std::mutex> Lock{m_GpuMtx};
+    m_pDevice = pDevice;
+    m_GpuQueues.clear();
+}
+
+TimelineProfiler::GpuQueue* TimelineProfiler::FindGpuQueue(IDeviceContext* pContext)
+{
+    for (auto& pQueue : m_GpuQueues)
+    {
+        if (pQueue->pContext == pContext)
+            return pQueue->Supported ? pQueue.get() : nullptr;
+    }
+
+    std::unique_ptr<GpuQueue> pQueue{new GpuQueue};
+    pQueue->pContext = pContext;
+    pQueue->TrackId  = static_cast<Uint32>(m_GpuQueues.size());
+
+    const auto& Features = m_pDevice->GetDeviceInfo().Features;
+    const auto& CtxDesc  = pContext->GetDesc();
+
+    const bool IsTransferQueue = (CtxDesc.QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK) == COMMAND_QUEUE_TYPE_TRANSFER;
+    pQueue->Supported          = !CtxDesc.IsDeferred && Features.TimestampQueries && (!IsTransferQueue || Features.TransferQueueTimestampQueries);
+
+    m_GpuQueues.emplace_back(std::move(pQueue));
+    return m_GpuQueues.back()->Supported ? m_GpuQueues.back().get() : nullptr;
+}
+
+void TimelineProfiler::BeginGpuScope(IDeviceContext* pContext, const char* Name)
+{
+    std::lock_guard<std::mutex> Lock{m_GpuMtx};
+    if (!m_pDevice)
+        return;
+
+    GpuQueue* pQueue = FindGpuQueue(pContext);
+    if (pQueue == nullptr)
+        return;
+
+    GpuQueue::Scope Scope;
+    Scope.Name    = Name;
+    Scope.CpuTime = GetTime();
+    const auto AcquireQuery = [&]() {
+        RefCntAutoPtr<IQuery> pQuery;
+        if (!pQueue->FreeQueries.empty())
+        {
+            pQuery = std::move(pQueue->FreeQueries.back());
+            pQueue->FreeQueries.pop_back();
+        }
+        else
+        {
+            QueryDesc Desc;
+            Desc.Name = "Timeline profiler timestamp";
+            Desc.Type = QUERY_TYPE_TIMESTAMP;
+            m_pDevice->CreateQuery(Desc, &pQuery);
+        }
+        return pQuery;
+    };
+    Scope.pBeginQuery = AcquireQuery();
+    Scope.pEndQuery   = AcquireQuery();
+
+    if (Scope.pBeginQuery && Scope.pEndQuery)
+        pContext->EndQuery(Scope.pBeginQuery);
+    pQueue->OpenScopes.emplace_back(std::move(Scope));
+}
+
+void TimelineProfiler::EndGpuScope(IDeviceContext* pContext)
+{
+    std::lock_guard<std::mutex> Lock{m_GpuMtx};
+    if (!m_pDevice)
+        return;
+
+    GpuQueue* pQueue = FindGpuQueue(pContext);
+    if (pQueue == nullptr)
+        return;
+
+    VERIFY(!pQueue->OpenScopes.empty(), "EndGpuScope() is called without matching BeginGpuScope()");
+    if (pQueue->OpenScopes.empty())
+        return;
+
+    auto Scope = std::move(pQueue->OpenScopes.back());
+    pQueue->OpenScopes.pop_back();
+    if (!Scope.pBeginQuery || !Scope.pEndQuery)
+        return;
+
+    if (pQueue->PendingScopes.size() >= GpuQueue::MaxPendingScopes)
+    {
+        // The queries are never resolved if the context is not flushed; stop measuring rather than growing the queue
+        m_NumDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    pContext->EndQuery(Scope.pEndQuery);
+    pQueue->PendingScopes.emplace_back(std::move(Scope));
+}
+
+void TimelineProfiler::EndFrame()
+{
+    std::lock_guard<std::mutex> Lock{m_GpuMtx};
+    for (auto& pQueue : m_GpuQueues)
+    {
+        // Queries complete in order, so stop at the first scope that is not ready
+        while (!pQueue->PendingScopes.empty())
+        {
+            auto& Scope = pQueue->PendingScopes.front();
+
+            QueryDataTimestamp BeginData, EndData;
+            if (!Scope.pEndQuery->GetData(&EndData, sizeof(EndData), false) ||
+                !Scope.pBeginQuery->GetData(&BeginData, sizeof(BeginData), false))
+                break;
+
+            const auto ToNanoseconds = [](const QueryDataTimestamp& Data) {
+                return static_cast<Uint64>(static_cast<double>(Data.Counter) * 1e+9 / static_cast<double>(std::max(Data.Frequency, Uint64{1})));
+            };
+            const Event Evt{Scope.Name, ToNanoseconds(BeginData), ToNanoseconds(EndData)};
+            if (pQueue->Events.size() >= GpuQueue::MaxEvents)
+            {
+                pQueue->Events.pop_front();
+                m_NumDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            }
+            pQueue->Events.push_back(Evt);
+
+            // The commands could not have started before they were recorded
+            const Int64 Offset   = static_cast<Int64>(Scope.CpuTime) - static_cast<Int64>(Evt.BeginTime);
+            pQueue->CpuTimeOffset = pQueue->HasTimeOffset ? std::max(pQueue->CpuTimeOffset, Offset) : Offset;
+            pQueue->HasTimeOffset = true;
+
+            Scope.pBeginQuery->Invalidate();
+            Scope.pEndQuery->Invalidate();
+            pQueue->FreeQueries.emplace_back(std::move(Scope.pBeginQuery));
+            pQueue->FreeQueries.emplace_back(std::move(Scope.pEndQuery));
+            pQueue->PendingScopes.pop_front();
+        }
+    }
+}
+
+bool TimelineProfiler::WriteTrace(const char* Path)
+{
+    if (Path == nullptr)
+        Path = m_TracePath.c_str();
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    ss << "{\"ph\":\"M\",\"pid\":" << CpuPid << ",\"name\":\"process_name\",\"args\":{\"name\":\"CPU\"}}";
+
+    {
+        std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+        for (const auto& pThread : m_Threads)
+        {
+            const std::string Name = !pThread->Name.empty() ? pThread->Name : "Thread " + std::to_string(pThread->ThreadIndex);
+            WriteTrackName(ss, "thread_name", CpuPid, pThread->ThreadIndex, Name.c_str());
+
+            for (const auto* pChunk = pThread->pFirstChunk.get(); pChunk != nullptr; pChunk = pChunk->pNext.load(std::memory_order_acquire))
+            {
+                const Uint32 NumEvents = pChunk->NumEvents.load(std::memory_order_acquire);
+                for (Uint32 i = 0; i < NumEvents; ++i)
+                {
+                    const auto& Evt = pChunk->Events[i];
+                    WriteCompleteEvent(ss, Evt.Name, CpuPid, pThread->ThreadIndex, static_cast<double>(Evt.BeginTime), static_cast<double>(Evt.EndTime));
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock{m_GpuMtx};
+        if (!m_GpuQueues.empty())
+            ss << ",\n{\"ph\":\"M\",\"pid\":" << GpuPid << ",\"name\":\"process_name\",\"args\":{\"name\":\"GPU\"}}";
+
+        for (const auto& pQueue : m_GpuQueues)
+        {
+            if (!pQueue->Supported)
+                continue;
+
+            const char* CtxName = pQueue->pContext->GetDesc().Name;
+            WriteTrackName(ss, "thread_name", GpuPid, pQueue->TrackId, CtxName != nullptr ? CtxName : "Immediate context");
+            for (const auto& Evt : pQueue->Events)
+            {
+                WriteCompleteEvent(ss, Evt.Name, GpuPid, pQueue->TrackId,
+                                   static_cast<double>(static_cast<Int64>(Evt.BeginTime) + pQueue->CpuTimeOffset),
+                                   static_cast<double>(static_cast<Int64>(Evt.EndTime) + pQueue->CpuTimeOffset));
+            }
+        }
+    }
+    ss << "\n]}\n";
+
+    if (const auto NumDroppedEvents = m_NumDroppedEvents.load())
+        LOG_WARNING_MESSAGE(NumDroppedEvents, " profiler events were dropped because the event buffers are full");
+
+    const auto Trace = ss.str();
+
+    FileWrapper pFile(Path, EFileAccessMode::Overwrite);
+    if (pFile && pFile->Write(Trace.data(), Trace.size()))
+    {
+        LOG_INFO_MESSAGE("Timeline trace is written to '", Path, "'.");
+        return true;
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to write timeline trace to '", Path, "'.");
+        return false;
+    }
+}
+
+} // namespace Diligent
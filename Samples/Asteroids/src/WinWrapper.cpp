@@ -191,9 +191,13 @@ LRESULT CALLBACK WindowProc(
                 gSettings.submitRendering = !gSettings.submitRendering;
                 std::cout << "Submit Rendering: " << gSettings.submitRendering << std::endl;
                 return 0;
+            case 'C':
+                gSettings.frustumCulling = !gSettings.frustumCulling;
+                std::cout << "Frustum Culling: " << gSettings.frustumCulling << std::endl;
+                return 0;
             case 'B':
-                if (gSettings.mode == Settings::RenderMode::DiligentD3D12 || gSettings.mode == Settings::RenderMode::DiligentVulkan) {
-                    gSettings.resourceBindingMode = (gSettings.resourceBindingMode + 1) % 4;
+                if (gSettings.mode == Settings::RenderMode::DiligentD3D11 || gSettings.mode == Settings::RenderMode::DiligentD3D12 || gSettings.mode == Settings::RenderMode::DiligentVulkan) {
+                    gSettings.resourceBindingMode = (gSettings.resourceBindingMode + 1) % 5;
                     gUpdateWorkload = true;
                 }
                 return 0;
@@ -210,7 +214,7 @@ LRESULT CALLBACK WindowProc(
                 return 0;
 
             case '1': gSettings.mode = gd3d11Available ? Settings::RenderMode::NativeD3D11 : gSettings.mode; return 0;
-            case '2': gSettings.mode = gd3d12Available ? Settings::RenderMode::NativeD3D12 : gSettings.mode; return 0;
+            case '2': gSettings.mode = gd3d12Available && gSettings.numAsteroids == NUM_ASTEROIDS ? Settings::RenderMode::NativeD3D12 : gSettings.mode; return 0;
             case '3': gSettings.mode = gd3d11Available ? Settings::RenderMode::DiligentD3D11 : gSettings.mode; return 0;
             case '4': gSettings.mode = gd3d12Available ? Settings::RenderMode::DiligentD3D12 : gSettings.mode; return 0;
             case '5': gSettings.mode = gVulkanAvailable ? Settings::RenderMode::DiligentVulkan : gSettings.mode; return 0;
@@ -409,6 +413,10 @@ int main(int argc, char** argv)
             gSettings.lockedFrameRate = atoi(argv[++a]);
         } else if (_stricmp(argv[a], "-threads") == 0 && a + 1 < argc) {
             gSettings.numThreads = atoi(argv[++a]);
+        } else if (_stricmp(argv[a], "-asteroids") == 0 && a + 1 < argc) {
+            gSettings.numAsteroids = std::max(atoi(argv[++a]), 1);
+        } else if (_stricmp(argv[a], "-instanced") == 0) {
+            gSettings.resourceBindingMode = 4;
         } else if (_stricmp(argv[a], "-d3d11") == 0) {
             gSettings.mode = Settings::RenderMode::DiligentD3D11;
         } else if (_stricmp(argv[a], "-d3d12") == 0) {
@@ -427,6 +435,8 @@ int main(int argc, char** argv)
             fprintf(stderr, "  -render_scale [scale]\n");
             fprintf(stderr, "  -locked_fps [fps]\n");
             fprintf(stderr, "  -warp\n");
+            fprintf(stderr, "  -asteroids [count] (Diligent and native D3D11 modes only)\n");
+            fprintf(stderr, "  -instanced\n");
             return -1;
         }
     }
@@ -450,7 +460,7 @@ int main(int argc, char** argv)
     ResetCameraView();
     // Camera projection set up in WM_SIZE
 
-    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES);
+    AsteroidsSimulation asteroids(1337, gSettings.numAsteroids, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES);
 
     if (gSettings.mode == Settings::RenderMode::Undefined)
     {
@@ -566,13 +576,10 @@ int main(int argc, char** argv)
                 break;
 
                 case Settings::RenderMode::DiligentD3D11:
-                    ModeStr = "Diligent D3D11";
-                    gWorkloadDE->GetPerfCounters(updateTime, renderTime);
-                break;
-
                 case Settings::RenderMode::DiligentD3D12:
                 case Settings::RenderMode::DiligentVulkan:
-                    ModeStr = gSettings.mode == Settings::RenderMode::DiligentD3D12 ? "Diligent D3D12" : "Diligent Vk";
+                    ModeStr = gSettings.mode == Settings::RenderMode::DiligentD3D11 ? "Diligent D3D11" :
+                        (gSettings.mode == Settings::RenderMode::DiligentD3D12 ? "Diligent D3D12" : "Diligent Vk");
                     gWorkloadDE->GetPerfCounters(updateTime, renderTime);
                     switch (gSettings.resourceBindingMode)
                     {
@@ -580,6 +587,7 @@ int main(int argc, char** argv)
                         case 1: resBindModeStr = "-mut";break;
                         case 2: resBindModeStr = "-tex_mut";break;
                         case 3: resBindModeStr = "-bindless";break;
+                        case 4: resBindModeStr = "-instanced";break;
                     }
                 break;
             }
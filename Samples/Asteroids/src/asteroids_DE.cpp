@@ -88,7 +88,7 @@ struct AsteroidData
 {
     DirectX::XMFLOAT4X4 mWorld;
     DirectX::XMFLOAT3   mSurfaceColor;
-    float               unused0;
+    Uint32              mVertexStart; // Only used in instanced mode
     DirectX::XMFLOAT3   mDeepColor;
     Uint32              mTextureIndex;
 };
@@ -216,21 +216,23 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
 {
     QueryPerformanceFrequency((LARGE_INTEGER*)&mPerfCounterFreq);
 
-    mNumSubsets = std::max(settings.numThreads, 1);
-    mNumSubsets = std::min(settings.numThreads, 32);
+    // Every subset must contain at least one asteroid
+    mNumSubsets = static_cast<Uint32>(std::min(std::max(settings.numThreads, 1), 32));
+    mNumSubsets = std::max(std::min(mNumSubsets, static_cast<Uint32>(mAsteroids->Core().Count())), 1u);
 
     InitDevice(hWnd, DevType);
 
     m_BindingMode = static_cast<BindingMode>(settings.resourceBindingMode);
     if (m_BindingMode == BindingMode::Bindless && !mDevice->GetDeviceInfo().Features.BindlessResources)
         m_BindingMode = BindingMode::TextureMutable;
+    // Both bindless and instanced modes read asteroid data from a structured buffer
+    const bool UseDataBuffer = m_BindingMode == BindingMode::Bindless || m_BindingMode == BindingMode::Instanced;
 
     mCmdLists.resize(mDeferredCtxt.size());
-    mWorkerThreads.resize(mNumSubsets - 1);
-    for (auto& thread : mWorkerThreads)
-    {
-        thread = std::thread(WorkerThreadFunc, this, (Uint32)(&thread - mWorkerThreads.data()));
-    }
+    mVisibleAsteroids.resize(mNumSubsets);
+    mVisibleSubdivOffsets.resize(mNumSubsets);
+    // Thread 0 is the main thread. Worker thread i renders subset i using deferred context i-1.
+    mTaskScheduler.reset(new TaskScheduler{mNumSubsets - 1});
 
     const char* spriteFile = nullptr;
     switch (DevType)
@@ -249,23 +251,24 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
     std::vector<StateTransitionDesc> Barriers;
     mBackBufferWidth                = mSwapChain->GetDesc().Width;
     mBackBufferHeight               = mSwapChain->GetDesc().Height;
-    const auto MaxAsteroidsInSubset = (NUM_ASTEROIDS + mNumSubsets - 1) / mNumSubsets;
+    const auto NumAsteroids         = static_cast<Uint32>(mAsteroids->Core().Count());
+    const auto MaxAsteroidsInSubset = (NumAsteroids + mNumSubsets - 1) / mNumSubsets;
 
     {
         BufferDesc desc;
         desc.Name = "Asteroids constant buffer";
-        // In bindless mode we will be updating the buffer with UpdateBuffer method
-        desc.Usage          = (m_BindingMode == BindingMode::Bindless) ? USAGE_DEFAULT : USAGE_DYNAMIC;
+        // In bindless and instanced modes we will be updating the buffer with UpdateBuffer method
+        desc.Usage          = UseDataBuffer ? USAGE_DEFAULT : USAGE_DYNAMIC;
         desc.CPUAccessFlags = desc.Usage == USAGE_DYNAMIC ? CPU_ACCESS_WRITE : CPU_ACCESS_NONE;
         desc.BindFlags      = BIND_UNIFORM_BUFFER;
-        // In bindless mode, we will only write view-projection matrix
-        desc.Size = static_cast<Uint32>((m_BindingMode == BindingMode::Bindless) ? sizeof(DirectX::XMFLOAT4X4) : sizeof(DrawConstantBuffer));
+        // In bindless and instanced modes, we will only write view-projection matrix
+        desc.Size = static_cast<Uint32>(UseDataBuffer ? sizeof(DirectX::XMFLOAT4X4) : sizeof(DrawConstantBuffer));
         mDevice->CreateBuffer(desc, nullptr, &mDrawConstantBuffer);
-        if (m_BindingMode != BindingMode::Bindless)
+        if (!UseDataBuffer)
             Barriers.emplace_back(mDrawConstantBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
-    if (m_BindingMode == BindingMode::Bindless)
+    if (UseDataBuffer)
     {
         {
             // In Direct3D there is no easy way to pass draw call number into the shader,
@@ -286,7 +289,8 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
 
         {
             // Structured buffer that contains asteroid data. Every thread needs to use
-            // its own buffer.
+            // its own buffer. The buffer is dynamic, so mapping it with MAP_FLAG_DISCARD
+            // every frame suballocates it from the context's persistently mapped upload ring.
             BufferDesc desc;
             desc.Name              = "Asteroids data buffer";
             desc.Usage             = USAGE_DYNAMIC;
@@ -316,11 +320,25 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             LayoutElement{1, 0, 3, VT_FLOAT32},
             LayoutElement{2, 1, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
         };
+        // In instanced mode vertices are fetched from the structured buffer in the shader,
+        // and the instance ID buffer is the only input
+        LayoutElement instancedInputDesc[] =
+        {
+            LayoutElement{2, 0, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+        };
         // clang-format on
 
-        GraphicsPipeline.InputLayout.LayoutElements = inputDesc;
-        // In bindless mode we will use instance ID buffer as the third input
-        GraphicsPipeline.InputLayout.NumElements = (m_BindingMode == BindingMode::Bindless) ? 3 : 2;
+        if (m_BindingMode == BindingMode::Instanced)
+        {
+            GraphicsPipeline.InputLayout.LayoutElements = instancedInputDesc;
+            GraphicsPipeline.InputLayout.NumElements    = _countof(instancedInputDesc);
+        }
+        else
+        {
+            GraphicsPipeline.InputLayout.LayoutElements = inputDesc;
+            // In bindless mode we will use instance ID buffer as the third input
+            GraphicsPipeline.InputLayout.NumElements = (m_BindingMode == BindingMode::Bindless) ? 3 : 2;
+        }
 
         GraphicsPipeline.DepthStencilDesc.DepthFunc = COMPARISON_FUNC_GREATER_EQUAL;
 
@@ -333,11 +351,16 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             attribs.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
             attribs.pShaderSourceStreamFactory = pShaderSourceFactory;
 
-            ShaderMacro Macros[] = {{"BINDLESS", "1"}};
+            ShaderMacro Macros[]          = {{"BINDLESS", "1"}};
+            ShaderMacro InstancedMacros[] = {{"INSTANCED", "1"}};
             if (m_BindingMode == BindingMode::Bindless)
             {
                 attribs.Macros = {Macros, _countof(Macros)};
             }
+            else if (m_BindingMode == BindingMode::Instanced)
+            {
+                attribs.Macros = {InstancedMacros, _countof(InstancedMacros)};
+            }
 
             mDevice->CreateShader(attribs, &vs);
         }
@@ -350,11 +373,16 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             attribs.pShaderSourceStreamFactory = pShaderSourceFactory;
             attribs.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
 
-            ShaderMacro Macros[] = {{"BINDLESS", "1"}};
+            ShaderMacro Macros[]          = {{"BINDLESS", "1"}};
+            ShaderMacro InstancedMacros[] = {{"INSTANCED", "1"}};
             if (m_BindingMode == BindingMode::Bindless)
             {
                 attribs.Macros = {Macros, _countof(Macros)};
             }
+            else if (m_BindingMode == BindingMode::Instanced)
+            {
+                attribs.Macros = {InstancedMacros, _countof(InstancedMacros)};
+            }
 
             mDevice->CreateShader(attribs, &ps);
         }
@@ -380,8 +408,10 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         std::vector<ShaderResourceVariableDesc> Variables =
             {
                 {SHADER_TYPE_PIXEL, "Tex", m_BindingMode == BindingMode::Dynamic ? SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC : SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
-        if (m_BindingMode == BindingMode::Bindless)
+        if (UseDataBuffer)
             Variables.emplace_back(SHADER_TYPE_VERTEX, "g_Data", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        if (m_BindingMode == BindingMode::Instanced)
+            Variables.emplace_back(SHADER_TYPE_VERTEX, "g_Vertices", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
 
         PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
         PSODesc.ResourceLayout.Variables           = Variables.data();
@@ -409,7 +439,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         {
             // Create one SRB per asteroid in mutable binding mode
             PSODesc.SRBAllocationGranularity = 1024;
-            NumSRBs                          = NUM_ASTEROIDS;
+            NumSRBs                          = NumAsteroids;
         }
         else if (m_BindingMode == BindingMode::TextureMutable)
         {
@@ -417,9 +447,9 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             PSODesc.SRBAllocationGranularity = NUM_UNIQUE_TEXTURES;
             NumSRBs                          = NUM_UNIQUE_TEXTURES;
         }
-        else if (m_BindingMode == BindingMode::Bindless)
+        else if (UseDataBuffer)
         {
-            // Create one SRB per subset for bindless mode
+            // Create one SRB per subset for bindless and instanced modes
             NumSRBs = mNumSubsets;
         }
         mAsteroidsSRBs.resize(NumSRBs);
@@ -617,7 +647,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
     if (m_BindingMode == BindingMode::Mutable)
     {
         // Bind the corresponding texture to the asteroids's SRB
-        for (size_t srb = 0; srb < NUM_ASTEROIDS; ++srb)
+        for (size_t srb = 0; srb < NumAsteroids; ++srb)
         {
             auto staticData = &mAsteroids->StaticData()[srb];
             mAsteroidsSRBs[srb]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex")->Set(mTextureSRVs[staticData->textureIndex]);
@@ -643,6 +673,16 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_VERTEX, "g_Data")->Set(mAsteroidsDataBuffers[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
         }
     }
+    else if (m_BindingMode == BindingMode::Instanced)
+    {
+        auto* pVerticesSRV = mVertexBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+        {
+            mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex")->Set(mTextureArraySRV);
+            mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_VERTEX, "g_Data")->Set(mAsteroidsDataBuffers[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+            mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_VERTEX, "g_Vertices")->Set(pVerticesSRV);
+        }
+    }
     mDeviceCtxt->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 }
 
@@ -651,12 +691,7 @@ Asteroids::~Asteroids()
     mDeviceCtxt->Flush();
     mDeviceCtxt->FinishFrame();
 
-    mUpdateSubsetsSignal.Trigger(true, -1);
-
-    for (auto& thread : mWorkerThreads)
-    {
-        thread.join();
-    }
+    mTaskScheduler.reset();
 }
 
 
@@ -680,13 +715,22 @@ void Asteroids::CreateMeshes()
         desc.Size      = (Uint32)asteroidMeshes->vertices.size() * sizeof(asteroidMeshes->vertices[0]);
         desc.BindFlags = BIND_VERTEX_BUFFER;
         desc.Usage     = USAGE_DEFAULT;
+        if (m_BindingMode == BindingMode::Instanced)
+        {
+            // Vertices are fetched in the shader. Structured buffers can't be bound as vertex buffers in D3D11.
+            desc.BindFlags         = BIND_SHADER_RESOURCE;
+            desc.Mode              = BUFFER_MODE_STRUCTURED;
+            desc.ElementByteStride = static_cast<Uint32>(sizeof(asteroidMeshes->vertices[0]));
+        }
 
         BufferData data;
         data.pData    = asteroidMeshes->vertices.data();
         data.DataSize = desc.Size;
 
         mDevice->CreateBuffer(desc, &data, &mVertexBuffer);
-        Barriers.emplace_back(mVertexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        Barriers.emplace_back(mVertexBuffer, RESOURCE_STATE_UNKNOWN,
+                              m_BindingMode == BindingMode::Instanced ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_VERTEX_BUFFER,
+                              STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
     // create index buffer
@@ -772,6 +816,33 @@ void Asteroids::InitializeTextureData()
         mTextureSRVs[t]->SetSampler(mSamplerState);
         Barriers.emplace_back(mTextures[t], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
+
+    if (m_BindingMode == BindingMode::Instanced)
+    {
+        // Pack all textures into one array so that asteroids with different
+        // textures can be drawn by the same draw call
+        const auto SlicesPerTexture = textureDesc.ArraySize;
+        textureDesc.Name            = "Asteroid texture array";
+        textureDesc.ArraySize       = SlicesPerTexture * NUM_UNIQUE_TEXTURES;
+
+        // Subresources of every slice are stored contiguously, so per-texture data can be concatenated
+        std::vector<TextureSubResData> subResData;
+        subResData.reserve(size_t{textureDesc.ArraySize} * size_t{mAsteroids->GetTextureMipLevels()});
+        for (UINT t = 0; t < NUM_UNIQUE_TEXTURES; ++t)
+        {
+            auto* texData = mAsteroids->TextureData(t);
+            for (size_t subRes = 0; subRes < size_t{SlicesPerTexture} * size_t{mAsteroids->GetTextureMipLevels()}; ++subRes)
+                subResData.emplace_back(texData[subRes].pSysMem, texData[subRes].SysMemPitch, texData[subRes].SysMemSlicePitch);
+        }
+        TextureData initData;
+        initData.NumSubresources = (Uint32)subResData.size();
+        initData.pSubResources   = subResData.data();
+
+        mDevice->CreateTexture(textureDesc, &initData, &mTextureArray);
+        mTextureArraySRV = mTextureArray->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        mTextureArraySRV->SetSampler(mSamplerState);
+        Barriers.emplace_back(mTextureArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    }
     mDeviceCtxt->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 }
 
@@ -821,39 +892,6 @@ void Asteroids::CreateGUIResources()
 
 static_assert(sizeof(IndexType) == 2, "Expecting 16-bit index buffer");
 
-void Asteroids::WorkerThreadFunc(Asteroids* pThis, Uint32 ThreadNum)
-{
-    for (;;)
-    {
-        // Wait for UpdateSubsets signal
-        auto SignalledValue = pThis->mUpdateSubsetsSignal.Wait();
-        if (SignalledValue < 0)
-            return;
-
-        auto  SubsetSize   = NUM_ASTEROIDS / pThis->mNumSubsets;
-        auto  SubsetStart  = SubsetSize * (ThreadNum + 1);
-        auto& FrameAttribs = pThis->mFrameAttribs;
-
-        pThis->mAsteroids->Update(FrameAttribs.frameTime, FrameAttribs.camera->Eye(), *FrameAttribs.settings, SubsetStart, SubsetSize);
-
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
-
-
-        // Wait for RenderSubsets signal
-        pThis->mRenderSubsetsSignal.Wait();
-
-        pThis->RenderSubset(1 + ThreadNum, pThis->mDeferredCtxt[ThreadNum], *FrameAttribs.camera, SubsetStart, SubsetSize);
-
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pThis->mCmdLists[ThreadNum].Release();
-        pThis->mDeferredCtxt[ThreadNum]->FinishCommandList(&pThis->mCmdLists[ThreadNum]);
-
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
-    }
-}
-
 void Asteroids::RenderSubset(Uint32             SubsetNum,
                              IDeviceContext*    pCtx,
                              const OrbitCamera& camera,
@@ -868,11 +906,20 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
     pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
     // Frame data
-    auto staticAsteroidData  = mAsteroids->StaticData();
-    auto dynamicAsteroidData = mAsteroids->DynamicData();
+    auto staticAsteroidData = mAsteroids->StaticData();
 
     pCtx->SetPipelineState(mAsteroidsPSO);
 
+    const bool useDataBuffer = m_BindingMode == BindingMode::Bindless || m_BindingMode == BindingMode::Instanced;
+
+    if (m_BindingMode == BindingMode::Instanced)
+    {
+        // Vertices are fetched in the shader, so only bind the instance ID buffer
+        IBuffer* ia_buffers[] = {mInstanceIDBuffer};
+        pCtx->SetVertexBuffers(0, 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
+        pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    }
+    else
     {
         IBuffer* ia_buffers[] = {mVertexBuffer, mInstanceIDBuffer};
         // Bind instance data buffer in bindless mode
@@ -880,19 +927,29 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
-    if (m_BindingMode == BindingMode::Bindless)
+    // Only draw asteroids that passed frustum culling, sorted by texture
+    // (by subdiv level in instanced mode)
+    auto& visibleAsteroids = mVisibleAsteroids[SubsetNum];
+    auto& subdivOffsets    = mVisibleSubdivOffsets[SubsetNum];
+    if (m_BindingMode == BindingMode::Instanced)
+        mAsteroids->GetVisibleAsteroidsBySubdiv(startIdx, numAsteroids, visibleAsteroids, subdivOffsets);
+    else
+        mAsteroids->GetVisibleAsteroids(startIdx, numAsteroids, visibleAsteroids);
+    const auto numVisible = static_cast<Uint32>(visibleAsteroids.size());
+
+    if (useDataBuffer)
     {
         {
             // Update asteroid data buffer
             MapHelper<AsteroidData> asteroidData(pCtx, mAsteroidsDataBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
-            UINT                    i = 0;
-            for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx, ++i)
+            for (Uint32 i = 0; i < numVisible; ++i)
             {
-                const auto staticData  = &staticAsteroidData[drawIdx];
-                const auto dynamicData = &dynamicAsteroidData[drawIdx];
+                const auto drawIdx    = visibleAsteroids[i];
+                const auto staticData = &staticAsteroidData[drawIdx];
 
-                XMStoreFloat4x4(&asteroidData[i].mWorld, dynamicData->world);
+                mAsteroids->WorldMatrix(drawIdx, &asteroidData[i].mWorld);
                 asteroidData[i].mSurfaceColor = staticData->surfaceColor;
+                asteroidData[i].mVertexStart  = staticData->vertexStart;
                 asteroidData[i].mDeepColor    = staticData->deepColor;
                 asteroidData[i].mTextureIndex = staticData->textureIndex;
             }
@@ -905,17 +962,38 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
+    if (m_BindingMode == BindingMode::Instanced)
+    {
+        // All meshes of the same subdiv level share the index range, and vertices of the
+        // mesh are located with the VertexStart field of the asteroid data.
+        // Draw every subdiv level with one instanced draw call.
+        for (Uint32 subdiv = 0; subdiv < mAsteroids->SubdivLevelCount(); ++subdiv)
+        {
+            const auto numInstances = subdivOffsets[subdiv + 1] - subdivOffsets[subdiv];
+            if (numInstances == 0)
+                continue;
+
+            DrawIndexedAttribs attribs(mAsteroids->SubdivIndexCount(subdiv), VT_UINT16, DRAW_FLAG_VERIFY_ALL | DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT, numInstances);
+            attribs.FirstIndexLocation    = mAsteroids->SubdivIndexStart(subdiv);
+            attribs.FirstInstanceLocation = subdivOffsets[subdiv];
+            pCtx->DrawIndexed(attribs);
+        }
+        return;
+    }
+
     const auto& viewProjection = camera.ViewProjection();
     auto        pVar           = m_BindingMode == BindingMode::Dynamic ? mAsteroidsSRBs[SubsetNum]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex") : nullptr;
-    for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx)
+    // Asteroids are sorted by texture, so the SRB only changes when the texture does
+    auto currTextureIndex = ~0u;
+    for (Uint32 i = 0; i < numVisible; ++i)
     {
-        const auto staticData  = &staticAsteroidData[drawIdx];
-        const auto dynamicData = &dynamicAsteroidData[drawIdx];
+        const auto drawIdx    = visibleAsteroids[i];
+        const auto staticData = &staticAsteroidData[drawIdx];
 
         if (m_BindingMode != BindingMode::Bindless)
         {
             MapHelper<DrawConstantBuffer> drawConstants(pCtx, mDrawConstantBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-            XMStoreFloat4x4(&drawConstants->mWorld, dynamicData->world);
+            mAsteroids->WorldMatrix(drawIdx, &drawConstants->mWorld);
             XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
             drawConstants->mSurfaceColor = staticData->surfaceColor;
             drawConstants->mDeepColor    = staticData->deepColor;
@@ -924,8 +1002,11 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
 
         if (m_BindingMode == BindingMode::Dynamic)
         {
-            pVar->Set(mTextureSRVs[staticData->textureIndex]);
-            pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            if (staticData->textureIndex != currTextureIndex)
+            {
+                pVar->Set(mTextureSRVs[staticData->textureIndex]);
+                pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            }
         }
         else if (m_BindingMode == BindingMode::Mutable)
         {
@@ -933,11 +1014,13 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         }
         else if (m_BindingMode == BindingMode::TextureMutable)
         {
-            pCtx->CommitShaderResources(mAsteroidsSRBs[staticData->textureIndex], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            if (staticData->textureIndex != currTextureIndex)
+                pCtx->CommitShaderResources(mAsteroidsSRBs[staticData->textureIndex], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
         }
+        currTextureIndex = staticData->textureIndex;
 
-        DrawIndexedAttribs attribs(dynamicData->indexCount, VT_UINT16, DRAW_FLAG_VERIFY_ALL);
-        attribs.FirstIndexLocation = dynamicData->indexStart;
+        DrawIndexedAttribs attribs(mAsteroids->IndexCount(drawIdx), VT_UINT16, DRAW_FLAG_VERIFY_ALL);
+        attribs.FirstIndexLocation = mAsteroids->IndexStart(drawIdx);
         attribs.BaseVertex         = staticData->vertexStart;
 
         if (m_BindingMode == BindingMode::Bindless)
@@ -945,7 +1028,7 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
             // It is very important to specify this flag to make sure the engine does not do extra
             // work processing buffers that stay intact.
             attribs.Flags |= DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT;
-            attribs.FirstInstanceLocation = drawIdx - startIdx;
+            attribs.FirstInstanceLocation = i;
         }
 
         pCtx->DrawIndexed(attribs);
@@ -954,10 +1037,6 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
 
 void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Settings& settings)
 {
-    mFrameAttribs.frameTime = frameTime;
-    mFrameAttribs.camera    = &camera;
-    mFrameAttribs.settings  = &settings;
-
     // Clear the render target
     float clearcol[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     auto* pRTV        = mSwapChain->GetCurrentBackBufferRTV();
@@ -970,9 +1049,13 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mUpdateTicks = currCounter;
 
-    auto SubsetSize = NUM_ASTEROIDS / mNumSubsets;
+    // Subset i covers [i * N / NumSubsets, (i + 1) * N / NumSubsets), which spreads the remainder over the subsets
+    const auto NumAsteroids   = static_cast<Uint32>(mAsteroids->Core().Count());
+    const auto GetSubsetStart = [&](Uint32 Subset) {
+        return static_cast<Uint32>(Uint64{NumAsteroids} * Subset / mNumSubsets);
+    };
 
-    if (m_BindingMode == BindingMode::Bindless)
+    if (m_BindingMode == BindingMode::Bindless || m_BindingMode == BindingMode::Instanced)
     {
         // Write view-projection matrix into the buffer
         const auto& viewProjection = camera.ViewProjection();
@@ -984,21 +1067,19 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
     if (settings.multithreadedRendering)
     {
-        m_NumThreadsCompleted = 0;
-        mUpdateSubsetsSignal.Trigger(true);
+        // Asteroids are updated independently of each other, so any thread may update
+        // any range. Use ranges that are several times smaller than the subset to let
+        // threads that finish early steal the remaining work.
+        const Uint32 GrainSize = std::max(NumAsteroids / (mNumSubsets * 4), 64u);
+        mTaskScheduler->ParallelFor(0, NumAsteroids, GrainSize,
+                                    [&](Uint32, Uint32 Begin, Uint32 End) {
+                                        mAsteroids->Update(frameTime, camera, settings, Begin, End - Begin);
+                                    });
     }
-
-    // Update all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        mAsteroids->Update(frameTime, camera.Eye(), settings, SubsetSize * i, SubsetSize);
-
-    if (settings.multithreadedRendering)
+    else
     {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mUpdateSubsetsSignal while all threads are waiting for mRenderSubsetsSignal
-        mUpdateSubsetsSignal.Reset();
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+            mAsteroids->Update(frameTime, camera, settings, GetSubsetStart(i), GetSubsetStart(i + 1) - GetSubsetStart(i));
     }
 
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -1008,22 +1089,18 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
     if (settings.multithreadedRendering)
     {
-        // Signal RenderSubsets
-        m_NumThreadsCompleted = 0;
-        mRenderSubsetsSignal.Trigger(true);
-    }
-
-    // Render all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        RenderSubset(i, mDeviceCtxt, camera, SubsetSize * i, SubsetSize);
+        // Every subset has its own data buffer and SRB, so every thread renders a fixed subset
+        mTaskScheduler->RunOnAllThreads([&](Uint32 ThreadId) {
+            if (ThreadId == 0)
+            {
+                RenderSubset(0, mDeviceCtxt, camera, 0, GetSubsetStart(1));
+                return;
+            }
 
-    if (settings.multithreadedRendering)
-    {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mRenderSubsetsSignal while all threads are waiting for mUpdateSubsetsSignal
-        mRenderSubsetsSignal.Reset();
+            auto* pDeferredCtx = mDeferredCtxt[ThreadId - 1].RawPtr();
+            RenderSubset(ThreadId, pDeferredCtx, camera, GetSubsetStart(ThreadId), GetSubsetStart(ThreadId + 1) - GetSubsetStart(ThreadId));
+            pDeferredCtx->FinishCommandList(&mCmdLists[ThreadId - 1]);
+        });
 
         mCmdListPtrs.resize(mCmdLists.size());
         for (size_t i = 0; i < mCmdLists.size(); ++i)
@@ -1037,13 +1114,25 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
             // that cause swap chain resize to fail
             cmdList.Release();
         }
+
+        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+        // IMPORTANT: we must wait until the command lists are submitted for execution
+        // because FinishFrame() invalidates all dynamic resources.
+        // FinishFrame() is called from the thread that recorded the commands.
+        mTaskScheduler->RunOnAllThreads([&](Uint32 ThreadId) {
+            if (ThreadId != 0)
+                mDeferredCtxt[ThreadId - 1]->FinishFrame();
+        });
     }
+    else
+    {
+        // Render all subsets in this thread when multithreadedRendering is false
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+            RenderSubset(i, mDeviceCtxt, camera, GetSubsetStart(i), GetSubsetStart(i + 1) - GetSubsetStart(i));
 
-    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-    // IMPORTANT: we must wait until the command lists are submitted for execution
-    // because FinishFrame() invalidates all dynamic resources
-    for (auto& ctx : mDeferredCtxt)
-        ctx->FinishFrame();
+        for (auto& ctx : mDeferredCtxt)
+            ctx->FinishFrame();
+    }
 
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mRenderTicks = currCounter - mRenderTicks;
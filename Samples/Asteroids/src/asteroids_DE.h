@@ -14,10 +14,9 @@
 #include "SwapChain.h"
 #include "DeviceContext.h"
 #include "RefCntAutoPtr.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
 #include <map>
-#include <mutex>
-#include <atomic>
+#include <memory>
 
 #include "camera.h"
 #include "settings.h"
@@ -51,7 +50,9 @@ private:
         Dynamic = 0,
         Mutable,
         TextureMutable,
-        Bindless
+        Bindless,
+        // All visible asteroids of a subset that share the subdiv level are drawn by a single instanced draw call
+        Instanced
     }m_BindingMode = BindingMode::TextureMutable;
 
     AsteroidsSimulation*        mAsteroids = nullptr;
@@ -66,21 +67,13 @@ private:
     
     Diligent::Uint32 mBackBufferWidth, mBackBufferHeight;
     Diligent::Uint32 mNumSubsets = 0;
-    std::vector<std::thread> mWorkerThreads;
-    
-    std::mutex mMutex;
-    std::condition_variable mCondVar;
-    Threading::Signal mUpdateSubsetsSignal;
-    Threading::Signal mRenderSubsetsSignal;
-    std::atomic_int m_NumThreadsCompleted;
-    static void WorkerThreadFunc(Asteroids *pThis, Diligent::Uint32 ThreadNum);
-
-    struct FrameAttribs
-    {
-        float frameTime;
-        const OrbitCamera* camera;
-        const Settings* settings;
-    }mFrameAttribs;
+    std::unique_ptr<Diligent::TaskScheduler> mTaskScheduler;
+
+    // Indices of the visible asteroids of every subset, sorted by texture
+    // (or by subdiv level in instanced mode)
+    std::vector<std::vector<Diligent::Uint32>> mVisibleAsteroids;
+    // Offsets of every subdiv level in mVisibleAsteroids (instanced mode only)
+    std::vector<std::vector<Diligent::Uint32>> mVisibleSubdivOffsets;
 
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mIndexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mVertexBuffer;
@@ -108,6 +101,9 @@ private:
     Diligent::RefCntAutoPtr<Diligent::ITextureView> mFontTextureSRV;
     Diligent::RefCntAutoPtr<Diligent::ITexture> mTextures[NUM_UNIQUE_TEXTURES];
     Diligent::RefCntAutoPtr<Diligent::ITextureView> mTextureSRVs[NUM_UNIQUE_TEXTURES];
+    // All textures in one array, used in instanced mode
+    Diligent::RefCntAutoPtr<Diligent::ITexture> mTextureArray;
+    Diligent::RefCntAutoPtr<Diligent::ITextureView> mTextureArraySRV;
     Diligent::RefCntAutoPtr<Diligent::ISampler> mSamplerState;
 
     std::unique_ptr<GUISprite> mSprite;
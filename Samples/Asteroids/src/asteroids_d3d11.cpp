@@ -442,14 +442,13 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
 
     // Frame data
-    mAsteroids->Update(frameTime, camera.Eye(), settings);
+    mAsteroids->Update(frameTime, camera, settings);
     
     mTotalUpdateTicks = currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mTotalUpdateTicks = currCounter - mTotalUpdateTicks;
 
     auto staticAsteroidData = mAsteroids->StaticData();
-    auto dynamicAsteroidData = mAsteroids->DynamicData();
    
     // Clear the render target
     float clearcol[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
@@ -481,16 +480,19 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     mDeviceCtxt->OMSetBlendState(mBlendState, nullptr, 0xFFFFFFFF);
 
     auto viewProjection = camera.ViewProjection();
-    for (UINT drawIdx = 0; drawIdx < NUM_ASTEROIDS; ++drawIdx)
+    const auto numAsteroids = static_cast<UINT>(mAsteroids->Core().Count());
+    for (UINT drawIdx = 0; drawIdx < numAsteroids; ++drawIdx)
     {
+        if (!mAsteroids->Visible(drawIdx))
+            continue;
+
         auto staticData = &staticAsteroidData[drawIdx];
-        auto dynamicData = &dynamicAsteroidData[drawIdx];
 
         D3D11_MAPPED_SUBRESOURCE mapped = {};
         ThrowIfFailed(mDeviceCtxt->Map(mDrawConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
 
         auto drawConstants = (DrawConstantBuffer*) mapped.pData;
-        XMStoreFloat4x4(&drawConstants->mWorld,          dynamicData->world);
+        mAsteroids->WorldMatrix(drawIdx, &drawConstants->mWorld);
         XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
         drawConstants->mSurfaceColor = staticData->surfaceColor;
         drawConstants->mDeepColor    = staticData->deepColor;
@@ -499,7 +501,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
         mDeviceCtxt->PSSetShaderResources(0, 1, &mTextureSRVs[staticData->textureIndex]);
 
-        mDeviceCtxt->DrawIndexedInstanced(dynamicData->indexCount, 1, dynamicData->indexStart, staticData->vertexStart, 0);
+        mDeviceCtxt->DrawIndexedInstanced(mAsteroids->IndexCount(drawIdx), 1, mAsteroids->IndexStart(drawIdx), staticData->vertexStart, 0);
     }
 
     mTotalRenderTicks = currCounter;
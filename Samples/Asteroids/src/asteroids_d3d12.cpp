@@ -687,7 +687,6 @@ void Asteroids::RenderSubset(
     UINT drawEnd = std::min(drawStart + mDrawsPerSubset, (UINT)NUM_ASTEROIDS);
     assert(drawStart < drawEnd);
     auto staticAsteroidData = mAsteroids->StaticData();
-    auto dynamicAsteroidData = mAsteroids->DynamicData();
     // Frame data
     auto frame = &mFrame[frameIndex];
     auto drawConstantBuffers = frame->mDynamicUpload->DataWO()->mDrawConstantBuffers;
@@ -716,20 +715,21 @@ void Asteroids::RenderSubset(
     {
         // Standard draw path
         auto constantsPointer = frame->mDrawConstantBuffersGPUVA + sizeof(DrawConstantBuffer) * drawStart;
-        for (UINT drawIdx = drawStart; drawIdx < drawEnd; ++drawIdx)
+        for (UINT drawIdx = drawStart; drawIdx < drawEnd; ++drawIdx, constantsPointer += sizeof(DrawConstantBuffer))
         {
+            if (!mAsteroids->Visible(drawIdx))
+                continue;
+
             auto staticData = &staticAsteroidData[drawIdx];
-            auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            mAsteroids->WorldMatrix(drawIdx, &drawConstantBuffers[drawIdx].mWorld);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             // Set root cbuffer
             //cmdLst->SetGraphicsRootDescriptorTable(RP_TEX_SRV, mSRVDescs->GPU(0));
             cmdLst->SetGraphicsRootConstantBufferView(RP_DRAW_CBV, constantsPointer);
-            constantsPointer += sizeof(DrawConstantBuffer);
                     
-            cmdLst->DrawIndexedInstanced(dynamicData->indexCount, 1, dynamicData->indexStart, staticData->vertexStart, 0);
+            cmdLst->DrawIndexedInstanced(mAsteroids->IndexCount(drawIdx), 1, mAsteroids->IndexStart(drawIdx), staticData->vertexStart, 0);
         }
     }
     else
@@ -737,14 +737,13 @@ void Asteroids::RenderSubset(
         // ExecuteIndirect path
         for (UINT drawIdx = drawStart; drawIdx < drawEnd; ++drawIdx)
         {
-            auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            mAsteroids->WorldMatrix(drawIdx, &drawConstantBuffers[drawIdx].mWorld);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             auto drawIndexed = &indirectArgs[drawIdx].mDrawIndexed;
-            drawIndexed->IndexCountPerInstance = dynamicData->indexCount;
-            drawIndexed->StartIndexLocation = dynamicData->indexStart;
+            drawIndexed->IndexCountPerInstance = mAsteroids->IndexCount(drawIdx);
+            drawIndexed->StartIndexLocation = mAsteroids->IndexStart(drawIdx);
         }
 
         UINT64 offset = (BYTE*)(&indirectArgs[drawStart]) - (BYTE*)frame->mDynamicUpload->DataWO();
@@ -774,12 +773,12 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         concurrency::parallel_for<UINT>(0, mSubsetCount, [&](UINT subsetIdx) {
             UINT drawStart = mDrawsPerSubset * subsetIdx;
             UINT drawEnd = std::min(drawStart + mDrawsPerSubset, (UINT)NUM_ASTEROIDS);
-            mAsteroids->Update(frameTime, camera.Eye(), settings, drawStart, drawEnd - drawStart);
+            mAsteroids->Update(frameTime, camera, settings, drawStart, drawEnd - drawStart);
         });
     }
     else
     {
-        mAsteroids->Update(frameTime, camera.Eye(), settings, 0, (UINT)NUM_ASTEROIDS);
+        mAsteroids->Update(frameTime, camera, settings, 0, (UINT)NUM_ASTEROIDS);
     }
     LONG64 currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -28,6 +28,7 @@ public:
 
     DirectX::XMVECTOR const& Eye() const { return mEye; }
     DirectX::XMMATRIX const& ViewProjection() const { return mViewProjection; }
+    DirectX::XMMATRIX const& ProjectionMatrix() const { return mProjection; }
 
     void AddPointer(UINT pointerId);
     void ProcessPointerFrames(UINT pointerId, const POINTER_INFO* pointerInfo);
@@ -10,8 +10,14 @@
 
 #include "mesh.h"
 #include "noise.h"
-#include <map>
+#include "parallel_for.h"
+#include <unordered_map>
 #include <random>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
 
 using namespace DirectX;
 
@@ -80,13 +86,21 @@ struct Edge
     IndexType v0;
     IndexType v1;
 
-    bool operator<(const Edge &c) const
+    bool operator==(const Edge &c) const
     {
-        return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1);
+        return v0 == c.v0 && v1 == c.v1;
     }
+
+    struct Hasher
+    {
+        size_t operator()(const Edge &e) const
+        {
+            return std::hash<uint32_t>()(uint32_t{e.v0} << 16 | uint32_t{e.v1});
+        }
+    };
 };
 
-typedef std::map<Edge, IndexType> MidpointMap;
+typedef std::unordered_map<Edge, IndexType, Edge::Hasher> MidpointMap;
 
 inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
 {
@@ -110,7 +124,9 @@ inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
 
 void SubdivideInPlace(Mesh *outMesh)
 {
+    // Every edge is shared by two triangles, so there are 1.5 edges per triangle
     MidpointMap midpoints;
+    midpoints.reserve(outMesh->indices.size() / 2);
 
     std::vector<IndexType> newIndices;
     newIndices.reserve(outMesh->indices.size() * 4);
@@ -152,21 +168,21 @@ void SpherifyInPlace(Mesh *outMesh, float radius)
 }
 
 
-void ComputeAvgNormalsInPlace(Mesh *outMesh)
+void ComputeAvgNormals(Vertex *vertices, size_t firstVertex, size_t vertexCount, const IndexType *indices, size_t indexCount)
 {
-    for (auto &v : outMesh->vertices) {
-        v.nx = 0.0f;
-        v.ny = 0.0f;
-        v.nz = 0.0f;
+    for (size_t i = firstVertex; i < firstVertex + vertexCount; ++i) {
+        vertices[i].nx = 0.0f;
+        vertices[i].ny = 0.0f;
+        vertices[i].nz = 0.0f;
     }
 
-    assert(outMesh->indices.size() % 3 == 0); // trilist
-    size_t triangles = outMesh->indices.size() / 3;
+    assert(indexCount % 3 == 0); // trilist
+    size_t triangles = indexCount / 3;
     for (size_t t = 0; t < triangles; ++t)
     {
-        auto v1 = &outMesh->vertices[outMesh->indices[t*3+0]];
-        auto v2 = &outMesh->vertices[outMesh->indices[t*3+1]];
-        auto v3 = &outMesh->vertices[outMesh->indices[t*3+2]];
+        auto v1 = &vertices[indices[t*3+0]];
+        auto v2 = &vertices[indices[t*3+1]];
+        auto v3 = &vertices[indices[t*3+2]];
 
         // Two edge vectors u,v
         auto ux = v2->x - v1->x;
@@ -188,7 +204,8 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
     }
 
     // Normalize
-    for (auto &v : outMesh->vertices) {
+    for (size_t i = firstVertex; i < firstVertex + vertexCount; ++i) {
+        auto &v = vertices[i];
         float n = 1.0f / std::sqrt(v.nx*v.nx + v.ny*v.ny + v.nz*v.nz);
         v.nx *= n;
         v.ny *= n;
@@ -197,16 +214,27 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
 }
 
 
-void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets)
+void ComputeAvgNormalsInPlace(Mesh *outMesh)
+{
+    ComputeAvgNormals(outMesh->vertices.data(), 0, outMesh->vertices.size(), outMesh->indices.data(), outMesh->indices.size());
+}
+
+
+void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets,
+                      unsigned int* outSubdivVertexOffsets)
 {
     CreateIcosahedron(outMesh);
     outSubdivIndexOffsets[0] = 0;
+    if (outSubdivVertexOffsets)
+        outSubdivVertexOffsets[0] = 0;
 
     std::vector<Vertex> vertices(outMesh->vertices);
     std::vector<IndexType> indices(outMesh->indices);
 
     for (unsigned int i = 0; i < subdivLevelCount; ++i) {
         outSubdivIndexOffsets[i+1] = (unsigned int)indices.size();
+        if (outSubdivVertexOffsets)
+            outSubdivVertexOffsets[i+1] = (unsigned int)vertices.size();
         SubdivideInPlace(outMesh);
 
         // Ensure we add the proper offset to the indices from this subdiv level for the combined mesh
@@ -219,6 +247,8 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
         }
     }
     outSubdivIndexOffsets[subdivLevelCount+1] = (unsigned int)indices.size();
+    if (outSubdivVertexOffsets)
+        outSubdivVertexOffsets[subdivLevelCount+1] = (unsigned int)vertices.size();
 
     SpherifyInPlace(outMesh);
 
@@ -231,51 +261,187 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh)
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler)
 {
     assert(subdivLevelCount <= meshInstanceCount);
 
     std::mt19937 rng(rngSeed);
 
+    // The topology is shared by all meshes, so it is only generated once
     Mesh baseMesh;
-    CreateGeospheres(&baseMesh, subdivLevelCount, outSubdivIndexOffsets);
+    std::vector<unsigned int> subdivVertexOffsets(subdivLevelCount + 2);
+    CreateGeospheres(&baseMesh, subdivLevelCount, outSubdivIndexOffsets, subdivVertexOffsets.data());
 
     // Per unique mesh
     *vertexCountPerMesh = (unsigned int)baseMesh.vertices.size();
-    std::vector<Vertex> vertices;
-    vertices.reserve(meshInstanceCount * baseMesh.vertices.size());
+    std::vector<Vertex> vertices(meshInstanceCount * baseMesh.vertices.size());
     // Reuse indices for the different unique meshes
 
+    // Subdivision only appends vertices, so the first N vertices of every subdiv level are the
+    // vertices of the previous level. Displacement only depends on the position, so it is computed
+    // once for the vertices of the finest level and then copied to the coarser levels.
+    const auto finestLevelStart = subdivVertexOffsets[subdivLevelCount];
+    const auto finestLevelCount = subdivVertexOffsets[subdivLevelCount + 1] - finestLevelStart;
+
     auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
     auto randomPersistence = std::normal_distribution<float>(0.95f, 0.04f);
     float noiseScale = 0.5f;
     float radiusScale = 0.9f;
     float radiusBias = 0.3f;
 
-    // Create and randomize unique vertices for each mesh instance
-    for (unsigned int m = 0; m < meshInstanceCount; ++m) {
-        Mesh newMesh(baseMesh);
-        NoiseOctaves<4> textureNoise(randomPersistence(rng));
-        float noise = randomNoise(rng);
-
-        for (auto &v : newMesh.vertices) {
-            float radius = textureNoise(v.x*noiseScale, v.y*noiseScale, v.z*noiseScale, noise);
-            radius = radius * radiusScale + radiusBias;
-            v.x *= radius;
-            v.y *= radius;
-            v.z *= radius;
-        }
-        ComputeAvgNormalsInPlace(&newMesh);
+    // Draw random parameters up front in the original order so that the meshes do not depend on the scheduling
+    struct MeshParams
+    {
+        float persistence;
+        float noise;
+    };
+    std::vector<MeshParams> meshParams(meshInstanceCount);
+    for (auto &p : meshParams) {
+        p.persistence = randomPersistence(rng);
+        p.noise = randomNoise(rng);
+    }
 
-        vertices.insert(vertices.end(), newMesh.vertices.begin(), newMesh.vertices.end());
+    // Noise coordinates of the finest level are the same for every mesh; keep them in SoA form for the SIMD noise
+    std::vector<float> noiseCoords[3];
+    for (auto &c : noiseCoords)
+        c.resize(finestLevelCount);
+    for (unsigned int i = 0; i < finestLevelCount; ++i) {
+        auto v = baseMesh.vertices[finestLevelStart + i];
+        noiseCoords[0][i] = v.x*noiseScale;
+        noiseCoords[1][i] = v.y*noiseScale;
+        noiseCoords[2][i] = v.z*noiseScale;
     }
 
+    // Create and randomize unique vertices for each mesh instance, parallel over meshes
+    ParallelFor(scheduler, 0u, meshInstanceCount, [&](unsigned int m) {
+        NoiseOctaves<4> textureNoise(meshParams[m].persistence);
+        float noise = meshParams[m].noise;
+
+        std::vector<float> radii(finestLevelCount);
+        textureNoise(noiseCoords[0].data(), noiseCoords[1].data(), noiseCoords[2].data(), noise, radii.data(), finestLevelCount);
+
+        auto meshVertices = vertices.data() + size_t{m} * baseMesh.vertices.size();
+        auto finestLevel = meshVertices + finestLevelStart;
+        for (unsigned int i = 0; i < finestLevelCount; ++i) {
+            auto v = baseMesh.vertices[finestLevelStart + i];
+            float radius = radii[i] * radiusScale + radiusBias;
+            finestLevel[i].x = v.x * radius;
+            finestLevel[i].y = v.y * radius;
+            finestLevel[i].z = v.z * radius;
+        }
+
+        for (unsigned int level = 0; level <= subdivLevelCount; ++level) {
+            auto levelStart = subdivVertexOffsets[level];
+            auto levelCount = subdivVertexOffsets[level + 1] - levelStart;
+            if (level < subdivLevelCount)
+                std::copy(finestLevel, finestLevel + levelCount, meshVertices + levelStart);
+
+            // Indices of every level already include the level's vertex offset
+            auto indexStart = outSubdivIndexOffsets[level];
+            auto indexCount = outSubdivIndexOffsets[level + 1] - indexStart;
+            ComputeAvgNormals(meshVertices, levelStart, levelCount, baseMesh.indices.data() + indexStart, indexCount);
+        }
+    }); // ParallelFor
+
     // Copy to output
     std::swap(outMesh->indices, baseMesh.indices);
     std::swap(outMesh->vertices, vertices);
 }
 
 
+namespace
+{
+
+struct AsteroidsMeshCacheHeader
+{
+    static constexpr uint32_t Magic   = 0x48534D41; // 'AMSH'
+    static constexpr uint32_t Version = 3; // 2: displacement uses the SIMD simplex noise, 3: noise kernel in the header
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rngSeed;
+    uint32_t subdivLevelCount;
+    uint32_t meshInstanceCount;
+    uint32_t vertexCountPerMesh;
+    // The displacement depends on the noise kernel, see SimplexNoiseSimdIsa()
+    uint32_t noiseSimdWidth;
+    char     noiseIsa[12];
+    uint64_t vertexCount;
+    uint64_t indexCount;
+};
+
+} // namespace
+
+
+bool LoadAsteroidsMeshCache(const char* filePath, Mesh *outMesh,
+                            unsigned int subdivLevelCount, unsigned int meshInstanceCount,
+                            unsigned int rngSeed,
+                            unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    AsteroidsMeshCacheHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file ||
+        header.magic != AsteroidsMeshCacheHeader::Magic ||
+        header.version != AsteroidsMeshCacheHeader::Version ||
+        header.rngSeed != rngSeed ||
+        header.subdivLevelCount != subdivLevelCount ||
+        header.meshInstanceCount != meshInstanceCount ||
+        header.noiseSimdWidth != SimplexNoiseSimdWidth() ||
+        strncmp(header.noiseIsa, SimplexNoiseSimdIsa(), sizeof(header.noiseIsa)) != 0 ||
+        header.vertexCount != uint64_t{header.vertexCountPerMesh} * meshInstanceCount)
+        return false;
+
+    std::vector<unsigned int> subdivIndexOffsets(subdivLevelCount + 2);
+    Mesh mesh;
+    mesh.vertices.resize(static_cast<size_t>(header.vertexCount));
+    mesh.indices.resize(static_cast<size_t>(header.indexCount));
+    file.read(reinterpret_cast<char*>(subdivIndexOffsets.data()), subdivIndexOffsets.size() * sizeof(subdivIndexOffsets[0]));
+    file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(mesh.vertices[0]));
+    file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size() * sizeof(mesh.indices[0]));
+    if (!file || subdivIndexOffsets.back() != header.indexCount)
+        return false;
+
+    std::copy(subdivIndexOffsets.begin(), subdivIndexOffsets.end(), outSubdivIndexOffsets);
+    *vertexCountPerMesh = header.vertexCountPerMesh;
+    std::swap(*outMesh, mesh);
+    return true;
+}
+
+
+bool SaveAsteroidsMeshCache(const char* filePath, const Mesh &mesh,
+                            unsigned int subdivLevelCount, unsigned int meshInstanceCount,
+                            unsigned int rngSeed,
+                            const unsigned int* subdivIndexOffsets, unsigned int vertexCountPerMesh)
+{
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    AsteroidsMeshCacheHeader header = {};
+    header.magic = AsteroidsMeshCacheHeader::Magic;
+    header.version = AsteroidsMeshCacheHeader::Version;
+    header.rngSeed = rngSeed;
+    header.subdivLevelCount = subdivLevelCount;
+    header.meshInstanceCount = meshInstanceCount;
+    header.vertexCountPerMesh = vertexCountPerMesh;
+    header.noiseSimdWidth = SimplexNoiseSimdWidth();
+    snprintf(header.noiseIsa, sizeof(header.noiseIsa), "%s", SimplexNoiseSimdIsa());
+    header.vertexCount = mesh.vertices.size();
+    header.indexCount = mesh.indices.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(subdivIndexOffsets), (subdivLevelCount + 2) * sizeof(subdivIndexOffsets[0]));
+    file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(mesh.vertices[0]));
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(mesh.indices[0]));
+    return static_cast<bool>(file);
+}
+
+
 void CreateSkyboxMesh(std::vector<SkyboxVertex>* outVertices)
 {
     // See http://msdn.microsoft.com/en-us/library/windows/desktop/bb204881(v=vs.85).aspx
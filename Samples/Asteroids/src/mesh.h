@@ -13,6 +13,11 @@
 #include <vector>
 #include <directxmath.h>
 
+namespace Diligent
+{
+class TaskScheduler;
+}
+
 typedef unsigned short IndexType;
 
 // NOTE: This data could be compressed, but it's not really the bottleneck at the moment
@@ -45,19 +50,38 @@ void SubdivideInPlace(Mesh *outMesh);
 
 void SpherifyInPlace(Mesh *outMesh, float radius = 1.0f);
 
+// Only computes normals of vertices [firstVertex, firstVertex + vertexCount), which must be
+// the only vertices referenced by the indices
+void ComputeAvgNormals(Vertex *vertices, size_t firstVertex, size_t vertexCount, const IndexType *indices, size_t indexCount);
+
 void ComputeAvgNormalsInPlace(Mesh *outMesh);
 
-// subdivIndexOffset array should be [subdivLevels+2] in size
-void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets);
+// subdivIndexOffset and subdivVertexOffsets arrays should be [subdivLevels+2] in size
+void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets,
+                      unsigned int* outSubdivVertexOffsets = nullptr);
 
 // Returns a combined "mesh" that includes:
 // - A set of indices for each subdiv level (outSubdivIndexOffsets for offsets/counts)
 // - A set of vertices for each mesh instance (base vertices per mesh computed from vertexCountPerMesh)
 // - Indices already have the vertex offsets for the correct subdiv level "baked-in", so only need the mesh offset
+// Mesh instances are generated in parallel on the scheduler threads (serially if the scheduler is null).
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh);
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler);
+
+// Binary cache of the meshes created by CreateAsteroidsFromGeospheres.
+// Loading fails if the file does not exist or was created with different parameters.
+bool LoadAsteroidsMeshCache(const char* filePath, Mesh *outMesh,
+                            unsigned int subdivLevelCount, unsigned int meshInstanceCount,
+                            unsigned int rngSeed,
+                            unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh);
+
+bool SaveAsteroidsMeshCache(const char* filePath, const Mesh &mesh,
+                            unsigned int subdivLevelCount, unsigned int meshInstanceCount,
+                            unsigned int rngSeed,
+                            const unsigned int* subdivIndexOffsets, unsigned int vertexCountPerMesh);
 
 
 struct SkyboxVertex
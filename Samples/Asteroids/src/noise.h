@@ -11,6 +11,9 @@
 #pragma once
 
 #include "simplexnoise1234.h"
+#include "noise_simd.h"
+
+#include <algorithm>
 
 // Very simple multi-octave simplex noise helper
 // Returns noise in the range [0, 1] vs. the usual [-1, 1]
@@ -54,4 +57,35 @@ public:
         }
         return r * mWeightNorm + 0.5f;
     }
+
+    // Evaluates count points at once with the SIMD noise kernels, out[i] is in [0, 1]
+    void operator()(const float* x, const float* y, const float* z, float* out, size_t count) const
+    {
+        std::fill(out, out + count, 0.0f);
+        float scale = 1.0f;
+        for (size_t i = 0; i < N; ++i) {
+            AccumulateSimplexNoise3(x, y, z, scale, mWeights[i], out, count);
+            scale *= 2.0f;
+        }
+        Normalize(out, count);
+    }
+
+    // Same as above with the w coordinate shared by all points
+    void operator()(const float* x, const float* y, const float* z, float w, float* out, size_t count) const
+    {
+        std::fill(out, out + count, 0.0f);
+        float scale = 1.0f;
+        for (size_t i = 0; i < N; ++i) {
+            AccumulateSimplexNoise4(x, y, z, w, scale, mWeights[i], out, count);
+            scale *= 2.0f;
+        }
+        Normalize(out, count);
+    }
+
+private:
+    void Normalize(float* out, size_t count) const
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = out[i] * mWeightNorm + 0.5f;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,290 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "noise_simd.h"
+#include "simd_float.h"
+
+// Permutation table of simplexnoise1234.c
+extern "C" unsigned char perm[512];
+
+namespace
+{
+
+using AsteroidsSimd::Float1;
+#if ASTEROIDS_SIM_USE_SIMD
+using AsteroidsSimd::FloatSimd;
+#endif
+
+// The kernels keep integer values in float registers and look up the permutation table with gathers.
+// Gradients are looked up by the permuted hash, so that grad3()/grad4() become dot products with
+// vectors whose components are -1, 0 or 1. Adding zero terms does not change the result.
+struct NoiseTables
+{
+    float perm[512];
+    float grad3[3][256];
+    float grad4[4][256];
+
+    NoiseTables()
+    {
+        for (int i = 0; i < 512; ++i)
+            perm[i] = static_cast<float>(::perm[i]);
+
+        for (int p = 0; p < 256; ++p)
+        {
+            // Same gradients as grad3()
+            {
+                const int h    = p & 15;
+                const int u    = h < 8 ? 0 : 1;
+                const int v    = h < 4 ? 1 : (h == 12 || h == 14) ? 0 : 2;
+                float     g[3] = {};
+                g[u] += (h & 1) ? -1.f : 1.f;
+                g[v] += (h & 2) ? -1.f : 1.f;
+                for (int c = 0; c < 3; ++c)
+                    grad3[c][p] = g[c];
+            }
+
+            // Same gradients as grad4()
+            {
+                const int h    = p & 31;
+                const int u    = h < 24 ? 0 : 1;
+                const int v    = h < 16 ? 1 : 2;
+                const int w    = h < 8 ? 2 : 3;
+                float     g[4] = {};
+                g[u] += (h & 1) ? -1.f : 1.f;
+                g[v] += (h & 2) ? -1.f : 1.f;
+                g[w] += (h & 4) ? -1.f : 1.f;
+                for (int c = 0; c < 4; ++c)
+                    grad4[c][p] = g[c];
+            }
+        }
+    }
+};
+
+const NoiseTables& GetNoiseTables()
+{
+    static const NoiseTables Tables;
+    return Tables;
+}
+
+// Same as FASTFLOOR(): (int)x for x > 0 and (int)x - 1 otherwise
+template <typename V>
+V FastFloor(V x)
+{
+    return V::Trunc(x) - (V::Set(1.f) - V::Greater(x, V::Set(0.f)));
+}
+
+// Contribution of one simplex corner: max(0.6 - |d|^2, 0)^4 * dot(grad, d)
+template <typename V>
+V Corner3(const NoiseTables& T, V hash, V x, V y, V z)
+{
+    V t = V::Max(V::Set(0.6f) - x * x - y * y - z * z, V::Set(0.f));
+    t   = t * t;
+    const V grad = V::Gather(T.grad3[0], hash) * x + V::Gather(T.grad3[1], hash) * y + V::Gather(T.grad3[2], hash) * z;
+    return t * t * grad;
+}
+
+template <typename V>
+V Corner4(const NoiseTables& T, V hash, V x, V y, V z, V w)
+{
+    V t = V::Max(V::Set(0.6f) - x * x - y * y - z * z - w * w, V::Set(0.f));
+    t   = t * t;
+    const V grad = V::Gather(T.grad4[0], hash) * x + V::Gather(T.grad4[1], hash) * y + V::Gather(T.grad4[2], hash) * z + V::Gather(T.grad4[3], hash) * w;
+    return t * t * grad;
+}
+
+template <typename V>
+V SimplexNoise3(const NoiseTables& T, V x, V y, V z)
+{
+    const V one = V::Set(1.f);
+    const V G3  = V::Set(1.f / 6.f);
+
+    // Skew the input space to determine which simplex cell we're in
+    const V s = (x + y + z) * V::Set(1.f / 3.f);
+    const V i = FastFloor(x + s);
+    const V j = FastFloor(y + s);
+    const V k = FastFloor(z + s);
+    const V t = (i + j + k) * G3;
+
+    // The x,y,z distances from the cell origin
+    const V x0 = x - (i - t);
+    const V y0 = y - (j - t);
+    const V z0 = z - (k - t);
+
+    // Offsets of the second and third corners, the same as the branches in snoise3()
+    const V xy = V::GreaterEqual(x0, y0);
+    const V yz = V::GreaterEqual(y0, z0);
+    const V xz = V::GreaterEqual(x0, z0);
+    const V i1 = xy * xz;
+    const V j1 = (one - xy) * yz;
+    const V k1 = one - i1 - j1;
+    const V i2 = xy + xz - xy * xz;
+    const V j2 = one - xy + xy * yz;
+    const V k2 = V::Set(2.f) - i2 - j2;
+
+    const V x1 = x0 - i1 + G3;
+    const V y1 = y0 - j1 + G3;
+    const V z1 = z0 - k1 + G3;
+    const V x2 = x0 - i2 + V::Set(2.f / 6.f);
+    const V y2 = y0 - j2 + V::Set(2.f / 6.f);
+    const V z2 = z0 - k2 + V::Set(2.f / 6.f);
+    const V x3 = x0 - V::Set(0.5f);
+    const V y3 = y0 - V::Set(0.5f);
+    const V z3 = z0 - V::Set(0.5f);
+
+    // Wrap the integer indices at 256, to avoid indexing perm[] out of bounds
+    const V ii = V::Wrap255(i);
+    const V jj = V::Wrap255(j);
+    const V kk = V::Wrap255(k);
+
+    const float* P  = T.perm;
+    const V      h0 = V::Gather(P, ii + V::Gather(P, jj + V::Gather(P, kk)));
+    const V      h1 = V::Gather(P, ii + i1 + V::Gather(P, jj + j1 + V::Gather(P, kk + k1)));
+    const V      h2 = V::Gather(P, ii + i2 + V::Gather(P, jj + j2 + V::Gather(P, kk + k2)));
+    const V      h3 = V::Gather(P, ii + one + V::Gather(P, jj + one + V::Gather(P, kk + one)));
+
+    const V n = Corner3(T, h0, x0, y0, z0) + Corner3(T, h1, x1, y1, z1) + Corner3(T, h2, x2, y2, z2) + Corner3(T, h3, x3, y3, z3);
+    return V::Set(32.f) * n;
+}
+
+template <typename V>
+V SimplexNoise4(const NoiseTables& T, V x, V y, V z, V w)
+{
+    const V one = V::Set(1.f);
+    const V G4  = V::Set(0.138196601f); // (5 - sqrt(5)) / 20
+
+    // Skew the (x,y,z,w) space to determine which cell of 24 simplices we're in
+    const V s = (x + y + z + w) * V::Set(0.309016994f); // (sqrt(5) - 1) / 4
+    const V i = FastFloor(x + s);
+    const V j = FastFloor(y + s);
+    const V k = FastFloor(z + s);
+    const V l = FastFloor(w + s);
+    const V t = (i + j + k + l) * G4;
+
+    const V x0 = x - (i - t);
+    const V y0 = y - (j - t);
+    const V z0 = z - (k - t);
+    const V w0 = w - (l - t);
+
+    // Rank of every coordinate in the magnitude ordering. This is what the simplex[] lookup table of snoise4() contains.
+    const V c1    = V::Greater(x0, y0);
+    const V c2    = V::Greater(x0, z0);
+    const V c3    = V::Greater(y0, z0);
+    const V c4    = V::Greater(x0, w0);
+    const V c5    = V::Greater(y0, w0);
+    const V c6    = V::Greater(z0, w0);
+    const V rankX = c1 + c2 + c4;
+    const V rankY = (one - c1) + c3 + c5;
+    const V rankZ = (one - c2) + (one - c3) + c6;
+    const V rankW = V::Set(3.f) - c4 - c5 - c6;
+
+    const V two   = V::Set(2.f);
+    const V three = V::Set(3.f);
+    const V i1 = V::GreaterEqual(rankX, three), j1 = V::GreaterEqual(rankY, three), k1 = V::GreaterEqual(rankZ, three), l1 = V::GreaterEqual(rankW, three);
+    const V i2 = V::GreaterEqual(rankX, two), j2 = V::GreaterEqual(rankY, two), k2 = V::GreaterEqual(rankZ, two), l2 = V::GreaterEqual(rankW, two);
+    const V i3 = V::GreaterEqual(rankX, one), j3 = V::GreaterEqual(rankY, one), k3 = V::GreaterEqual(rankZ, one), l3 = V::GreaterEqual(rankW, one);
+
+    const V G4x2 = V::Set(2.f * 0.138196601f);
+    const V G4x3 = V::Set(3.f * 0.138196601f);
+    const V G4x4 = V::Set(4.f * 0.138196601f - 1.f);
+
+    const V x1 = x0 - i1 + G4, y1 = y0 - j1 + G4, z1 = z0 - k1 + G4, w1 = w0 - l1 + G4;
+    const V x2 = x0 - i2 + G4x2, y2 = y0 - j2 + G4x2, z2 = z0 - k2 + G4x2, w2 = w0 - l2 + G4x2;
+    const V x3 = x0 - i3 + G4x3, y3 = y0 - j3 + G4x3, z3 = z0 - k3 + G4x3, w3 = w0 - l3 + G4x3;
+    const V x4 = x0 + G4x4, y4 = y0 + G4x4, z4 = z0 + G4x4, w4 = w0 + G4x4;
+
+    const V ii = V::Wrap255(i);
+    const V jj = V::Wrap255(j);
+    const V kk = V::Wrap255(k);
+    const V ll = V::Wrap255(l);
+
+    const float* P  = T.perm;
+    const V      h0 = V::Gather(P, ii + V::Gather(P, jj + V::Gather(P, kk + V::Gather(P, ll))));
+    const V      h1 = V::Gather(P, ii + i1 + V::Gather(P, jj + j1 + V::Gather(P, kk + k1 + V::Gather(P, ll + l1))));
+    const V      h2 = V::Gather(P, ii + i2 + V::Gather(P, jj + j2 + V::Gather(P, kk + k2 + V::Gather(P, ll + l2))));
+    const V      h3 = V::Gather(P, ii + i3 + V::Gather(P, jj + j3 + V::Gather(P, kk + k3 + V::Gather(P, ll + l3))));
+    const V      h4 = V::Gather(P, ii + one + V::Gather(P, jj + one + V::Gather(P, kk + one + V::Gather(P, ll + one))));
+
+    const V n = Corner4(T, h0, x0, y0, z0, w0) + Corner4(T, h1, x1, y1, z1, w1) + Corner4(T, h2, x2, y2, z2, w2) +
+        Corner4(T, h3, x3, y3, z3, w3) + Corner4(T, h4, x4, y4, z4, w4);
+    return V::Set(27.f) * n;
+}
+
+template <typename V>
+size_t AccumulateNoise3Kernel(const float* x, const float* y, const float* z, float scale, float weight, float* out, size_t i, size_t count)
+{
+    const auto& T       = GetNoiseTables();
+    const V     vScale  = V::Set(scale);
+    const V     vWeight = V::Set(weight);
+    for (; i + V::Width <= count; i += V::Width)
+    {
+        const V n = SimplexNoise3(T, V::Load(x + i) * vScale, V::Load(y + i) * vScale, V::Load(z + i) * vScale);
+        (V::Load(out + i) + vWeight * n).Store(out + i);
+    }
+    return i;
+}
+
+template <typename V>
+size_t AccumulateNoise4Kernel(const float* x, const float* y, const float* z, float w, float scale, float weight, float* out, size_t i, size_t count)
+{
+    const auto& T       = GetNoiseTables();
+    const V     vScale  = V::Set(scale);
+    const V     vWeight = V::Set(weight);
+    const V     vW      = V::Set(w * scale);
+    for (; i + V::Width <= count; i += V::Width)
+    {
+        const V n = SimplexNoise4(T, V::Load(x + i) * vScale, V::Load(y + i) * vScale, V::Load(z + i) * vScale, vW);
+        (V::Load(out + i) + vWeight * n).Store(out + i);
+    }
+    return i;
+}
+
+} // namespace
+
+void AccumulateSimplexNoise3(const float* x, const float* y, const float* z, float scale, float weight, float* out, size_t count)
+{
+    size_t i = 0;
+#if ASTEROIDS_SIM_USE_SIMD
+    i = AccumulateNoise3Kernel<FloatSimd>(x, y, z, scale, weight, out, i, count);
+#endif
+    // Remaining points
+    AccumulateNoise3Kernel<Float1>(x, y, z, scale, weight, out, i, count);
+}
+
+void AccumulateSimplexNoise4(const float* x, const float* y, const float* z, float w, float scale, float weight, float* out, size_t count)
+{
+    size_t i = 0;
+#if ASTEROIDS_SIM_USE_SIMD
+    i = AccumulateNoise4Kernel<FloatSimd>(x, y, z, w, scale, weight, out, i, count);
+#endif
+    // Remaining points
+    AccumulateNoise4Kernel<Float1>(x, y, z, w, scale, weight, out, i, count);
+}
+
+unsigned int SimplexNoiseSimdWidth()
+{
+#if ASTEROIDS_SIM_USE_SIMD
+    return static_cast<unsigned int>(FloatSimd::Width);
+#else
+    return 1;
+#endif
+}
+
+const char* SimplexNoiseSimdIsa()
+{
+#if SAMPLES_USE_AVX2
+    return "AVX2";
+#elif SAMPLES_USE_SSE2
+    return "SSE2";
+#elif SAMPLES_USE_NEON_A64
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
@@ -0,0 +1,32 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <cstddef>
+
+// SIMD versions of snoise3() and snoise4() from simplexnoise1234.c that evaluate 4 (SSE2, NEON)
+// or 8 (AVX2, see DILIGENT_ASTEROIDS_AVX2) points at a time. The skew factors are applied in single precision, while
+// the scalar code rounds double-precision products to float. Near the origin the results agree
+// to about 1e-4; with the large seed coordinates used by the sample both versions keep only
+// a few bits of the fraction and may differ by a few 1e-3.
+
+// out[i] += weight * snoise3(x[i] * scale, y[i] * scale, z[i] * scale)
+void AccumulateSimplexNoise3(const float* x, const float* y, const float* z, float scale, float weight, float* out, size_t count);
+
+// out[i] += weight * snoise4(x[i] * scale, y[i] * scale, z[i] * scale, w * scale)
+void AccumulateSimplexNoise4(const float* x, const float* y, const float* z, float w, float scale, float weight, float* out, size_t count);
+
+// Number of points evaluated at a time
+unsigned int SimplexNoiseSimdWidth();
+
+// Instruction set of the kernel ("AVX2", "SSE2", "NEON" or "Scalar"). Kernels that use
+// different instruction sets may produce slightly different results.
+const char* SimplexNoiseSimdIsa();
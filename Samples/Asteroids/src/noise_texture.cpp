@@ -0,0 +1,155 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "noise_texture.h"
+#include "noise.h"
+#include "simd_float.h"
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+
+uint32_t NoiseToRGBA8(float c, const NoiseTextureParams& params)
+{
+    c = std::max(0.0f, std::min(1.0f, (c - 0.5f) * params.noiseStrength + 0.5f));
+
+    int32_t cr = (int32_t)(c * params.redScale);
+    int32_t cg = (int32_t)(c * params.greenScale);
+    int32_t cb = (int32_t)(c * params.blueScale);
+    assert(cr >= 0 && cr < 256);
+    assert(cg >= 0 && cg < 256);
+    assert(cb >= 0 && cb < 256);
+
+    return cr << 16 | cg << 8 | cb << 0;
+}
+
+uint32_t Average2x2(const uint8_t* row0, const uint8_t* row1, size_t x)
+{
+    uint32_t result = 0;
+    for (size_t comp = 0; comp < 4; ++comp)
+    {
+        uint32_t c = row0[x * 8 + comp + 0];
+        c += row0[x * 8 + comp + 4];
+        c += row1[x * 8 + comp + 0];
+        c += row1[x * 8 + comp + 4];
+        result |= (c / 4) << (comp * 8);
+    }
+    return result;
+}
+
+// Downsamples 4 texels at a time. Returns the first texel that is not processed.
+size_t DownsampleRowSimd(const uint8_t* row0, const uint8_t* row1, uint8_t* rowDst, size_t width)
+{
+    size_t x = 0;
+#if SAMPLES_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8)));
+        const __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16)));
+        const __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8)));
+        const __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16)));
+
+        // Split even and odd source texels
+        const __m128i evenA = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i oddA  = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+        const __m128i evenB = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i oddB  = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        // Sum the four texels in 16-bit lanes
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(evenA, zero), _mm_unpacklo_epi8(oddA, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(evenA, zero), _mm_unpackhi_epi8(oddA, zero));
+        lo         = _mm_add_epi16(lo, _mm_add_epi16(_mm_unpacklo_epi8(evenB, zero), _mm_unpacklo_epi8(oddB, zero)));
+        hi         = _mm_add_epi16(hi, _mm_add_epi16(_mm_unpackhi_epi8(evenB, zero), _mm_unpackhi_epi8(oddB, zero)));
+
+        const __m128i avg = _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rowDst + x * 4), avg);
+    }
+#elif SAMPLES_USE_NEON_A64
+    for (; x + 4 <= width; x += 4)
+    {
+        // De-interleave even and odd source texels
+        const uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t*>(row0 + x * 8));
+        const uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t*>(row1 + x * 8));
+
+        const uint8x16_t evenA = vreinterpretq_u8_u32(a.val[0]);
+        const uint8x16_t oddA  = vreinterpretq_u8_u32(a.val[1]);
+        const uint8x16_t evenB = vreinterpretq_u8_u32(b.val[0]);
+        const uint8x16_t oddB  = vreinterpretq_u8_u32(b.val[1]);
+
+        uint16x8_t lo = vaddl_u8(vget_low_u8(evenA), vget_low_u8(oddA));
+        uint16x8_t hi = vaddl_u8(vget_high_u8(evenA), vget_high_u8(oddA));
+        lo            = vaddq_u16(lo, vaddl_u8(vget_low_u8(evenB), vget_low_u8(oddB)));
+        hi            = vaddq_u16(hi, vaddl_u8(vget_high_u8(evenB), vget_high_u8(oddB)));
+
+        vst1q_u8(rowDst + x * 4, vcombine_u8(vshrn_n_u16(lo, 2), vshrn_n_u16(hi, 2)));
+    }
+#else
+    (void)row0;
+    (void)row1;
+    (void)rowDst;
+    (void)width;
+#endif
+    return x;
+}
+
+} // namespace
+
+
+void FillNoiseRows_RGBA8(uint8_t* data, size_t rowPitch, size_t width, size_t firstRow, size_t numRows,
+                         const NoiseTextureParams& params, bool useSimd)
+{
+    NoiseOctaves<4> textureNoise(params.persistence);
+
+    if (!useSimd)
+    {
+        for (size_t y = firstRow; y < firstRow + numRows; ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(data + y * rowPitch);
+            for (size_t x = 0; x < width; ++x)
+                row[x] = NoiseToRGBA8(textureNoise((float)x * params.noiseScale, (float)y * params.noiseScale, params.seed), params);
+        }
+        return;
+    }
+
+    // Coordinates of a whole row are evaluated in one batch
+    std::vector<float> xs(width), ys(width), zs(width, params.seed), noise(width);
+    for (size_t x = 0; x < width; ++x)
+        xs[x] = (float)x * params.noiseScale;
+
+    for (size_t y = firstRow; y < firstRow + numRows; ++y)
+    {
+        std::fill(ys.begin(), ys.end(), (float)y * params.noiseScale);
+        textureNoise(xs.data(), ys.data(), zs.data(), noise.data(), width);
+
+        uint32_t* row = reinterpret_cast<uint32_t*>(data + y * rowPitch);
+        for (size_t x = 0; x < width; ++x)
+            row[x] = NoiseToRGBA8(noise[x], params);
+    }
+}
+
+
+void DownsampleRows_XXXX8(const uint8_t* src, size_t srcRowPitch, uint8_t* dst, size_t dstRowPitch, size_t dstWidth,
+                          size_t firstRow, size_t numRows, bool useSimd)
+{
+    for (size_t y = firstRow; y < firstRow + numRows; ++y)
+    {
+        const uint8_t* rowSrc0 = src + (y * 2 + 0) * srcRowPitch;
+        const uint8_t* rowSrc1 = src + (y * 2 + 1) * srcRowPitch;
+        uint8_t*       rowDst  = dst + y * dstRowPitch;
+
+        size_t x = useSimd ? DownsampleRowSimd(rowSrc0, rowSrc1, rowDst, dstWidth) : 0;
+        for (; x < dstWidth; ++x)
+            reinterpret_cast<uint32_t*>(rowDst)[x] = Average2x2(rowSrc0, rowSrc1, x);
+    }
+}
@@ -0,0 +1,38 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Platform-independent procedural texture kernels. They work on row ranges, so that
+// a single texture can be split into bands that are generated on different threads.
+
+struct NoiseTextureParams
+{
+    float seed          = 0.0f;
+    float persistence   = 0.5f;
+    float noiseScale    = 1.0f;
+    float noiseStrength = 1.0f;
+    float redScale      = 255.0f;
+    float greenScale    = 255.0f;
+    float blueScale     = 255.0f;
+};
+
+// Fills rows [firstRow, firstRow + numRows) of an RGBA8 image with 4-octave simplex noise.
+// data points to row 0. The scalar path is the reference implementation of the original FillNoise2D_RGBA8.
+void FillNoiseRows_RGBA8(uint8_t* data, size_t rowPitch, size_t width, size_t firstRow, size_t numRows,
+                         const NoiseTextureParams& params, bool useSimd = true);
+
+// Computes rows [firstRow, firstRow + numRows) of the next mip level with a 2x2 box filter.
+// Every channel is (a + b + c + d) / 4 rounded down, on all paths.
+void DownsampleRows_XXXX8(const uint8_t* src, size_t srcRowPitch, uint8_t* dst, size_t dstRowPitch, size_t dstWidth,
+                          size_t firstRow, size_t numRows, bool useSimd = true);
@@ -0,0 +1,25 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include "TaskScheduler.hpp"
+
+// Calls func for every index in [first, last) on the threads of the scheduler, or serially
+// on the calling thread if the scheduler is null. Every index is a separate chunk, so that
+// expensive and cheap items balance out.
+template <typename FuncType>
+void ParallelFor(Diligent::TaskScheduler* scheduler, unsigned int first, unsigned int last, const FuncType& func)
+{
+    Diligent::ParallelFor(scheduler, first, last, 1u, [&func](Diligent::Uint32, Diligent::Uint32 begin, Diligent::Uint32 end) {
+        for (Diligent::Uint32 i = begin; i < end; ++i)
+            func(i);
+    });
+}
@@ -59,6 +59,7 @@ struct Settings
     int renderHeight;
 
     int numThreads = 0; // 0 means #cpu-1
+    int numAsteroids = NUM_ASTEROIDS; // Native D3D12 mode only supports NUM_ASTEROIDS
     unsigned int lockedFrameRate = 15;
 
     bool logFrameTimes = false;
@@ -75,7 +76,7 @@ struct Settings
         DiligentVulkan
     }mode = DiligentD3D11;
        
-    int resourceBindingMode = 3;  // Only for DiligentD3D12 and DiligentVk modes
+    int resourceBindingMode = 3;  // Only for Diligent modes. See AsteroidsDE::Asteroids::BindingMode
 
     bool lockFrameRate = false;
     bool animate = true;
@@ -89,5 +90,6 @@ struct Settings
 
     bool submitRendering = true;
     bool executeIndirect = false;
+    bool frustumCulling = true;
     bool warp = false;
 };
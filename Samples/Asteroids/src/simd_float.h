@@ -0,0 +1,178 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "SIMDSupport.hpp"
+
+// The kernels need vrndnq_f32, vdivq_f32 and vsqrtq_f32, which are only available on AArch64
+#define ASTEROIDS_SIM_USE_SIMD (SAMPLES_USE_SSE2 || SAMPLES_USE_NEON_A64)
+
+// Thin wrappers over the SIMD registers so that the simulation and noise kernels are written once.
+// Every operation is IEEE-exact (no reciprocal estimates), so all paths produce the same results
+// up to the floating point contraction done by the compiler.
+// Comparisons return 1.0 or 0.0 in every lane, so that the kernels select values arithmetically.
+namespace AsteroidsSimd
+{
+
+struct Float1
+{
+    static constexpr size_t Width = 1;
+
+    float v;
+
+    static Float1 Load(const float* p) { return {*p}; }
+    static Float1 Set(float f) { return {f}; }
+    void          Store(float* p) const { *p = v; }
+
+    friend Float1 operator+(Float1 a, Float1 b) { return {a.v + b.v}; }
+    friend Float1 operator-(Float1 a, Float1 b) { return {a.v - b.v}; }
+    friend Float1 operator*(Float1 a, Float1 b) { return {a.v * b.v}; }
+    friend Float1 operator/(Float1 a, Float1 b) { return {a.v / b.v}; }
+
+    static Float1 Sqrt(Float1 a) { return {std::sqrt(a.v)}; }
+    static Float1 Min(Float1 a, Float1 b) { return {std::min(a.v, b.v)}; }
+    static Float1 Max(Float1 a, Float1 b) { return {std::max(a.v, b.v)}; }
+    // Round to nearest even
+    static Float1 Round(Float1 a) { return {std::nearbyint(a.v)}; }
+    // Round toward zero
+    static Float1 Trunc(Float1 a) { return {std::trunc(a.v)}; }
+    // Float bits interpreted as an integer and converted to float
+    static Float1 AsIntToFloat(Float1 a)
+    {
+        int32_t i;
+        memcpy(&i, &a.v, sizeof(i));
+        return {static_cast<float>(i)};
+    }
+    // Lowest 8 bits of an integer value (two's complement, same as i & 0xFF)
+    static Float1 Wrap255(Float1 a) { return {static_cast<float>(static_cast<int32_t>(a.v) & 0xFF)}; }
+
+    static Float1 Greater(Float1 a, Float1 b) { return {a.v > b.v ? 1.f : 0.f}; }
+    static Float1 GreaterEqual(Float1 a, Float1 b) { return {a.v >= b.v ? 1.f : 0.f}; }
+
+    // Loads table[index] in every lane. Indices must be non-negative integer values.
+    static Float1 Gather(const float* table, Float1 index) { return {table[static_cast<int32_t>(index.v)]}; }
+};
+
+#if SAMPLES_USE_AVX2
+
+struct FloatSimd
+{
+    static constexpr size_t Width = 8;
+
+    __m256 v;
+
+    static FloatSimd Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static FloatSimd Set(float f) { return {_mm256_set1_ps(f)}; }
+    void             Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend FloatSimd operator+(FloatSimd a, FloatSimd b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend FloatSimd operator-(FloatSimd a, FloatSimd b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend FloatSimd operator*(FloatSimd a, FloatSimd b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend FloatSimd operator/(FloatSimd a, FloatSimd b) { return {_mm256_div_ps(a.v, b.v)}; }
+
+    static FloatSimd Sqrt(FloatSimd a) { return {_mm256_sqrt_ps(a.v)}; }
+    static FloatSimd Min(FloatSimd a, FloatSimd b) { return {_mm256_min_ps(a.v, b.v)}; }
+    static FloatSimd Max(FloatSimd a, FloatSimd b) { return {_mm256_max_ps(a.v, b.v)}; }
+    static FloatSimd Round(FloatSimd a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+    static FloatSimd Trunc(FloatSimd a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)}; }
+    static FloatSimd AsIntToFloat(FloatSimd a) { return {_mm256_cvtepi32_ps(_mm256_castps_si256(a.v))}; }
+    static FloatSimd Wrap255(FloatSimd a) { return {_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_cvttps_epi32(a.v), _mm256_set1_epi32(0xFF)))}; }
+
+    static FloatSimd Greater(FloatSimd a, FloatSimd b) { return {_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), _mm256_set1_ps(1.f))}; }
+    static FloatSimd GreaterEqual(FloatSimd a, FloatSimd b) { return {_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ), _mm256_set1_ps(1.f))}; }
+
+    static FloatSimd Gather(const float* table, FloatSimd index) { return {_mm256_i32gather_ps(table, _mm256_cvttps_epi32(index.v), 4)}; }
+};
+
+#elif SAMPLES_USE_SSE2
+
+struct FloatSimd
+{
+    static constexpr size_t Width = 4;
+
+    __m128 v;
+
+    static FloatSimd Load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static FloatSimd Set(float f) { return {_mm_set1_ps(f)}; }
+    void             Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend FloatSimd operator+(FloatSimd a, FloatSimd b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend FloatSimd operator-(FloatSimd a, FloatSimd b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend FloatSimd operator*(FloatSimd a, FloatSimd b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend FloatSimd operator/(FloatSimd a, FloatSimd b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    static FloatSimd Sqrt(FloatSimd a) { return {_mm_sqrt_ps(a.v)}; }
+    static FloatSimd Min(FloatSimd a, FloatSimd b) { return {_mm_min_ps(a.v, b.v)}; }
+    static FloatSimd Max(FloatSimd a, FloatSimd b) { return {_mm_max_ps(a.v, b.v)}; }
+    // Uses the default MXCSR rounding mode, which is round to nearest even
+    static FloatSimd Round(FloatSimd a) { return {_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))}; }
+    static FloatSimd Trunc(FloatSimd a) { return {_mm_cvtepi32_ps(_mm_cvttps_epi32(a.v))}; }
+    static FloatSimd AsIntToFloat(FloatSimd a) { return {_mm_cvtepi32_ps(_mm_castps_si128(a.v))}; }
+    static FloatSimd Wrap255(FloatSimd a) { return {_mm_cvtepi32_ps(_mm_and_si128(_mm_cvttps_epi32(a.v), _mm_set1_epi32(0xFF)))}; }
+
+    static FloatSimd Greater(FloatSimd a, FloatSimd b) { return {_mm_and_ps(_mm_cmpgt_ps(a.v, b.v), _mm_set1_ps(1.f))}; }
+    static FloatSimd GreaterEqual(FloatSimd a, FloatSimd b) { return {_mm_and_ps(_mm_cmpge_ps(a.v, b.v), _mm_set1_ps(1.f))}; }
+
+    // SSE2 has no gather instruction
+    static FloatSimd Gather(const float* table, FloatSimd index)
+    {
+        alignas(16) int32_t i[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(i), _mm_cvttps_epi32(index.v));
+        return {_mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]])};
+    }
+};
+
+#elif SAMPLES_USE_NEON_A64
+
+struct FloatSimd
+{
+    static constexpr size_t Width = 4;
+
+    float32x4_t v;
+
+    static FloatSimd Load(const float* p) { return {vld1q_f32(p)}; }
+    static FloatSimd Set(float f) { return {vdupq_n_f32(f)}; }
+    void             Store(float* p) const { vst1q_f32(p, v); }
+
+    friend FloatSimd operator+(FloatSimd a, FloatSimd b) { return {vaddq_f32(a.v, b.v)}; }
+    friend FloatSimd operator-(FloatSimd a, FloatSimd b) { return {vsubq_f32(a.v, b.v)}; }
+    friend FloatSimd operator*(FloatSimd a, FloatSimd b) { return {vmulq_f32(a.v, b.v)}; }
+    friend FloatSimd operator/(FloatSimd a, FloatSimd b) { return {vdivq_f32(a.v, b.v)}; }
+
+    static FloatSimd Sqrt(FloatSimd a) { return {vsqrtq_f32(a.v)}; }
+    static FloatSimd Min(FloatSimd a, FloatSimd b) { return {vminq_f32(a.v, b.v)}; }
+    static FloatSimd Max(FloatSimd a, FloatSimd b) { return {vmaxq_f32(a.v, b.v)}; }
+    static FloatSimd Round(FloatSimd a) { return {vrndnq_f32(a.v)}; }
+    static FloatSimd Trunc(FloatSimd a) { return {vrndq_f32(a.v)}; }
+    static FloatSimd AsIntToFloat(FloatSimd a) { return {vcvtq_f32_s32(vreinterpretq_s32_f32(a.v))}; }
+    static FloatSimd Wrap255(FloatSimd a) { return {vcvtq_f32_s32(vandq_s32(vcvtq_s32_f32(a.v), vdupq_n_s32(0xFF)))}; }
+
+    static FloatSimd Greater(FloatSimd a, FloatSimd b) { return {vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(a.v, b.v), vreinterpretq_u32_f32(vdupq_n_f32(1.f))))}; }
+    static FloatSimd GreaterEqual(FloatSimd a, FloatSimd b) { return {vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(a.v, b.v), vreinterpretq_u32_f32(vdupq_n_f32(1.f))))}; }
+
+    // NEON has no gather instruction
+    static FloatSimd Gather(const float* table, FloatSimd index)
+    {
+        int32_t i[4];
+        vst1q_s32(i, vcvtq_s32_f32(index.v));
+        const float g[4] = {table[i[0]], table[i[1]], table[i[2]], table[i[3]]};
+        return {vld1q_f32(g)};
+    }
+};
+
+#endif
+
+} // namespace AsteroidsSimd
@@ -61,7 +61,9 @@ THE SOFTWARE.
 // We don't need to include this. It does no harm, but no use either.
 #include	"simplexnoise1234.h"
 
+#ifdef _MSC_VER
 #pragma warning(disable: 4244) // conversion double -> float
+#endif
 
 #define FASTFLOOR(x) ( ((x)>0) ? ((int)x) : (((int)x)-1) )
 
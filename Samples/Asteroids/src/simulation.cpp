@@ -11,13 +11,19 @@
 #include "simulation.h"
 #include "settings.h"
 #include "texture.h"
+#include "noise_simd.h"
+#include "noise_texture.h"
+#include "parallel_for.h"
 #include "util.h"
+#include "AdvancedMath.hpp"
+#include "FileSystem.hpp"
 
 #include <random>
 #include <limits>
 #include <algorithm>
 #include <iostream>
-#include <ppl.h>
+#include <string>
+#include <thread>
 
 using namespace DirectX;
 
@@ -32,27 +38,17 @@ static int const COLOR_SCHEMES[] = {
 
 static int const NUM_COLOR_SCHEMES = (int) (sizeof(COLOR_SCHEMES) / (6 * sizeof(int)));
 
-static XMVECTOR RandomPointOnSphere(std::mt19937& rng)
+static AsteroidsSimulationCore::CreateInfo GetCoreCreateInfo(unsigned int rngSeed, unsigned int asteroidCount, unsigned int subdivCount)
 {
-    std::normal_distribution<float> dist;
-
-    XMVECTOR r;
-    for (;;) {
-        r = XMVectorSet(dist(rng), dist(rng), dist(rng), 0.0f);
-        auto d2 = XMVectorGetX(XMVector3LengthSq(r));
-        if (d2 > std::numeric_limits<float>::min()) {
-            return XMVector3Normalize(r);
-        }
-    }
-    // Unreachable
-}
-
-// From http://guihaire.com/code/?p=1135
-static inline float VeryApproxLog2f(float x)
-{   
-    union { float f; uint32_t i; } ux;
-    ux.f = x;
-    return (float)ux.i * 1.1920928955078125e-7f - 126.94269504f;
+    AsteroidsSimulationCore::CreateInfo CI;
+    // Use a different seed than the meshes and the render data
+    CI.rngSeed       = rngSeed ^ 0x9E3779B9u;
+    CI.asteroidCount = asteroidCount;
+    CI.orbitRadius   = SIM_ORBIT_RADIUS;
+    CI.discRadius    = SIM_DISC_RADIUS;
+    CI.minScale      = SIM_MIN_SCALE;
+    CI.maxSubdiv     = subdivCount;
+    return CI;
 }
 
 
@@ -60,29 +56,46 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
                                          unsigned int meshInstanceCount, unsigned int subdivCount,
                                          unsigned int textureCount)
     : mAsteroidStatic(asteroidCount)
-    , mAsteroidDynamic(asteroidCount)
+    , mCore(GetCoreCreateInfo(rngSeed, asteroidCount, subdivCount))
     , mIndexOffsets(size_t{subdivCount} + 2) // Mesh subdivs are inclusive on both ends and need forward differencing for count
     , mSubdivCount(subdivCount)
 {
     std::mt19937 rng(rngSeed);
 
+    // Meshes and textures are generated on one pool that is released once the assets are ready
+    Diligent::TaskScheduler scheduler{std::max(std::thread::hardware_concurrency(), 1u) - 1u};
+
     // Create meshes
     std::cout
         << "Creating " << meshInstanceCount << " meshes, each with "
         << subdivCount << " subdivision levels..." << std::endl;
 
-    CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
-                                  rng(), mIndexOffsets.data(), &mVertexCountPerMesh);
+    // Mesh generation is deterministic, so the meshes are cached between launches in the local
+    // application data directory. The displacement depends on the noise kernel, so every kernel
+    // uses its own file.
+    auto meshSeed = rng();
+    std::string meshCacheFile = Diligent::FileSystem::GetLocalAppDataDirectory("DiligentEngine-Asteroids");
+    if (!Diligent::FileSystem::PathExists(meshCacheFile.c_str()))
+        Diligent::FileSystem::CreateDirectory(meshCacheFile.c_str());
+    if (!meshCacheFile.empty() && !Diligent::FileSystem::IsSlash(meshCacheFile.back()))
+        meshCacheFile.push_back(Diligent::FileSystem::SlashSymbol);
+    meshCacheFile += "asteroid_meshes_" + std::to_string(meshSeed) + "_" +
+        std::to_string(meshInstanceCount) + "_" + std::to_string(subdivCount) + "_" +
+        SimplexNoiseSimdIsa() + std::to_string(SimplexNoiseSimdWidth()) + ".bin";
+    if (LoadAsteroidsMeshCache(meshCacheFile.c_str(), &mMeshes, mSubdivCount, meshInstanceCount,
+                               meshSeed, mIndexOffsets.data(), &mVertexCountPerMesh)) {
+        std::cout << "Loaded meshes from " << meshCacheFile << std::endl;
+    } else {
+        CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
+                                      meshSeed, mIndexOffsets.data(), &mVertexCountPerMesh, &scheduler);
+        if (!SaveAsteroidsMeshCache(meshCacheFile.c_str(), mMeshes, mSubdivCount, meshInstanceCount,
+                                    meshSeed, mIndexOffsets.data(), mVertexCountPerMesh))
+            std::cout << "Failed to write mesh cache " << meshCacheFile << std::endl;
+    }
 
-    CreateTextures(textureCount, rng());
+    CreateTextures(textureCount, rng(), &scheduler);
 
     // Constants
-    std::normal_distribution<float> orbitRadiusDist(SIM_ORBIT_RADIUS, 0.6f * SIM_DISC_RADIUS);
-    std::normal_distribution<float> heightDist(0.0f, 0.4f);
-    std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
-    std::uniform_real_distribution<float> radialVelocityDist(5.0f, 15.0f);
-    std::uniform_real_distribution<float> spinVelocityDist(-2.0f, 2.0f);
-    std::normal_distribution<float> scaleDist(1.3f, 0.7f);
     std::normal_distribution<float> colorSchemeDist(0, NUM_COLOR_SCHEMES - 1);
     std::uniform_int_distribution<unsigned int> textureIndexDist(0, textureCount-1);
 
@@ -94,83 +107,93 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         linearColorSchemes[i] = std::powf((float)COLOR_SCHEMES[i] / 255.0f, 2.2f);
     }
 
-    // Create a torus of asteroids that spin around the ring
+    // Orbits are created by AsteroidsSimulationCore; only the render data is initialized here
     for (unsigned int i = 0; i < asteroidCount; ++i) {
-        auto scale = scaleDist(rng);
-#if SIM_USE_GAMMA_DIST_SCALE
-        scale = scale * 0.3f;
-#endif
-        scale = std::max(scale, SIM_MIN_SCALE);
-        auto scaleMatrix = XMMatrixScaling(scale, scale, scale);
-
-        auto orbitRadius = orbitRadiusDist(rng);
-        auto discPosY = float(SIM_DISC_RADIUS) * heightDist(rng);
-
-        auto disc = XMMatrixTranslation(orbitRadius, discPosY, 0.0f);
-
-        auto positionAngle = angleDist(rng);
-        auto orbit = XMMatrixRotationY(positionAngle);
-
         auto meshInstance = (unsigned int)(i / instancesPerMesh); // Vcache friendly ordering
 
-        // Static data
-        mAsteroidStatic[i].spinVelocity = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
-        mAsteroidStatic[i].orbitVelocity = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
         mAsteroidStatic[i].vertexStart = mVertexCountPerMesh * meshInstance;
-        mAsteroidStatic[i].spinAxis = XMVector3Normalize(RandomPointOnSphere(rng));
-        mAsteroidStatic[i].scale = scale;
         mAsteroidStatic[i].textureIndex = textureIndexDist(rng);
 
         auto colorScheme = ((int)abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
         auto c = linearColorSchemes + 6 * colorScheme;
         mAsteroidStatic[i].surfaceColor = XMFLOAT3(c[0], c[1], c[2]);
         mAsteroidStatic[i].deepColor    = XMFLOAT3(c[3], c[4], c[5]);
-
-        // Initialize dynamic data
-        mAsteroidDynamic[i].world = scaleMatrix * disc * orbit;
-
-        assert(mAsteroidStatic[i].scale > 0.0f);
-        assert(mAsteroidStatic[i].orbitVelocity > 0.0f);
     }
 }
 
 
-void AsteroidsSimulation::Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+void AsteroidsSimulation::Update(float frameTime, const OrbitCamera& camera, const Settings& settings,
                                  size_t startIndex, size_t count)
 {
-    bool animate = settings.animate;
+    XMFLOAT3 eye;
+    XMStoreFloat3(&eye, camera.Eye());
+
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4(&viewProj, camera.ViewProjection());
+    Diligent::float4x4 viewProjMatr;
+    static_assert(sizeof(viewProj) == sizeof(viewProjMatr), "Unexpected matrix size");
+    memcpy(&viewProjMatr, &viewProj, sizeof(viewProj));
+
+    Diligent::ViewFrustum frustum;
+    Diligent::ExtractViewFrustumPlanesFromMatrix(viewProjMatr, frustum, false);
+
+    AsteroidsSimulationCore::UpdateAttribs attribs;
+    attribs.frameTime     = frameTime;
+    attribs.cameraEye     = Diligent::float3{eye.x, eye.y, eye.z};
+    attribs.animate       = settings.animate;
+    attribs.frustum       = settings.frustumCulling ? &frustum : nullptr;
+    attribs.lodPixelScale = 0.5f * static_cast<float>(settings.renderHeight) * XMVectorGetY(camera.ProjectionMatrix().r[1]);
+    mCore.Update(attribs, startIndex, count);
+}
 
-    // TODO: This constant should really depend on resolution and/or be configurable...
-    static const float minSubdivSizeLog2 = std::log2f(0.0019f);
 
-    size_t last = count ? startIndex + count : mAsteroidDynamic.size();
-    for (size_t i = startIndex; i < last; ++i) {
-        const AsteroidStatic& staticData = mAsteroidStatic[i];
-        AsteroidDynamic& dynamicData = mAsteroidDynamic[i];
+void AsteroidsSimulation::GetVisibleAsteroids(size_t startIndex, size_t count, std::vector<unsigned int>& visibleIndices) const
+{
+    // Counting sort by texture index
+    std::vector<unsigned int> textureOffsets(mTextureCount + 1);
+    for (size_t i = startIndex; i < startIndex + count; ++i)
+    {
+        if (mCore.Visible(i))
+            ++textureOffsets[mAsteroidStatic[i].textureIndex + 1];
+    }
+    for (unsigned int t = 0; t < mTextureCount; ++t)
+        textureOffsets[t + 1] += textureOffsets[t];
+
+    visibleIndices.resize(textureOffsets[mTextureCount]);
+    for (size_t i = startIndex; i < startIndex + count; ++i)
+    {
+        if (mCore.Visible(i))
+            visibleIndices[textureOffsets[mAsteroidStatic[i].textureIndex]++] = static_cast<unsigned int>(i);
+    }
+}
 
-        if (animate) {
-            auto orbit = XMMatrixRotationY(staticData.orbitVelocity * frameTime);
-            auto spin = XMMatrixRotationNormal(staticData.spinAxis, staticData.spinVelocity * frameTime);
-            dynamicData.world = spin * dynamicData.world * orbit;
-        }
 
-        // Pick LOD based on approx screen area - can be very approximate
-        auto position = dynamicData.world.r[3];
-        auto distanceToEyeRcp = XMVectorGetX(XMVector3ReciprocalLengthEst(XMVectorSubtract(cameraEye, position)));
-        // Add one subdiv for each factor of 2 past min
-        auto relativeScreenSizeLog2 = VeryApproxLog2f(staticData.scale * distanceToEyeRcp);
-        float subdivFloat = std::max(0.0f, relativeScreenSizeLog2 - minSubdivSizeLog2);
-        auto subdiv = std::min(mSubdivCount, (unsigned int)subdivFloat);
-
-        // TODO: Ignore/cull/force lowest subdiv if offscreen?
-        
-        dynamicData.indexStart = mIndexOffsets[subdiv];
-        dynamicData.indexCount = mIndexOffsets[subdiv+1] - dynamicData.indexStart;
+void AsteroidsSimulation::GetVisibleAsteroidsBySubdiv(size_t startIndex, size_t count, std::vector<unsigned int>& visibleIndices,
+                                                      std::vector<unsigned int>& subdivOffsets) const
+{
+    const auto numLevels = SubdivLevelCount();
+
+    // Counting sort by subdiv level
+    subdivOffsets.assign(numLevels + 1, 0);
+    for (size_t i = startIndex; i < startIndex + count; ++i)
+    {
+        if (mCore.Visible(i))
+            ++subdivOffsets[mCore.Subdiv(i) + 1];
+    }
+    for (unsigned int l = 0; l < numLevels; ++l)
+        subdivOffsets[l + 1] += subdivOffsets[l];
+
+    visibleIndices.resize(subdivOffsets[numLevels]);
+    std::vector<unsigned int> writePos(subdivOffsets.begin(), subdivOffsets.end() - 1);
+    for (size_t i = startIndex; i < startIndex + count; ++i)
+    {
+        if (mCore.Visible(i))
+            visibleIndices[writePos[mCore.Subdiv(i)]++] = static_cast<unsigned int>(i);
     }
 }
 
 
-void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int rngSeed)
+void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int rngSeed, Diligent::TaskScheduler* scheduler)
 {
     mTextureDim = TEXTURE_DIM;
     mTextureCount = textureCount;
@@ -197,19 +220,8 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
     mTextureDataBuffer.resize(size_t{totalTextureSizeInBytes} * size_t{textureCount});
     mTextureSubresources.resize(size_t{mTextureArraySize} * size_t{mTextureMipLevels} * size_t{textureCount});
     
-    // Parallel over textures
-    std::vector<unsigned int> rngSeeds(textureCount);
-    {
-        std::mt19937 seeds;
-        for (auto &i : rngSeeds) i = seeds();
-    }
-
-    concurrency::parallel_for(UINT(0), textureCount, [&](UINT t) {
-        std::mt19937 rng(rngSeeds[t]);
-        auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
-        auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
-        auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
-
+    // Subresource layout: all mips of every array slice of a texture are packed together
+    for (UINT t = 0; t < textureCount; ++t) {
         BYTE* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
         for (UINT a = 0; a < mTextureArraySize; ++a) {
             for (UINT m = 0; m < mTextureMipLevels; ++m) {
@@ -224,27 +236,61 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
                 data += size_t{initialData.SysMemPitch} * size_t{height};
             }
         }
+    }
 
-        // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
-        float noiseScale = randomNoiseScale(rng) / float(mTextureDim);
-        float persistence = randomPersistence(rng);
-        float strength = 1.5f;
-
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            float redScale   = 255.0f;
-            float greenScale = 255.0f;
-            float blueScale  = 255.0f;
+    // Draw the noise parameters serially, so the textures do not depend on the scheduling
+    std::vector<NoiseTextureParams> sliceParams(size_t{textureCount} * size_t{mTextureArraySize});
+    {
+        std::mt19937 seeds;
+        for (UINT t = 0; t < textureCount; ++t) {
+            std::mt19937 rng(seeds());
+            auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
+            auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
+            auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
+
+            // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
+            NoiseTextureParams params;
+            params.noiseScale = randomNoiseScale(rng) / float(mTextureDim);
+            params.persistence = randomPersistence(rng);
+            params.noiseStrength = 1.5f;
 
             // DEBUG colors
 #if 0
-            redScale   = t & 1 ? 255.0f : 0.0f;
-            greenScale = t & 2 ? 255.0f : 0.0f;
-            blueScale  = t & 4 ? 255.0f : 0.0f;
+            params.redScale   = t & 1 ? 255.0f : 0.0f;
+            params.greenScale = t & 2 ? 255.0f : 0.0f;
+            params.blueScale  = t & 4 ? 255.0f : 0.0f;
 #endif
 
-            FillNoise2D_RGBA8(&mTextureSubresources[SubresourceIndex(t, a)], mTextureDim, mTextureDim, mTextureMipLevels,
-                              randomNoise(rng), persistence, noiseScale, strength,
-                              redScale, greenScale, blueScale);
+            for (UINT a = 0; a < mTextureArraySize; ++a) {
+                params.seed = randomNoise(rng);
+                sliceParams[t * mTextureArraySize + a] = params;
+            }
         }
-    }); // parallel_for
+    }
+
+    // Parallel over bands of rows of every texture slice, so that a handful of textures still keeps all threads busy.
+    // Each mip level is a separate pass, as it reads the level above it.
+    const UINT bandRows = 32;
+    const UINT sliceCount = textureCount * mTextureArraySize;
+    for (UINT m = 0; m < mTextureMipLevels; ++m) {
+        const UINT width = mTextureDim >> m;
+        const UINT height = mTextureDim >> m;
+        const UINT bandCount = (height + bandRows - 1) / bandRows;
+        ParallelFor(scheduler, UINT(0), sliceCount * bandCount, [&](UINT job) {
+            const UINT slice = job / bandCount;
+            const UINT t = slice / mTextureArraySize;
+            const UINT a = slice % mTextureArraySize;
+            const UINT firstRow = (job % bandCount) * bandRows;
+            const UINT numRows = std::min(bandRows, height - firstRow);
+
+            const auto& dst = mTextureSubresources[SubresourceIndex(t, a, m)];
+            if (m == 0) {
+                FillNoiseRows_RGBA8((uint8_t*)dst.pSysMem, dst.SysMemPitch, width, firstRow, numRows, sliceParams[slice]);
+            } else {
+                const auto& src = mTextureSubresources[SubresourceIndex(t, a, m - 1)];
+                DownsampleRows_XXXX8((const uint8_t*)src.pSysMem, src.SysMemPitch, (uint8_t*)dst.pSysMem, dst.SysMemPitch,
+                                     width, firstRow, numRows);
+            }
+        });
+    }
 }
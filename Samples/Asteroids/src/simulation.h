@@ -15,28 +15,17 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <cstring>
 
 #include "mesh.h"
 #include "settings.h"
+#include "simulation_core.h"
 
-// We may want to ISPC-ify this down the road and just let it own the data structure in AoSoA format or similar
-// For now we'll just do the dumb thing and see if it's fast enough
-struct AsteroidDynamic
-{
-    DirectX::XMMATRIX world;
-    // These depend on chosen subdiv level, hence are not constant
-    unsigned int indexStart;
-    unsigned int indexCount;
-};
-
+// Render-only data. Orbit and spin state is owned by AsteroidsSimulationCore
 struct AsteroidStatic
 {
     DirectX::XMFLOAT3 surfaceColor;
     DirectX::XMFLOAT3 deepColor;
-    DirectX::XMVECTOR spinAxis;
-    float scale;
-    float spinVelocity;
-    float orbitVelocity;
     unsigned int vertexStart;
     unsigned int textureIndex;
 };
@@ -44,9 +33,8 @@ struct AsteroidStatic
 class AsteroidsSimulation
 {
 private:
-    // NOTE: Memory could be optimized further for efficient cache traversal, etc.
     std::vector<AsteroidStatic> mAsteroidStatic;
-    std::vector<AsteroidDynamic> mAsteroidDynamic;
+    AsteroidsSimulationCore mCore;
 
     Mesh mMeshes;
     std::vector<unsigned int> mIndexOffsets;
@@ -65,7 +53,7 @@ private:
         return mip + mTextureMipLevels * (arrayElement + mTextureArraySize * texture);
     }
 
-    void CreateTextures(unsigned int textureCount, unsigned int rngSeed);
+    void CreateTextures(unsigned int textureCount, unsigned int rngSeed, Diligent::TaskScheduler* scheduler);
     
 public:
     AsteroidsSimulation(unsigned int rngSeed, unsigned int asteroidCount,
@@ -81,10 +69,39 @@ public:
     unsigned int GetTextureMipLevels()const{return mTextureMipLevels;}
 
     const AsteroidStatic* StaticData() const { return mAsteroidStatic.data(); }
-    const AsteroidDynamic* DynamicData() const { return mAsteroidDynamic.data(); }
+    const AsteroidsSimulationCore& Core() const { return mCore; }
+
+    void WorldMatrix(size_t i, DirectX::XMFLOAT4X4* world) const
+    {
+        static_assert(sizeof(*world) == sizeof(Diligent::float4x4), "Unexpected matrix size");
+        const auto m = mCore.WorldMatrix(i);
+        memcpy(world, &m, sizeof(*world));
+    }
+
+    // Number of subdiv levels, which are shared by all meshes
+    unsigned int SubdivLevelCount() const { return mSubdivCount + 1; }
+    unsigned int SubdivIndexStart(unsigned int subdiv) const { return mIndexOffsets[subdiv]; }
+    unsigned int SubdivIndexCount(unsigned int subdiv) const { return mIndexOffsets[subdiv + 1] - mIndexOffsets[subdiv]; }
+
+    // Index range of the subdiv level selected by the last Update()
+    unsigned int IndexStart(size_t i) const { return SubdivIndexStart(mCore.Subdiv(i)); }
+    unsigned int IndexCount(size_t i) const { return SubdivIndexCount(mCore.Subdiv(i)); }
+
+    // Result of the frustum culling done by the last Update()
+    bool Visible(size_t i) const { return mCore.Visible(i); }
+
+    // Writes indices of the visible asteroids in [startIndex, startIndex + count) to visibleIndices,
+    // sorted by texture index to minimize state changes. Different threads may process different ranges.
+    void GetVisibleAsteroids(size_t startIndex, size_t count, std::vector<unsigned int>& visibleIndices) const;
+
+    // Same as GetVisibleAsteroids(), but sorts the asteroids by subdiv level instead, so that all
+    // asteroids of one level can be drawn with a single instanced draw call.
+    // subdivOffsets receives SubdivLevelCount() + 1 offsets of the levels in visibleIndices.
+    void GetVisibleAsteroidsBySubdiv(size_t startIndex, size_t count, std::vector<unsigned int>& visibleIndices,
+                                     std::vector<unsigned int>& subdivOffsets) const;
 
     // Can optionally provide a range of asteroids to update; count = 0 => to the end
     // This is useful for multithreading
-    void Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+    void Update(float frameTime, const OrbitCamera& camera, const Settings& settings,
                 size_t startIndex = 0, size_t count = 0);
 };
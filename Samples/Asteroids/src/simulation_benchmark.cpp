@@ -0,0 +1,192 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// Headless benchmark of AsteroidsSimulationCore::Update().
+//
+// Usage: AsteroidsSimulationBenchmark [--count N]... [--frames N] [--threads N] [--scalar] [--no_cull]
+// Without --count, runs 50k, 100k, 250k, 500k and 1M asteroids.
+// Unless --no_cull is specified, the update also performs frustum culling against the default camera.
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+#include "simulation_core.h"
+#include "AdvancedMath.hpp"
+
+namespace
+{
+
+struct BenchmarkResult
+{
+    double msPerFrame;
+    double asteroidsPerSecond;
+    double visibleFraction;
+};
+
+// Right-handed look-at view matrix multiplied by a reverse-Z perspective projection,
+// the same as OrbitCamera uses. Row-vector convention.
+Diligent::float4x4 ViewProjection(const Diligent::float3& eye, float fovY, float aspect, float zNear, float zFar)
+{
+    // Looking at the origin with Y up
+    const float     eyeLen = std::sqrt(Diligent::dot(eye, eye));
+    Diligent::float3 z      = eye / eyeLen;
+    Diligent::float3 x{z.z, 0, -z.x}; // cross(up, z)
+    x = x / std::sqrt(Diligent::dot(x, x));
+    const Diligent::float3 y{z.y * x.z - z.z * x.y, z.z * x.x - z.x * x.z, z.x * x.y - z.y * x.x}; // cross(z, x)
+
+    const float yScale = 1.f / std::tan(0.5f * fovY);
+    const float xScale = yScale / aspect;
+    // The camera uses near and far planes swapped, i.e. zNear > zFar
+    const float zRange = zFar / (zNear - zFar);
+
+    const float view[4][4] = {
+        {x.x, y.x, z.x, 0},
+        {x.y, y.y, z.y, 0},
+        {x.z, y.z, z.z, 0},
+        {-Diligent::dot(x, eye), -Diligent::dot(y, eye), -Diligent::dot(z, eye), 1},
+    };
+    // Projection is [xScale 0 0 0; 0 yScale 0 0; 0 0 zRange -1; 0 0 zRange*zNear 0]
+    float m[4][4];
+    for (int r = 0; r < 4; ++r)
+    {
+        m[r][0] = view[r][0] * xScale;
+        m[r][1] = view[r][1] * yScale;
+        m[r][2] = view[r][2] * zRange + view[r][3] * zRange * zNear;
+        m[r][3] = -view[r][2];
+    }
+    // clang-format off
+    return Diligent::float4x4
+    {
+        m[0][0], m[0][1], m[0][2], m[0][3],
+        m[1][0], m[1][1], m[1][2], m[1][3],
+        m[2][0], m[2][1], m[2][2], m[2][3],
+        m[3][0], m[3][1], m[3][2], m[3][3]
+    };
+    // clang-format on
+}
+
+BenchmarkResult RunBenchmark(size_t asteroidCount, unsigned int numFrames, unsigned int numThreads, bool useSimd, bool cull)
+{
+    AsteroidsSimulationCore::CreateInfo CI;
+    CI.rngSeed       = 1337;
+    CI.asteroidCount = asteroidCount;
+    AsteroidsSimulationCore simulation{CI};
+    simulation.SetSimdEnabled(useSimd);
+
+    // Default camera of the sample at 1080x720
+    const Diligent::float3 eye{0.f, 180.f, -600.f};
+    const float            fovY   = 0.4f * 3.14159265f;
+    const float            height = 720.f;
+
+    Diligent::ViewFrustum frustum;
+    Diligent::ExtractViewFrustumPlanesFromMatrix(ViewProjection(eye, fovY, 1.5f, 10000.f, 0.1f), frustum, false);
+
+    AsteroidsSimulationCore::UpdateAttribs attribs;
+    attribs.frameTime     = 1.f / 60.f;
+    attribs.cameraEye     = eye;
+    attribs.animate       = true;
+    attribs.frustum       = cull ? &frustum : nullptr;
+    attribs.lodPixelScale = 0.5f * height / std::tan(0.5f * fovY);
+
+    // Asteroids are independent, so every thread updates its own range for all frames.
+    // Ranges are aligned to the SIMD width so that only the last one has a scalar tail.
+    // With fewer asteroids than threads, some threads stay idle: an empty range would
+    // never advance the loop below, and a zero count means "to the end" for Update().
+    const size_t simdWidth  = AsteroidsSimulationCore::SimdWidth();
+    const size_t rangeSize  = std::max((asteroidCount / numThreads + simdWidth - 1) / simdWidth * simdWidth, simdWidth);
+    auto         updateFunc = [&](size_t start) {
+        const size_t count = std::min(rangeSize, asteroidCount - start);
+        for (unsigned int frame = 0; frame < numFrames; ++frame)
+            simulation.Update(attribs, start, count);
+    };
+
+    // Warm up caches
+    simulation.Update(attribs);
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    {
+        std::vector<std::thread> threads;
+        for (size_t start = rangeSize; start < asteroidCount; start += rangeSize)
+            threads.emplace_back(updateFunc, start);
+        updateFunc(0);
+        for (auto& thread : threads)
+            thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+    BenchmarkResult result;
+    result.msPerFrame         = elapsed.count() * 1000.0 / numFrames;
+    result.asteroidsPerSecond = static_cast<double>(asteroidCount) * numFrames / elapsed.count();
+
+    size_t numVisible = 0;
+    for (size_t i = 0; i < asteroidCount; ++i)
+        numVisible += simulation.Visible(i) ? 1 : 0;
+    result.visibleFraction = static_cast<double>(numVisible) / asteroidCount;
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> counts;
+    unsigned int        numFrames  = 100;
+    unsigned int        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool                useSimd    = true;
+    bool                cull       = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            counts.push_back(static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10)));
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            numFrames = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            numThreads = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--scalar") == 0)
+            useSimd = false;
+        else if (strcmp(argv[i], "--no_cull") == 0)
+            cull = false;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--count N]... [--frames N] [--threads N] [--scalar] [--no_cull]" << std::endl;
+            return -1;
+        }
+    }
+
+    if (counts.empty())
+        counts = {50000, 100000, 250000, 500000, 1000000};
+    numFrames  = std::max(numFrames, 1u);
+    numThreads = std::max(numThreads, 1u);
+
+    std::cout << "Kernel: " << (useSimd ? AsteroidsSimulationCore::SimdWidth() : 1u) << "-wide, "
+              << numThreads << " thread(s), " << numFrames << " frames, culling " << (cull ? "on" : "off") << std::endl;
+    std::cout << std::setw(12) << "asteroids" << std::setw(14) << "ms/frame" << std::setw(18) << "Masteroids/s" << std::setw(12) << "visible" << std::endl;
+    for (auto count : counts)
+    {
+        if (count == 0)
+            continue;
+        auto result = RunBenchmark(count, numFrames, numThreads, useSimd, cull);
+        std::cout << std::setw(12) << count
+                  << std::setw(14) << std::fixed << std::setprecision(3) << result.msPerFrame
+                  << std::setw(18) << std::fixed << std::setprecision(1) << result.asteroidsPerSecond * 1e-6
+                  << std::setw(11) << std::fixed << std::setprecision(1) << result.visibleFraction * 100.0 << "%" << std::endl;
+    }
+
+    return 0;
+}
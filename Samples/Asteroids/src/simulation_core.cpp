@@ -0,0 +1,384 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "simulation_core.h"
+#include "simd_float.h"
+#include "AdvancedMath.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+
+using AsteroidsSimd::Float1;
+#if ASTEROIDS_SIM_USE_SIMD
+using AsteroidsSimd::FloatSimd;
+#endif
+
+// Computes sin(x) and cos(x) for |x| < 2^23.
+// Cody-Waite reduction to [-pi/4, pi/4] followed by the minimax polynomials from Cephes.
+template <typename V>
+void SinCos(V x, V& outSin, V& outCos)
+{
+    const V j = V::Round(x * V::Set(0.63661977236f)); // x * 2/pi
+    const V r = ((x - j * V::Set(1.5703125f)) - j * V::Set(4.837512969970703125e-4f)) - j * V::Set(7.54978995489188216e-8f);
+
+    const V r2 = r * r;
+    const V s  = r + r * r2 * (V::Set(-1.6666654611e-1f) + r2 * (V::Set(8.3321608736e-3f) + r2 * V::Set(-1.9515295891e-4f)));
+    const V c  = V::Set(1.f) - V::Set(0.5f) * r2 +
+        r2 * r2 * (V::Set(4.166664568298827e-2f) + r2 * (V::Set(-1.388731625493765e-3f) + r2 * V::Set(2.443315711809948e-5f)));
+
+    // Quadrant q = j mod 4 split into bits b0 and b1. Offsets keep Round() away from ties.
+    const V q  = j - V::Set(4.f) * V::Round(j * V::Set(0.25f) - V::Set(0.375f));
+    const V b1 = V::Round(q * V::Set(0.5f) - V::Set(0.25f));
+    const V b0 = q - V::Set(2.f) * b1;
+
+    // q = 0: ( s,  c)
+    // q = 1: ( c, -s)
+    // q = 2: (-s, -c)
+    // q = 3: (-c,  s)
+    const V one     = V::Set(1.f);
+    const V two     = V::Set(2.f);
+    const V sinSign = one - two * b1;
+    const V cosSign = one - two * (b0 + b1 - two * b0 * b1); // -1 if b0 xor b1
+    outSin          = ((one - b0) * s + b0 * c) * sinSign;
+    outCos          = ((one - b0) * c + b0 * s) * cosSign;
+}
+
+struct KernelArgs
+{
+    const float* spinAxisX;
+    const float* spinAxisY;
+    const float* spinAxisZ;
+    const float* spinVelocity;
+    const float* orbitVelocity;
+    const float* scale;
+
+    float*   posX;
+    float*   posY;
+    float*   posZ;
+    float*   rotX;
+    float*   rotY;
+    float*   rotZ;
+    float*   rotW;
+    uint8_t* subdiv;
+    uint8_t* visible;
+
+    float            frameTime;
+    Diligent::float3 eye;
+    bool             animate;
+    float            lodScale;
+    float            minSubdivSizeLog2;
+    float            maxSubdiv;
+
+    // Normalized frustum planes (nx, ny, nz, d) with normals pointing inside
+    bool  cull;
+    float planes[Diligent::ViewFrustum::NUM_PLANES][4];
+    float meshRadius;
+};
+
+// Updates asteroids [start, start + N*V::Width) and returns the first asteroid that was not updated
+template <typename V>
+size_t UpdateKernel(const KernelArgs& a, size_t start, size_t end)
+{
+    const V halfFrameTime = V::Set(0.5f * a.frameTime);
+    const V eyeX          = V::Set(a.eye.x);
+    const V eyeY          = V::Set(a.eye.y);
+    const V eyeZ          = V::Set(a.eye.z);
+    const V one           = V::Set(1.f);
+    const V two           = V::Set(2.f);
+
+    size_t i = start;
+    for (; i + V::Width <= end; i += V::Width)
+    {
+        V px = V::Load(a.posX + i);
+        V py = V::Load(a.posY + i);
+        V pz = V::Load(a.posZ + i);
+
+        if (a.animate)
+        {
+            V so, co;
+            SinCos(V::Load(a.orbitVelocity + i) * halfFrameTime, so, co);
+            V ss, cs;
+            SinCos(V::Load(a.spinVelocity + i) * halfFrameTime, ss, cs);
+
+            // world = spin * world * orbit, which in terms of quaternions is
+            // rot = orbit (x) rot (x) spin, and the position is rotated by the orbit.
+            const V sx = V::Load(a.spinAxisX + i) * ss;
+            const V sy = V::Load(a.spinAxisY + i) * ss;
+            const V sz = V::Load(a.spinAxisZ + i) * ss;
+
+            const V qx = V::Load(a.rotX + i);
+            const V qy = V::Load(a.rotY + i);
+            const V qz = V::Load(a.rotZ + i);
+            const V qw = V::Load(a.rotW + i);
+
+            // t = rot (x) spin
+            const V tx = qw * sx + qx * cs + qy * sz - qz * sy;
+            const V ty = qw * sy - qx * sz + qy * cs + qz * sx;
+            const V tz = qw * sz + qx * sy - qy * sx + qz * cs;
+            const V tw = qw * cs - qx * sx - qy * sy - qz * sz;
+
+            // orbit (x) t, where orbit = (0, so, 0, co)
+            V rx = co * tx + so * tz;
+            V ry = co * ty + so * tw;
+            V rz = co * tz - so * tx;
+            V rw = co * tw - so * ty;
+
+            // Renormalize to keep rounding errors from accumulating
+            const V rcpLen = one / V::Sqrt(rx * rx + ry * ry + rz * rz + rw * rw);
+            rx             = rx * rcpLen;
+            ry             = ry * rcpLen;
+            rz             = rz * rcpLen;
+            rw             = rw * rcpLen;
+            rx.Store(a.rotX + i);
+            ry.Store(a.rotY + i);
+            rz.Store(a.rotZ + i);
+            rw.Store(a.rotW + i);
+
+            // Full orbit angle from the half angle
+            const V cosOrbit = one - two * so * so;
+            const V sinOrbit = two * so * co;
+
+            const V newX = px * cosOrbit + pz * sinOrbit;
+            const V newZ = pz * cosOrbit - px * sinOrbit;
+            px           = newX;
+            pz           = newZ;
+            px.Store(a.posX + i);
+            pz.Store(a.posZ + i);
+        }
+
+        const V scale = V::Load(a.scale + i);
+
+        // Sphere-vs-frustum test: the asteroid is visible unless its bounding sphere
+        // is entirely behind one of the planes. Lanes with a non-negative value are visible.
+        V visible = one;
+        if (a.cull)
+        {
+            V minDist = V::Set(std::numeric_limits<float>::max());
+            for (size_t p = 0; p < Diligent::ViewFrustum::NUM_PLANES; ++p)
+            {
+                const V d = px * V::Set(a.planes[p][0]) + py * V::Set(a.planes[p][1]) + pz * V::Set(a.planes[p][2]) + V::Set(a.planes[p][3]);
+                minDist   = V::Min(minDist, d);
+            }
+            visible = minDist + scale * V::Set(a.meshRadius);
+        }
+
+        // Pick LOD based on approx screen area - can be very approximate
+        const V dx               = eyeX - px;
+        const V dy               = eyeY - py;
+        const V dz               = eyeZ - pz;
+        const V distanceToEyeRcp = one / V::Sqrt(dx * dx + dy * dy + dz * dz);
+
+        // Very approximate log2 from http://guihaire.com/code/?p=1135
+        const V relativeScreenSizeLog2 = V::AsIntToFloat(scale * distanceToEyeRcp * V::Set(a.lodScale)) * V::Set(1.1920928955078125e-7f) - V::Set(126.94269504f);
+        // Add one subdiv for each factor of 2 past min
+        const V subdiv = V::Min(V::Max(relativeScreenSizeLog2 - V::Set(a.minSubdivSizeLog2), V::Set(0.f)), V::Set(a.maxSubdiv));
+
+        float subdivLanes[V::Width];
+        float visibleLanes[V::Width];
+        subdiv.Store(subdivLanes);
+        visible.Store(visibleLanes);
+        for (size_t l = 0; l < V::Width; ++l)
+        {
+            const bool isVisible = visibleLanes[l] >= 0.f;
+            a.visible[i + l]     = isVisible ? 1 : 0;
+            // Offscreen asteroids are not drawn, but use the lowest LOD in case they are
+            a.subdiv[i + l] = isVisible ? static_cast<uint8_t>(subdivLanes[l]) : 0;
+        }
+    }
+
+    return i;
+}
+
+Diligent::float3 RandomPointOnSphere(std::mt19937& rng)
+{
+    std::normal_distribution<float> dist;
+
+    for (;;)
+    {
+        Diligent::float3 r{dist(rng), dist(rng), dist(rng)};
+
+        auto d2 = Diligent::dot(r, r);
+        if (d2 > std::numeric_limits<float>::min())
+        {
+            return r / std::sqrt(d2);
+        }
+    }
+    // Unreachable
+}
+
+} // namespace
+
+AsteroidsSimulationCore::AsteroidsSimulationCore(const CreateInfo& CI) :
+    mCount{CI.asteroidCount},
+    mMaxSubdiv{CI.maxSubdiv},
+    mMeshRadius{CI.meshRadius},
+    mSpinAxisX(CI.asteroidCount),
+    mSpinAxisY(CI.asteroidCount),
+    mSpinAxisZ(CI.asteroidCount),
+    mSpinVelocity(CI.asteroidCount),
+    mOrbitVelocity(CI.asteroidCount),
+    mScale(CI.asteroidCount),
+    mPosX(CI.asteroidCount),
+    mPosY(CI.asteroidCount),
+    mPosZ(CI.asteroidCount),
+    mRotX(CI.asteroidCount),
+    mRotY(CI.asteroidCount),
+    mRotZ(CI.asteroidCount),
+    mRotW(CI.asteroidCount),
+    mSubdiv(CI.asteroidCount),
+    mVisible(CI.asteroidCount, 1)
+{
+    std::mt19937 rng(CI.rngSeed);
+
+    const float PI = 3.14159265358979f;
+
+    std::normal_distribution<float>       orbitRadiusDist(CI.orbitRadius, 0.6f * CI.discRadius);
+    std::normal_distribution<float>       heightDist(0.0f, 0.4f);
+    std::uniform_real_distribution<float> angleDist(-PI, PI);
+    std::uniform_real_distribution<float> radialVelocityDist(5.0f, 15.0f);
+    std::uniform_real_distribution<float> spinVelocityDist(-2.0f, 2.0f);
+    std::normal_distribution<float>       scaleDist(1.3f, 0.7f);
+
+    // Create a torus of asteroids that spin around the ring
+    for (size_t i = 0; i < mCount; ++i)
+    {
+        auto scale = scaleDist(rng);
+#if SIM_USE_GAMMA_DIST_SCALE
+        scale = scale * 0.3f;
+#endif
+        scale = std::max(scale, CI.minScale);
+
+        auto orbitRadius = orbitRadiusDist(rng);
+        auto discPosY    = CI.discRadius * heightDist(rng);
+
+        auto positionAngle = angleDist(rng);
+
+        mSpinVelocity[i]  = spinVelocityDist(rng) / scale;                   // Smaller asteroids spin faster
+        mOrbitVelocity[i] = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
+        mScale[i]         = scale;
+
+        auto spinAxis = RandomPointOnSphere(rng);
+        mSpinAxisX[i] = spinAxis.x;
+        mSpinAxisY[i] = spinAxis.y;
+        mSpinAxisZ[i] = spinAxis.z;
+
+        // Equivalent to scale * translation(orbitRadius, discPosY, 0) * rotationY(positionAngle)
+        mPosX[i] = orbitRadius * std::cos(positionAngle);
+        mPosY[i] = discPosY;
+        mPosZ[i] = -orbitRadius * std::sin(positionAngle);
+        mRotX[i] = 0;
+        mRotY[i] = std::sin(0.5f * positionAngle);
+        mRotZ[i] = 0;
+        mRotW[i] = std::cos(0.5f * positionAngle);
+
+        assert(mScale[i] > 0.0f);
+    }
+}
+
+unsigned int AsteroidsSimulationCore::SimdWidth()
+{
+#if ASTEROIDS_SIM_USE_SIMD
+    return static_cast<unsigned int>(FloatSimd::Width);
+#else
+    return 1;
+#endif
+}
+
+void AsteroidsSimulationCore::Update(const UpdateAttribs& attribs, size_t startIndex, size_t count)
+{
+    // TODO: This constant should really depend on resolution and/or be configurable...
+    static const float minSubdivSizeLog2 = std::log2(0.0019f);
+
+    KernelArgs args;
+    args.spinAxisX     = mSpinAxisX.data();
+    args.spinAxisY     = mSpinAxisY.data();
+    args.spinAxisZ     = mSpinAxisZ.data();
+    args.spinVelocity  = mSpinVelocity.data();
+    args.orbitVelocity = mOrbitVelocity.data();
+    args.scale         = mScale.data();
+    args.posX          = mPosX.data();
+    args.posY          = mPosY.data();
+    args.posZ          = mPosZ.data();
+    args.rotX          = mRotX.data();
+    args.rotY          = mRotY.data();
+    args.rotZ          = mRotZ.data();
+    args.rotW          = mRotW.data();
+    args.subdiv        = mSubdiv.data();
+    args.visible       = mVisible.data();
+    args.frameTime     = attribs.frameTime;
+    args.eye           = attribs.cameraEye;
+    args.animate       = attribs.animate;
+    args.maxSubdiv     = static_cast<float>(mMaxSubdiv);
+    args.meshRadius    = mMeshRadius;
+
+    if (attribs.lodPixelScale > 0)
+    {
+        // Lowest LOD for asteroids whose projected radius is one pixel or less
+        args.lodScale          = mMeshRadius * attribs.lodPixelScale;
+        args.minSubdivSizeLog2 = 0;
+    }
+    else
+    {
+        args.lodScale          = 1;
+        args.minSubdivSizeLog2 = minSubdivSizeLog2;
+    }
+
+    args.cull = attribs.frustum != nullptr;
+    if (args.cull)
+    {
+        for (size_t p = 0; p < Diligent::ViewFrustum::NUM_PLANES; ++p)
+        {
+            const auto& plane = attribs.frustum->GetPlane(static_cast<Diligent::ViewFrustum::PLANE_IDX>(p));
+            // Frustum planes extracted from a matrix are not normalized
+            const float rcpLen = 1.f / std::sqrt(Diligent::dot(plane.Normal, plane.Normal));
+            args.planes[p][0]  = plane.Normal.x * rcpLen;
+            args.planes[p][1]  = plane.Normal.y * rcpLen;
+            args.planes[p][2]  = plane.Normal.z * rcpLen;
+            args.planes[p][3]  = plane.Distance * rcpLen;
+        }
+    }
+
+    size_t last = count ? startIndex + count : mCount;
+    assert(last <= mCount);
+
+    size_t i = startIndex;
+#if ASTEROIDS_SIM_USE_SIMD
+    if (mSimdEnabled)
+        i = UpdateKernel<FloatSimd>(args, i, last);
+#endif
+    // Remaining asteroids
+    UpdateKernel<Float1>(args, i, last);
+}
+
+Diligent::float4x4 AsteroidsSimulationCore::WorldMatrix(size_t i) const
+{
+    const float x = mRotX[i];
+    const float y = mRotY[i];
+    const float z = mRotZ[i];
+    const float w = mRotW[i];
+    const float s = mScale[i];
+
+    // clang-format off
+    return Diligent::float4x4
+    {
+        s * (1 - 2 * (y * y + z * z)), s * (2 * (x * y + z * w)),     s * (2 * (x * z - y * w)),     0,
+        s * (2 * (x * y - z * w)),     s * (1 - 2 * (x * x + z * z)), s * (2 * (y * z + x * w)),     0,
+        s * (2 * (x * z + y * w)),     s * (2 * (y * z - x * w)),     s * (1 - 2 * (x * x + y * y)), 0,
+        mPosX[i],                      mPosY[i],                      mPosZ[i],                      1
+    };
+    // clang-format on
+}
@@ -0,0 +1,114 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+struct ViewFrustum;
+}
+
+// Platform-independent part of the asteroid simulation: orbit and spin state of every
+// asteroid, per-frame visibility and LOD selection. The state is stored in SoA format (position and
+// orientation quaternion instead of a full world matrix) so that Update() can process
+// 4 (SSE2, NEON) or 8 (AVX2, see DILIGENT_ASTEROIDS_AVX2) asteroids per iteration.
+class AsteroidsSimulationCore
+{
+public:
+    struct CreateInfo
+    {
+        unsigned int rngSeed       = 0;
+        size_t       asteroidCount = 0;
+
+        float orbitRadius = 450.f;
+        float discRadius  = 120.f;
+        float minScale    = 0.2f;
+
+        // Bounding sphere radius of an asteroid mesh with unit scale
+        float meshRadius = 1.2f;
+
+        // Maximum LOD returned by Subdiv()
+        unsigned int maxSubdiv = 3;
+    };
+
+    struct UpdateAttribs
+    {
+        float            frameTime = 0;
+        Diligent::float3 cameraEye;
+        bool             animate = true;
+
+        // Asteroids whose bounding spheres are outside of the frustum are marked invisible.
+        // Null disables culling.
+        const Diligent::ViewFrustum* frustum = nullptr;
+
+        // Projected size in pixels of a unit length at unit distance from the camera,
+        // i.e. half of the render target height times the [1][1] element of the projection matrix.
+        // When not zero, the LOD is selected by the projected radius of the asteroid in pixels.
+        float lodPixelScale = 0;
+    };
+
+    explicit AsteroidsSimulationCore(const CreateInfo& CI);
+
+    size_t Count() const { return mCount; }
+
+    // Can optionally provide a range of asteroids to update; count = 0 => to the end.
+    // Ranges updated by different threads must not overlap.
+    void Update(const UpdateAttribs& attribs, size_t startIndex = 0, size_t count = 0);
+
+    // Uses the SIMD kernel when available (default). Disabling it is only useful for benchmarking.
+    void SetSimdEnabled(bool enabled) { mSimdEnabled = enabled; }
+
+    // Number of asteroids processed per iteration by the SIMD kernel (1 if SIMD is not available)
+    static unsigned int SimdWidth();
+
+    // World matrix (scale * rotation * translation) in row-vector convention
+    Diligent::float4x4 WorldMatrix(size_t i) const;
+
+    Diligent::float3 Position(size_t i) const { return Diligent::float3{mPosX[i], mPosY[i], mPosZ[i]}; }
+    float            Scale(size_t i) const { return mScale[i]; }
+
+    // LOD selected by the last Update(), in [0, maxSubdiv]. Invisible asteroids always use LOD 0.
+    unsigned int Subdiv(size_t i) const { return mSubdiv[i]; }
+
+    // Result of the frustum culling done by the last Update()
+    bool Visible(size_t i) const { return mVisible[i] != 0; }
+
+private:
+    const size_t       mCount;
+    const unsigned int mMaxSubdiv;
+    const float        mMeshRadius;
+    bool               mSimdEnabled = true;
+
+    // Static data
+    std::vector<float> mSpinAxisX;
+    std::vector<float> mSpinAxisY;
+    std::vector<float> mSpinAxisZ;
+    std::vector<float> mSpinVelocity;
+    std::vector<float> mOrbitVelocity;
+    std::vector<float> mScale;
+
+    // Dynamic data
+    std::vector<float> mPosX;
+    std::vector<float> mPosY;
+    std::vector<float> mPosZ;
+    std::vector<float> mRotX;
+    std::vector<float> mRotY;
+    std::vector<float> mRotZ;
+    std::vector<float> mRotW;
+
+    std::vector<uint8_t> mSubdiv;
+    std::vector<uint8_t> mVisible;
+};
@@ -10,7 +10,7 @@
 
 #include "texture.h"
 #include "util.h"
-#include "noise.h"
+#include "noise_texture.h"
 #include "DDSTextureLoader.h"
 
 #include <stdint.h>
@@ -36,33 +36,9 @@ static void WaitForAll(ID3D12Device* device, ID3D12CommandQueue* queue)
 void GenerateMips2D_XXXX8(D3D11_SUBRESOURCE_DATA* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels)
 {
     for (size_t m = 1; m < mipLevels; ++m) {
-        auto rowPitchSrc = subresources[m - 1].SysMemPitch;
-        const BYTE* dataSrc = (BYTE*)subresources[m - 1].pSysMem;
-
-        auto rowPitchDst = subresources[m].SysMemPitch;
-        BYTE* dataDst = (BYTE*)subresources[m].pSysMem;
-        
-        auto width = widthLevel0 >> m;
-        auto height = heightLevel0 >> m;
-
-        // Iterating byte-wise is simpler in this case (pulls apart color nicely)
-        // Not optimized at all, obviously...
-        for (size_t y = 0; y < height; ++y) {
-            auto rowSrc0 = (dataSrc + (y*2+0)*rowPitchSrc);
-            auto rowSrc1 = (dataSrc + (y*2+1)*rowPitchSrc);
-            auto rowDst  = (dataDst + (y    )*rowPitchDst);
-            for (size_t x = 0; x < width; ++x) {
-                for (size_t comp = 0; comp < 4; ++comp) {
-                    uint32_t c = rowSrc0[x*8+comp+0];
-                    c +=         rowSrc0[x*8+comp+4];
-                    c +=         rowSrc1[x*8+comp+0];
-                    c +=         rowSrc1[x*8+comp+4];
-                    c = c / 4;
-                    assert(c < 256);
-                    rowDst[4*x+comp] = (byte)c;
-                }
-            }
-        }
+        DownsampleRows_XXXX8((const uint8_t*)subresources[m - 1].pSysMem, subresources[m - 1].SysMemPitch,
+                             (uint8_t*)subresources[m].pSysMem, subresources[m].SysMemPitch,
+                             widthLevel0 >> m, 0, heightLevel0 >> m);
     }
 }
 
@@ -71,25 +47,17 @@ void FillNoise2D_RGBA8(D3D11_SUBRESOURCE_DATA* subresources, size_t width, size_
                        float seed, float persistence, float noiseScale, float noiseStrength,
 					   float redScale, float greenScale, float blueScale)
 {
-    NoiseOctaves<4> textureNoise(persistence);
-    
+    NoiseTextureParams params;
+    params.seed          = seed;
+    params.persistence   = persistence;
+    params.noiseScale    = noiseScale;
+    params.noiseStrength = noiseStrength;
+    params.redScale      = redScale;
+    params.greenScale    = greenScale;
+    params.blueScale     = blueScale;
+
     // Level 0
-    for (size_t y = 0; y < height; ++y) {
-        uint32_t* row = (uint32_t*)((BYTE*)subresources[0].pSysMem + y*subresources[0].SysMemPitch);
-        for (size_t x = 0; x < width; ++x) {
-            auto c = textureNoise((float)x*noiseScale, (float)y*noiseScale, seed);
-            c = std::max(0.0f, std::min(1.0f, (c - 0.5f) * noiseStrength + 0.5f));
-
-            int32_t cr = (int32_t)(c * redScale);
-			int32_t cg = (int32_t)(c * greenScale);
-			int32_t cb = (int32_t)(c * blueScale);
-			assert(cr >= 0 && cr < 256);
-			assert(cg >= 0 && cg < 256);
-            assert(cb >= 0 && cb < 256);
-
-            row[x] = (cr) << 16 | (cg) <<  8 | (cb) << 0;
-        }
-    }
+    FillNoiseRows_RGBA8((uint8_t*)subresources[0].pSysMem, subresources[0].SysMemPitch, width, 0, height, params);
 
     if (mipLevels > 1)
         GenerateMips2D_XXXX8(subresources, width, height, mipLevels);
@@ -0,0 +1,173 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// Headless benchmark of the procedural texture kernels.
+//
+// Usage: AsteroidsTextureBenchmark [--dim N] [--textures N] [--iterations N] [--threads N]
+// Measures noise fill and mip downsampling on one thread with the scalar and the SIMD kernels,
+// then generates a full set of textures with mips (3 slices each, as in the sample) on all threads.
+// Also reports the largest difference between the scalar and the SIMD results.
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#include "noise_texture.h"
+#include "noise_simd.h"
+#include "parallel_for.h"
+
+namespace
+{
+
+NoiseTextureParams GetParams(unsigned int dim, unsigned int index)
+{
+    NoiseTextureParams params;
+    params.seed          = 1234.5f + 97.f * static_cast<float>(index);
+    params.persistence   = 0.9f;
+    params.noiseScale    = 125.f / static_cast<float>(dim);
+    params.noiseStrength = 1.5f;
+    return params;
+}
+
+template <typename FuncType>
+double MeasureSeconds(unsigned int iterations, const FuncType& func)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < iterations; ++i)
+        func();
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    return elapsed.count();
+}
+
+// Largest per-channel difference between two RGBA8 images
+int MaxChannelDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+{
+    int maxDiff = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        maxDiff = std::max(maxDiff, std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+    return maxDiff;
+}
+
+void PrintRow(const char* name, size_t texels, unsigned int iterations, double seconds)
+{
+    std::cout << std::setw(20) << name
+              << std::setw(14) << std::fixed << std::setprecision(3) << seconds * 1000.0 / iterations
+              << std::setw(14) << std::fixed << std::setprecision(1) << static_cast<double>(texels) * iterations / seconds * 1e-6 << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned int dim          = 256;
+    unsigned int textureCount = 100;
+    unsigned int iterations   = 10;
+    unsigned int numThreads   = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--dim") == 0 && i + 1 < argc)
+            dim = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--textures") == 0 && i + 1 < argc)
+            textureCount = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            numThreads = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--dim N] [--textures N] [--iterations N] [--threads N]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Mips are generated down to 1x1, so the dimension must be a power of two
+    dim = std::max(dim, 2u);
+    while ((dim & (dim - 1)) != 0)
+        dim &= dim - 1;
+    textureCount = std::max(textureCount, 1u);
+    iterations   = std::max(iterations, 1u);
+    numThreads   = std::max(numThreads, 1u);
+
+    const size_t             rowPitch = size_t{dim} * 4;
+    const size_t             texels   = size_t{dim} * dim;
+    const NoiseTextureParams params   = GetParams(dim, 0);
+
+    std::cout << "Noise kernel: " << SimplexNoiseSimdWidth() << "-wide, " << dim << "x" << dim << " texels, "
+              << iterations << " iteration(s)" << std::endl;
+    std::cout << std::setw(20) << "kernel" << std::setw(14) << "ms" << std::setw(14) << "Mtexels/s" << std::endl;
+
+    // Single-threaded kernels
+    std::vector<uint8_t> scalarNoise(texels * 4), simdNoise(texels * 4);
+    PrintRow("noise scalar", texels, iterations, MeasureSeconds(iterations, [&]() {
+                 FillNoiseRows_RGBA8(scalarNoise.data(), rowPitch, dim, 0, dim, params, false);
+             }));
+    PrintRow("noise SIMD", texels, iterations, MeasureSeconds(iterations, [&]() {
+                 FillNoiseRows_RGBA8(simdNoise.data(), rowPitch, dim, 0, dim, params, true);
+             }));
+
+    // Mip throughput is counted in source texels
+    std::vector<uint8_t> scalarMip(texels), simdMip(texels);
+    PrintRow("mip scalar", texels, iterations, MeasureSeconds(iterations, [&]() {
+                 DownsampleRows_XXXX8(scalarNoise.data(), rowPitch, scalarMip.data(), rowPitch / 2, dim / 2, 0, dim / 2, false);
+             }));
+    PrintRow("mip SIMD", texels, iterations, MeasureSeconds(iterations, [&]() {
+                 DownsampleRows_XXXX8(scalarNoise.data(), rowPitch, simdMip.data(), rowPitch / 2, dim / 2, 0, dim / 2, true);
+             }));
+
+    // Full texture set, split the same way as AsteroidsSimulation::CreateTextures
+    const unsigned int sliceCount = textureCount * 3;
+    unsigned int       mipLevels  = 0;
+    while ((dim >> mipLevels) != 0)
+        ++mipLevels;
+    std::vector<std::vector<uint8_t>> levels(mipLevels);
+    for (unsigned int m = 0; m < mipLevels; ++m)
+        levels[m].resize(size_t{sliceCount} * (dim >> m) * (dim >> m) * 4);
+
+    // Start the worker threads before the measurement
+    Diligent::TaskScheduler scheduler{numThreads - 1};
+
+    const unsigned int bandRows   = 32;
+    const double       setSeconds = MeasureSeconds(1, [&]() {
+        for (unsigned int m = 0; m < mipLevels; ++m)
+        {
+            const unsigned int width     = dim >> m;
+            const unsigned int bandCount = (width + bandRows - 1) / bandRows;
+            ParallelFor(&scheduler, 0u, sliceCount * bandCount, [&](unsigned int job) {
+                const unsigned int slice    = job / bandCount;
+                const unsigned int firstRow = (job % bandCount) * bandRows;
+                const unsigned int numRows  = std::min(bandRows, width - firstRow);
+                uint8_t*           dst      = levels[m].data() + size_t{slice} * width * width * 4;
+                if (m == 0)
+                    FillNoiseRows_RGBA8(dst, size_t{width} * 4, width, firstRow, numRows, GetParams(dim, slice));
+                else
+                {
+                    const uint8_t* src = levels[m - 1].data() + size_t{slice} * width * width * 16;
+                    DownsampleRows_XXXX8(src, size_t{width} * 8, dst, size_t{width} * 4, width, firstRow, numRows);
+                }
+            });
+        }
+    });
+    std::cout << std::endl
+              << textureCount << " textures x 3 slices with mips on " << numThreads << " thread(s):" << std::endl;
+    PrintRow("texture set", texels * sliceCount, 1, setSeconds);
+
+    std::cout << std::endl
+              << "Max channel difference, noise scalar vs SIMD: " << MaxChannelDifference(scalarNoise, simdNoise) << std::endl;
+    std::cout << "Max channel difference, mip scalar vs SIMD: " << MaxChannelDifference(scalarMip, simdMip) << std::endl;
+
+    return 0;
+}
@@ -25,25 +25,22 @@ cbuffer cbParticipatingMediaScatteringParams
     AirScatteringAttribs g_MediaParams;
 }
 
+cbuffer cbCDLODAttribs
+{
+    CDLODAttribs g_CDLODAttribs;
+}
+
 Texture2D< float2 > g_tex2DOccludedNetDensityToAtmTop;
 SamplerState        g_tex2DOccludedNetDensityToAtmTop_sampler;
 
 Texture2D< float3 > g_tex2DAmbientSkylight;
 SamplerState        g_tex2DAmbientSkylight_sampler;
 
-void HemisphereVS(in float3 f3PosWS : ATTRIB0,
-                  in float2 f2MaskUV0 : ATTRIB1,
-                  out float4 f4PosPS : SV_Position,
-                  out HemisphereVSOutput VSOut
-                  // IMPORTANT: non-system generated pixel shader input
-                  // arguments must have the exact same name as vertex shader 
-                  // outputs and must go in the same order.
-                 )
+HemisphereVSOutput GetHemisphereVSOutput(float3 f3PosWS, float2 f2MaskUV0)
 {
+    HemisphereVSOutput VSOut;
     VSOut.TileTexUV = f3PosWS.xz;
 
-    f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
-    
     float4 ShadowMapSpacePos = mul( float4(f3PosWS,1.0), g_LightAttribs.ShadowAttribs.mWorldToLightView);
     VSOut.f3PosInLightViewSpace = ShadowMapSpacePos.xyz / ShadowMapSpacePos.w;
     VSOut.f2MaskUV0 = f2MaskUV0;
@@ -62,4 +59,30 @@ void HemisphereVS(in float3 f3PosWS : ATTRIB0,
         g_tex2DAmbientSkylight_sampler,
         VSOut.f3SunLightExtinction,
         VSOut.f3AmbientSkyLight);
+
+    return VSOut;
+}
+
+void HemisphereVS(in float3 f3PosWS : ATTRIB0,
+                  in float2 f2MaskUV0 : ATTRIB1,
+                  out float4 f4PosPS : SV_Position,
+                  out HemisphereVSOutput VSOut
+                  // IMPORTANT: non-system generated pixel shader input
+                  // arguments must have the exact same name as vertex shader 
+                  // outputs and must go in the same order.
+                 )
+{
+    f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
+    VSOut = GetHemisphereVSOutput(f3PosWS, f2MaskUV0);
+}
+
+void HemisphereCDLODVS(in float3 f3PosWS : ATTRIB0,
+                       in float2 f2MaskUV0 : ATTRIB1,
+                       in float4 f4MorphDelta : ATTRIB2,
+                       out float4 f4PosPS : SV_Position,
+                       out HemisphereVSOutput VSOut)
+{
+    f3PosWS = MorphCDLODVertex(f3PosWS, f4MorphDelta, g_CDLODAttribs);
+    f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
+    VSOut = GetHemisphereVSOutput(f3PosWS, f2MaskUV0);
 }
@@ -12,3 +12,16 @@ void HemisphereZOnlyVS(in float3 f3PosWS : ATTRIB0,
 {
     f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
 }
+
+cbuffer cbCDLODAttribs
+{
+    CDLODAttribs g_CDLODAttribs;
+}
+
+void HemisphereCDLODZOnlyVS(in float3 f3PosWS : ATTRIB0,
+                            in float4 f4MorphDelta : ATTRIB2,
+                            out float4 f4PosPS : SV_Position)
+{
+    f3PosWS = MorphCDLODVertex(f3PosWS, f4MorphDelta, g_CDLODAttribs);
+    f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
+}
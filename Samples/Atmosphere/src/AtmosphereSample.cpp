@@ -28,6 +28,7 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <thread>
 
 #include "AtmosphereSample.hpp"
 #include "MapHelper.hpp"
@@ -37,6 +38,7 @@
 #include "../imGuIZMO.quat/imGuIZMO.h"
 #include "PlatformMisc.hpp"
 #include "ImGuiUtils.hpp"
+#include "CommandLineParser.hpp"
 
 namespace Diligent
 {
@@ -49,6 +51,20 @@ SampleBase* CreateSample()
 AtmosphereSample::AtmosphereSample()
 {}
 
+AtmosphereSample::CommandLineStatus AtmosphereSample::ProcessCommandLine(int argc, const char* const* argv)
+{
+    CommandLineParser ArgsParser{argc, argv};
+    // Height map: a tiled elevation file, or a 16-bit image or raw height map that is converted to the tiled format
+    ArgsParser.Parse("dem", m_strRawDEMDataFile);
+    // Maximum number of elevation data tiles kept in memory
+    if (ArgsParser.Parse("dem_cache_tiles", m_DEMCacheTiles))
+    {
+        m_DEMCacheTiles = std::max(m_DEMCacheTiles, 1);
+    }
+
+    return CommandLineStatus::OK;
+}
+
 void AtmosphereSample::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
 {
     SampleBase::ModifyEngineInitInfo(Attribs);
@@ -80,6 +96,12 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
         m_TerrainRenderParams.m_TexturingMode              = RenderingParams::TM_MATERIAL_MASK;
     }
 
+    // CDLOD patches are drawn from the slots of a shared vertex buffer with a base vertex,
+    // which is not available in GLES3.0 and WebGL
+    m_bCDLODSupported = (InitInfo.pDevice->GetAdapterInfo().DrawCommand.CapFlags & DRAW_COMMAND_CAP_FLAG_BASE_VERTEX) != 0;
+    if (!m_bCDLODSupported)
+        m_TerrainRenderParams.m_bCDLODTerrain = false;
+
     const auto& RG16UAttribs = m_pDevice->GetTextureFormatInfoExt(TEX_FORMAT_RG16_UNORM);
     const auto& RG32FAttribs = m_pDevice->GetTextureFormatInfoExt(TEX_FORMAT_RG32_FLOAT);
     m_bRG16UFmtSupported     = RG16UAttribs.Supported && (RG16UAttribs.BindFlags & BIND_RENDER_TARGET);
@@ -101,7 +123,6 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
     m_f3CustomMieBeta         = m_PPAttribs.f4CustomMieBeta;
     m_f3CustomOzoneAbsoprtion = m_PPAttribs.f4CustomOzoneAbsorption;
 
-    m_strRawDEMDataFile       = "Terrain\\HeightMap.tif";
     m_strMtrlMaskFile         = "Terrain\\Mask.png";
     m_strTileTexPaths[0]      = "Terrain\\Tiles\\gravel_DM.dds";
     m_strTileTexPaths[1]      = "Terrain\\Tiles\\grass_DM.dds";
@@ -114,10 +135,13 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
     m_strNormalMapTexPaths[3] = "Terrain\\Tiles\\Snow_NM.jpg";
     m_strNormalMapTexPaths[4] = "Terrain\\Tiles\\grass_NM.dds";
 
+    // Worker threads build the elevation pyramids and generate the terrain ring meshes
+    m_pTaskScheduler.reset(new TaskScheduler{std::max(std::thread::hardware_concurrency(), 1u) - 1});
+
     // Create data source
     try
     {
-        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str()));
+        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str(), static_cast<Uint32>(m_DEMCacheTiles), m_pTaskScheduler.get()));
         m_pElevDataSource->SetOffsets(m_TerrainRenderParams.m_iColOffset, m_TerrainRenderParams.m_iRowOffset);
         m_fMinElevation = m_pElevDataSource->GetGlobalMinElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
         m_fMaxElevation = m_pElevDataSource->GetGlobalMaxElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
@@ -158,11 +182,17 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
                              strNormalMapPaths,
                              m_pcbCameraAttribs,
                              m_pcbLightAttribs,
-                             m_pLightSctrPP->GetMediaAttribsCB());
+                             m_pLightSctrPP->GetMediaAttribsCB(),
+                             m_bParallelTerrainMesh ? m_pTaskScheduler.get() : nullptr);
 
     CreateShadowMap();
 }
 
+void AtmosphereSample::RecreateTerrainGeometry()
+{
+    m_EarthHemisphere.RecreateGeometry(m_pElevDataSource.get(), m_TerrainRenderParams, m_bParallelTerrainMesh ? m_pTaskScheduler.get() : nullptr);
+}
+
 void AtmosphereSample::UpdateUI()
 {
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
@@ -197,6 +227,56 @@ void AtmosphereSample::UpdateUI()
             ImGui::TreePop();
         }
 
+        if (ImGui::TreeNode("Terrain"))
+        {
+            if (m_bCDLODSupported)
+                ImGui::Checkbox("CDLOD terrain", &m_TerrainRenderParams.m_bCDLODTerrain);
+            if (m_TerrainRenderParams.m_bCDLODTerrain)
+            {
+                ImGui::SliderFloat("Target quad size", &m_TerrainRenderParams.m_fCDLODTargetQuadSize, 4, 20, "%.0f px");
+                ImGui::Checkbox("Parallel selection", &m_bParallelTerrainSelection);
+
+                const auto& Stats = m_EarthHemisphere.GetCDLODStats();
+                ImGui::Text("Patches: %u selected, %u drawn, %u triangles", Stats.NumSelectedPatches, Stats.NumDrawnPatches, Stats.NumDrawnTriangles);
+                ImGui::Text("Selection: %.2f ms, streaming: %.2f ms (%u patches)", Stats.SelectionTime * 1000.0, Stats.StreamingTime * 1000.0, Stats.NumStreamedPatches);
+                ImGui::Text("Resident patches: %u", Stats.NumResidentPatches);
+                if (Stats.NumDroppedPatches > 0)
+                    ImGui::TextColored(ImVec4{1, 0.5f, 0.5f, 1}, "Dropped patches: %u", Stats.NumDroppedPatches);
+            }
+            else
+            {
+                {
+                    // Ring dimension must be 4k+1
+                    constexpr int MinRingDimension = 33;
+                    int           RingDimComboId   = 0;
+                    while (((MinRingDimension - 1) << RingDimComboId) + 1 < m_TerrainRenderParams.m_iRingDimension)
+                        ++RingDimComboId;
+                    if (ImGui::Combo("Ring dimension", &RingDimComboId,
+                                     "33\0"
+                                     "65\0"
+                                     "129\0"
+                                     "257\0\0"))
+                    {
+                        m_TerrainRenderParams.m_iRingDimension = ((MinRingDimension - 1) << RingDimComboId) + 1;
+                        RecreateTerrainGeometry();
+                    }
+                }
+
+                if (ImGui::SliderInt("Num rings", &m_TerrainRenderParams.m_iNumRings, 4, 20))
+                    RecreateTerrainGeometry();
+
+                if (ImGui::Checkbox("Parallel mesh generation", &m_bParallelTerrainMesh))
+                    RecreateTerrainGeometry();
+
+                const auto& Stats = m_EarthHemisphere.GetGeometryStats();
+                ImGui::Text("Mesh generation: %.1f ms (%u threads)", Stats.TotalTime * 1000.0, Stats.NumThreads);
+                ImGui::Text("  Vertices: %.1f ms, indices: %.1f ms, buffers: %.1f ms", Stats.VerticesTime * 1000.0, Stats.IndicesTime * 1000.0, Stats.BuffersTime * 1000.0);
+                ImGui::Text("  %u vertices, %u indices", Stats.NumVertices, Stats.NumIndices);
+            }
+
+            ImGui::TreePop();
+        }
+
         ImGui::Checkbox("Enable Light Scattering", &m_bEnableLightScattering);
 
         if (m_bEnableLightScattering)
@@ -582,6 +662,15 @@ void AtmosphereSample::Render()
     // m_iFirstCascade must be initialized before calling RenderShadowMap()!
     m_PPAttribs.iFirstCascadeToRayMarch = std::min(m_PPAttribs.iFirstCascadeToRayMarch, m_TerrainRenderParams.m_iNumShadowCascades - 1);
 
+    if (m_TerrainRenderParams.m_bCDLODTerrain)
+    {
+        // Terrain patches are selected for the camera once and are used by all passes
+        const auto& SCDesc     = m_pSwapChain->GetDesc();
+        const float fProjScale = static_cast<float>(SCDesc.Height) * m_mCameraProj._22 * 0.5f;
+        m_EarthHemisphere.UpdateCDLODTerrain(m_pImmediateContext, m_TerrainRenderParams, m_f3CameraPos, mViewProj, fProjScale,
+                                             m_bParallelTerrainSelection ? m_pTaskScheduler.get() : nullptr);
+    }
+
     RenderShadowMap(m_pImmediateContext, LightAttrs, m_mCameraView, m_mCameraProj);
 
     LightAttrs.ShadowAttribs.bVisualizeCascades = m_ShadowSettings.bVisualizeCascades ? TRUE : FALSE;
@@ -816,6 +905,41 @@ void AtmosphereSample::Update(double CurrTime, double ElapsedTime)
 
     auto CameraRotationMatrix = m_CameraRotation.ToMatrix();
 
+    if (m_TerrainRenderParams.m_bCDLODTerrain)
+    {
+        // Move the camera over the terrain with the speed proportional to the altitude
+        float3 MoveDir{0, 0, 0};
+        if (m_InputController.IsKeyDown(InputKeys::MoveForward))
+            MoveDir += float3{CameraRotationMatrix._13, 0, CameraRotationMatrix._33};
+        if (m_InputController.IsKeyDown(InputKeys::MoveBackward))
+            MoveDir -= float3{CameraRotationMatrix._13, 0, CameraRotationMatrix._33};
+        if (m_InputController.IsKeyDown(InputKeys::MoveRight))
+            MoveDir += float3{CameraRotationMatrix._11, 0, CameraRotationMatrix._31};
+        if (m_InputController.IsKeyDown(InputKeys::MoveLeft))
+            MoveDir -= float3{CameraRotationMatrix._11, 0, CameraRotationMatrix._31};
+
+        if (length(MoveDir) > 1e-3f)
+        {
+            const float fSpeed = m_f3CameraPos.y * (m_InputController.IsKeyDown(InputKeys::ShiftDown) ? 2.f : 0.5f);
+            m_f3CameraPos += normalize(MoveDir) * fSpeed * static_cast<float>(ElapsedTime);
+
+            // Keep the camera over the part of the hemisphere where the altitude is close to the camera height
+            constexpr float MaxCameraDistance = 100000.f;
+            const float     fDistance         = length(float2{m_f3CameraPos.x, m_f3CameraPos.z});
+            if (fDistance > MaxCameraDistance)
+            {
+                m_f3CameraPos.x *= MaxCameraDistance / fDistance;
+                m_f3CameraPos.z *= MaxCameraDistance / fDistance;
+            }
+        }
+    }
+    else
+    {
+        // The ring mesh is only built around the origin
+        m_f3CameraPos.x = 0;
+        m_f3CameraPos.z = 0;
+    }
+
     if ((m_LastMouseState.ButtonFlags & MouseState::BUTTON_FLAG_RIGHT) != 0)
     {
         constexpr float LightRotationSpeed = 0.001f;
@@ -33,6 +33,7 @@
 #include "ElevationDataSource.hpp"
 #include "EpipolarLightScattering.hpp"
 #include "ShadowMapManager.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -43,7 +44,8 @@ public:
     AtmosphereSample();
     ~AtmosphereSample();
 
-    virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
+    virtual CommandLineStatus ProcessCommandLine(int argc, const char* const* argv) override final;
+    virtual void              ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
 
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
     virtual void Render() override final;
@@ -54,6 +56,7 @@ public:
 
 private:
     void UpdateUI();
+    void RecreateTerrainGeometry();
     void CreateShadowMap();
     void RenderShadowMap(IDeviceContext* pContext,
                          LightAttribs&   LightAttribs,
@@ -84,7 +87,8 @@ private:
     RenderingParams                m_TerrainRenderParams;
     EpipolarLightScatteringAttribs m_PPAttribs;
 
-    String m_strRawDEMDataFile;
+    String m_strRawDEMDataFile = "Terrain\\HeightMap.tif";
+    int    m_DEMCacheTiles     = static_cast<int>(ElevationDataSource::DefaultMaxResidentTiles);
     String m_strMtrlMaskFile;
     String m_strTileTexPaths[EarthHemsiphere::NUM_TILE_TEXTURES];
     String m_strNormalMapTexPaths[EarthHemsiphere::NUM_TILE_TEXTURES];
@@ -93,6 +97,9 @@ private:
 
     std::unique_ptr<ElevationDataSource> m_pElevDataSource;
     EarthHemsiphere                      m_EarthHemisphere;
+    std::unique_ptr<TaskScheduler>       m_pTaskScheduler;
+    bool                                 m_bParallelTerrainMesh      = true;
+    bool                                 m_bParallelTerrainSelection = true;
     bool                                 m_PackMatrixRowMajor = false;
 
     std::unique_ptr<EpipolarLightScattering> m_pLightSctrPP;
@@ -110,6 +117,7 @@ private:
 
     bool m_bRG16UFmtSupported = false;
     bool m_bRG32FFmtSupported = false;
+    bool m_bCDLODSupported    = false;
 };
 
 } // namespace Diligent
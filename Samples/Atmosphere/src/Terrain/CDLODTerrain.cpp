@@ -0,0 +1,530 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "CDLODTerrain.hpp"
+
+namespace Diligent
+{
+#include "../../assets/shaders/HostSharedTerrainStructs.fxh"
+} // namespace Diligent
+
+#include "ElevationDataSource.hpp"
+#include "MapHelper.hpp"
+#include "GraphicsUtilities.h"
+#include "Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 PatchDim        = CDLODTerrain::PatchQuads + 1;
+constexpr Uint32 NumPatchVerts   = PatchDim * PatchDim;
+constexpr Uint32 InvalidSlot     = ~0u;
+constexpr float  MorphRegion     = 0.3f;
+constexpr Uint32 ParallelSubtree = 3; // Subtrees this many levels below the root are selected in parallel
+
+// Squared distance from the point to the box
+float GetDistanceSq(const float3& Pos, const BoundBox& BndBox)
+{
+    const float dx = std::max(std::max(BndBox.Min.x - Pos.x, Pos.x - BndBox.Max.x), 0.f);
+    const float dy = std::max(std::max(BndBox.Min.y - Pos.y, Pos.y - BndBox.Max.y), 0.f);
+    const float dz = std::max(std::max(BndBox.Min.z - Pos.z, Pos.z - BndBox.Max.z), 0.f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+CDLODTerrain::CDLODTerrain(const CreateInfo& CI) :
+    // clang-format off
+    m_pDevice        {CI.pDevice},
+    m_pDataSource    {CI.pDataSource},
+    m_fEarthRadius   {CI.fEarthRadius},
+    m_fSamplingStep  {CI.fSamplingStep},
+    m_fElevationScale{CI.fElevationScale},
+    m_fLeafNodeSize  {CI.fSamplingStep * static_cast<float>(PatchQuads)}
+// clang-format on
+{
+    VERIFY_EXPR(CI.pDevice != nullptr && m_pDataSource != nullptr && CI.MaxResidentPatches > 0);
+
+    // The root node must cover the entire hemisphere
+    m_NumLevels = 1;
+    while (GetNodeSize(m_NumLevels - 1) < 2.f * m_fEarthRadius && m_NumLevels < CDLOD_MAX_LEVELS)
+        ++m_NumLevels;
+    m_iRootHalfSize = static_cast<int>(PatchQuads << (m_NumLevels - 1)) / 2;
+
+    // Patch indices are grouped by quadrants so that any quadrant can be drawn separately.
+    // All quads use the same diagonal, which the morph targets of the odd vertices follow.
+    const Uint32 HalfQuads = PatchQuads / 2;
+
+    std::vector<Uint16> Indices;
+    Indices.reserve(PatchQuads * PatchQuads * 6);
+    for (Uint32 Quadrant = 0; Quadrant < 4; ++Quadrant)
+    {
+        const Uint32 QuadrantX = (Quadrant & 0x01) * HalfQuads;
+        const Uint32 QuadrantZ = (Quadrant >> 1) * HalfQuads;
+        for (Uint32 z = QuadrantZ; z < QuadrantZ + HalfQuads; ++z)
+        {
+            for (Uint32 x = QuadrantX; x < QuadrantX + HalfQuads; ++x)
+            {
+                const Uint16 V00 = static_cast<Uint16>(x + z * PatchDim);
+                const Uint16 V10 = static_cast<Uint16>(V00 + 1);
+                const Uint16 V01 = static_cast<Uint16>(V00 + PatchDim);
+                const Uint16 V11 = static_cast<Uint16>(V01 + 1);
+                // clang-format off
+                Indices.push_back(V01); Indices.push_back(V00); Indices.push_back(V11);
+                Indices.push_back(V11); Indices.push_back(V00); Indices.push_back(V10);
+                // clang-format on
+            }
+        }
+    }
+    m_NumQuadrantIndices = static_cast<Uint32>(Indices.size() / 4);
+
+    BufferDesc IBDesc;
+    IBDesc.Name      = "CDLOD patch index buffer";
+    IBDesc.Size      = static_cast<Uint64>(Indices.size() * sizeof(Indices[0]));
+    IBDesc.BindFlags = BIND_INDEX_BUFFER;
+    IBDesc.Usage     = USAGE_IMMUTABLE;
+    BufferData IBInitData;
+    IBInitData.pData    = Indices.data();
+    IBInitData.DataSize = IBDesc.Size;
+    CI.pDevice->CreateBuffer(IBDesc, &IBInitData, &m_pIndexBuffer);
+
+    CreateUniformBuffer(CI.pDevice, sizeof(CDLODAttribs), "CDLOD Attribs CB", &m_pcbCDLODAttribs);
+
+    m_Slots.resize(CI.MaxResidentPatches);
+    m_FreeSlots.reserve(CI.MaxResidentPatches);
+    for (Uint32 Slot = CI.MaxResidentPatches; Slot > 0; --Slot)
+        m_FreeSlots.push_back(Slot - 1);
+}
+
+bool CDLODTerrain::ComputeNodeBounds(Node& N) const
+{
+    const int    NodeSamples = static_cast<int>(PatchQuads << N.Level);
+    const int    iCol0       = -m_iRootHalfSize + static_cast<int>(N.X) * NodeSamples;
+    const int    iRow0       = -m_iRootHalfSize + static_cast<int>(N.Z) * NodeSamples;
+    const double x0          = static_cast<double>(iCol0) * m_fSamplingStep;
+    const double z0          = static_cast<double>(iRow0) * m_fSamplingStep;
+    const double x1          = static_cast<double>(iCol0 + NodeSamples) * m_fSamplingStep;
+    const double z1          = static_cast<double>(iRow0 + NodeSamples) * m_fSamplingStep;
+
+    // Distances from the Earth axis to the nearest and the farthest points of the node
+    const double dxNear = x0 > 0 ? x0 : (x1 < 0 ? -x1 : 0);
+    const double dzNear = z0 > 0 ? z0 : (z1 < 0 ? -z1 : 0);
+    const double dxFar  = std::max(std::abs(x0), std::abs(x1));
+    const double dzFar  = std::max(std::abs(z0), std::abs(z1));
+    const double R      = m_fEarthRadius;
+    const double rNear2 = dxNear * dxNear + dzNear * dzNear;
+    const double rFar2  = dxFar * dxFar + dzFar * dzFar;
+    if (rNear2 >= R * R)
+        return false;
+
+    Uint16 MinElevation = 0, MaxElevation = 0;
+    m_pDataSource->GetRegionElevationRange(static_cast<float>(iCol0), static_cast<float>(iRow0),
+                                           static_cast<float>(iCol0 + NodeSamples), static_cast<float>(iRow0 + NodeSamples),
+                                           MinElevation, MaxElevation);
+    const double MinDispl = MinElevation * static_cast<double>(m_fElevationScale);
+    const double MaxDispl = MaxElevation * static_cast<double>(m_fElevationScale);
+
+    // Vertices are displaced along the sphere normal, which scales their horizontal coordinates
+    // by at most (1 + MaxDispl / R). The height of a displaced vertex at the distance r from the
+    // axis is sqrt(R^2 - r^2) * (1 + Displ / R) - R.
+    const double Expansion = MaxDispl / R;
+    N.BndBox.Min.x         = static_cast<float>(x0 + std::min(x0, 0.0) * Expansion);
+    N.BndBox.Max.x         = static_cast<float>(x1 + std::max(x1, 0.0) * Expansion);
+    N.BndBox.Min.z         = static_cast<float>(z0 + std::min(z0, 0.0) * Expansion);
+    N.BndBox.Max.z         = static_cast<float>(z1 + std::max(z1, 0.0) * Expansion);
+    N.BndBox.Min.y         = static_cast<float>(std::sqrt(std::max(R * R - rFar2, 0.0)) * (1.0 + MinDispl / R) - R);
+    N.BndBox.Max.y         = static_cast<float>(std::sqrt(R * R - rNear2) * (1.0 + MaxDispl / R) - R);
+
+    return true;
+}
+
+bool CDLODTerrain::IsWithinRange(const BoundBox& BndBox, Uint32 Level) const
+{
+    const float Range = m_LevelRanges[Level];
+    return Range == FLT_MAX || GetDistanceSq(m_f3CameraPos, BndBox) <= Range * Range;
+}
+
+void CDLODTerrain::SelectNode(const Node&                 N,
+                              const ViewFrustumExt*       pViewFrustum,
+                              std::vector<SelectedPatch>& Selection,
+                              std::vector<Node>*          pDeferredNodes,
+                              Uint32                      DeferredLevel) const
+{
+    // The node is known to be within the range of its level. It is not subdivided if it is entirely
+    // outside of the range of the finer level, or if it is not visible.
+    if (N.Level == 0 ||
+        !IsWithinRange(N.BndBox, N.Level - 1) ||
+        (pViewFrustum != nullptr && GetBoxVisibility(*pViewFrustum, N.BndBox, FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) == BoxVisibility::Invisible))
+    {
+        Selection.push_back({N, 0x0F, InvalidSlot});
+        return;
+    }
+
+    Uint32 QuadrantMask = 0;
+    for (Uint32 Quadrant = 0; Quadrant < 4; ++Quadrant)
+    {
+        Node Child;
+        Child.Level = N.Level - 1;
+        Child.X     = N.X * 2 + (Quadrant & 0x01);
+        Child.Z     = N.Z * 2 + (Quadrant >> 1);
+        if (!ComputeNodeBounds(Child))
+            continue; // The child is outside of the hemisphere
+
+        if (!IsWithinRange(Child.BndBox, Child.Level))
+        {
+            // The child is too far, so the quadrant is covered by this node
+            QuadrantMask |= 1u << Quadrant;
+        }
+        else if (pDeferredNodes != nullptr && Child.Level == DeferredLevel)
+        {
+            pDeferredNodes->push_back(Child);
+        }
+        else
+        {
+            SelectNode(Child, pViewFrustum, Selection, pDeferredNodes, DeferredLevel);
+        }
+    }
+
+    if (QuadrantMask != 0)
+        Selection.push_back({N, QuadrantMask, InvalidSlot});
+}
+
+Uint32 CDLODTerrain::AllocatePatchSlot()
+{
+    if (!m_FreeSlots.empty())
+    {
+        const Uint32 Slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+        return Slot;
+    }
+
+    // Evict the least recently used patch that is not used in the current frame
+    Uint32 LRUSlot  = InvalidSlot;
+    Uint64 LRUFrame = m_FrameIndex;
+    for (Uint32 Slot = 0; Slot < m_Slots.size(); ++Slot)
+    {
+        if (m_Slots[Slot].LastUsedFrame < LRUFrame)
+        {
+            LRUSlot  = Slot;
+            LRUFrame = m_Slots[Slot].LastUsedFrame;
+        }
+    }
+    if (LRUSlot != InvalidSlot)
+        m_ResidentPatches.erase(m_Slots[LRUSlot].Key);
+
+    return LRUSlot;
+}
+
+void CDLODTerrain::GeneratePatchVertices(const Node& Patch, PatchVertex* pVerts) const
+{
+    const int iStep = 1 << Patch.Level;
+    const int iCol0 = -m_iRootHalfSize + static_cast<int>(Patch.X) * static_cast<int>(PatchQuads) * iStep;
+    const int iRow0 = -m_iRootHalfSize + static_cast<int>(Patch.Z) * static_cast<int>(PatchQuads) * iStep;
+
+    int iColOffset, iRowOffset;
+    m_pDataSource->GetOffsets(iColOffset, iRowOffset);
+    const float fNumCols = static_cast<float>(m_pDataSource->GetNumCols());
+    const float fNumRows = static_cast<float>(m_pDataSource->GetNumRows());
+
+    // Positions are computed in double precision as the vertex height is a small difference of two
+    // values close to the Earth radius
+    const double R = m_fEarthRadius;
+
+    float Cols[PatchDim];
+    float Rows[PatchDim];
+    float Heights[PatchDim];
+    for (Uint32 j = 0; j < PatchDim; ++j)
+    {
+        for (Uint32 i = 0; i < PatchDim; ++i)
+        {
+            Cols[i] = static_cast<float>(iCol0 + static_cast<int>(i) * iStep);
+            Rows[i] = static_cast<float>(iRow0 + static_cast<int>(j) * iStep);
+        }
+        m_pDataSource->GetInterpolatedHeights(Cols, Rows, Heights, PatchDim);
+
+        for (Uint32 i = 0; i < PatchDim; ++i)
+        {
+            const double X      = static_cast<double>(Cols[i]) * m_fSamplingStep;
+            const double Z      = static_cast<double>(Rows[i]) * m_fSamplingStep;
+            const double Y      = std::sqrt(std::max(R * R - X * X - Z * Z, 0.0));
+            const double Length = std::sqrt(X * X + Y * Y + Z * Z);
+            const double Scale  = 1.0 + Heights[i] * static_cast<double>(m_fElevationScale) / Length;
+
+            auto& Vert        = pVerts[i + j * PatchDim];
+            Vert.f3WorldPos   = float3{static_cast<float>(X * Scale), static_cast<float>(Y * Scale - R), static_cast<float>(Z * Scale)};
+            Vert.f2MaskUV0.x  = (Cols[i] + static_cast<float>(iColOffset) + 0.5f) / fNumCols;
+            Vert.f2MaskUV0.y  = (Rows[i] + static_cast<float>(iRowOffset) + 0.5f) / fNumRows;
+            Vert.f4MorphDelta = float4{0, 0, 0, static_cast<float>(Patch.Level)};
+        }
+    }
+
+    if (Patch.Level + 1 == m_NumLevels)
+        return; // There is no coarser level to morph to
+
+    // Vertices with odd coordinates are not present in the coarser level and are morphed to the
+    // middle of the coarser level edge they lie on. The center of a quad lies on its diagonal.
+    for (Uint32 j = 0; j < PatchDim; ++j)
+    {
+        for (Uint32 i = 0; i < PatchDim; ++i)
+        {
+            const bool bOddCol = (i & 0x01) != 0;
+            const bool bOddRow = (j & 0x01) != 0;
+            if (!bOddCol && !bOddRow)
+                continue;
+
+            const Uint32 Idx0 = (i - (bOddCol ? 1 : 0)) + (j - (bOddRow ? 1 : 0)) * PatchDim;
+            const Uint32 Idx1 = (i + (bOddCol ? 1 : 0)) + (j + (bOddRow ? 1 : 0)) * PatchDim;
+
+            auto&        Vert   = pVerts[i + j * PatchDim];
+            const float3 Target = (pVerts[Idx0].f3WorldPos + pVerts[Idx1].f3WorldPos) * 0.5f;
+            Vert.f4MorphDelta   = float4{Target - Vert.f3WorldPos, static_cast<float>(Patch.Level)};
+        }
+    }
+}
+
+void CDLODTerrain::Update(IDeviceContext* pContext, const UpdateAttribs& Attribs)
+{
+    ++m_FrameIndex;
+    m_f3CameraPos = Attribs.f3CameraPos;
+
+    // Level L is used up to the distance at which the quads of level L + 1 project to the target size.
+    // Neighboring patches only differ by one level if every range exceeds the previous one by more
+    // than the node size, which limits the target quad size.
+    const float fTargetQuadSize = std::min(std::max(Attribs.fTargetQuadSize, 1.f), Attribs.fProjScale / static_cast<float>(2 * PatchQuads));
+
+    m_LevelRanges.resize(m_NumLevels);
+    for (Uint32 Level = 0; Level < m_NumLevels; ++Level)
+    {
+        m_LevelRanges[Level] = Level + 1 < m_NumLevels ?
+            2.f * m_fSamplingStep * static_cast<float>(1u << Level) * Attribs.fProjScale / fTargetQuadSize :
+            FLT_MAX;
+    }
+
+    {
+        MapHelper<CDLODAttribs> CDLODAttribsData(pContext, m_pcbCDLODAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+        CDLODAttribsData->f4CameraPos = float4{m_f3CameraPos, 1};
+        for (Uint32 Level = 0; Level < CDLOD_MAX_LEVELS; ++Level)
+        {
+            auto& MorphParams = CDLODAttribsData->f4MorphParams[Level];
+            if (Level + 1 < m_NumLevels)
+            {
+                // Vertices are morphed over the last part of the range of their level
+                const float RangeStart = Level > 0 ? m_LevelRanges[Level - 1] : 0.f;
+                const float MorphEnd   = m_LevelRanges[Level];
+                const float MorphStart = MorphEnd - (MorphEnd - RangeStart) * MorphRegion;
+                MorphParams.x          = 1.f / (MorphEnd - MorphStart);
+                MorphParams.y          = -MorphStart / (MorphEnd - MorphStart);
+                MorphParams.z          = 0;
+                MorphParams.w          = 0;
+            }
+            else
+            {
+                MorphParams = float4{0, 0, 0, 0};
+            }
+        }
+    }
+
+    Timer SelectionTimer;
+
+    m_Selection.clear();
+    {
+        Node Root;
+        Root.Level = m_NumLevels - 1;
+        ComputeNodeBounds(Root);
+
+        // Top levels are traversed on this thread, and the subtrees below them are selected in parallel
+        TaskScheduler* pScheduler = Attribs.pScheduler;
+        const bool     bParallel  = pScheduler != nullptr && m_NumLevels > ParallelSubtree;
+
+        std::vector<Node> Subtrees;
+        SelectNode(Root, Attribs.pViewFrustum, m_Selection, bParallel ? &Subtrees : nullptr, bParallel ? m_NumLevels - 1 - ParallelSubtree : 0);
+        if (!Subtrees.empty())
+        {
+            m_ThreadSelections.resize(pScheduler->GetNumThreads());
+            for (auto& ThreadSelection : m_ThreadSelections)
+                ThreadSelection.clear();
+
+            pScheduler->ParallelFor(0, static_cast<Uint32>(Subtrees.size()), 1,
+                                    [&](Uint32 ThreadId, Uint32 Begin, Uint32 End) {
+                                        for (Uint32 i = Begin; i < End; ++i)
+                                            SelectNode(Subtrees[i], Attribs.pViewFrustum, m_ThreadSelections[ThreadId], nullptr, 0);
+                                    });
+
+            for (const auto& ThreadSelection : m_ThreadSelections)
+                m_Selection.insert(m_Selection.end(), ThreadSelection.begin(), ThreadSelection.end());
+        }
+
+        // Draw the patches front to back
+        std::sort(m_Selection.begin(), m_Selection.end(),
+                  [this](const SelectedPatch& P0, const SelectedPatch& P1) {
+                      return GetDistanceSq(m_f3CameraPos, P0.Patch.BndBox) < GetDistanceSq(m_f3CameraPos, P1.Patch.BndBox);
+                  });
+    }
+
+    m_Stats.SelectionTime = SelectionTimer.GetElapsedTime();
+
+    Timer StreamingTimer;
+
+    if (!m_pVertexBuffer)
+    {
+        // The vertex buffer is created on first use as it is large
+        BufferDesc VBDesc;
+        VBDesc.Name      = "CDLOD patch vertex buffer";
+        VBDesc.Size      = Uint64{m_Slots.size()} * NumPatchVerts * sizeof(PatchVertex);
+        VBDesc.BindFlags = BIND_VERTEX_BUFFER;
+        VBDesc.Usage     = USAGE_DEFAULT;
+        m_pDevice->CreateBuffer(VBDesc, nullptr, &m_pVertexBuffer);
+    }
+
+    // Mark the resident patches as used first so that they are not evicted
+    m_NewPatches.clear();
+    for (Uint32 i = 0; i < m_Selection.size(); ++i)
+    {
+        auto&      Patch = m_Selection[i];
+        const auto It    = m_ResidentPatches.find(GetPatchKey(Patch.Patch));
+        if (It != m_ResidentPatches.end())
+        {
+            Patch.Slot                        = It->second;
+            m_Slots[Patch.Slot].LastUsedFrame = m_FrameIndex;
+        }
+        else
+        {
+            m_NewPatches.push_back(i);
+        }
+    }
+
+    Uint32 NumNewPatches = 0;
+    Uint32 NumDropped    = 0;
+    for (Uint32 i = 0; i < m_NewPatches.size(); ++i)
+    {
+        auto&        Patch = m_Selection[m_NewPatches[i]];
+        const Uint32 Slot  = AllocatePatchSlot();
+        if (Slot == InvalidSlot)
+        {
+            ++NumDropped;
+            continue;
+        }
+
+        Patch.Slot                  = Slot;
+        m_Slots[Slot].Key           = GetPatchKey(Patch.Patch);
+        m_Slots[Slot].LastUsedFrame = m_FrameIndex;
+        m_ResidentPatches.emplace(m_Slots[Slot].Key, Slot);
+        m_NewPatches[NumNewPatches++] = m_NewPatches[i];
+    }
+    m_NewPatches.resize(NumNewPatches);
+
+    if (NumNewPatches > 0)
+    {
+        m_StagingVertices.resize(size_t{NumNewPatches} * NumPatchVerts);
+        ParallelFor(Attribs.pScheduler, 0, NumNewPatches, 1,
+                    [&](Uint32 ThreadId, Uint32 Begin, Uint32 End) {
+                        for (Uint32 i = Begin; i < End; ++i)
+                            GeneratePatchVertices(m_Selection[m_NewPatches[i]].Patch, &m_StagingVertices[size_t{i} * NumPatchVerts]);
+                    });
+
+        const Uint64 PatchDataSize = Uint64{NumPatchVerts} * sizeof(PatchVertex);
+        for (Uint32 i = 0; i < NumNewPatches; ++i)
+        {
+            pContext->UpdateBuffer(m_pVertexBuffer, m_Selection[m_NewPatches[i]].Slot * PatchDataSize, PatchDataSize,
+                                   &m_StagingVertices[size_t{i} * NumPatchVerts], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+    }
+
+    if (NumDropped > 0)
+    {
+        if (!m_bSlotsExhaustedReported)
+        {
+            LOG_WARNING_MESSAGE("CDLOD terrain selected more patches than fit into ", m_Slots.size(),
+                                " resident slots. Some patches will not be rendered; increase the target quad size or the number of resident patches.");
+            m_bSlotsExhaustedReported = true;
+        }
+
+        m_Selection.erase(std::remove_if(m_Selection.begin(), m_Selection.end(),
+                                         [](const SelectedPatch& Patch) { return Patch.Slot == InvalidSlot; }),
+                          m_Selection.end());
+    }
+
+    m_Stats.StreamingTime      = StreamingTimer.GetElapsedTime();
+    m_Stats.NumSelectedPatches = static_cast<Uint32>(m_Selection.size());
+    m_Stats.NumStreamedPatches = NumNewPatches;
+    m_Stats.NumDroppedPatches  = NumDropped;
+    m_Stats.NumResidentPatches = static_cast<Uint32>(m_ResidentPatches.size());
+}
+
+void CDLODTerrain::Draw(IDeviceContext* pContext, const ViewFrustumExt& Frustum, FRUSTUM_PLANE_FLAGS PlaneFlags, bool bUpdateStats)
+{
+    IBuffer* ppBuffers[1] = {m_pVertexBuffer};
+    pContext->SetVertexBuffers(0, 1, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+    pContext->SetIndexBuffer(m_pIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    Uint32 NumDrawnPatches   = 0;
+    Uint32 NumDrawnTriangles = 0;
+    for (const auto& Patch : m_Selection)
+    {
+        if (GetBoxVisibility(Frustum, Patch.Patch.BndBox, PlaneFlags) == BoxVisibility::Invisible)
+            continue;
+
+        DrawIndexedAttribs DrawAttrs{0, VT_UINT16, DRAW_FLAG_VERIFY_ALL};
+        DrawAttrs.BaseVertex = Patch.Slot * NumPatchVerts;
+        // Draw consecutive quadrants with one call
+        for (Uint32 Quadrant = 0; Quadrant < 4;)
+        {
+            if ((Patch.QuadrantMask & (1u << Quadrant)) == 0)
+            {
+                ++Quadrant;
+                continue;
+            }
+
+            Uint32 EndQuadrant = Quadrant + 1;
+            while (EndQuadrant < 4 && (Patch.QuadrantMask & (1u << EndQuadrant)) != 0)
+                ++EndQuadrant;
+
+            DrawAttrs.FirstIndexLocation = Quadrant * m_NumQuadrantIndices;
+            DrawAttrs.NumIndices         = (EndQuadrant - Quadrant) * m_NumQuadrantIndices;
+            pContext->DrawIndexed(DrawAttrs);
+            NumDrawnTriangles += DrawAttrs.NumIndices / 3;
+
+            Quadrant = EndQuadrant;
+        }
+        ++NumDrawnPatches;
+    }
+
+    if (bUpdateStats)
+    {
+        m_Stats.NumDrawnPatches   = NumDrawnPatches;
+        m_Stats.NumDrawnTriangles = NumDrawnTriangles;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,224 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "RefCntAutoPtr.hpp"
+
+#include "AdvancedMath.hpp"
+#include "TaskScheduler.hpp"
+
+namespace Diligent
+{
+
+class ElevationDataSource;
+
+// Continuous distance-dependent level of detail (CDLOD) terrain.
+//
+// The terrain is a quadtree of square patches in the plane tangent to the Earth at the origin. Every patch is
+// a grid of PatchQuads x PatchQuads quads, and the quad size doubles with every level. Every frame, the patches
+// are selected by the distance to the camera: level L is used up to the distance at which its quads project to
+// the target number of pixels. The vertex shader morphs every vertex towards its position in the next coarser
+// level over the last part of the level's range, so that there are no cracks or popping between the levels.
+// The number of triangles is thus determined by the screen resolution rather than by the size of the DEM.
+//
+// Patch vertices are computed from the elevation data source when the patch is selected for the first time
+// and are kept in a vertex buffer that holds a fixed number of patches; the least recently used patches are
+// replaced as the camera moves. Node selection and vertex generation run on the task scheduler threads.
+// Patches are drawn with a base vertex, so the device must support DRAW_COMMAND_CAP_FLAG_BASE_VERTEX.
+class CDLODTerrain
+{
+public:
+    // Number of quads along the side of a patch
+    static constexpr Uint32 PatchQuads = 32;
+
+    static constexpr Uint32 DefaultMaxResidentPatches = 1024;
+
+    struct CreateInfo
+    {
+        IRenderDevice*             pDevice     = nullptr;
+        const ElevationDataSource* pDataSource = nullptr;
+
+        float fEarthRadius    = 0;
+        float fSamplingStep   = 0;
+        float fElevationScale = 0;
+
+        // The number of patches whose vertices are kept in the vertex buffer
+        Uint32 MaxResidentPatches = DefaultMaxResidentPatches;
+    };
+    explicit CDLODTerrain(const CreateInfo& CI);
+
+    // clang-format off
+    CDLODTerrain             (const CDLODTerrain&) = delete;
+    CDLODTerrain& operator = (const CDLODTerrain&) = delete;
+    CDLODTerrain             (CDLODTerrain&&)      = delete;
+    CDLODTerrain& operator = (CDLODTerrain&&)      = delete;
+    // clang-format on
+
+    struct UpdateAttribs
+    {
+        float3 f3CameraPos;
+
+        // Nodes outside of this frustum are not subdivided further. They are still selected
+        // at their coarse level so that they cast shadows.
+        const ViewFrustumExt* pViewFrustum = nullptr;
+
+        // Screen size in pixels of an object of unit size at unit distance from the camera,
+        // i.e. ScreenHeight * Proj._22 / 2
+        float fProjScale = 1;
+
+        // Target screen size of a patch quad, in pixels
+        float fTargetQuadSize = 8;
+
+        TaskScheduler* pScheduler = nullptr;
+    };
+
+    // Selects the patches for the camera, generates the vertices of the patches that are not
+    // resident and updates the morph attributes. Must be called once per frame before Draw().
+    void Update(IDeviceContext* pContext, const UpdateAttribs& Attribs);
+
+    // Draws the selected patches that are not culled by the frustum. The pipeline state and
+    // the shader resources must be committed by the caller.
+    void Draw(IDeviceContext* pContext, const ViewFrustumExt& Frustum, FRUSTUM_PLANE_FLAGS PlaneFlags, bool bUpdateStats);
+
+    // Constant buffer with CDLODAttribs that the vertex shaders use to morph the vertices
+    IBuffer* GetAttribsCB() const { return m_pcbCDLODAttribs; }
+
+    Uint32 GetNumLevels() const { return m_NumLevels; }
+
+    struct Statistics
+    {
+        Uint32 NumSelectedPatches = 0;
+        Uint32 NumDrawnPatches    = 0;
+        Uint32 NumDrawnTriangles  = 0;
+        Uint32 NumStreamedPatches = 0;
+        Uint32 NumResidentPatches = 0;
+        Uint32 NumDroppedPatches  = 0;
+
+        // Time spent on the last update, in seconds
+        double SelectionTime = 0;
+        double StreamingTime = 0;
+    };
+    const Statistics& GetStats() const { return m_Stats; }
+
+private:
+    struct Node
+    {
+        Uint32   Level = 0;
+        Uint32   X     = 0;
+        Uint32   Z     = 0;
+        BoundBox BndBox;
+    };
+
+    struct SelectedPatch
+    {
+        Node Patch;
+
+        // Bit N is set if quadrant N of the patch is drawn (quadrants are ordered by X, then by Z)
+        Uint32 QuadrantMask = 0;
+
+        // Index of the patch in the vertex buffer
+        Uint32 Slot = 0;
+    };
+
+    struct PatchVertex
+    {
+        float3 f3WorldPos;
+        float2 f2MaskUV0;
+        // Offset to the vertex position in the coarser level (xyz) and the patch level (w)
+        float4 f4MorphDelta;
+    };
+
+    static Uint64 GetPatchKey(const Node& Patch)
+    {
+        return (Uint64{Patch.Level} << 48u) | (Uint64{Patch.Z} << 24u) | Uint64{Patch.X};
+    }
+
+    float GetNodeSize(Uint32 Level) const { return m_fLeafNodeSize * static_cast<float>(1u << Level); }
+
+    bool ComputeNodeBounds(Node& N) const;
+    bool IsWithinRange(const BoundBox& BndBox, Uint32 Level) const;
+    void SelectNode(const Node&                 N,
+                    const ViewFrustumExt*       pViewFrustum,
+                    std::vector<SelectedPatch>& Selection,
+                    std::vector<Node>*          pDeferredNodes,
+                    Uint32                      DeferredLevel) const;
+
+    Uint32 AllocatePatchSlot();
+    void   GeneratePatchVertices(const Node& Patch, PatchVertex* pVerts) const;
+
+    RefCntAutoPtr<IRenderDevice>     m_pDevice;
+    const ElevationDataSource* const m_pDataSource;
+
+    const float m_fEarthRadius;
+    const float m_fSamplingStep;
+    const float m_fElevationScale;
+    const float m_fLeafNodeSize;
+
+    // Half size of the root node, in elevation samples
+    int    m_iRootHalfSize = 0;
+    Uint32 m_NumLevels     = 0;
+
+    RefCntAutoPtr<IBuffer> m_pVertexBuffer;
+    RefCntAutoPtr<IBuffer> m_pIndexBuffer;
+    RefCntAutoPtr<IBuffer> m_pcbCDLODAttribs;
+
+    Uint32 m_NumQuadrantIndices = 0;
+
+    float3             m_f3CameraPos;
+    std::vector<float> m_LevelRanges;
+
+    std::vector<SelectedPatch>              m_Selection;
+    std::vector<std::vector<SelectedPatch>> m_ThreadSelections;
+    // Indices of the selected patches whose vertices are generated in this frame
+    std::vector<Uint32> m_NewPatches;
+
+    // Resident patch slots
+    struct PatchSlot
+    {
+        Uint64 Key           = 0;
+        Uint64 LastUsedFrame = 0;
+    };
+    std::vector<PatchSlot>             m_Slots;
+    std::vector<Uint32>                m_FreeSlots;
+    std::unordered_map<Uint64, Uint32> m_ResidentPatches;
+    std::vector<PatchVertex>           m_StagingVertices;
+
+    Uint64 m_FrameIndex = 0;
+
+    bool m_bSlotsExhaustedReported = false;
+
+    Statistics m_Stats;
+};
+
+} // namespace Diligent
@@ -45,8 +45,11 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <cmath>
 #include <array>
 
+#include "SIMDSupport.hpp"
+
 #include "EarthHemisphere.hpp"
 
 namespace Diligent
@@ -68,6 +71,8 @@ namespace Diligent
 #include "CallbackWrapper.hpp"
 #include "Utilities/interface/DiligentFXShaderSourceStreamFactory.hpp"
 #include "ShaderSourceFactoryUtils.hpp"
+#include "Timer.hpp"
+#include "TimelineProfiler.hpp"
 
 namespace Diligent
 {
@@ -204,25 +209,207 @@ private:
 typedef TriStrip<Uint32, StdIndexGenerator> StdTriStrip32;
 
 
-void ComputeVertexHeight(HemisphereVertex&          Vertex,
-                         class ElevationDataSource* pDataSource,
-                         float                      fSamplingStep,
-                         float                      fSampleScale)
+namespace
 {
-    float3& f3PosWS = Vertex.f3WorldPos;
 
-    float fCol   = f3PosWS.x / fSamplingStep;
-    float fRow   = f3PosWS.z / fSamplingStep;
-    float fDispl = pDataSource->GetInterpolatedHeight(fCol, fRow);
-    int   iColOffset, iRowOffset;
-    pDataSource->GetOffsets(iColOffset, iRowOffset);
-    Vertex.f2MaskUV0.x = (fCol + (float)iColOffset + 0.5f) / (float)pDataSource->GetNumCols();
-    Vertex.f2MaskUV0.y = (fRow + (float)iRowOffset + 0.5f) / (float)pDataSource->GetNumRows();
+// Vertex positions are computed for groups of SIMD-width vertices in a row.
+// Float1 processes the remaining vertices. All operations are IEEE-exact, so
+// both paths produce the same positions.
+struct Float1
+{
+    static constexpr size_t Width = 1;
+
+    float v;
+
+    static Float1 Load(const float* p) { return {*p}; }
+    static Float1 Set(float f) { return {f}; }
+    void          Store(float* p) const { *p = v; }
+
+    friend Float1 operator+(Float1 a, Float1 b) { return {a.v + b.v}; }
+    friend Float1 operator-(Float1 a, Float1 b) { return {a.v - b.v}; }
+    friend Float1 operator*(Float1 a, Float1 b) { return {a.v * b.v}; }
+    friend Float1 operator/(Float1 a, Float1 b) { return {a.v / b.v}; }
+
+    static Float1 Sqrt(Float1 a) { return {std::sqrt(a.v)}; }
+    static Float1 Abs(Float1 a) { return {std::abs(a.v)}; }
+    static Float1 Min(Float1 a, Float1 b) { return {std::min(a.v, b.v)}; }
+    static Float1 Max(Float1 a, Float1 b) { return {std::max(a.v, b.v)}; }
+};
+
+#if SAMPLES_USE_SSE2
+
+struct FloatSimd
+{
+    static constexpr size_t Width = 4;
+
+    __m128 v;
+
+    static FloatSimd Load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static FloatSimd Set(float f) { return {_mm_set1_ps(f)}; }
+    void             Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend FloatSimd operator+(FloatSimd a, FloatSimd b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend FloatSimd operator-(FloatSimd a, FloatSimd b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend FloatSimd operator*(FloatSimd a, FloatSimd b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend FloatSimd operator/(FloatSimd a, FloatSimd b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    static FloatSimd Sqrt(FloatSimd a) { return {_mm_sqrt_ps(a.v)}; }
+    static FloatSimd Abs(FloatSimd a) { return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)}; }
+    static FloatSimd Min(FloatSimd a, FloatSimd b) { return {_mm_min_ps(a.v, b.v)}; }
+    static FloatSimd Max(FloatSimd a, FloatSimd b) { return {_mm_max_ps(a.v, b.v)}; }
+};
+
+#elif SAMPLES_USE_NEON_A64
+
+struct FloatSimd
+{
+    static constexpr size_t Width = 4;
+
+    float32x4_t v;
+
+    static FloatSimd Load(const float* p) { return {vld1q_f32(p)}; }
+    static FloatSimd Set(float f) { return {vdupq_n_f32(f)}; }
+    void             Store(float* p) const { vst1q_f32(p, v); }
+
+    friend FloatSimd operator+(FloatSimd a, FloatSimd b) { return {vaddq_f32(a.v, b.v)}; }
+    friend FloatSimd operator-(FloatSimd a, FloatSimd b) { return {vsubq_f32(a.v, b.v)}; }
+    friend FloatSimd operator*(FloatSimd a, FloatSimd b) { return {vmulq_f32(a.v, b.v)}; }
+    friend FloatSimd operator/(FloatSimd a, FloatSimd b) { return {vdivq_f32(a.v, b.v)}; }
+
+    static FloatSimd Sqrt(FloatSimd a) { return {vsqrtq_f32(a.v)}; }
+    static FloatSimd Abs(FloatSimd a) { return {vabsq_f32(a.v)}; }
+    static FloatSimd Min(FloatSimd a, FloatSimd b) { return {vminq_f32(a.v, b.v)}; }
+    static FloatSimd Max(FloatSimd a, FloatSimd b) { return {vmaxq_f32(a.v, b.v)}; }
+};
+
+#endif
+
+// Structure-of-arrays data of one grid row
+struct GridRowData
+{
+    explicit GridRowData(size_t NumVerts) :
+        X(NumVerts), Y(NumVerts), Z(NumVerts), Cols(NumVerts), Rows(NumVerts), Heights(NumVerts)
+    {}
+
+    std::vector<float> X, Y, Z;
+    std::vector<float> Cols, Rows;
+    std::vector<float> Heights;
+};
+
+struct SphereGridAttribs
+{
+    // Normalized [-1, 1] coordinates of the grid lines
+    std::vector<float> GridCoords;
+
+    float fEarthRadius;
+    float fSamplingStep;
+    float fSampleScale;
+};
 
-    float3 f3SphereNormal = normalize(f3PosWS);
-    f3PosWS += f3SphereNormal * fDispl * fSampleScale;
+// Projects grid vertices [Start, End) of the row onto the sphere and computes
+// their coordinates in the height map
+template <typename VecType>
+void ProjectGridRow(const SphereGridAttribs& Attribs, float fRowCoord, float fGridScale, size_t Start, size_t End, GridRowData& Row)
+{
+    const auto Zero       = VecType::Set(0.f);
+    const auto One        = VecType::Set(1.f);
+    const auto MinDist    = VecType::Set(FLT_MIN);
+    const auto GridScale  = VecType::Set(fGridScale);
+    const auto Radius     = VecType::Set(Attribs.fEarthRadius);
+    const auto SampleStep = VecType::Set(Attribs.fSamplingStep);
+    for (size_t i = Start; i + VecType::Width <= End; i += VecType::Width)
+    {
+        auto X = VecType::Load(&Attribs.GridCoords[i]);
+        auto Z = VecType::Set(fRowCoord);
+
+        // The center vertex has zero distance to both axes, and the
+        // clamp makes the direction scale 1 for it.
+        const auto DX             = VecType::Abs(X);
+        const auto DZ             = VecType::Abs(Z);
+        const auto MaxD           = VecType::Max(DX, DZ);
+        const auto MinD           = VecType::Min(DX, DZ);
+        const auto Tan            = MinD / VecType::Max(MaxD, MinDist);
+        const auto DirectionScale = One / VecType::Sqrt(One + Tan * Tan);
+
+        X = X * (DirectionScale * GridScale);
+        Z = Z * (DirectionScale * GridScale);
+        auto Y = VecType::Sqrt(VecType::Max(Zero, One - (X * X + Z * Z)));
+
+        X = X * Radius;
+        Z = Z * Radius;
+        Y = Y * Radius;
+
+        X.Store(&Row.X[i]);
+        Y.Store(&Row.Y[i]);
+        Z.Store(&Row.Z[i]);
+        (X / SampleStep).Store(&Row.Cols[i]);
+        (Z / SampleStep).Store(&Row.Rows[i]);
+    }
+}
+
+// Displaces vertices [Start, End) of the row along the sphere normal by the terrain height
+template <typename VecType>
+void DisplaceGridRow(const SphereGridAttribs& Attribs, size_t Start, size_t End, GridRowData& Row)
+{
+    const auto SampleScale = VecType::Set(Attribs.fSampleScale);
+    const auto Radius      = VecType::Set(Attribs.fEarthRadius);
+    for (size_t i = Start; i + VecType::Width <= End; i += VecType::Width)
+    {
+        const auto X = VecType::Load(&Row.X[i]);
+        const auto Y = VecType::Load(&Row.Y[i]);
+        const auto Z = VecType::Load(&Row.Z[i]);
+
+        const auto Length = VecType::Sqrt(X * X + Y * Y + Z * Z);
+        const auto Displ  = VecType::Load(&Row.Heights[i]) * SampleScale;
+
+        (X + X / Length * Displ).Store(&Row.X[i]);
+        (Y + Y / Length * Displ - Radius).Store(&Row.Y[i]);
+        (Z + Z / Length * Displ).Store(&Row.Z[i]);
+    }
+}
+
+void GenerateGridRow(const SphereGridAttribs&   Attribs,
+                     class ElevationDataSource* pDataSource,
+                     int                        iRow,
+                     float                      fGridScale,
+                     GridRowData&               Row,
+                     HemisphereVertex*          pVerts)
+{
+    const size_t NumVerts = Attribs.GridCoords.size();
+#if SAMPLES_USE_SSE2 || SAMPLES_USE_NEON_A64
+    const size_t NumSimdVerts = NumVerts / FloatSimd::Width * FloatSimd::Width;
+#else
+    const size_t NumSimdVerts = 0;
+#endif
+
+    const float fRowCoord = Attribs.GridCoords[iRow];
+#if SAMPLES_USE_SSE2 || SAMPLES_USE_NEON_A64
+    ProjectGridRow<FloatSimd>(Attribs, fRowCoord, fGridScale, 0, NumSimdVerts, Row);
+#endif
+    ProjectGridRow<Float1>(Attribs, fRowCoord, fGridScale, NumSimdVerts, NumVerts, Row);
+
+    pDataSource->GetInterpolatedHeights(Row.Cols.data(), Row.Rows.data(), Row.Heights.data(), NumVerts);
+
+#if SAMPLES_USE_SSE2 || SAMPLES_USE_NEON_A64
+    DisplaceGridRow<FloatSimd>(Attribs, 0, NumSimdVerts, Row);
+#endif
+    DisplaceGridRow<Float1>(Attribs, NumSimdVerts, NumVerts, Row);
+
+    int iColOffset, iRowOffset;
+    pDataSource->GetOffsets(iColOffset, iRowOffset);
+    const float fNumCols = static_cast<float>(pDataSource->GetNumCols());
+    const float fNumRows = static_cast<float>(pDataSource->GetNumRows());
+    for (size_t i = 0; i < NumVerts; ++i)
+    {
+        auto& Vert         = pVerts[i];
+        Vert.f3WorldPos    = float3{Row.X[i], Row.Y[i], Row.Z[i]};
+        Vert.f2MaskUV0.x   = (Row.Cols[i] + (float)iColOffset + 0.5f) / fNumCols;
+        Vert.f2MaskUV0.y   = (Row.Rows[i] + (float)iRowOffset + 0.5f) / fNumRows;
+    }
 }
 
+} // namespace
+
 
 class RingMeshBuilder
 {
@@ -237,6 +424,7 @@ public:
         m_iGridDimenion(iGridDimenion)
     {}
 
+    // Adds the sector to the list of meshes that are created by CreateMeshes()
     void CreateMesh(int                          iBaseIndex,
                     int                          iStartCol,
                     int                          iStartRow,
@@ -244,58 +432,103 @@ public:
                     int                          iNumRows,
                     enum QUAD_TRIANGULATION_TYPE QuadTriangType)
     {
-        m_RingMeshes.push_back(RingSectorMesh());
-        auto& CurrMesh = m_RingMeshes.back();
-
-        std::vector<Uint32> IB;
-        StdTriStrip32       TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
-        TriStrip.AddStrip(iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType);
-
-        CurrMesh.uiNumIndices = (Uint32)IB.size();
-
-        // Prepare buffer description
-        BufferDesc IndexBufferDesc;
-        IndexBufferDesc.Name      = "Ring mesh index buffer";
-        IndexBufferDesc.Size      = (Uint32)(IB.size() * sizeof(IB[0]));
-        IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
-        IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
-        BufferData IBInitData;
-        IBInitData.pData    = IB.data();
-        IBInitData.DataSize = IndexBufferDesc.Size;
-        // Create the buffer
-        m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
-        VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
-
-        // Compute bounding box
-        auto& BB = CurrMesh.BndBox;
-        BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-        BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
-        for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
-        {
-            const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+        m_Sectors.push_back({iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType});
+    }
 
-            BB.Min = std::min(BB.Min, CurrVert);
-            BB.Max = std::max(BB.Max, CurrVert);
+    // Generates the indices and bounding boxes of all sectors in parallel,
+    // and creates the index buffers
+    void CreateMeshes(TaskScheduler* pScheduler, EarthHemsiphere::GeometryStats& Stats)
+    {
+        const size_t FirstMesh = m_RingMeshes.size();
+        m_RingMeshes.resize(FirstMesh + m_Sectors.size());
+
+        Timer IndicesTimer;
+
+        std::vector<std::vector<Uint32>> SectorIndices(m_Sectors.size());
+        ParallelFor(pScheduler, 0, static_cast<Uint32>(m_Sectors.size()), 1,
+                    [&](Uint32 ThreadId, Uint32 StartSector, Uint32 EndSector) {
+                        TimelineProfiler::CpuScope ProfilerScope{"Ring sector indices"};
+                        for (Uint32 Sector = StartSector; Sector < EndSector; ++Sector)
+                        {
+                            const auto& Desc = m_Sectors[Sector];
+                            auto&       IB   = SectorIndices[Sector];
+
+                            StdTriStrip32 TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
+                            TriStrip.AddStrip(Desc.iBaseIndex, Desc.iStartCol, Desc.iStartRow, Desc.iNumCols, Desc.iNumRows, Desc.QuadTriangType);
+
+                            // Compute bounding box
+                            auto& BB = m_RingMeshes[FirstMesh + Sector].BndBox;
+                            BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                            BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+                            for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
+                            {
+                                const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+
+                                BB.Min = std::min(BB.Min, CurrVert);
+                                BB.Max = std::max(BB.Max, CurrVert);
+                            }
+                        }
+                    });
+
+        Stats.IndicesTime += IndicesTimer.GetElapsedTime();
+
+        Timer BuffersTimer;
+        for (size_t Sector = 0; Sector < m_Sectors.size(); ++Sector)
+        {
+            const auto& IB       = SectorIndices[Sector];
+            auto&       CurrMesh = m_RingMeshes[FirstMesh + Sector];
+
+            CurrMesh.uiNumIndices = (Uint32)IB.size();
+            Stats.NumIndices += CurrMesh.uiNumIndices;
+
+            // Prepare buffer description
+            BufferDesc IndexBufferDesc;
+            IndexBufferDesc.Name      = "Ring mesh index buffer";
+            IndexBufferDesc.Size      = (Uint32)(IB.size() * sizeof(IB[0]));
+            IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
+            IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
+            BufferData IBInitData;
+            IBInitData.pData    = IB.data();
+            IBInitData.DataSize = IndexBufferDesc.Size;
+            // Create the buffer
+            m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
+            VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
         }
+        Stats.BuffersTime += BuffersTimer.GetElapsedTime();
+
+        m_Sectors.clear();
     }
 
 private:
+    struct SectorDesc
+    {
+        int                     iBaseIndex;
+        int                     iStartCol;
+        int                     iStartRow;
+        int                     iNumCols;
+        int                     iNumRows;
+        QUAD_TRIANGULATION_TYPE QuadTriangType;
+    };
+
     RefCntAutoPtr<IRenderDevice>         m_pDevice;
     std::vector<RingSectorMesh>&         m_RingMeshes;
     const std::vector<HemisphereVertex>& m_VB;
     const int                            m_iGridDimenion;
+    std::vector<SectorDesc>              m_Sectors;
 };
 
 
-void GenerateSphereGeometry(IRenderDevice*                 pDevice,
-                            const float                    fEarthRadius,
-                            int                            iGridDimension,
-                            const int                      iNumRings,
-                            class ElevationDataSource*     pDataSource,
-                            float                          fSamplingStep,
-                            float                          fSampleScale,
-                            std::vector<HemisphereVertex>& VB,
-                            std::vector<RingSectorMesh>&   SphereMeshes)
+void GenerateSphereGeometry(IRenderDevice*                  pDevice,
+                            const float                     fEarthRadius,
+                            int                             iGridDimension,
+                            const int                       iNumRings,
+                            class ElevationDataSource*      pDataSource,
+                            float                           fSamplingStep,
+                            float                           fSampleScale,
+                            std::vector<HemisphereVertex>&  VB,
+                            std::vector<RingSectorMesh>&    SphereMeshes,
+                            TaskScheduler*                  pScheduler,
+                            EarthHemsiphere::GeometryStats& Stats)
 {
     if ((iGridDimension - 1) % 4 != 0)
     {
@@ -309,74 +542,77 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 
     RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, SphereMeshes);
 
-    int iStartRing = 0;
-    VB.reserve((iNumRings - iStartRing) * iGridDimension * iGridDimension);
-    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
+    const size_t GridSize = static_cast<size_t>(iGridDimension) * static_cast<size_t>(iGridDimension);
+
+    SphereGridAttribs GridAttribs;
+    GridAttribs.fEarthRadius  = fEarthRadius;
+    GridAttribs.fSamplingStep = fSamplingStep;
+    GridAttribs.fSampleScale  = fSampleScale;
+    GridAttribs.GridCoords.resize(iGridDimension);
+    for (int i = 0; i < iGridDimension; ++i)
     {
-        int iCurrGridStart = (int)VB.size();
-        VB.resize(VB.size() + static_cast<size_t>(iGridDimension) * static_cast<size_t>(iGridDimension));
-        float fGridScale = 1.f / (float)(1 << (iNumRings - 1 - iRing));
-        // Fill vertex buffer
-        for (int iRow = 0; iRow < iGridDimension; ++iRow)
-            for (int iCol = 0; iCol < iGridDimension; ++iCol)
-            {
-                auto& CurrVert = VB[iCurrGridStart + iCol + iRow * iGridDimension];
-                auto& f3Pos    = CurrVert.f3WorldPos;
+        const float fCoord         = static_cast<float>(i) / static_cast<float>(iGridDimension - 1);
+        GridAttribs.GridCoords[i] = fCoord * 2 - 1;
+    }
 
-                f3Pos.x = static_cast<float>(iCol) / static_cast<float>(iGridDimension - 1);
-                f3Pos.z = static_cast<float>(iRow) / static_cast<float>(iGridDimension - 1);
-                f3Pos.x = f3Pos.x * 2 - 1;
-                f3Pos.z = f3Pos.z * 2 - 1;
-                f3Pos.y = 0;
+    int iStartRing = 0;
+    VB.resize((iNumRings - iStartRing) * GridSize);
 
-                float fDirectionScale = 1;
-                if (f3Pos.x != 0 || f3Pos.z != 0)
-                {
-                    float fDX       = fabs(f3Pos.x);
-                    float fDZ       = fabs(f3Pos.z);
-                    float fMaxD     = std::max(fDX, fDZ);
-                    float fMinD     = std::min(fDX, fDZ);
-                    float fTan      = fMinD / fMaxD;
-                    fDirectionScale = 1 / sqrt(1 + fTan * fTan);
-                }
+    Timer VerticesTimer;
 
-                f3Pos.x *= fDirectionScale * fGridScale;
-                f3Pos.z *= fDirectionScale * fGridScale;
-                f3Pos.y = sqrt(std::max(0.f, 1.f - (f3Pos.x * f3Pos.x + f3Pos.z * f3Pos.z)));
+    // Fill vertex buffer. Rows of all rings are independent, so they are processed in parallel.
+    // Every chunk is large enough to amortize the task overhead.
+    const Uint32 NumGridRows = static_cast<Uint32>((iNumRings - iStartRing) * iGridDimension);
+    const Uint32 GrainSize   = std::max(4096u / static_cast<Uint32>(iGridDimension), 1u);
+    ParallelFor(pScheduler, 0, NumGridRows, GrainSize,
+                [&](Uint32 ThreadId, Uint32 StartRow, Uint32 EndRow) {
+                    TimelineProfiler::CpuScope ProfilerScope{"Ring vertices"};
 
-                f3Pos.x *= fEarthRadius;
-                f3Pos.z *= fEarthRadius;
-                f3Pos.y *= fEarthRadius;
+                    GridRowData RowData{static_cast<size_t>(iGridDimension)};
+                    for (Uint32 GridRow = StartRow; GridRow < EndRow; ++GridRow)
+                    {
+                        const int iRing      = iStartRing + static_cast<int>(GridRow) / iGridDimension;
+                        const int iRow       = static_cast<int>(GridRow) % iGridDimension;
+                        float     fGridScale = 1.f / (float)(1 << (iNumRings - 1 - iRing));
+                        GenerateGridRow(GridAttribs, pDataSource, iRow, fGridScale, RowData, &VB[GridRow * static_cast<size_t>(iGridDimension)]);
+                    }
+                });
 
-                ComputeVertexHeight(CurrVert, pDataSource, fSamplingStep, fSampleScale);
-                f3Pos.y -= fEarthRadius;
-            }
+    // Align vertices on the outer boundary
+    ParallelFor(pScheduler, iStartRing, static_cast<Uint32>(std::max(iNumRings - 1, iStartRing)), 1,
+                [&](Uint32 ThreadId, Uint32 StartRing, Uint32 EndRing) {
+                    for (Uint32 iRing = StartRing; iRing < EndRing; ++iRing)
+                    {
+                        const size_t iCurrGridStart = (iRing - iStartRing) * GridSize;
+                        for (int i = 1; i < iGridDimension - 1; i += 2)
+                        {
+                            // Top & bottom boundaries
+                            for (int iRow = 0; iRow < iGridDimension; iRow += iGridDimension - 1)
+                            {
+                                const auto& V0 = VB[iCurrGridStart + i - 1 + iRow * iGridDimension].f3WorldPos;
+                                auto&       V1 = VB[iCurrGridStart + i + 0 + iRow * iGridDimension].f3WorldPos;
+                                const auto& V2 = VB[iCurrGridStart + i + 1 + iRow * iGridDimension].f3WorldPos;
+                                V1             = (V0 + V2) / 2.f;
+                            }
+
+                            // Left & right boundaries
+                            for (int iCol = 0; iCol < iGridDimension; iCol += iGridDimension - 1)
+                            {
+                                const auto& V0 = VB[iCurrGridStart + iCol + (i - 1) * iGridDimension].f3WorldPos;
+                                auto&       V1 = VB[iCurrGridStart + iCol + (i + 0) * iGridDimension].f3WorldPos;
+                                const auto& V2 = VB[iCurrGridStart + iCol + (i + 1) * iGridDimension].f3WorldPos;
+                                V1             = (V0 + V2) / 2.f;
+                            }
+                        }
+                    }
+                });
 
-        // Align vertices on the outer boundary
-        if (iRing < iNumRings - 1)
-        {
-            for (int i = 1; i < iGridDimension - 1; i += 2)
-            {
-                // Top & bottom boundaries
-                for (int iRow = 0; iRow < iGridDimension; iRow += iGridDimension - 1)
-                {
-                    const auto& V0 = VB[iCurrGridStart + i - 1 + iRow * iGridDimension].f3WorldPos;
-                    auto&       V1 = VB[iCurrGridStart + i + 0 + iRow * iGridDimension].f3WorldPos;
-                    const auto& V2 = VB[iCurrGridStart + i + 1 + iRow * iGridDimension].f3WorldPos;
-                    V1             = (V0 + V2) / 2.f;
-                }
-
-                // Left & right boundaries
-                for (int iCol = 0; iCol < iGridDimension; iCol += iGridDimension - 1)
-                {
-                    const auto& V0 = VB[iCurrGridStart + iCol + (i - 1) * iGridDimension].f3WorldPos;
-                    auto&       V1 = VB[iCurrGridStart + iCol + (i + 0) * iGridDimension].f3WorldPos;
-                    const auto& V2 = VB[iCurrGridStart + iCol + (i + 1) * iGridDimension].f3WorldPos;
-                    V1             = (V0 + V2) / 2.f;
-                }
-            }
-        }
+    Stats.VerticesTime += VerticesTimer.GetElapsedTime();
+    Stats.NumVertices += static_cast<Uint32>(VB.size());
 
+    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
+    {
+        int iCurrGridStart = static_cast<int>((iRing - iStartRing) * GridSize);
 
         // Generate indices for the current ring
         if (iRing == 0)
@@ -396,10 +632,10 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 
             RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
             RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-                                       
+
             RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
             RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-                                       
+
             RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
             RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
 
@@ -412,6 +648,9 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
         }
     }
 
+    // Sector index buffers are generated concurrently
+    RingMeshBuilder.CreateMeshes(pScheduler, Stats);
+
     // We do not need per-vertex normals as we use normal map to shade terrain
     // Sphere tangent vertex are computed in the shader
 #if 0
@@ -491,77 +730,39 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 #endif
 }
 
-
-void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
-                                      IDeviceContext* pContext,
-                                      const Uint16*   pHeightMap,
-                                      size_t          HeightMapStride,
-                                      int             iHeightMapDim,
-                                      ITexture*       ptex2DNormalMap)
+void EarthHemsiphere::RenderNormalMap(IRenderDevice*                   pDevice,
+                                      IDeviceContext*                  pContext,
+                                      const class ElevationDataSource* pDataSource,
+                                      ITexture*                        ptex2DNormalMap)
 {
     TextureDesc HeightMapDesc;
     HeightMapDesc.Name      = "Height map texture";
     HeightMapDesc.Type      = RESOURCE_DIM_TEX_2D;
-    HeightMapDesc.Width     = iHeightMapDim;
-    HeightMapDesc.Height    = iHeightMapDim;
+    HeightMapDesc.Width     = pDataSource->GetNumCols();
+    HeightMapDesc.Height    = pDataSource->GetNumRows();
     HeightMapDesc.Format    = TEX_FORMAT_R16_UINT;
-    HeightMapDesc.Usage     = USAGE_IMMUTABLE;
+    HeightMapDesc.Usage     = USAGE_DEFAULT;
     HeightMapDesc.BindFlags = BIND_SHADER_RESOURCE;
-    HeightMapDesc.MipLevels = ComputeMipLevelsCount(HeightMapDesc.Width, HeightMapDesc.Height);
-
-    // Stack all coarse mip levels on top of each other with the same stride
-    //    __________
-    //   |__|__     |
-    //   |     |    |
-    //   |_____|____|
-    //   |          |
-    //   |          |
-    //   |          |
-    //   |__________|
-    std::vector<Uint16> CoarseMipLevels;
-    CoarseMipLevels.resize(static_cast<size_t>(iHeightMapDim) / 2 * iHeightMapDim);
-
-    std::vector<TextureSubResData> InitData(HeightMapDesc.MipLevels);
-    InitData[0].pData            = pHeightMap;
-    InitData[0].Stride           = (Uint32)HeightMapStride * sizeof(pHeightMap[0]);
-    const Uint16* pFinerMipLevel = pHeightMap;
-    Uint16*       pCurrMipLevel  = &CoarseMipLevels[0];
-    size_t        FinerMipStride = HeightMapStride;
-    size_t        CurrMipStride  = iHeightMapDim / 2;
-    for (Uint32 uiMipLevel = 1; uiMipLevel < HeightMapDesc.MipLevels; ++uiMipLevel)
-    {
-        const auto MipProps = GetMipLevelProperties(HeightMapDesc, uiMipLevel);
-        for (size_t Row = 0; Row < MipProps.LogicalHeight; ++Row)
-        {
-            for (size_t Col = 0; Col < MipProps.LogicalWidth; ++Col)
-            {
-                int iAverageHeight = 0;
-                for (size_t i = 0; i < 2; ++i)
-                {
-                    for (size_t j = 0; j < 2; ++j)
-                    {
-                        iAverageHeight += pFinerMipLevel[(Col * 2 + i) + (Row * 2 + j) * size_t{FinerMipStride}];
-                    }
-                }
-                pCurrMipLevel[Col + Row * CurrMipStride] = (Uint16)(iAverageHeight >> 2);
-            }
-        }
-
-        InitData[uiMipLevel].pData  = pCurrMipLevel;
-        InitData[uiMipLevel].Stride = (Uint32)CurrMipStride * sizeof(*pCurrMipLevel);
-        pFinerMipLevel              = pCurrMipLevel;
-        FinerMipStride              = CurrMipStride;
-        pCurrMipLevel += MipProps.LogicalHeight * CurrMipStride;
-        CurrMipStride = iHeightMapDim / 2; // Same stride for all mips
-    }
+    HeightMapDesc.MipLevels = pDataSource->GetNumLevels();
+    VERIFY_EXPR(HeightMapDesc.MipLevels == ComputeMipLevelsCount(HeightMapDesc.Width, HeightMapDesc.Height));
 
     RefCntAutoPtr<ITexture> ptex2DHeightMap;
-    TextureData             HeigtMapInitData;
-    HeigtMapInitData.pSubResources   = InitData.data();
-    HeigtMapInitData.NumSubresources = (Uint32)InitData.size();
-    pDevice->CreateTexture(HeightMapDesc, &HeigtMapInitData, &ptex2DHeightMap);
+    pDevice->CreateTexture(HeightMapDesc, nullptr, &ptex2DHeightMap);
     VERIFY(ptex2DHeightMap, "Failed to create height map texture");
 
+    // The data source stores all mip levels, so the height map is uploaded tile by tile
+    // and is never fully loaded into memory
+    for (Uint32 uiMipLevel = 0; uiMipLevel < HeightMapDesc.MipLevels; ++uiMipLevel)
+    {
+        pDataSource->ProcessLevelTiles(uiMipLevel, [&](Uint32 iCol, Uint32 iRow, Uint32 Width, Uint32 Height, const Uint16* pData, size_t Stride) {
+            TextureSubResData SubResData;
+            SubResData.pData  = pData;
+            SubResData.Stride = Stride * sizeof(*pData);
+            pContext->UpdateTexture(ptex2DHeightMap, uiMipLevel, 0, Box{iCol, iCol + Width, iRow, iRow + Height}, SubResData,
+                                    RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        });
+    }
+
     m_pResMapping->AddResource("g_tex2DElevationMap", ptex2DHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), true);
 
     RefCntAutoPtr<IBuffer> pcbNMGenerationAttribs;
@@ -617,7 +818,8 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
                              const Char*                TileNormalMapPath[],
                              IBuffer*                   pcbCameraAttribs,
                              IBuffer*                   pcbLightAttribs,
-                             IBuffer*                   pcMediaScatteringParams)
+                             IBuffer*                   pcMediaScatteringParams,
+                             TaskScheduler*             pScheduler)
 {
     m_Params  = Params;
     m_pDevice = pDevice;
@@ -641,9 +843,6 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         CreateRenderStateNotationLoader({m_pDevice, pRSNParser, pCompoundFactory}, &m_pRSNLoader);
     }
 
-    const Uint16* pHeightMap;
-    size_t        HeightMapPitch;
-    pDataSource->GetDataPtr(pHeightMap, HeightMapPitch);
     Uint32 iHeightMapDim = pDataSource->GetNumCols();
     VERIFY_EXPR(iHeightMapDim == pDataSource->GetNumRows());
 
@@ -663,6 +862,16 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
     CreateUniformBuffer(pDevice, sizeof(TerrainAttribs), "Terrain Attribs CB", &m_pcbTerrainAttribs);
 
+    {
+        CDLODTerrain::CreateInfo CDLODCI;
+        CDLODCI.pDevice         = pDevice;
+        CDLODCI.pDataSource     = pDataSource;
+        CDLODCI.fEarthRadius    = AirScatteringAttribs().fEarthRadius;
+        CDLODCI.fSamplingStep   = m_Params.m_TerrainAttribs.m_fElevationSamplingInterval;
+        CDLODCI.fElevationScale = m_Params.m_TerrainAttribs.m_fElevationScale;
+        m_pCDLODTerrain.reset(new CDLODTerrain{CDLODCI});
+    }
+
     ResourceMappingCreateInfo ResMappingCI;
     // clang-format off
     ResourceMappingEntry pEntries[] = 
@@ -671,7 +880,8 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         {"cbTerrainAttribs", m_pcbTerrainAttribs}, 
         {"cbLightAttribs", pcbLightAttribs}, 
         {"g_tex2DNormalMap", ptex2DNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)}, 
-        {"cbParticipatingMediaScatteringParams", pcMediaScatteringParams}
+        {"cbParticipatingMediaScatteringParams", pcMediaScatteringParams},
+        {"cbCDLODAttribs", m_pCDLODTerrain->GetAttribsCB()}
     };
     // clang-format on
     ResMappingCI.pEntries   = pEntries;
@@ -708,7 +918,7 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
     m_pDevice->CreateSampler(Sam_ComparisonLinearClamp, &m_pComparisonSampler);
 
-    RenderNormalMap(pDevice, pContext, pHeightMap, HeightMapPitch, iHeightMapDim, ptex2DNormalMap);
+    RenderNormalMap(pDevice, pContext, pDataSource, ptex2DNormalMap);
 
     {
         auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
@@ -723,10 +933,34 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         m_pRSNLoader->LoadPipelineState({"Render Hemisphere Z Only", PIPELINE_TYPE_GRAPHICS, false, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemisphereZOnlyPSO);
         m_pHemisphereZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
         m_pHemisphereZOnlyPSO->CreateShaderResourceBinding(&m_pHemisphereZOnlySRB, true);
+
+        m_pRSNLoader->LoadPipelineState({"Render CDLOD Hemisphere Z Only", PIPELINE_TYPE_GRAPHICS, false, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pCDLODZOnlyPSO);
+        m_pCDLODZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+        m_pCDLODZOnlyPSO->CreateShaderResourceBinding(&m_pCDLODZOnlySRB, true);
     }
 
+    RecreateGeometry(pDataSource, m_Params, pScheduler);
+}
+
+void EarthHemsiphere::RecreateGeometry(class ElevationDataSource* pDataSource,
+                                       const RenderingParams&     Params,
+                                       TaskScheduler*             pScheduler)
+{
+    m_Params.m_iRingDimension = Params.m_iRingDimension;
+    m_Params.m_iNumRings      = Params.m_iNumRings;
+
+    m_SphereMeshes.clear();
+    m_pVertBuff.Release();
+
+    m_GeometryStats            = {};
+    m_GeometryStats.NumThreads = pScheduler != nullptr ? pScheduler->GetNumThreads() : 1;
+
+    Timer TotalTimer;
+
     std::vector<HemisphereVertex> VB;
-    GenerateSphereGeometry(pDevice, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, VB, m_SphereMeshes);
+    GenerateSphereGeometry(m_pDevice, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, VB, m_SphereMeshes, pScheduler, m_GeometryStats);
+
+    Timer BufferTimer;
 
     BufferDesc VBDesc;
     VBDesc.Name      = "Hemisphere vertex buffer";
@@ -736,8 +970,31 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     BufferData VBInitData;
     VBInitData.pData    = VB.data();
     VBInitData.DataSize = VBDesc.Size;
-    pDevice->CreateBuffer(VBDesc, &VBInitData, &m_pVertBuff);
+    m_pDevice->CreateBuffer(VBDesc, &VBInitData, &m_pVertBuff);
     VERIFY(m_pVertBuff, "Failed to create VB");
+
+    m_GeometryStats.BuffersTime += BufferTimer.GetElapsedTime();
+    m_GeometryStats.TotalTime = TotalTimer.GetElapsedTime();
+}
+
+void EarthHemsiphere::UpdateCDLODTerrain(IDeviceContext*        pContext,
+                                         const RenderingParams& Params,
+                                         const float3&          vCameraPosition,
+                                         const float4x4&        CameraViewProjMatrix,
+                                         float                  fProjScale,
+                                         TaskScheduler*         pScheduler)
+{
+    ViewFrustumExt ViewFrustum;
+    auto           DevType = m_pDevice->GetDeviceInfo().Type;
+    ExtractViewFrustumPlanesFromMatrix(CameraViewProjMatrix, ViewFrustum, DevType == RENDER_DEVICE_TYPE_D3D11 || DevType == RENDER_DEVICE_TYPE_D3D12);
+
+    CDLODTerrain::UpdateAttribs Attribs;
+    Attribs.f3CameraPos     = vCameraPosition;
+    Attribs.pViewFrustum    = &ViewFrustum;
+    Attribs.fProjScale      = fProjScale;
+    Attribs.fTargetQuadSize = Params.m_fCDLODTargetQuadSize;
+    Attribs.pScheduler      = pScheduler;
+    m_pCDLODTerrain->Update(pContext, Attribs);
 }
 
 void EarthHemsiphere::Render(IDeviceContext*        pContext,
@@ -757,6 +1014,8 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
     {
         m_pHemispherePSO.Release();
         m_pHemisphereSRB.Release();
+        m_pCDLODPSO.Release();
+        m_pCDLODSRB.Release();
     }
 
     m_Params = NewParams;
@@ -795,11 +1054,15 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
             GraphicsPipelineCI.GraphicsPipeline.RTVFormats[0]    = m_Params.DstRTVFormat;
             GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets = 1;
         });
-        m_pRSNLoader->LoadPipelineState({"RenderHemisphere", PIPELINE_TYPE_GRAPHICS, false, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemispherePSO);
-
-        m_pHemispherePSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
-        m_pHemispherePSO->CreateShaderResourceBinding(&m_pHemisphereSRB, true);
-        m_pHemisphereSRB->BindResources(SHADER_TYPE_VERTEX, m_pResMapping, BIND_SHADER_RESOURCES_KEEP_EXISTING);
+        auto LoadPipeline = [&](const char* Name, RefCntAutoPtr<IPipelineState>& pPSO, RefCntAutoPtr<IShaderResourceBinding>& pSRB) {
+            m_pRSNLoader->LoadPipelineState({Name, PIPELINE_TYPE_GRAPHICS, false, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &pPSO);
+
+            pPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+            pPSO->CreateShaderResourceBinding(&pSRB, true);
+            pSRB->BindResources(SHADER_TYPE_VERTEX, m_pResMapping, BIND_SHADER_RESOURCES_KEEP_EXISTING);
+        };
+        LoadPipeline("RenderHemisphere", m_pHemispherePSO, m_pHemisphereSRB);
+        LoadPipeline("RenderCDLODHemisphere", m_pCDLODPSO, m_pCDLODSRB);
     }
 
     ViewFrustumExt ViewFrustum;
@@ -833,29 +1096,39 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
 	pd3dImmediateContext->PSSetSamplers(0, _countof(pSamplers), pSamplers);
 #endif
 
-    IBuffer* ppBuffers[1] = {m_pVertBuff};
-    pContext->SetVertexBuffers(0, 1, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+    const bool bCDLOD = m_Params.m_bCDLODTerrain;
 
+    IShaderResourceBinding* pSRB = nullptr;
     if (bZOnlyPass)
     {
-        pContext->SetPipelineState(m_pHemisphereZOnlyPSO);
-        pContext->CommitShaderResources(m_pHemisphereZOnlySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pContext->SetPipelineState(bCDLOD ? m_pCDLODZOnlyPSO : m_pHemisphereZOnlyPSO);
+        pSRB = bCDLOD ? m_pCDLODZOnlySRB : m_pHemisphereZOnlySRB;
     }
     else
     {
         pShadowMapSRV->SetSampler(m_pComparisonSampler);
-        pContext->SetPipelineState(m_pHemispherePSO);
+        pContext->SetPipelineState(bCDLOD ? m_pCDLODPSO : m_pHemispherePSO);
+        pSRB = bCDLOD ? m_pCDLODSRB : m_pHemisphereSRB;
 
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DOccludedNetDensityToAtmTop")->Set(pPrecomputedNetDensitySRV);
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DAmbientSkylight")->Set(pAmbientSkylightSRV);
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DShadowMap")->Set(pShadowMapSRV);
+        pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DOccludedNetDensityToAtmTop")->Set(pPrecomputedNetDensitySRV);
+        pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DAmbientSkylight")->Set(pAmbientSkylightSRV);
+        pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DShadowMap")->Set(pShadowMapSRV);
+    }
+    pContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        pContext->CommitShaderResources(m_pHemisphereSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    const auto PlaneFlags = bZOnlyPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM;
+    if (bCDLOD)
+    {
+        m_pCDLODTerrain->Draw(pContext, ViewFrustum, PlaneFlags, !bZOnlyPass);
+        return;
     }
 
+    IBuffer* ppBuffers[1] = {m_pVertBuff};
+    pContext->SetVertexBuffers(0, 1, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+
     for (auto MeshIt = m_SphereMeshes.begin(); MeshIt != m_SphereMeshes.end(); ++MeshIt)
     {
-        if (GetBoxVisibility(ViewFrustum, MeshIt->BndBox, bZOnlyPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) != BoxVisibility::Invisible)
+        if (GetBoxVisibility(ViewFrustum, MeshIt->BndBox, PlaneFlags) != BoxVisibility::Invisible)
         {
             pContext->SetIndexBuffer(MeshIt->pIndBuff, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
             DrawIndexedAttribs DrawAttrs(MeshIt->uiNumIndices, VT_UINT32, DRAW_FLAG_VERIFY_ALL);
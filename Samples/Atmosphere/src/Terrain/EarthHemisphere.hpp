@@ -46,6 +46,7 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 
 #include "RenderDevice.h"
 #include "DeviceContext.h"
@@ -58,6 +59,8 @@
 #include "RenderStateNotationLoader.h"
 
 #include "AdvancedMath.hpp"
+#include "TaskScheduler.hpp"
+#include "CDLODTerrain.hpp"
 
 namespace Diligent
 {
@@ -82,6 +85,11 @@ struct RenderingParams
     int            m_iRingDimension = 65;
     int            m_iNumRings      = 15;
 
+    // Render the terrain with the continuous distance-dependent LOD quadtree (see CDLODTerrain)
+    // instead of the ring meshes
+    bool  m_bCDLODTerrain        = false;
+    float m_fCDLODTargetQuadSize = 12.f; // Target screen size of a terrain quad, in pixels
+
     int            m_iNumShadowCascades         = 6;
     int            m_bBestCascadeSearch         = 1;
     int            m_FixedShadowFilterSize      = 5;
@@ -125,7 +133,7 @@ public:
                 ITextureView*          pAmbientSkylightSRV,
                 bool                   bZOnlyPass);
 
-    // Creates device resources
+    // Creates device resources. If pScheduler is not null, the ring meshes are generated in parallel.
     void Create(class ElevationDataSource* pDataSource,
                 const RenderingParams&     Params,
                 IRenderDevice*             pDevice,
@@ -135,7 +143,39 @@ public:
                 const char*                TileNormalMapPath[],
                 IBuffer*                   pcbCameraAttribs,
                 IBuffer*                   pcbLightAttribs,
-                IBuffer*                   pcMediaScatteringParams);
+                IBuffer*                   pcMediaScatteringParams,
+                TaskScheduler*             pScheduler = nullptr);
+
+    // Selects the CDLOD terrain patches for the camera and streams their vertices. Must be called once
+    // per frame before the terrain is rendered if Params.m_bCDLODTerrain is set. fProjScale is the
+    // screen height multiplied by the vertical scale of the camera projection and divided by 2.
+    void UpdateCDLODTerrain(IDeviceContext*        pContext,
+                            const RenderingParams& Params,
+                            const float3&          vCameraPosition,
+                            const float4x4&        CameraViewProjMatrix,
+                            float                  fProjScale,
+                            TaskScheduler*         pScheduler = nullptr);
+
+    const CDLODTerrain::Statistics& GetCDLODStats() const { return m_pCDLODTerrain->GetStats(); }
+
+    // Recreates the ring meshes using the ring dimension and the number of rings from Params
+    void RecreateGeometry(class ElevationDataSource* pDataSource,
+                          const RenderingParams&     Params,
+                          TaskScheduler*             pScheduler = nullptr);
+
+    // Time spent on the last ring mesh generation, in seconds
+    struct GeometryStats
+    {
+        double VerticesTime = 0;
+        double IndicesTime  = 0;
+        double BuffersTime  = 0;
+        double TotalTime    = 0;
+
+        Uint32 NumVertices = 0;
+        Uint32 NumIndices  = 0;
+        Uint32 NumThreads  = 0;
+    };
+    const GeometryStats& GetGeometryStats() const { return m_GeometryStats; }
 
     enum
     {
@@ -143,12 +183,10 @@ public:
     }; // One base material + 4 masked materials
 
 private:
-    void RenderNormalMap(IRenderDevice*  pd3dDevice,
-                         IDeviceContext* pd3dImmediateContext,
-                         const Uint16*   pHeightMap,
-                         size_t          HeightMapPitch,
-                         int             HeightMapDim,
-                         ITexture*       ptex2DNormalMap);
+    void RenderNormalMap(IRenderDevice*                   pd3dDevice,
+                         IDeviceContext*                  pd3dImmediateContext,
+                         const class ElevationDataSource* pDataSource,
+                         ITexture*                        ptex2DNormalMap);
 
     RenderingParams m_Params;
 
@@ -169,10 +207,17 @@ private:
     RefCntAutoPtr<IShaderResourceBinding> m_pHemisphereZOnlySRB;
     RefCntAutoPtr<IPipelineState>         m_pHemispherePSO;
     RefCntAutoPtr<IShaderResourceBinding> m_pHemisphereSRB;
+    RefCntAutoPtr<IPipelineState>         m_pCDLODZOnlyPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pCDLODZOnlySRB;
+    RefCntAutoPtr<IPipelineState>         m_pCDLODPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pCDLODSRB;
     RefCntAutoPtr<ISampler>               m_pComparisonSampler;
 
     std::vector<RingSectorMesh> m_SphereMeshes;
 
+    std::unique_ptr<CDLODTerrain> m_pCDLODTerrain;
+    GeometryStats               m_GeometryStats;
+
     Uint32 m_ValidShaders;
 };
 
@@ -45,108 +45,884 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+
+#include "SIMDSupport.hpp"
 
 #include "ElevationDataSource.hpp"
 #include "FileWrapper.hpp"
-#include "DataBlobImpl.hpp"
+#include "FileSystem.hpp"
 #include "Image.h"
-#include "BasicFileStream.hpp"
 #include "TextureUtilities.h"
 #include "GraphicsAccessories.hpp"
+#include "StringTools.hpp"
+#include "Align.hpp"
+#include "Timer.hpp"
+#include "TaskScheduler.hpp"
+
+// Tiles are mapped into memory on the platforms where the files are accessed directly.
+// On other platforms, they are read from the file.
+#if PLATFORM_WIN32
+#    include "WinHPreface.h"
+#    include <Windows.h>
+#    include "WinHPostface.h"
+#elif PLATFORM_LINUX
+#    include <sys/mman.h>
+#    include <sys/types.h>
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
 
 namespace Diligent
 {
 
-// Creates data source from the specified raw data file
-ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
-    m_iNumLevels(0),
-    m_iPatchSize(128),
-    m_iColOffset(0),
-    m_iRowOffset(0)
+namespace
+{
+
+constexpr char TiledFileExtension[] = ".tiles";
+
+// Tile data offsets are aligned to the allocation granularity of the file mapping on all supported platforms
+constexpr Uint32 TileDataAlignment = 65536;
+
+// Tiled elevation file layout:
+//   - Header
+//   - Tile table: TileInfo for every tile of every stored level. The average pyramid (levels 0 to NumLevels-1)
+//     is followed by the min and max pyramids (levels 1 to NumLevels-1). Levels of a pyramid go from the finest
+//     to the coarsest, and the tiles of a level are stored row by row.
+//   - Tile data: TileSize x TileSize 16-bit samples of every tile, starting at TileInfo::DataOffset.
+//     Tiles at the right and bottom edges of a level are padded by repeating the last column and row.
+struct TiledFileHeader
+{
+    static constexpr Uint32 MagicNumber    = 0x4C455444; // DTEL
+    static constexpr Uint32 CurrentVersion = 2;
+
+    Uint32 Magic   = 0;
+    Uint32 Version = 0;
+    // The size of the file that the tiled file was converted from, used to detect outdated tiled files
+    Uint64 SourceFileSize = 0;
+
+    // Dimensions of the finest level
+    Uint32 NumCols           = 0;
+    Uint32 NumRows           = 0;
+    Uint32 TileSize          = 0;
+    Uint32 NumLevels         = 0;
+    Uint32 TileDataAlignment = 0;
+    Uint16 MinElevation      = 0;
+    Uint16 MaxElevation      = 0;
+};
+static_assert(sizeof(TiledFileHeader) == 40, "Tiled file header must not have implicit padding");
+
+struct TileInfo
+{
+    Uint64 DataOffset   = 0;
+    Uint16 MinElevation = 0;
+    Uint16 MaxElevation = 0;
+    Uint32 Padding      = 0;
+};
+static_assert(sizeof(TileInfo) == 16, "Tile info must not have implicit padding");
+
+Uint32 GetLevelDim(Uint32 Dim, Uint32 Level)
+{
+    return std::max(Dim >> Level, 1u);
+}
+
+Uint32 GetNumTiles(Uint32 Dim, Uint32 TileSize)
 {
+    return (Dim + TileSize - 1) / TileSize;
+}
+
+size_t GetTileDataSize(Uint32 TileSize)
+{
+    return size_t{TileSize} * size_t{TileSize} * sizeof(Uint16);
+}
 
-#if 1
+using PYRAMID_TYPE = ElevationDataSource::PYRAMID_TYPE;
+
+// Calls the handler for every level of every pyramid in the order the levels are stored in the tiled file
+template <typename HandlerType>
+void ForEachStoredLevel(Uint32 NumLevels, HandlerType Handler)
+{
+    for (Uint32 Pyramid = 0; Pyramid < ElevationDataSource::PYRAMID_TYPE_COUNT; ++Pyramid)
+    {
+        // Level 0 of the min and max pyramids would only repeat the heights
+        const Uint32 FirstLevel = Pyramid == ElevationDataSource::PYRAMID_TYPE_AVERAGE ? 0 : 1;
+        for (Uint32 Level = FirstLevel; Level < NumLevels; ++Level)
+            Handler(static_cast<PYRAMID_TYPE>(Pyramid), Level);
+    }
+}
+
+Uint32 ComputeTotalNumTiles(const TiledFileHeader& Header)
+{
+    Uint32 NumTiles = 0;
+    ForEachStoredLevel(Header.NumLevels, [&](PYRAMID_TYPE, Uint32 Level) {
+        NumTiles += GetNumTiles(GetLevelDim(Header.NumCols, Level), Header.TileSize) *
+            GetNumTiles(GetLevelDim(Header.NumRows, Level), Header.TileSize);
+    });
+    return NumTiles;
+}
+
+bool HasExtension(const std::string& Path, const Char* Extension)
+{
+    const auto ExtLen = strlen(Extension);
+    return Path.size() >= ExtLen && StrCmpNoCase(Path.c_str() + Path.size() - ExtLen, Extension) == 0;
+}
+
+// Loads the source height map and pads it to the minimal size in the form (2^n+1) x (2^n+1)
+// by duplicating the last row and column
+std::vector<Uint16> LoadSourceHeightMap(const Char* strSrcDemFile, Uint32& NumCols, Uint32& NumRows, Uint64& SourceFileSize)
+{
+    Uint32 SrcWidth  = 0;
+    Uint32 SrcHeight = 0;
+    size_t SrcStride = 0;
+
+    std::vector<Uint16>  RawData;
     RefCntAutoPtr<Image> pHeightMap;
-    CreateImageFromFile(strSrcDemFile, &pHeightMap);
+    const Uint16*        pSrcData = nullptr;
+    {
+        FileWrapper pFile{strSrcDemFile};
+        if (!pFile)
+            LOG_ERROR_AND_THROW("Failed to open elevation data file '", strSrcDemFile, "'.");
+        SourceFileSize = pFile->GetSize();
+
+        const std::string SrcPath{strSrcDemFile};
+        if (HasExtension(SrcPath, ".raw") || HasExtension(SrcPath, ".r16"))
+        {
+            // Raw height maps are square arrays of 16-bit samples
+            RawData.resize(static_cast<size_t>(SourceFileSize / sizeof(Uint16)));
+            if (RawData.empty() || !pFile->Read(RawData.data(), RawData.size() * sizeof(Uint16)))
+                LOG_ERROR_AND_THROW("Failed to read elevation data file '", strSrcDemFile, "'.");
+
+            SrcWidth = static_cast<Uint32>(std::sqrt(static_cast<double>(RawData.size())) + 0.5);
+            if (size_t{SrcWidth} * size_t{SrcWidth} != RawData.size())
+                LOG_ERROR_AND_THROW("Raw elevation data file '", strSrcDemFile, "' does not contain a square height map.");
+
+            SrcHeight = SrcWidth;
+            SrcStride = SrcWidth;
+            pSrcData  = RawData.data();
+        }
+    }
+
+    if (pSrcData == nullptr)
+    {
+        CreateImageFromFile(strSrcDemFile, &pHeightMap);
+        if (!pHeightMap)
+            LOG_ERROR_AND_THROW("Failed to load elevation data from '", strSrcDemFile, "'.");
+
+        const auto& ImgInfo = pHeightMap->GetDesc();
+        if (ImgInfo.ComponentType != VT_UINT16 || ImgInfo.NumComponents != 1)
+            LOG_ERROR_AND_THROW("'", strSrcDemFile, "' is not a 16-bit single-channel image.");
+
+        SrcWidth  = ImgInfo.Width;
+        SrcHeight = ImgInfo.Height;
+        SrcStride = ImgInfo.RowStride / sizeof(Uint16);
+        pSrcData  = reinterpret_cast<const Uint16*>(pHeightMap->GetData()->GetConstDataPtr());
+    }
 
-    const auto& ImgInfo    = pHeightMap->GetDesc();
-    auto*       pImageData = pHeightMap->GetData();
     // Calculate minimal number of columns and rows
     // in the form 2^n+1 that encompass the data
-    m_iNumCols = 1;
-    m_iNumRows = 1;
-    while (m_iNumCols + 1 < ImgInfo.Width || m_iNumRows + 1 < ImgInfo.Height)
+    NumCols = 1;
+    NumRows = 1;
+    while (NumCols + 1 < SrcWidth || NumRows + 1 < SrcHeight)
+    {
+        NumCols *= 2;
+        NumRows *= 2;
+    }
+    NumCols++;
+    NumRows++;
+
+    std::vector<Uint16> HeightMap(size_t{NumCols} * size_t{NumRows});
+    for (size_t Row = 0; Row < NumRows; ++Row)
+    {
+        // Duplicate the last row and column
+        const Uint16* pSrcRow = pSrcData + std::min(Row, size_t{SrcHeight} - 1) * SrcStride;
+        Uint16*       pDstRow = &HeightMap[Row * NumCols];
+        memcpy(pDstRow, pSrcRow, size_t{SrcWidth} * sizeof(Uint16));
+        std::fill(pDstRow + SrcWidth, pDstRow + NumCols, pSrcRow[SrcWidth - 1]);
+    }
+
+    return HeightMap;
+}
+
+struct MinOp
+{
+    static Uint16 Apply(Uint16 a, Uint16 b) { return std::min(a, b); }
+#if SAMPLES_USE_SSE2
+    // Operates on the values biased to the signed range
+    static __m128i Apply(__m128i a, __m128i b) { return _mm_min_epi16(a, b); }
+#elif SAMPLES_USE_NEON
+    static uint16x4_t Apply(uint16x4_t a, uint16x4_t b) { return vmin_u16(a, b); }
+    static uint16x4_t ApplyPairwise(uint16x8_t v) { return vpmin_u16(vget_low_u16(v), vget_high_u16(v)); }
+#endif
+};
+
+struct MaxOp
+{
+    static Uint16 Apply(Uint16 a, Uint16 b) { return std::max(a, b); }
+#if SAMPLES_USE_SSE2
+    static __m128i Apply(__m128i a, __m128i b) { return _mm_max_epi16(a, b); }
+#elif SAMPLES_USE_NEON
+    static uint16x4_t Apply(uint16x4_t a, uint16x4_t b) { return vmax_u16(a, b); }
+    static uint16x4_t ApplyPairwise(uint16x8_t v) { return vpmax_u16(vget_low_u16(v), vget_high_u16(v)); }
+#endif
+};
+
+// Computes a row of the coarser level of the average pyramid from two rows of the finer level.
+// Every sample is the average of the 2x2 block of the finer level samples, and the last column
+// of the finer level is repeated at the right edge.
+void DownsampleAverageRow(const Uint16* pSrcRow0, const Uint16* pSrcRow1, Uint32 SrcCols, Uint16* pDstRow, Uint32 DstCols)
+{
+    Uint32 Col = 0;
+    // Every iteration reads 8 samples from every source row and computes 4 samples
+#if SAMPLES_USE_SSE2
+    const __m128i LowMask = _mm_set1_epi32(0xFFFF);
+    const __m128i Bias32  = _mm_set1_epi32(0x8000);
+    const __m128i Bias16  = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; Col + 4 <= DstCols && Col * 2 + 8 <= SrcCols; Col += 4)
+    {
+        const __m128i Row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrcRow0 + Col * 2));
+        const __m128i Row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrcRow1 + Col * 2));
+
+        // Sums of the horizontal pairs in 32-bit lanes
+        const __m128i Sum0 = _mm_add_epi32(_mm_and_si128(Row0, LowMask), _mm_srli_epi32(Row0, 16));
+        const __m128i Sum1 = _mm_add_epi32(_mm_and_si128(Row1, LowMask), _mm_srli_epi32(Row1, 16));
+
+        // SSE2 only has the signed saturating pack, so the averages are biased to the signed range and back
+        __m128i Avg = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(Sum0, Sum1), 2), Bias32);
+        Avg         = _mm_xor_si128(_mm_packs_epi32(Avg, Avg), Bias16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDstRow + Col), Avg);
+    }
+#elif SAMPLES_USE_NEON
+    for (; Col + 4 <= DstCols && Col * 2 + 8 <= SrcCols; Col += 4)
+    {
+        const uint32x4_t Sum = vaddq_u32(vpaddlq_u16(vld1q_u16(pSrcRow0 + Col * 2)), vpaddlq_u16(vld1q_u16(pSrcRow1 + Col * 2)));
+        vst1_u16(pDstRow + Col, vshrn_n_u32(Sum, 2));
+    }
+#endif
+    for (; Col < DstCols; ++Col)
+    {
+        const Uint32 Col0 = std::min(Col * 2, SrcCols - 1);
+        const Uint32 Col1 = std::min(Col * 2 + 1, SrcCols - 1);
+        pDstRow[Col]      = static_cast<Uint16>((Uint32{pSrcRow0[Col0]} + pSrcRow0[Col1] + pSrcRow1[Col0] + pSrcRow1[Col1]) >> 2);
+    }
+}
+
+// Computes a row of the coarser level of the min or max pyramid from NumTaps (2 or 3) rows of the finer level.
+// Every sample is the minimum or maximum of the NumTaps x NumTaps block of the finer level samples.
+template <typename OpType>
+void DownsampleRangeRow(const Uint16* const* ppSrcRows, Uint32 NumTaps, Uint32 SrcCols, Uint16* pDstRow, Uint32 DstCols)
+{
+    VERIFY_EXPR(NumTaps == 2 || NumTaps == 3);
+
+    Uint32 Col = 0;
+    // Every iteration reads 8 samples starting at Col * 2 from every source row, plus 8 samples starting
+    // at Col * 2 + 2 for three taps, and computes 4 samples
+#if SAMPLES_USE_SSE2
+    // Unsigned values are biased so that they can be compared with the signed 16-bit instructions
+    const __m128i Bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    const auto ReduceRow = [&](const Uint16* pSrc) {
+        const __m128i Src = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)), Bias16);
+        // The low 16 bits of every 32-bit lane contain the result for the horizontal pair
+        __m128i Res = OpType::Apply(Src, _mm_srli_epi32(Src, 16));
+        if (NumTaps == 3)
+            Res = OpType::Apply(Res, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2)), Bias16));
+        return Res;
+    };
+
+    for (; Col + 4 <= DstCols && Col * 2 + 4 + NumTaps * 2 <= SrcCols; Col += 4)
+    {
+        __m128i Res = ReduceRow(ppSrcRows[0] + Col * 2);
+        for (Uint32 Tap = 1; Tap < NumTaps; ++Tap)
+            Res = OpType::Apply(Res, ReduceRow(ppSrcRows[Tap] + Col * 2));
+
+        // Sign-extend the low 16 bits of the 32-bit lanes and pack them
+        Res = _mm_srai_epi32(_mm_slli_epi32(Res, 16), 16);
+        Res = _mm_xor_si128(_mm_packs_epi32(Res, Res), Bias16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDstRow + Col), Res);
+    }
+#elif SAMPLES_USE_NEON
+    const auto ReduceRow = [&](const Uint16* pSrc) {
+        uint16x4_t Res = OpType::ApplyPairwise(vld1q_u16(pSrc));
+        // Narrowing the 32-bit lanes keeps the even samples
+        if (NumTaps == 3)
+            Res = OpType::Apply(Res, vmovn_u32(vreinterpretq_u32_u16(vld1q_u16(pSrc + 2))));
+        return Res;
+    };
+
+    for (; Col + 4 <= DstCols && Col * 2 + 4 + NumTaps * 2 <= SrcCols; Col += 4)
+    {
+        uint16x4_t Res = ReduceRow(ppSrcRows[0] + Col * 2);
+        for (Uint32 Tap = 1; Tap < NumTaps; ++Tap)
+            Res = OpType::Apply(Res, ReduceRow(ppSrcRows[Tap] + Col * 2));
+        vst1_u16(pDstRow + Col, Res);
+    }
+#endif
+    for (; Col < DstCols; ++Col)
     {
-        m_iNumCols *= 2;
-        m_iNumRows *= 2;
+        Uint16 Res = ppSrcRows[0][Col * 2];
+        for (Uint32 Tap = 0; Tap < NumTaps; ++Tap)
+        {
+            for (Uint32 i = 0; i < NumTaps; ++i)
+                Res = OpType::Apply(Res, ppSrcRows[Tap][std::min(Col * 2 + i, SrcCols - 1)]);
+        }
+        pDstRow[Col] = Res;
     }
+}
+
+// Blends the four corner samples of every point with the bilinear weights. Corner samples
+// of a point are stored together in the order H00, H10, H01, H11.
+void BlendBilinearSamples(const Uint16* pSamples, const float2* pWeights, float* pHeights, size_t NumPoints)
+{
+    size_t s = 0;
+    // Every iteration reads 16 corner samples and computes 4 heights
+#if SAMPLES_USE_SSE2
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128  One  = _mm_set1_ps(1.f);
+    for (; s + 4 <= NumPoints; s += 4)
+    {
+        const __m128i Src0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSamples + s * 4));
+        const __m128i Src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSamples + s * 4 + 8));
 
-    m_iNumLevels = 1;
-    while ((m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumCols ||
-           (m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumRows)
-        m_iNumLevels++;
+        // Every vector contains the corners of one point, the transpose gathers every corner of the four points
+        __m128 H00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(Src0, Zero));
+        __m128 H10 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(Src0, Zero));
+        __m128 H01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(Src1, Zero));
+        __m128 H11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(Src1, Zero));
+        _MM_TRANSPOSE4_PS(H00, H10, H01, H11);
 
-    m_iNumCols++;
-    m_iNumRows++;
-    m_iStride = (m_iNumCols + 1) & (-2);
+        const __m128 W0  = _mm_loadu_ps(&pWeights[s].x);
+        const __m128 W1  = _mm_loadu_ps(&pWeights[s + 2].x);
+        const __m128 HW  = _mm_shuffle_ps(W0, W1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 VW  = _mm_shuffle_ps(W0, W1, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m128 HW1 = _mm_sub_ps(One, HW);
 
-    // Load the data
-    m_TheHeightMap.resize(size_t{m_iStride} * size_t{m_iNumRows});
+        const __m128 Row0 = _mm_add_ps(_mm_mul_ps(H00, HW1), _mm_mul_ps(H10, HW));
+        const __m128 Row1 = _mm_add_ps(_mm_mul_ps(H01, HW1), _mm_mul_ps(H11, HW));
+        _mm_storeu_ps(pHeights + s, _mm_add_ps(_mm_mul_ps(Row0, _mm_sub_ps(One, VW)), _mm_mul_ps(Row1, VW)));
+    }
+#elif SAMPLES_USE_NEON
+    const float32x4_t One = vdupq_n_f32(1.f);
+    for (; s + 4 <= NumPoints; s += 4)
+    {
+        // The structure load deinterleaves the corners of the four points
+        const uint16x4x4_t Src = vld4_u16(pSamples + s * 4);
+        const float32x4_t  H00 = vcvtq_f32_u32(vmovl_u16(Src.val[0]));
+        const float32x4_t  H10 = vcvtq_f32_u32(vmovl_u16(Src.val[1]));
+        const float32x4_t  H01 = vcvtq_f32_u32(vmovl_u16(Src.val[2]));
+        const float32x4_t  H11 = vcvtq_f32_u32(vmovl_u16(Src.val[3]));
 
-    VERIFY(ImgInfo.ComponentType == VT_UINT16 && ImgInfo.NumComponents == 1, "Unexpected scanline size: 16-bit single-channel image is expected");
-    auto* pSrcImgData = reinterpret_cast<Uint8*>(pImageData->GetDataPtr());
-    for (size_t row = 0; row < ImgInfo.Height; row++, pSrcImgData += ImgInfo.RowStride)
+        const float32x4x2_t W   = vld2q_f32(&pWeights[s].x);
+        const float32x4_t   HW1 = vsubq_f32(One, W.val[0]);
+
+        const float32x4_t Row0 = vaddq_f32(vmulq_f32(H00, HW1), vmulq_f32(H10, W.val[0]));
+        const float32x4_t Row1 = vaddq_f32(vmulq_f32(H01, HW1), vmulq_f32(H11, W.val[0]));
+        vst1q_f32(pHeights + s, vaddq_f32(vmulq_f32(Row0, vsubq_f32(One, W.val[1])), vmulq_f32(Row1, W.val[1])));
+    }
+#endif
+    for (; s < NumPoints; ++s)
     {
-        memcpy(&m_TheHeightMap[row * m_iStride], pSrcImgData, size_t{ImgInfo.Width} * size_t{GetValueSize(ImgInfo.ComponentType)});
+        Uint16 H00 = pSamples[s * 4 + 0];
+        Uint16 H10 = pSamples[s * 4 + 1];
+        Uint16 H01 = pSamples[s * 4 + 2];
+        Uint16 H11 = pSamples[s * 4 + 3];
+
+        const float fHWeight = pWeights[s].x;
+        const float fVWeight = pWeights[s].y;
+
+        pHeights[s] = (H00 * (1 - fHWeight) + H10 * fHWeight) * (1 - fVWeight) +
+            (H01 * (1 - fHWeight) + H11 * fHWeight) * fVWeight;
     }
+}
 
-    // Duplicate the last row and column
-    for (Uint32 iRow = 0; iRow < ImgInfo.Height; iRow++)
-        for (Uint32 iCol = ImgInfo.Width; iCol < m_iNumCols; iCol++)
-            GetElevSample(iCol, iRow) = GetElevSample((ImgInfo.Width - 1), iRow);
+using ElevationPyramids = std::array<std::vector<std::vector<Uint16>>, ElevationDataSource::PYRAMID_TYPE_COUNT>;
 
-    for (Uint32 iCol = 0; iCol < m_iNumCols; iCol++)
-        for (Uint32 iRow = ImgInfo.Height; iRow < m_iNumRows; iRow++)
-            GetElevSample(iCol, iRow) = GetElevSample(iCol, ImgInfo.Height - 1);
+// Builds the average, min and max pyramids of the height map. Levels are computed one after another,
+// and the rows of a level are computed in parallel.
+void BuildElevationPyramids(std::vector<Uint16> HeightMap,
+                            Uint32              NumCols,
+                            Uint32              NumRows,
+                            Uint32              NumLevels,
+                            TaskScheduler*      pScheduler,
+                            ElevationPyramids&  Pyramids)
+{
+    // Minimal number of samples computed by one task
+    constexpr Uint32 MinSamplesPerTask = 16384;
 
-#else
-    m_iStride  = 2048;
-    m_iNumRows = m_iNumCols = 2048;
-    m_iNumLevels            = 5;
-    m_TheHeightMap.resize(m_iStride * m_iNumRows);
-    for (Uint32 j = 0; j < m_iNumRows; ++j)
+    auto& Heights = Pyramids[ElevationDataSource::PYRAMID_TYPE_AVERAGE];
+    auto& Mins    = Pyramids[ElevationDataSource::PYRAMID_TYPE_MIN];
+    auto& Maxs    = Pyramids[ElevationDataSource::PYRAMID_TYPE_MAX];
+    for (auto& Levels : Pyramids)
+        Levels.resize(NumLevels);
+    Heights[0] = std::move(HeightMap);
+
+    for (Uint32 Level = 1; Level < NumLevels; ++Level)
     {
-        for (Uint32 i = 0; i < m_iNumCols; ++i)
+        const Uint32 FinerCols = GetLevelDim(NumCols, Level - 1);
+        const Uint32 FinerRows = GetLevelDim(NumRows, Level - 1);
+        const Uint32 LevelCols = GetLevelDim(NumCols, Level);
+        const Uint32 LevelRows = GetLevelDim(NumRows, Level);
+        for (auto& Levels : Pyramids)
+            Levels[Level].resize(size_t{LevelCols} * size_t{LevelRows});
+
+        // Samples of level 1 of the min and max pyramids cover 3x3 samples of the height map, which
+        // includes the samples shared with the neighbors. Every sample of a coarser level then covers
+        // 2x2 samples of the finer level, whose regions already include the shared samples.
+        const auto&  FinerMins = Level == 1 ? Heights[0] : Mins[Level - 1];
+        const auto&  FinerMaxs = Level == 1 ? Heights[0] : Maxs[Level - 1];
+        const Uint32 NumTaps   = Level == 1 ? 3 : 2;
+
+        ParallelFor(pScheduler, 0, LevelRows, std::max(MinSamplesPerTask / LevelCols, 1u),
+                    [&](Uint32 ThreadId, Uint32 StartRow, Uint32 EndRow) {
+                        for (Uint32 Row = StartRow; Row < EndRow; ++Row)
+                        {
+                            // Offsets of the finer level rows, repeating the last row at the bottom edge
+                            size_t FinerRowOffsets[3];
+                            for (Uint32 i = 0; i < 3; ++i)
+                                FinerRowOffsets[i] = size_t{std::min(Row * 2 + i, FinerRows - 1)} * FinerCols;
+
+                            const size_t DstOffset = size_t{Row} * LevelCols;
+                            DownsampleAverageRow(&Heights[Level - 1][FinerRowOffsets[0]], &Heights[Level - 1][FinerRowOffsets[1]], FinerCols,
+                                                 &Heights[Level][DstOffset], LevelCols);
+
+                            const Uint16* pMinRows[] = {&FinerMins[FinerRowOffsets[0]], &FinerMins[FinerRowOffsets[1]], &FinerMins[FinerRowOffsets[2]]};
+                            const Uint16* pMaxRows[] = {&FinerMaxs[FinerRowOffsets[0]], &FinerMaxs[FinerRowOffsets[1]], &FinerMaxs[FinerRowOffsets[2]]};
+                            DownsampleRangeRow<MinOp>(pMinRows, NumTaps, FinerCols, &Mins[Level][DstOffset], LevelCols);
+                            DownsampleRangeRow<MaxOp>(pMaxRows, NumTaps, FinerCols, &Maxs[Level][DstOffset], LevelCols);
+                        }
+                    });
+    }
+}
+
+// Builds the pyramids of the height map and writes the tiled data through the Write function
+void WriteTiledElevationData(std::vector<Uint16>                             HeightMap,
+                             Uint32                                          NumCols,
+                             Uint32                                          NumRows,
+                             Uint32                                          TileSize,
+                             Uint64                                          SourceFileSize,
+                             TaskScheduler*                                  pScheduler,
+                             const std::function<void(const void*, size_t)>& Write)
+{
+    TiledFileHeader Header;
+    Header.Magic             = TiledFileHeader::MagicNumber;
+    Header.Version           = TiledFileHeader::CurrentVersion;
+    Header.SourceFileSize    = SourceFileSize;
+    Header.NumCols           = NumCols;
+    Header.NumRows           = NumRows;
+    Header.TileSize          = TileSize;
+    Header.NumLevels         = ComputeMipLevelsCount(NumCols, NumRows);
+    Header.TileDataAlignment = TileDataAlignment;
+
+    ElevationPyramids Pyramids;
+    {
+        Timer PyramidTimer;
+        BuildElevationPyramids(std::move(HeightMap), NumCols, NumRows, Header.NumLevels, pScheduler, Pyramids);
+        LOG_INFO_MESSAGE("Built elevation pyramids of ", NumCols, "x", NumRows, " height map in ",
+                         static_cast<int>(PyramidTimer.GetElapsedTime() * 1000), " ms using ",
+                         pScheduler != nullptr ? pScheduler->GetNumThreads() : 1u, " thread(s)");
+    }
+
+    // Copies the tile from the level, repeating the last column and row at the edges
+    const auto CopyTile = [TileSize](const std::vector<Uint16>& LevelData, Uint32 LevelCols, Uint32 LevelRows, Uint32 TileX, Uint32 TileY, Uint16* pDst) {
+        for (Uint32 y = 0; y < TileSize; ++y)
         {
-            float x = (float)i / (float)m_iNumRows;
-            float y = (float)j / (float)m_iNumCols;
-            float A = 1;
-            float F = 1;
-            float h = 0;
-            for (int Octave = 0; Octave < 8; ++Octave, A *= 0.7f, F *= 1.8f)
+            const Uint32 Row = std::min(TileY * TileSize + y, LevelRows - 1);
+            for (Uint32 x = 0; x < TileSize; ++x)
             {
-                h += A * (sin(x * F) * sin(y * 1.5f * F) + 0.5f * (sin((x + y) * 1.3f * F) + cos((x * y) * 1.7f * F)));
-                h = fabs(h - 0.5f);
+                const Uint32 Col = std::min(TileX * TileSize + x, LevelCols - 1);
+                pDst[x + y * TileSize] = LevelData[Col + size_t{Row} * LevelCols];
             }
-            h = fabs(h) * 32000.f;
-            h = std::min(h, (float)std::numeric_limits<Uint16>::max());
+        }
+    };
 
-            GetElevSample(i, j) = (Uint16)h;
+    struct StoredTile
+    {
+        const std::vector<Uint16>* pLevelData;
+
+        Uint32 LevelCols;
+        Uint32 LevelRows;
+        Uint32 TileX;
+        Uint32 TileY;
+    };
+    std::vector<StoredTile> StoredTiles;
+    StoredTiles.reserve(ComputeTotalNumTiles(Header));
+    ForEachStoredLevel(Header.NumLevels, [&](PYRAMID_TYPE Pyramid, Uint32 Level) {
+        const Uint32 LevelCols = GetLevelDim(NumCols, Level);
+        const Uint32 LevelRows = GetLevelDim(NumRows, Level);
+        for (Uint32 TileY = 0; TileY < GetNumTiles(LevelRows, TileSize); ++TileY)
+        {
+            for (Uint32 TileX = 0; TileX < GetNumTiles(LevelCols, TileSize); ++TileX)
+                StoredTiles.push_back({&Pyramids[Pyramid][Level], LevelCols, LevelRows, TileX, TileY});
         }
+    });
+
+    const size_t TileDataSize = GetTileDataSize(TileSize);
+    const Uint64 TileStride   = AlignUp(Uint64{TileDataSize}, Uint64{TileDataAlignment});
+
+    std::vector<TileInfo> Tiles(StoredTiles.size());
+
+    const Uint64 TableEnd        = sizeof(Header) + Tiles.size() * sizeof(TileInfo);
+    const Uint64 FirstTileOffset = AlignUp(TableEnd, Uint64{TileDataAlignment});
+
+    ParallelFor(pScheduler, 0, static_cast<Uint32>(Tiles.size()), 1,
+                [&](Uint32 ThreadId, Uint32 StartTile, Uint32 EndTile) {
+                    std::vector<Uint16> TileData(TileDataSize / sizeof(Uint16));
+                    for (Uint32 TileIdx = StartTile; TileIdx < EndTile; ++TileIdx)
+                    {
+                        // Padding samples repeat the edge samples, so they do not change the range
+                        const auto& Src = StoredTiles[TileIdx];
+                        CopyTile(*Src.pLevelData, Src.LevelCols, Src.LevelRows, Src.TileX, Src.TileY, TileData.data());
+                        const auto MinMax = std::minmax_element(TileData.begin(), TileData.end());
+
+                        auto& Tile        = Tiles[TileIdx];
+                        Tile.DataOffset   = FirstTileOffset + TileIdx * TileStride;
+                        Tile.MinElevation = *MinMax.first;
+                        Tile.MaxElevation = *MinMax.second;
+                    }
+                });
+
+    // The tiles of level 0 of the average pyramid go first
+    const Uint32 NumLevel0Tiles = GetNumTiles(NumCols, TileSize) * GetNumTiles(NumRows, TileSize);
+    for (Uint32 TileIdx = 0; TileIdx < NumLevel0Tiles; ++TileIdx)
+    {
+        Header.MinElevation = TileIdx == 0 ? Tiles[TileIdx].MinElevation : std::min(Header.MinElevation, Tiles[TileIdx].MinElevation);
+        Header.MaxElevation = TileIdx == 0 ? Tiles[TileIdx].MaxElevation : std::max(Header.MaxElevation, Tiles[TileIdx].MaxElevation);
+    }
+
+    const std::vector<Uint8> Padding(TileDataAlignment);
+    std::vector<Uint16>      TileData(TileDataSize / sizeof(Uint16));
+
+    Write(&Header, sizeof(Header));
+    Write(Tiles.data(), Tiles.size() * sizeof(TileInfo));
+    Write(Padding.data(), static_cast<size_t>(FirstTileOffset - TableEnd));
+    for (const auto& Src : StoredTiles)
+    {
+        CopyTile(*Src.pLevelData, Src.LevelCols, Src.LevelRows, Src.TileX, Src.TileY, TileData.data());
+        Write(TileData.data(), TileDataSize);
+        Write(Padding.data(), static_cast<size_t>(TileStride - TileDataSize));
+    }
+}
+
+void ValidateTiledFileHeader(const TiledFileHeader& Header, Uint64 FileSize, const Char* Path)
+{
+    if (FileSize < sizeof(Header) || Header.Magic != TiledFileHeader::MagicNumber)
+        LOG_ERROR_AND_THROW("'", Path, "' is not a tiled elevation file.");
+    if (Header.Version != TiledFileHeader::CurrentVersion)
+        LOG_ERROR_AND_THROW("Tiled elevation file version ", Header.Version, " is not supported. Expected version: ", Uint32{TiledFileHeader::CurrentVersion}, ".");
+    if (Header.NumCols == 0 || Header.NumRows == 0 || Header.TileSize < 16 || !IsPowerOfTwo(Header.TileSize) ||
+        Header.NumLevels != ComputeMipLevelsCount(Header.NumCols, Header.NumRows) || Header.TileDataAlignment == 0)
+        LOG_ERROR_AND_THROW("Tiled elevation file '", Path, "' has invalid header.");
+}
+
+void ValidateTiles(const TiledFileHeader& Header, const std::vector<TileInfo>& Tiles, Uint64 FileSize, const Char* Path)
+{
+    const size_t TileDataSize = GetTileDataSize(Header.TileSize);
+    for (const auto& Tile : Tiles)
+    {
+        if (Tile.DataOffset + TileDataSize > FileSize)
+            LOG_ERROR_AND_THROW("Tiled elevation file '", Path, "' is truncated.");
+        if (Tile.DataOffset % Header.TileDataAlignment != 0)
+            LOG_ERROR_AND_THROW("Tile data in '", Path, "' is not properly aligned.");
     }
+}
+
+} // namespace
+
+
+// Provides access to the tile data of a tiled elevation file
+class ElevationDataSource::TileStorage
+{
+public:
+    // Opens the tiled file
+    explicit TileStorage(const Char* Path)
+    {
+        FileWrapper pFile{Path};
+        if (!pFile)
+            LOG_ERROR_AND_THROW("Failed to open tiled elevation file '", Path, "'.");
+
+        const Uint64 FileSize = pFile->GetSize();
+        if (FileSize < sizeof(m_Header) || !pFile->Read(&m_Header, sizeof(m_Header)))
+            LOG_ERROR_AND_THROW("Failed to read tiled elevation file '", Path, "'.");
+        ValidateTiledFileHeader(m_Header, FileSize, Path);
+
+        m_Tiles.resize(ComputeTotalNumTiles(m_Header));
+        if (!pFile->Read(m_Tiles.data(), m_Tiles.size() * sizeof(TileInfo)))
+            LOG_ERROR_AND_THROW("Failed to read the tile table of '", Path, "'.");
+        ValidateTiles(m_Header, m_Tiles, FileSize, Path);
+
+        m_ZeroTile.resize(GetTileDataSize(m_Header.TileSize) / sizeof(Uint16));
+
+#if PLATFORM_WIN32 || PLATFORM_LINUX
+        // Offsets of the mapped regions must be multiples of the allocation granularity
+        if (m_Header.TileDataAlignment % TileDataAlignment == 0)
+        {
+            std::string NativePath{Path};
+            FileSystem::CorrectSlashes(NativePath);
+#    if PLATFORM_WIN32
+            m_hFile = CreateFileA(NativePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_hFile != INVALID_HANDLE_VALUE)
+                m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_hMapping != nullptr)
+                return;
+#    else
+            m_File = open(NativePath.c_str(), O_RDONLY);
+            if (m_File >= 0)
+                return;
+#    endif
+            LOG_WARNING_MESSAGE("Failed to map tiled elevation file '", Path, "' into memory. Tiles will be read from the file.");
+        }
 #endif
 
-    m_GlobalMinElevation = m_TheHeightMap[0];
-    m_GlobalMaxElevation = m_TheHeightMap[0];
-    for (auto Elev : m_TheHeightMap)
+        m_pFile.reset(new FileWrapper{Path});
+        if (!*m_pFile)
+            LOG_ERROR_AND_THROW("Failed to open tiled elevation file '", Path, "'.");
+        m_ReadTiles.resize(m_Tiles.size());
+    }
+
+    // Uses the tiled data that is kept in memory
+    explicit TileStorage(std::vector<Uint8>&& Data) :
+        m_Data{std::move(Data)}
     {
-        m_GlobalMinElevation = std::min(m_GlobalMinElevation, Elev);
-        m_GlobalMaxElevation = std::max(m_GlobalMaxElevation, Elev);
+        const Uint64 DataSize = m_Data.size();
+        if (DataSize >= sizeof(m_Header))
+            memcpy(&m_Header, m_Data.data(), sizeof(m_Header));
+        ValidateTiledFileHeader(m_Header, DataSize, "memory");
+
+        m_Tiles.resize(ComputeTotalNumTiles(m_Header));
+        if (DataSize < sizeof(m_Header) + m_Tiles.size() * sizeof(TileInfo))
+            LOG_ERROR_AND_THROW("Tiled elevation data is truncated.");
+        memcpy(m_Tiles.data(), m_Data.data() + sizeof(m_Header), m_Tiles.size() * sizeof(TileInfo));
+        ValidateTiles(m_Header, m_Tiles, DataSize, "memory");
     }
+
+    ~TileStorage()
+    {
+#if PLATFORM_WIN32
+        if (m_hMapping != nullptr)
+            CloseHandle(m_hMapping);
+        if (m_hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(m_hFile);
+#elif PLATFORM_LINUX
+        if (m_File >= 0)
+            close(m_File);
+#endif
+    }
+
+    // clang-format off
+    TileStorage           (const TileStorage&) = delete;
+    TileStorage& operator=(const TileStorage&) = delete;
+    // clang-format on
+
+    const TiledFileHeader& GetHeader() const { return m_Header; }
+    const TileInfo&        GetTile(Uint32 TileIdx) const { return m_Tiles[TileIdx]; }
+    Uint32                 GetNumTiles() const { return static_cast<Uint32>(m_Tiles.size()); }
+
+    // Returns false if all tiles are always in memory and never need to be unloaded
+    bool IsPaged() const { return m_Data.empty(); }
+
+    // Returns TileSize x TileSize samples of the tile. If the tile can't be loaded, returns a tile filled with zeros.
+    const Uint16* LoadTile(Uint32 TileIdx)
+    {
+        const auto Offset = m_Tiles[TileIdx].DataOffset;
+        if (!m_Data.empty())
+            return reinterpret_cast<const Uint16*>(&m_Data[static_cast<size_t>(Offset)]);
+
+        const auto TileDataSize = GetTileDataSize(m_Header.TileSize);
+#if PLATFORM_WIN32
+        if (m_hMapping != nullptr)
+        {
+            if (const void* pData = MapViewOfFile(m_hMapping, FILE_MAP_READ, static_cast<DWORD>(Offset >> 32), static_cast<DWORD>(Offset & 0xFFFFFFFFu), TileDataSize))
+                return static_cast<const Uint16*>(pData);
+            return OnTileLoadFailed(TileIdx);
+        }
+#elif PLATFORM_LINUX
+        if (m_File >= 0)
+        {
+            void* pData = mmap(nullptr, TileDataSize, PROT_READ, MAP_PRIVATE, m_File, static_cast<off_t>(Offset));
+            if (pData != MAP_FAILED)
+                return static_cast<const Uint16*>(pData);
+            return OnTileLoadFailed(TileIdx);
+        }
+#endif
+
+        auto& pTile = m_ReadTiles[TileIdx];
+        pTile.reset(new Uint16[TileDataSize / sizeof(Uint16)]);
+        auto& pFile = *m_pFile;
+        if (!pFile->SetPos(static_cast<size_t>(Offset), FilePosOrigin::Start) || !pFile->Read(pTile.get(), TileDataSize))
+        {
+            pTile.reset();
+            return OnTileLoadFailed(TileIdx);
+        }
+        return pTile.get();
+    }
+
+    void UnloadTile(Uint32 TileIdx, const Uint16* pData)
+    {
+        if (!m_Data.empty() || pData == m_ZeroTile.data())
+            return;
+
+#if PLATFORM_WIN32
+        if (m_hMapping != nullptr)
+        {
+            UnmapViewOfFile(pData);
+            return;
+        }
+#elif PLATFORM_LINUX
+        if (m_File >= 0)
+        {
+            munmap(const_cast<Uint16*>(pData), GetTileDataSize(m_Header.TileSize));
+            return;
+        }
+#endif
+        m_ReadTiles[TileIdx].reset();
+    }
+
+private:
+    const Uint16* OnTileLoadFailed(Uint32 TileIdx)
+    {
+        LOG_ERROR_MESSAGE("Failed to load elevation data tile ", TileIdx);
+        return m_ZeroTile.data();
+    }
+
+    TiledFileHeader       m_Header;
+    std::vector<TileInfo> m_Tiles;
+    std::vector<Uint16>   m_ZeroTile;
+
+    // Tiled data in memory
+    std::vector<Uint8> m_Data;
+
+    // Tiles that are read from the file
+    std::unique_ptr<FileWrapper>           m_pFile;
+    std::vector<std::unique_ptr<Uint16[]>> m_ReadTiles;
+
+#if PLATFORM_WIN32
+    HANDLE m_hFile    = INVALID_HANDLE_VALUE;
+    HANDLE m_hMapping = nullptr;
+#elif PLATFORM_LINUX
+    int m_File = -1;
+#endif
+};
+
+
+void ElevationDataSource::ConvertToTiledFile(const Char* strSrcDemFile, const Char* strDstFile, Uint32 TileSize, TaskScheduler* pScheduler)
+{
+    if (TileSize < 16 || !IsPowerOfTwo(TileSize))
+        LOG_ERROR_AND_THROW("Tile size (", TileSize, ") must be a power of two not less than 16.");
+
+    Uint32 NumCols = 0, NumRows = 0;
+    Uint64 SourceFileSize = 0;
+    auto   HeightMap      = LoadSourceHeightMap(strSrcDemFile, NumCols, NumRows, SourceFileSize);
+
+    FileWrapper pFile{strDstFile, EFileAccessMode::Overwrite};
+    if (!pFile)
+        LOG_ERROR_AND_THROW("Failed to create tiled elevation file '", strDstFile, "'.");
+
+    WriteTiledElevationData(std::move(HeightMap), NumCols, NumRows, TileSize, SourceFileSize, pScheduler,
+                            [&](const void* pData, size_t Size) {
+                                if (Size > 0 && !pFile->Write(pData, Size))
+                                    LOG_ERROR_AND_THROW("Failed to write tiled elevation file '", strDstFile, "'.");
+                            });
+}
+
+// Creates data source from the specified file
+ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile, Uint32 MaxResidentTiles, TaskScheduler* pScheduler) :
+    m_MaxResidentTiles{std::max(MaxResidentTiles, 1u)}
+{
+    const std::string SrcPath{strSrcDemFile};
+    if (HasExtension(SrcPath, TiledFileExtension))
+    {
+        m_pStorage.reset(new TileStorage{SrcPath.c_str()});
+    }
+    else
+    {
+        const std::string TiledPath = SrcPath + TiledFileExtension;
+
+        Uint64 SourceFileSize = 0;
+        if (FileSystem::FileExists(SrcPath.c_str()))
+        {
+            FileWrapper pSrcFile{SrcPath.c_str()};
+            if (pSrcFile)
+                SourceFileSize = pSrcFile->GetSize();
+        }
+
+        if (FileSystem::FileExists(TiledPath.c_str()))
+        {
+            try
+            {
+                std::unique_ptr<TileStorage> pStorage{new TileStorage{TiledPath.c_str()}};
+                // The tiled file may be distributed without the source file
+                if (SourceFileSize == 0 || pStorage->GetHeader().SourceFileSize == SourceFileSize)
+                    m_pStorage = std::move(pStorage);
+                else
+                    LOG_INFO_MESSAGE("Tiled elevation file '", TiledPath, "' is out of date.");
+            }
+            catch (...)
+            {
+                LOG_WARNING_MESSAGE("Failed to open tiled elevation file '", TiledPath, "'. The file will be recreated.");
+            }
+        }
+
+        if (!m_pStorage)
+        {
+            LOG_INFO_MESSAGE("Converting elevation data '", SrcPath, "' to tiled file '", TiledPath, "'.");
+            try
+            {
+                ConvertToTiledFile(SrcPath.c_str(), TiledPath.c_str(), DefaultTileSize, pScheduler);
+                m_pStorage.reset(new TileStorage{TiledPath.c_str()});
+            }
+            catch (...)
+            {
+                // The directory of the source file may be read-only
+                LOG_WARNING_MESSAGE("Failed to create tiled elevation file '", TiledPath, "'. Tiled data will be kept in memory.");
+
+                Uint32 NumCols = 0, NumRows = 0;
+                auto   HeightMap = LoadSourceHeightMap(SrcPath.c_str(), NumCols, NumRows, SourceFileSize);
+
+                std::vector<Uint8> TiledData;
+                WriteTiledElevationData(std::move(HeightMap), NumCols, NumRows, DefaultTileSize, SourceFileSize, pScheduler,
+                                        [&TiledData](const void* pData, size_t Size) {
+                                            const auto* pBytes = static_cast<const Uint8*>(pData);
+                                            TiledData.insert(TiledData.end(), pBytes, pBytes + Size);
+                                        });
+                m_pStorage.reset(new TileStorage{std::move(TiledData)});
+            }
+        }
+    }
+
+    const auto& Header   = m_pStorage->GetHeader();
+    m_iNumCols           = Header.NumCols;
+    m_iNumRows           = Header.NumRows;
+    m_TileSize           = Header.TileSize;
+    m_GlobalMinElevation = Header.MinElevation;
+    m_GlobalMaxElevation = Header.MaxElevation;
+    while ((1u << m_TileSizeLog2) < m_TileSize)
+        ++m_TileSizeLog2;
+
+    // Level 0 of the min and max pyramids is not stored and has no tiles
+    for (auto& Levels : m_Pyramids)
+        Levels.resize(Header.NumLevels);
+    Uint32 FirstTileIdx = 0;
+    ForEachStoredLevel(Header.NumLevels, [&](PYRAMID_TYPE Pyramid, Uint32 Level) {
+        auto& LevelData        = m_Pyramids[Pyramid][Level];
+        LevelData.NumCols      = GetLevelDim(m_iNumCols, Level);
+        LevelData.NumRows      = GetLevelDim(m_iNumRows, Level);
+        LevelData.NumTilesX    = GetNumTiles(LevelData.NumCols, m_TileSize);
+        LevelData.NumTilesY    = GetNumTiles(LevelData.NumRows, m_TileSize);
+        LevelData.FirstTileIdx = FirstTileIdx;
+        FirstTileIdx += LevelData.NumTilesX * LevelData.NumTilesY;
+    });
+    VERIFY_EXPR(FirstTileIdx == m_pStorage->GetNumTiles());
+
+    const auto NumTiles = m_pStorage->GetNumTiles();
+    m_TileData.resize(NumTiles);
+    m_TileLastUse.reset(new std::atomic<Uint64>[NumTiles]);
+    for (Uint32 TileIdx = 0; TileIdx < NumTiles; ++TileIdx)
+        m_TileLastUse[TileIdx].store(0);
 }
 
 ElevationDataSource::~ElevationDataSource(void)
 {
+    for (auto TileIdx : m_ResidentTiles)
+        m_pStorage->UnloadTile(TileIdx, m_TileData[TileIdx]);
 }
 
 Uint16 ElevationDataSource::GetGlobalMinElevation() const
@@ -159,6 +935,142 @@ Uint16 ElevationDataSource::GetGlobalMaxElevation() const
     return m_GlobalMaxElevation;
 }
 
+void ElevationDataSource::GetElevationRange(Uint32 iCol0, Uint32 iRow0, Uint32 iCol1, Uint32 iRow1, Uint16& MinElevation, Uint16& MaxElevation) const
+{
+    const auto&  Level0 = m_Pyramids[PYRAMID_TYPE_AVERAGE][0];
+    const Uint32 TileX0 = std::min(iCol0, m_iNumCols - 1) >> m_TileSizeLog2;
+    const Uint32 TileY0 = std::min(iRow0, m_iNumRows - 1) >> m_TileSizeLog2;
+    const Uint32 TileX1 = std::min(iCol1, m_iNumCols - 1) >> m_TileSizeLog2;
+    const Uint32 TileY1 = std::min(iRow1, m_iNumRows - 1) >> m_TileSizeLog2;
+
+    MinElevation = m_GlobalMaxElevation;
+    MaxElevation = m_GlobalMinElevation;
+    for (Uint32 TileY = TileY0; TileY <= TileY1; ++TileY)
+    {
+        for (Uint32 TileX = TileX0; TileX <= TileX1; ++TileX)
+        {
+            const auto& Tile = m_pStorage->GetTile(Level0.FirstTileIdx + TileY * Level0.NumTilesX + TileX);
+            MinElevation     = std::min(MinElevation, Tile.MinElevation);
+            MaxElevation     = std::max(MaxElevation, Tile.MaxElevation);
+        }
+    }
+}
+
+void ElevationDataSource::GetLevelElevationRange(Uint32 Level, Uint32 iCol, Uint32 iRow, Uint16& MinElevation, Uint16& MaxElevation) const
+{
+    VERIFY_EXPR(Level < GetNumLevels());
+    if (Level == 0)
+    {
+        // Level 0 of the min and max pyramids is not stored: the range is computed from the corners of the cell
+        int2 Coords[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            Coords[i].x = static_cast<int>(std::min(iCol + (i & 0x01), m_iNumCols - 1));
+            Coords[i].y = static_cast<int>(std::min(iRow + (i >> 1), m_iNumRows - 1));
+        }
+        Uint16 Samples[4];
+        ReadElevSamples(PYRAMID_TYPE_AVERAGE, 0, Coords, Samples, 4);
+        MinElevation = *std::min_element(Samples, Samples + 4);
+        MaxElevation = *std::max_element(Samples, Samples + 4);
+        return;
+    }
+
+    const auto& LevelData = m_Pyramids[PYRAMID_TYPE_MIN][Level];
+    const int2  Coords{static_cast<int>(std::min(iCol, LevelData.NumCols - 1)), static_cast<int>(std::min(iRow, LevelData.NumRows - 1))};
+    ReadElevSamples(PYRAMID_TYPE_MIN, Level, &Coords, &MinElevation, 1);
+    ReadElevSamples(PYRAMID_TYPE_MAX, Level, &Coords, &MaxElevation, 1);
+}
+
+Uint32 ElevationDataSource::GetNumResidentTiles() const
+{
+    std::shared_lock<std::shared_timed_mutex> Lock{m_CacheMtx};
+    return static_cast<Uint32>(m_ResidentTiles.size());
+}
+
+const Uint16* ElevationDataSource::MakeTileResident(Uint32 TileIdx) const
+{
+    if (const auto* pData = m_TileData[TileIdx])
+    {
+        m_TileLastUse[TileIdx].store(m_CacheClock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return pData;
+    }
+
+    if (m_pStorage->IsPaged() && m_ResidentTiles.size() >= m_MaxResidentTiles)
+    {
+        // Evict the least recently used tile
+        auto LRUTile = m_ResidentTiles.begin();
+        for (auto it = m_ResidentTiles.begin(); it != m_ResidentTiles.end(); ++it)
+        {
+            if (m_TileLastUse[*it].load(std::memory_order_relaxed) < m_TileLastUse[*LRUTile].load(std::memory_order_relaxed))
+                LRUTile = it;
+        }
+        m_pStorage->UnloadTile(*LRUTile, m_TileData[*LRUTile]);
+        m_TileData[*LRUTile] = nullptr;
+        *LRUTile             = m_ResidentTiles.back();
+        m_ResidentTiles.pop_back();
+    }
+
+    const auto* pData   = m_pStorage->LoadTile(TileIdx);
+    m_TileData[TileIdx] = pData;
+    m_ResidentTiles.push_back(TileIdx);
+    m_TileLastUse[TileIdx].store(m_CacheClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return pData;
+}
+
+void ElevationDataSource::ReadElevSamples(PYRAMID_TYPE Pyramid, Uint32 Level, const int2* pCoords, Uint16* pSamples, size_t NumSamples) const
+{
+    {
+        // Fast path: all tiles are resident
+        std::shared_lock<std::shared_timed_mutex> Lock{m_CacheMtx};
+
+        const auto Clock = m_CacheClock.load(std::memory_order_relaxed);
+
+        size_t i = 0;
+        for (; i < NumSamples; ++i)
+        {
+            const Uint32 iCol    = static_cast<Uint32>(pCoords[i].x);
+            const Uint32 iRow    = static_cast<Uint32>(pCoords[i].y);
+            const Uint32 TileIdx = GetTileIndex(Pyramid, Level, iCol, iRow);
+            const auto*  pTile   = m_TileData[TileIdx];
+            if (pTile == nullptr)
+                break;
+
+            m_TileLastUse[TileIdx].store(Clock, std::memory_order_relaxed);
+            pSamples[i] = pTile[GetSampleOffsetInTile(iCol, iRow)];
+        }
+        if (i == NumSamples)
+            return;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> Lock{m_CacheMtx};
+    for (size_t i = 0; i < NumSamples; ++i)
+    {
+        const Uint32 iCol  = static_cast<Uint32>(pCoords[i].x);
+        const Uint32 iRow  = static_cast<Uint32>(pCoords[i].y);
+        const auto*  pTile = MakeTileResident(GetTileIndex(Pyramid, Level, iCol, iRow));
+        pSamples[i]        = pTile[GetSampleOffsetInTile(iCol, iRow)];
+    }
+}
+
+void ElevationDataSource::ProcessLevelTiles(Uint32 Level, const TileHandlerType& Handler, PYRAMID_TYPE Pyramid) const
+{
+    VERIFY_EXPR(Level < GetNumLevels());
+    const auto& LevelData = m_Pyramids[Pyramid][Level];
+    for (Uint32 TileY = 0; TileY < LevelData.NumTilesY; ++TileY)
+    {
+        for (Uint32 TileX = 0; TileX < LevelData.NumTilesX; ++TileX)
+        {
+            const Uint32 iCol = TileX * m_TileSize;
+            const Uint32 iRow = TileY * m_TileSize;
+
+            std::unique_lock<std::shared_timed_mutex> Lock{m_CacheMtx};
+
+            const auto* pTile = MakeTileResident(GetTileIndex(Pyramid, Level, iCol, iRow));
+            Handler(iCol, iRow, std::min(m_TileSize, LevelData.NumCols - iCol), std::min(m_TileSize, LevelData.NumRows - iRow), pTile, m_TileSize);
+        }
+    }
+}
+
 int MirrorCoord(int iCoord, int iDim)
 {
     iCoord      = std::abs(iCoord);
@@ -171,17 +1083,126 @@ int MirrorCoord(int iCoord, int iDim)
     return iCoord;
 }
 
-inline Uint16& ElevationDataSource::GetElevSample(Int32 i, Int32 j)
+// Computes the range of the mirrored coordinates of the samples in [iCoord0, iCoord1]
+void MirrorCoordRange(int iCoord0, int iCoord1, int iDim, Uint32& uiMin, Uint32& uiMax)
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    // Negative coordinates are mirrored at zero
+    if (iCoord1 < 0)
+    {
+        std::swap(iCoord0, iCoord1);
+        iCoord0 = -iCoord0;
+        iCoord1 = -iCoord1;
+    }
+    else if (iCoord0 < 0)
+    {
+        iCoord1 = std::max(-iCoord0, iCoord1);
+        iCoord0 = 0;
+    }
+
+    const int iPeriod0 = iCoord0 / iDim;
+    const int iPeriod1 = iCoord1 / iDim;
+    if (iPeriod1 - iPeriod0 >= 2)
+    {
+        uiMin = 0;
+        uiMax = static_cast<Uint32>(iDim - 1);
+        return;
+    }
+
+    int iMin = std::min(MirrorCoord(iCoord0, iDim), MirrorCoord(iCoord1, iDim));
+    int iMax = std::max(MirrorCoord(iCoord0, iDim), MirrorCoord(iCoord1, iDim));
+    if (iPeriod0 != iPeriod1)
+    {
+        // The range is reflected at the period boundary
+        const int iBoundary = MirrorCoord(iPeriod1 * iDim, iDim);
+        iMin                = std::min(iMin, iBoundary);
+        iMax                = std::max(iMax, iBoundary);
+    }
+    uiMin = static_cast<Uint32>(iMin);
+    uiMax = static_cast<Uint32>(iMax);
 }
 
-inline Uint16 ElevationDataSource::GetElevSample(Int32 i, Int32 j) const
+void ElevationDataSource::GetRegionElevationRange(float fCol0, float fRow0, float fCol1, float fRow1, Uint16& MinElevation, Uint16& MaxElevation) const
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    Uint32 uiCol0, uiCol1, uiRow0, uiRow1;
+    MirrorCoordRange(static_cast<int>(std::floor(fCol0)) + m_iColOffset, static_cast<int>(std::ceil(fCol1)) + m_iColOffset, static_cast<int>(m_iNumCols), uiCol0, uiCol1);
+    MirrorCoordRange(static_cast<int>(std::floor(fRow0)) + m_iRowOffset, static_cast<int>(std::ceil(fRow1)) + m_iRowOffset, static_cast<int>(m_iNumRows), uiRow0, uiRow1);
+
+    // Sample (iCol, iRow) of level L of the min and max pyramids covers the finest level samples
+    // [iCol << L, (iCol + 1) << L] x [iRow << L, (iRow + 1) << L]. The level is selected so that
+    // the region is covered by at most 3x3 samples.
+    const Uint32 Extent = std::max(uiCol1 - uiCol0, uiRow1 - uiRow0);
+    Uint32       Level  = 0;
+    while (Level + 1 < GetNumLevels() && (2u << Level) <= Extent)
+        ++Level;
+
+    constexpr Uint32 MaxSamples = 9;
+
+    int2   Coords[MaxSamples];
+    Uint16 Samples[MaxSamples];
+    size_t NumSamples = 0;
+    if (Level == 0)
+    {
+        // Level 0 is only stored in the average pyramid: the region is covered by at most 2x2 samples
+        for (Uint32 iRow = uiRow0; iRow <= uiRow1; ++iRow)
+        {
+            for (Uint32 iCol = uiCol0; iCol <= uiCol1; ++iCol)
+                Coords[NumSamples++] = int2{static_cast<int>(iCol), static_cast<int>(iRow)};
+        }
+        ReadElevSamples(PYRAMID_TYPE_AVERAGE, 0, Coords, Samples, NumSamples);
+        MinElevation = *std::min_element(Samples, Samples + NumSamples);
+        MaxElevation = *std::max_element(Samples, Samples + NumSamples);
+        return;
+    }
+
+    const auto&  LevelData = m_Pyramids[PYRAMID_TYPE_MIN][Level];
+    const Uint32 iCol0     = std::min(uiCol0 >> Level, LevelData.NumCols - 1);
+    const Uint32 iRow0     = std::min(uiRow0 >> Level, LevelData.NumRows - 1);
+    const Uint32 iCol1     = std::min((std::max(uiCol1, 1u) - 1) >> Level, LevelData.NumCols - 1);
+    const Uint32 iRow1     = std::min((std::max(uiRow1, 1u) - 1) >> Level, LevelData.NumRows - 1);
+    for (Uint32 iRow = iRow0; iRow <= std::max(iRow0, iRow1); ++iRow)
+    {
+        for (Uint32 iCol = iCol0; iCol <= std::max(iCol0, iCol1); ++iCol)
+        {
+            VERIFY_EXPR(NumSamples < MaxSamples);
+            Coords[NumSamples++] = int2{static_cast<int>(iCol), static_cast<int>(iRow)};
+        }
+    }
+
+    ReadElevSamples(PYRAMID_TYPE_MIN, Level, Coords, Samples, NumSamples);
+    MinElevation = *std::min_element(Samples, Samples + NumSamples);
+    ReadElevSamples(PYRAMID_TYPE_MAX, Level, Coords, Samples, NumSamples);
+    MaxElevation = *std::max_element(Samples, Samples + NumSamples);
 }
 
 float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iStep) const
+{
+    float fHeight = 0;
+    GetInterpolatedHeights(&fCol, &fRow, &fHeight, 1, iStep);
+    return fHeight;
+}
+
+void ElevationDataSource::GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t NumSamples, int iStep) const
+{
+    // Points are processed in batches to avoid allocations. Every point needs four corner samples.
+    constexpr size_t BatchSize = 64;
+
+    int2   Coords[BatchSize * 4];
+    float2 Weights[BatchSize];
+    Uint16 Samples[BatchSize * 4];
+    for (size_t BatchStart = 0; BatchStart < NumSamples; BatchStart += BatchSize)
+    {
+        const size_t NumBatchSamples = std::min(BatchSize, NumSamples - BatchStart);
+        for (size_t s = 0; s < NumBatchSamples; ++s)
+        {
+            ComputeBilinearCoords(pCols[BatchStart + s], pRows[BatchStart + s], iStep, &Coords[s * 4], Weights[s]);
+        }
+
+        ReadElevSamples(PYRAMID_TYPE_AVERAGE, 0, Coords, Samples, NumBatchSamples * 4);
+        BlendBilinearSamples(Samples, Weights, pHeights + BatchStart, NumBatchSamples);
+    }
+}
+
+void ElevationDataSource::ComputeBilinearCoords(float fCol, float fRow, int iStep, int2* pCoords, float2& f2Weights) const
 {
     float fCol0    = floor(fCol);
     float fRow0    = floor(fRow);
@@ -204,14 +1225,11 @@ float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iSt
     iRow0 = MirrorCoord(iRow0, m_iNumRows);
     iRow1 = MirrorCoord(iRow1, m_iNumRows);
 
-    Uint16 H00 = GetElevSample(iCol0, iRow0);
-    Uint16 H10 = GetElevSample(iCol1, iRow0);
-    Uint16 H01 = GetElevSample(iCol0, iRow1);
-    Uint16 H11 = GetElevSample(iCol1, iRow1);
-
-    float fInterpolatedHeight = (H00 * (1 - fHWeight) + H10 * fHWeight) * (1 - fVWeight) +
-        (H01 * (1 - fHWeight) + H11 * fHWeight) * fVWeight;
-    return fInterpolatedHeight;
+    pCoords[0] = int2{iCol0, iRow0};
+    pCoords[1] = int2{iCol1, iRow0};
+    pCoords[2] = int2{iCol0, iRow1};
+    pCoords[3] = int2{iCol1, iRow1};
+    f2Weights  = float2{fHWeight, fVWeight};
 }
 
 float3 ElevationDataSource::ComputeSurfaceNormal(float fCol, float fRow, float fSampleSpacing, float fHeightScale, int iStep) const
@@ -233,10 +1251,4 @@ float3 ElevationDataSource::ComputeSurfaceNormal(float fCol, float fRow, float f
     return Normal;
 }
 
-void ElevationDataSource::GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch)
-{
-    pDataPtr = &m_TheHeightMap[0];
-    Pitch    = m_iStride;
-}
-
 } // namespace Diligent
@@ -46,6 +46,12 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
 
 #include "BasicTypes.h"
 #include "BasicMath.hpp"
@@ -53,15 +59,61 @@
 namespace Diligent
 {
 
+class TaskScheduler;
+
 // Class implementing elevation data source
+
+// The height map is stored on disk in a tiled format: every level of the mip pyramid is split into
+// square tiles, and every tile records its minimal and maximal elevation. Besides the mip pyramid of the
+// heights, the file contains the pyramids of minimal and maximal elevations that give conservative bounds
+// of the terrain regions at every level. Tiles are memory-mapped
+// (or read from the file on platforms that do not support mapping) when they are first accessed and
+// are kept in an LRU cache of limited size, so that only the tiles that are actually sampled are resident.
+// Other height map formats (16-bit PNG or TIFF, or raw 16-bit square height maps with the .raw or .r16
+// extension) are converted to the tiled format once, and the tiled file is saved next to the source file
+// with the .tiles extension appended to the file name. The pyramids are built by the converter, which
+// processes the rows of every level in parallel using SIMD instructions.
+//
+// All accessors are thread-safe.
 class ElevationDataSource
 {
 public:
-    // Creates data source from the specified raw data file
-    ElevationDataSource(const Char* strSrcDemFile);
+    static constexpr Uint32 DefaultTileSize         = 256;
+    static constexpr Uint32 DefaultMaxResidentTiles = 256;
+
+    // Pyramids stored in the tiled file
+    enum PYRAMID_TYPE : Uint32
+    {
+        // Mip pyramid of the heights: every sample of a coarser level is the average of 2x2 samples of the finer level
+        PYRAMID_TYPE_AVERAGE = 0,
+
+        // Pyramids of minimal and maximal elevations start at level 1. Sample (Col, Row) of level L is the minimum
+        // (maximum) of the finest level samples in [Col << L, (Col + 1) << L] x [Row << L, (Row + 1) << L]. The region
+        // includes the samples on its boundary shared with the neighboring regions, so that it bounds all
+        // triangles of the terrain inside the region.
+        PYRAMID_TYPE_MIN,
+        PYRAMID_TYPE_MAX,
+
+        PYRAMID_TYPE_COUNT
+    };
+
+    // Creates data source from the specified file. If the file has to be converted to the tiled format,
+    // the scheduler, if provided, is used to build the pyramids in parallel.
+    ElevationDataSource(const Char*    strSrcDemFile,
+                        Uint32         MaxResidentTiles = DefaultMaxResidentTiles,
+                        TaskScheduler* pScheduler       = nullptr);
     virtual ~ElevationDataSource(void);
 
-    void GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch);
+    // clang-format off
+    ElevationDataSource           (const ElevationDataSource&) = delete;
+    ElevationDataSource& operator=(const ElevationDataSource&) = delete;
+    // clang-format on
+
+    // Converts the height map to the tiled format. Throws an exception in case of an error.
+    static void ConvertToTiledFile(const Char*    strSrcDemFile,
+                                   const Char*    strDstFile,
+                                   Uint32         TileSize   = DefaultTileSize,
+                                   TaskScheduler* pScheduler = nullptr);
 
     // Returns minimal height of the whole terrain
     Uint16 GetGlobalMinElevation() const;
@@ -69,6 +121,19 @@ public:
     // Returns maximal height of the whole terrain
     Uint16 GetGlobalMaxElevation() const;
 
+    // Returns conservative elevation range of the region [iCol0, iCol1] x [iRow0, iRow1] of the finest level,
+    // computed from the ranges of the tiles that intersect the region. No tiles are loaded.
+    void GetElevationRange(Uint32 iCol0, Uint32 iRow0, Uint32 iCol1, Uint32 iRow1, Uint16& MinElevation, Uint16& MaxElevation) const;
+
+    // Returns exact elevation range of the finest level samples in [iCol << Level, (iCol + 1) << Level] x
+    // [iRow << Level, (iRow + 1) << Level], where (iCol, iRow) are the coordinates in the level.
+    // The range is read from the min and max pyramids, which loads the tiles if necessary.
+    void GetLevelElevationRange(Uint32 Level, Uint32 iCol, Uint32 iRow, Uint16& MinElevation, Uint16& MaxElevation) const;
+
+    // Returns conservative elevation range of the region [fCol0, fCol1] x [fRow0, fRow1] given in the same
+    // coordinates as GetInterpolatedHeight(), i.e. before the offsets and mirroring are applied. The range is
+    // read from the level of the min and max pyramids whose samples are comparable to the region size.
+    void GetRegionElevationRange(float fCol0, float fRow0, float fCol1, float fRow1, Uint16& MinElevation, Uint16& MaxElevation) const;
 
     void SetOffsets(int iColOffset, int iRowOffset)
     {
@@ -83,29 +148,89 @@ public:
 
     float GetInterpolatedHeight(float fCol, float fRow, int iStep = 1) const;
 
+    // Computes interpolated heights at NumSamples points. The tile cache is locked once per batch of points
+    // rather than once per point.
+    void GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t NumSamples, int iStep = 1) const;
+
     float3 ComputeSurfaceNormal(float fCol, float fRow, float fSampleSpacing, float fHeightScale, int iStep = 1) const;
 
     unsigned int GetNumCols() const { return m_iNumCols; }
     unsigned int GetNumRows() const { return m_iNumRows; }
 
+    // Returns the number of levels in the mip pyramid. Level 0 is the finest level, and
+    // the dimensions of level N are max(GetNumCols() >> N, 1) x max(GetNumRows() >> N, 1).
+    Uint32 GetNumLevels() const { return static_cast<Uint32>(m_Pyramids[PYRAMID_TYPE_AVERAGE].size()); }
+    Uint32 GetTileSize() const { return m_TileSize; }
+
+    // Tile handler receives the region of the level covered by the tile and the tile samples.
+    // Stride is given in samples.
+    using TileHandlerType = std::function<void(Uint32 iCol, Uint32 iRow, Uint32 Width, Uint32 Height, const Uint16* pData, size_t Stride)>;
+
+    // Calls the handler for every tile of the level of the pyramid. Tiles are loaded one at a time,
+    // and the tile data must not be accessed after the handler returns. Level 0 of the min and max
+    // pyramids has no tiles.
+    void ProcessLevelTiles(Uint32 Level, const TileHandlerType& Handler, PYRAMID_TYPE Pyramid = PYRAMID_TYPE_AVERAGE) const;
+
+    Uint32 GetNumResidentTiles() const;
+    Uint32 GetMaxResidentTiles() const { return m_MaxResidentTiles; }
+
 private:
-    inline Uint16  GetElevSample(Int32 i, Int32 j) const;
-    inline Uint16& GetElevSample(Int32 i, Int32 j);
+    class TileStorage;
+
+    struct LevelInfo
+    {
+        Uint32 NumCols      = 0;
+        Uint32 NumRows      = 0;
+        Uint32 NumTilesX    = 0;
+        Uint32 NumTilesY    = 0;
+        Uint32 FirstTileIdx = 0;
+    };
+
+    Uint32 GetTileIndex(PYRAMID_TYPE Pyramid, Uint32 Level, Uint32 iCol, Uint32 iRow) const
+    {
+        const auto& LevelData = m_Pyramids[Pyramid][Level];
+        return LevelData.FirstTileIdx + (iRow >> m_TileSizeLog2) * LevelData.NumTilesX + (iCol >> m_TileSizeLog2);
+    }
+    Uint32 GetSampleOffsetInTile(Uint32 iCol, Uint32 iRow) const
+    {
+        return (iRow & (m_TileSize - 1)) * m_TileSize + (iCol & (m_TileSize - 1));
+    }
+
+    // Computes coordinates of the four samples and the bilinear weights for the point
+    void ComputeBilinearCoords(float fCol, float fRow, int iStep, int2* pCoords, float2& f2Weights) const;
+
+    // Reads samples of the level of the pyramid at the given (column, row) coordinates
+    void ReadElevSamples(PYRAMID_TYPE Pyramid, Uint32 Level, const int2* pCoords, Uint16* pSamples, size_t NumSamples) const;
+
+    // Makes the tile resident, evicting the least recently used tile if the cache is full.
+    // Must be called while the cache mutex is exclusively locked.
+    const Uint16* MakeTileResident(Uint32 TileIdx) const;
 
     Uint16 m_GlobalMinElevation = 0;
     Uint16 m_GlobalMaxElevation = 0;
 
-    int m_iNumLevels = 0;
-    int m_iPatchSize = 0;
     int m_iColOffset = 0;
     int m_iRowOffset = 0;
 
-    // The whole terrain height map
-    std::vector<Uint16> m_TheHeightMap;
-
     Uint32 m_iNumCols = 0;
     Uint32 m_iNumRows = 0;
-    Uint32 m_iStride  = 0;
+
+    Uint32 m_TileSize     = 0;
+    Uint32 m_TileSizeLog2 = 0;
+
+    std::array<std::vector<LevelInfo>, PYRAMID_TYPE_COUNT> m_Pyramids;
+
+    std::unique_ptr<TileStorage> m_pStorage;
+
+    // Tile cache. Resident tile pointers are only modified while the mutex is exclusively locked.
+    // Last use times are updated under the shared lock and are only approximately ordered:
+    // the clock advances when a tile is loaded, so tiles accessed between two loads have the same time.
+    const Uint32                           m_MaxResidentTiles;
+    mutable std::shared_timed_mutex        m_CacheMtx;
+    mutable std::vector<const Uint16*>     m_TileData;
+    mutable std::vector<Uint32>            m_ResidentTiles;
+    std::unique_ptr<std::atomic<Uint64>[]> m_TileLastUse;
+    mutable std::atomic<Uint64>            m_CacheClock{0};
 };
 
 } // namespace Diligent
@@ -0,0 +1,202 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "MeshBVH.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 MaxLeafItems = 4;
+
+// Median splits halve the number of items at every level, so the depth
+// of the hierarchy never exceeds the number of bits in the item index.
+constexpr Uint32 MaxTreeDepth = 33;
+
+BoundBox GetUnion(const BoundBox& Box0, const BoundBox& Box1)
+{
+    return BoundBox{std::min(Box0.Min, Box1.Min), std::max(Box0.Max, Box1.Max)};
+}
+
+} // namespace
+
+void MeshBVH::Build(const std::vector<BoundBox>& Boxes)
+{
+    m_Nodes.clear();
+    m_ItemBoxes = Boxes;
+    m_Items.resize(Boxes.size());
+    if (Boxes.empty())
+        return;
+
+    std::vector<float3> Centers(Boxes.size());
+    for (Uint32 i = 0; i < Boxes.size(); ++i)
+    {
+        m_Items[i] = i;
+        Centers[i] = (Boxes[i].Min + Boxes[i].Max) * 0.5f;
+    }
+
+    m_Nodes.reserve(Boxes.size() * 2);
+    BuildNode(0, static_cast<Uint32>(Boxes.size()), Centers);
+}
+
+Uint32 MeshBVH::BuildNode(Uint32 FirstItem, Uint32 NumItems, const std::vector<float3>& Centers)
+{
+    VERIFY_EXPR(NumItems > 0);
+
+    const Uint32 NodeIdx = static_cast<Uint32>(m_Nodes.size());
+    m_Nodes.emplace_back();
+
+    BoundBox NodeBox   = m_ItemBoxes[m_Items[FirstItem]];
+    float3   CenterMin = Centers[m_Items[FirstItem]];
+    float3   CenterMax = CenterMin;
+    for (Uint32 i = FirstItem + 1; i < FirstItem + NumItems; ++i)
+    {
+        NodeBox   = GetUnion(NodeBox, m_ItemBoxes[m_Items[i]]);
+        CenterMin = std::min(CenterMin, Centers[m_Items[i]]);
+        CenterMax = std::max(CenterMax, Centers[m_Items[i]]);
+    }
+    m_Nodes[NodeIdx].Box = NodeBox;
+
+    if (NumItems <= MaxLeafItems)
+    {
+        m_Nodes[NodeIdx].FirstItem = FirstItem;
+        m_Nodes[NodeIdx].NumItems  = NumItems;
+        return NodeIdx;
+    }
+
+    // Split the items at the median of their centers along the axis where the centers are spread the most
+    const float3 CenterExtent = CenterMax - CenterMin;
+    const int    SplitAxis    = (CenterExtent.x >= CenterExtent.y && CenterExtent.x >= CenterExtent.z) ? 0 : (CenterExtent.y >= CenterExtent.z ? 1 : 2);
+
+    const Uint32 NumLeftItems = NumItems / 2;
+
+    auto ItemsStart = m_Items.begin() + FirstItem;
+    std::nth_element(ItemsStart, ItemsStart + NumLeftItems, ItemsStart + NumItems,
+                     [&Centers, SplitAxis](Uint32 Item0, Uint32 Item1) {
+                         return Centers[Item0][SplitAxis] < Centers[Item1][SplitAxis];
+                     });
+
+    BuildNode(FirstItem, NumLeftItems, Centers);
+    const Uint32 RightChild = BuildNode(FirstItem + NumLeftItems, NumItems - NumLeftItems, Centers);
+
+    m_Nodes[NodeIdx].RightChild = RightChild;
+    return NodeIdx;
+}
+
+void MeshBVH::Cull(const ViewFrustumExt* pFrusta,
+                   Uint32                NumFrusta,
+                   FRUSTUM_PLANE_FLAGS   PlaneFlags,
+                   std::vector<Uint32>*  pVisibleItems) const
+{
+    VERIFY(NumFrusta <= MaxFrusta, "Too many frusta");
+    if (NumFrusta > MaxFrusta)
+        NumFrusta = MaxFrusta;
+    for (Uint32 i = 0; i < NumFrusta; ++i)
+        pVisibleItems[i].clear();
+
+    if (m_Nodes.empty() || NumFrusta == 0)
+        return;
+
+    // Bit i of the masks corresponds to frustum i. The node partially intersects
+    // the frusta from PartialMask and is fully inside the frusta from InsideMask.
+    struct StackEntry
+    {
+        Uint32 NodeIdx;
+        Uint32 PartialMask;
+        Uint32 InsideMask;
+    };
+    StackEntry Stack[MaxTreeDepth + 1];
+    Uint32     StackSize = 0;
+
+    Stack[StackSize++] = {0, NumFrusta < 32 ? (1u << NumFrusta) - 1u : ~0u, 0};
+    while (StackSize > 0)
+    {
+        const StackEntry Entry    = Stack[--StackSize];
+        const Node&      CurrNode = m_Nodes[Entry.NodeIdx];
+
+        Uint32 PartialMask = 0;
+        Uint32 InsideMask  = Entry.InsideMask;
+        for (Uint32 Frustum = 0; Frustum < NumFrusta; ++Frustum)
+        {
+            const Uint32 FrustumBit = 1u << Frustum;
+            if ((Entry.PartialMask & FrustumBit) == 0)
+                continue;
+
+            const auto Visibility = GetBoxVisibility(pFrusta[Frustum], CurrNode.Box, PlaneFlags);
+            if (Visibility == BoxVisibility::FullyVisible)
+                InsideMask |= FrustumBit;
+            else if (Visibility == BoxVisibility::Intersecting)
+                PartialMask |= FrustumBit;
+        }
+
+        if ((PartialMask | InsideMask) == 0)
+            continue;
+
+        if (CurrNode.NumItems == 0)
+        {
+            VERIFY_EXPR(StackSize + 2 <= _countof(Stack));
+            // Push the right child first so that the left one is processed first
+            Stack[StackSize++] = {CurrNode.RightChild, PartialMask, InsideMask};
+            Stack[StackSize++] = {Entry.NodeIdx + 1, PartialMask, InsideMask};
+            continue;
+        }
+
+        for (Uint32 i = CurrNode.FirstItem; i < CurrNode.FirstItem + CurrNode.NumItems; ++i)
+        {
+            const Uint32 Item = m_Items[i];
+
+            Uint32 VisibleMask = InsideMask;
+            if (PartialMask != 0 && CurrNode.NumItems > 1)
+            {
+                // The leaf box is the union of the item boxes, so test the items individually
+                for (Uint32 Frustum = 0; Frustum < NumFrusta; ++Frustum)
+                {
+                    const Uint32 FrustumBit = 1u << Frustum;
+                    if ((PartialMask & FrustumBit) != 0 && GetBoxVisibility(pFrusta[Frustum], m_ItemBoxes[Item], PlaneFlags) != BoxVisibility::Invisible)
+                        VisibleMask |= FrustumBit;
+                }
+            }
+            else
+            {
+                VisibleMask |= PartialMask;
+            }
+
+            for (Uint32 Frustum = 0; Frustum < NumFrusta; ++Frustum)
+            {
+                if ((VisibleMask & (1u << Frustum)) != 0)
+                    pVisibleItems[Frustum].push_back(Item);
+            }
+        }
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "AdvancedMath.hpp"
+
+namespace Diligent
+{
+
+/// Bounding volume hierarchy over the bounding boxes of the mesh parts.
+
+/// The hierarchy is built once when the mesh is loaded. Cull() traverses it once for
+/// several view frusta (e.g. all shadow cascades) and produces a list of visible items
+/// for every frustum. Subtrees that are outside of a frustum are skipped, and subtrees that
+/// are fully inside of it are accepted without testing their children against that frustum.
+class MeshBVH
+{
+public:
+    static constexpr Uint32 MaxFrusta = 32;
+
+    /// Builds the hierarchy. Item indices reported by Cull() are indices in the Boxes array.
+    void Build(const std::vector<BoundBox>& Boxes);
+
+    /// Culls the items against NumFrusta frusta and writes the indices of the items visible
+    /// in frustum i to pVisibleItems[i]. Items are listed in the order of the hierarchy leaves,
+    /// so that items that are close in space are also close in the lists.
+    void Cull(const ViewFrustumExt* pFrusta,
+              Uint32                NumFrusta,
+              FRUSTUM_PLANE_FLAGS   PlaneFlags,
+              std::vector<Uint32>*  pVisibleItems) const;
+
+    Uint32 GetNumNodes() const { return static_cast<Uint32>(m_Nodes.size()); }
+
+private:
+    Uint32 BuildNode(Uint32 FirstItem, Uint32 NumItems, const std::vector<float3>& Centers);
+
+    struct Node
+    {
+        BoundBox Box;
+        // Leaf nodes reference NumItems elements of m_Items starting with FirstItem.
+        // Internal nodes have NumItems == 0; their left child immediately follows
+        // the node, and the right child is at index RightChild.
+        Uint32 FirstItem  = 0;
+        Uint32 NumItems   = 0;
+        Uint32 RightChild = 0;
+    };
+    std::vector<Node>     m_Nodes;
+    std::vector<Uint32>   m_Items;
+    std::vector<BoundBox> m_ItemBoxes;
+};
+
+} // namespace Diligent
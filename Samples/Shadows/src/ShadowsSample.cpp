@@ -40,10 +40,21 @@
 #include "CallbackWrapper.hpp"
 #include "Utilities/interface/DiligentFXShaderSourceStreamFactory.hpp"
 #include "ShaderSourceFactoryUtils.hpp"
+#include "TimelineProfiler.hpp"
+
+#include <thread>
 
 namespace Diligent
 {
 
+namespace
+{
+
+// Every cascade is recorded into its own deferred context
+constexpr Uint32 MaxCascades = 8;
+
+} // namespace
+
 SampleBase* CreateSample()
 {
     return new ShadowsSample();
@@ -58,6 +69,7 @@ void ShadowsSample::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attr
     SampleBase::ModifyEngineInitInfo(Attribs);
 
     Attribs.EngineCI.Features.DepthClamp = DEVICE_FEATURE_STATE_OPTIONAL;
+    Attribs.EngineCI.NumDeferredContexts = MaxCascades;
 
 #if D3D12_SUPPORTED
     if (Attribs.DeviceType == RENDER_DEVICE_TYPE_D3D12)
@@ -79,6 +91,30 @@ void ShadowsSample::Initialize(const SampleInitInfo& InitInfo)
     FileSystem::GetPathComponents(MeshFileName, &Directory, nullptr);
     m_Mesh.LoadGPUResources(Directory.c_str(), m_pDevice, m_pImmediateContext);
 
+    {
+        std::vector<BoundBox> MeshBoxes(m_Mesh.GetNumMeshes());
+        for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+        {
+            const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+            MeshBoxes[meshIdx].Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
+            MeshBoxes[meshIdx].Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
+        }
+        m_MeshBVH.Build(MeshBoxes);
+    }
+    m_CascadeVisibleMeshes.resize(MaxCascades);
+    m_CascadeCameraAttribs.resize(MaxCascades);
+
+    // Deferred contexts are not available in some backends (e.g. OpenGL), in which case
+    // all cascades are recorded into the immediate context.
+    if (m_pDeferredContexts.size() >= MaxCascades)
+    {
+        // The main thread records cascades too while it waits for the workers,
+        // so there is no use in having more threads than cascades.
+        const Uint32 NumWorkers = std::min(std::max(std::thread::hardware_concurrency(), 1u) - 1u, MaxCascades - 1u);
+        m_pTaskScheduler.reset(new TaskScheduler{NumWorkers});
+        m_CascadeCmdLists.resize(MaxCascades);
+    }
+
     m_LightAttribs.ShadowAttribs.iNumCascades     = 4;
     m_LightAttribs.ShadowAttribs.fFixedDepthBias  = 0.0025f;
     m_LightAttribs.ShadowAttribs.iFixedFilterSize = 5;
@@ -146,9 +182,12 @@ void ShadowsSample::UpdateUI()
             }
         }
 
-        if (ImGui::SliderInt("Num cascades", &m_LightAttribs.ShadowAttribs.iNumCascades, 1, 8))
+        if (ImGui::SliderInt("Num cascades", &m_LightAttribs.ShadowAttribs.iNumCascades, 1, static_cast<int>(MaxCascades)))
             CreateShadowMap();
 
+        if (m_pTaskScheduler)
+            ImGui::Checkbox("Parallel cascade recording", &m_ShadowSettings.ParallelRecording);
+
         {
             int Is32Bit = m_ShadowSettings.Format == TEX_FORMAT_D16_UNORM ? 0 : 1;
             if (ImGui::Combo("Shadow map format", &Is32Bit,
@@ -271,6 +310,14 @@ void ShadowsSample::UpdateUI()
             ImGui::Checkbox("Shadows only", &m_LightAttribs.ShadowAttribs.bVisualizeShadowing);
             ImGui::TreePop();
         }
+
+        if (ImGui::TreeNode("Visible meshes"))
+        {
+            ImGui::Text("Camera: %d / %d", static_cast<int>(m_VisibleMeshes.size()), static_cast<int>(m_Mesh.GetNumMeshes()));
+            for (int iCascade = 0; iCascade < m_LightAttribs.ShadowAttribs.iNumCascades; ++iCascade)
+                ImGui::Text("Cascade %d: %d", iCascade, static_cast<int>(m_CascadeVisibleMeshes[iCascade].size()));
+            ImGui::TreePop();
+        }
     }
     ImGui::End();
 }
@@ -439,9 +486,7 @@ void ShadowsSample::CreatePipelineStates()
 void ShadowsSample::InitializeResourceBindings()
 {
     m_SRBs.clear();
-    m_ShadowSRBs.clear();
     m_SRBs.resize(m_Mesh.GetNumMaterials());
-    m_ShadowSRBs.resize(m_Mesh.GetNumMaterials());
     for (Uint32 mat = 0; mat < m_Mesh.GetNumMaterials(); ++mat)
     {
         {
@@ -461,13 +506,12 @@ void ShadowsSample::InitializeResourceBindings()
             }
             m_SRBs[mat] = std::move(pSRB);
         }
-
-        {
-            RefCntAutoPtr<IShaderResourceBinding> pShadowSRB;
-            m_RenderMeshShadowPSO[0]->CreateShaderResourceBinding(&pShadowSRB, true);
-            m_ShadowSRBs[mat] = std::move(pShadowSRB);
-        }
     }
+
+    // Shadow pass only uses static resources, so a single SRB serves all materials
+    // and does not need to be recommitted between subsets.
+    m_ShadowSRB.Release();
+    m_RenderMeshShadowPSO[0]->CreateShaderResourceBinding(&m_ShadowSRB, true);
 }
 
 void ShadowsSample::CreateShadowMap()
@@ -515,20 +559,46 @@ void ShadowsSample::CreateShadowMap()
     InitializeResourceBindings();
 }
 
+bool ShadowsSample::UseParallelShadowRecording() const
+{
+    return m_ShadowSettings.ParallelRecording && m_pTaskScheduler && m_LightAttribs.ShadowAttribs.iNumCascades > 1;
+}
+
+void ShadowsSample::RenderCascade(IDeviceContext* pCtx, int iCascade)
+{
+    {
+        // Dynamic buffers must be mapped in every context that uses them
+        MapHelper<CameraAttribs> CameraData(pCtx, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CameraData = m_CascadeCameraAttribs[iCascade];
+    }
+
+    // The shadow map has been transitioned to the depth write state by the immediate context,
+    // here we only verify the state.
+    auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
+    pCtx->SetRenderTargets(0, nullptr, pCascadeDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    pCtx->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+    DrawMesh(pCtx, true, m_CascadeVisibleMeshes[iCascade]);
+}
+
 void ShadowsSample::RenderShadowMap()
 {
-    auto iNumShadowCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
+    const auto iNumShadowCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
+    VERIFY_EXPR(iNumShadowCascades > 0 && iNumShadowCascades <= static_cast<int>(MaxCascades));
+
+    const auto& WorldToLightViewSpaceMatr = m_PackMatrixRowMajor ?
+        m_LightAttribs.ShadowAttribs.mWorldToLightView :
+        m_LightAttribs.ShadowAttribs.mWorldToLightView.Transpose();
+
+    ViewFrustumExt CascadeFrusta[MaxCascades];
     for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
     {
         const auto CascadeProjMatr = m_ShadowMapMgr.GetCascadeTransform(iCascade).Proj;
 
-        const auto& WorldToLightViewSpaceMatr = m_PackMatrixRowMajor ?
-            m_LightAttribs.ShadowAttribs.mWorldToLightView :
-            m_LightAttribs.ShadowAttribs.mWorldToLightView.Transpose();
-
         const auto WorldToLightProjSpaceMatr = WorldToLightViewSpaceMatr * CascadeProjMatr;
 
-        CameraAttribs ShadowCameraAttribs = {};
+        CameraAttribs& ShadowCameraAttribs = m_CascadeCameraAttribs[iCascade];
+        ShadowCameraAttribs                = {};
 
         ShadowCameraAttribs.mView = m_LightAttribs.ShadowAttribs.mWorldToLightView;
         WriteShaderMatrix(&ShadowCameraAttribs.mProj, CascadeProjMatr, !m_PackMatrixRowMajor);
@@ -539,20 +609,76 @@ void ShadowsSample::RenderShadowMap()
         ShadowCameraAttribs.f4ViewportSize.z = 1.f / ShadowCameraAttribs.f4ViewportSize.x;
         ShadowCameraAttribs.f4ViewportSize.w = 1.f / ShadowCameraAttribs.f4ViewportSize.y;
 
+        ExtractViewFrustumPlanesFromMatrix(WorldToLightProjSpaceMatr, CascadeFrusta[iCascade], m_pDevice->GetDeviceInfo().IsGLDevice());
+    }
+
+    {
+        TimelineProfiler::CpuScope ProfilerScope{"Cull shadow cascades"};
+        // Cull the meshes against all cascades in a single traversal of the hierarchy.
+        // Notice that for shadow pass we test against frustum with open near plane.
+        m_MeshBVH.Cull(CascadeFrusta, static_cast<Uint32>(iNumShadowCascades), FRUSTUM_PLANE_FLAG_OPEN_NEAR, m_CascadeVisibleMeshes.data());
+    }
+
+    // Transition the shadow map and the shadow pass resources in the immediate context,
+    // so that the cascades can be recorded in any context in VERIFY mode.
+    StateTransitionDesc ShadowMapBarrier{m_ShadowMapMgr.GetCascadeDSV(0)->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_DEPTH_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &ShadowMapBarrier);
+    m_pImmediateContext->TransitionShaderResources(m_ShadowSRB);
+
+    if (UseParallelShadowRecording())
+    {
+        const Uint32 NumThreads = m_pTaskScheduler->GetNumThreads();
+
+        // Cascade i is always recorded into deferred context i by thread i % NumThreads.
+        // Pinning the cascade to a thread lets FinishFrame() below run on the thread
+        // that recorded the commands, which is required by Metal.
+        std::vector<TaskScheduler::TaskHandle> Tasks(iNumShadowCascades);
+        for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
         {
-            MapHelper<CameraAttribs> CameraData(m_pImmediateContext, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-            *CameraData = ShadowCameraAttribs;
+            Tasks[iCascade] = m_pTaskScheduler->Submit(
+                [this, iCascade](Uint32) {
+                    TimelineProfiler::CpuScope ProfilerScope{"Record shadow cascade"};
+
+                    IDeviceContext* pCtx = m_pDeferredContexts[iCascade];
+                    pCtx->Begin(0);
+                    RenderCascade(pCtx, iCascade);
+                    pCtx->FinishCommandList(&m_CascadeCmdLists[iCascade]);
+                },
+                {}, static_cast<Uint32>(iCascade) % NumThreads);
         }
+        for (const auto& pTask : Tasks)
+            m_pTaskScheduler->Wait(pTask);
+
+        m_CascadeCmdListPtrs.clear();
+        for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
+            m_CascadeCmdListPtrs.push_back(m_CascadeCmdLists[iCascade]);
 
-        auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
-        m_pImmediateContext->SetRenderTargets(0, nullptr, pCascadeDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        {
+            TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Shadow cascades"};
+            m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CascadeCmdListPtrs.size()), m_CascadeCmdListPtrs.data());
+        }
 
-        ViewFrustumExt Frutstum;
-        ExtractViewFrustumPlanesFromMatrix(WorldToLightProjSpaceMatr, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
+        // Release command lists now to release all outstanding references
+        for (auto& pCmdList : m_CascadeCmdLists)
+            pCmdList.Release();
 
-        //if (iCascade == 0)
-        DrawMesh(m_pImmediateContext, true, Frutstum);
+        // Release dynamic resources allocated by the deferred contexts. This must be done
+        // after the command lists have been submitted for execution.
+        for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
+        {
+            Tasks[iCascade] = m_pTaskScheduler->Submit(
+                [this, iCascade](Uint32) {
+                    m_pDeferredContexts[iCascade]->FinishFrame();
+                },
+                {}, static_cast<Uint32>(iCascade) % NumThreads);
+        }
+        for (const auto& pTask : Tasks)
+            m_pTaskScheduler->Wait(pTask);
+    }
+    else
+    {
+        for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
+            RenderCascade(m_pImmediateContext, iCascade);
     }
 
     if (m_ShadowSettings.iShadowMode > SHADOW_MODE_PCF)
@@ -599,42 +725,63 @@ void ShadowsSample::Render()
 
     ViewFrustumExt Frutstum;
     ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
-    DrawMesh(m_pImmediateContext, false, Frutstum);
+    m_MeshBVH.Cull(&Frutstum, 1, FRUSTUM_PLANE_FLAG_FULL_FRUSTUM, &m_VisibleMeshes);
+
+    // Note that Vulkan requires shadow map to be transitioned to DEPTH_READ state, not SHADER_RESOURCE
+    m_pImmediateContext->TransitionShaderResources(m_SRBs[0]);
+    DrawMesh(m_pImmediateContext, false, m_VisibleMeshes);
 }
 
 
-void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const ViewFrustumExt& Frustum)
+void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const std::vector<Uint32>& VisibleMeshes)
 {
-    // Note that Vulkan requires shadow map to be transitioned to DEPTH_READ state, not SHADER_RESOURCE
-    pCtx->TransitionShaderResources((bIsShadowPass ? m_ShadowSRBs : m_SRBs)[0]);
-
-    for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+    // Resources have been transitioned by the immediate context, and this function
+    // may be called for a deferred context, so here we only verify the states.
+    // Redundant state changes between consecutive meshes are skipped.
+    IPipelineState*         pCurrPSO = nullptr;
+    IShaderResourceBinding* pCurrSRB = nullptr;
+    IBuffer*                pCurrVB  = nullptr;
+    IBuffer*                pCurrIB  = nullptr;
+    for (Uint32 meshIdx : VisibleMeshes)
     {
         const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
-        BoundBox    BB;
-        BB.Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
-        BB.Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
-        // Notice that for shadow pass we test against frustum with open near plane
-        if (GetBoxVisibility(Frustum, BB, bIsShadowPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) == BoxVisibility::Invisible)
-            continue;
 
-        IBuffer* pVBs[] = {m_Mesh.GetMeshVertexBuffer(meshIdx, 0)};
-        pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+        IBuffer* pVB = m_Mesh.GetMeshVertexBuffer(meshIdx, 0);
+        if (pVB != pCurrVB)
+        {
+            IBuffer* pVBs[] = {pVB};
+            pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+            pCurrVB = pVB;
+        }
 
         auto* pIB      = m_Mesh.GetMeshIndexBuffer(meshIdx);
         auto  IBFormat = m_Mesh.GetIBFormat(meshIdx);
-
-        pCtx->SetIndexBuffer(pIB, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        if (pIB != pCurrIB)
+        {
+            pCtx->SetIndexBuffer(pIB, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCurrIB = pIB;
+        }
 
         auto  PSOIndex = m_PSOIndex[SubMesh.VertexBuffers[0]];
-        auto& pPSO     = (bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[PSOIndex];
-        pCtx->SetPipelineState(pPSO);
+        auto* pPSO     = (bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[PSOIndex].RawPtr();
+        if (pPSO != pCurrPSO)
+        {
+            pCtx->SetPipelineState(pPSO);
+            pCurrPSO = pPSO;
+            pCurrSRB = nullptr;
+        }
 
         // Draw all subsets
         for (Uint32 subsetIdx = 0; subsetIdx < SubMesh.NumSubsets; ++subsetIdx)
         {
             const auto& Subset = m_Mesh.GetSubset(meshIdx, subsetIdx);
-            pCtx->CommitShaderResources((bIsShadowPass ? m_ShadowSRBs : m_SRBs)[Subset.MaterialID], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+            auto* pSRB = bIsShadowPass ? m_ShadowSRB.RawPtr() : m_SRBs[Subset.MaterialID].RawPtr();
+            if (pSRB != pCurrSRB)
+            {
+                pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+                pCurrSRB = pSRB;
+            }
 
             DrawIndexedAttribs drawAttrs(static_cast<Uint32>(Subset.IndexCount), IBFormat, DRAW_FLAG_VERIFY_ALL);
             drawAttrs.FirstIndexLocation = static_cast<Uint32>(Subset.IndexStart);
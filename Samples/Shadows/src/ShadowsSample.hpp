@@ -27,12 +27,17 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
 #include "DXSDKMeshLoader.hpp"
 #include "FirstPersonCamera.hpp"
 #include "ShadowMapManager.hpp"
 #include "RenderStateNotationLoader.h"
+#include "TaskScheduler.hpp"
+#include "MeshBVH.hpp"
 
 namespace Diligent
 {
@@ -55,11 +60,13 @@ public:
     virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
 
 private:
-    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const struct ViewFrustumExt& Frustum);
+    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const std::vector<Uint32>& VisibleMeshes);
     void CreatePipelineStates();
     void InitializeResourceBindings();
     void CreateShadowMap();
     void RenderShadowMap();
+    void RenderCascade(IDeviceContext* pCtx, int iCascade);
+    bool UseParallelShadowRecording() const;
     void UpdateUI();
 
     static void DXSDKMESH_VERTEX_ELEMENTtoInputLayoutDesc(const DXSDKMESH_VERTEX_ELEMENT* VertexElement,
@@ -80,11 +87,25 @@ private:
         int            iShadowMode          = SHADOW_MODE_PCF;
 
         bool Is32BitFilterableFmt = true;
+
+        // Record every cascade into its own deferred context on the worker threads
+        bool ParallelRecording = true;
     } m_ShadowSettings;
 
     bool m_PackMatrixRowMajor = true;
 
     DXSDKMesh m_Mesh;
+    // Hierarchy over the bounding boxes of m_Mesh meshes
+    MeshBVH m_MeshBVH;
+
+    // Indices of the meshes visible in the camera frustum and in every shadow cascade
+    std::vector<Uint32>              m_VisibleMeshes;
+    std::vector<std::vector<Uint32>> m_CascadeVisibleMeshes;
+    std::vector<CameraAttribs>       m_CascadeCameraAttribs;
+
+    std::unique_ptr<TaskScheduler>           m_pTaskScheduler;
+    std::vector<RefCntAutoPtr<ICommandList>> m_CascadeCmdLists;
+    std::vector<ICommandList*>               m_CascadeCmdListPtrs;
 
     LightAttribs      m_LightAttribs;
     FirstPersonCamera m_Camera;
@@ -98,7 +119,7 @@ private:
     std::vector<RefCntAutoPtr<IPipelineState>>         m_RenderMeshPSO;
     std::vector<RefCntAutoPtr<IPipelineState>>         m_RenderMeshShadowPSO;
     std::vector<RefCntAutoPtr<IShaderResourceBinding>> m_SRBs;
-    std::vector<RefCntAutoPtr<IShaderResourceBinding>> m_ShadowSRBs;
+    RefCntAutoPtr<IShaderResourceBinding>              m_ShadowSRB;
 
     RefCntAutoPtr<IRenderStateNotationLoader> m_pRSNLoader;
 
@@ -149,8 +149,8 @@ void Tutorial04_Instancing::PopulateInstanceBuffer()
 
     float fGridSize = static_cast<float>(m_GridSize);
 
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> scale_distr(0.3f, 1.0f);
     std::uniform_real_distribution<float> offset_distr(-0.15f, +0.15f);
@@ -37,6 +37,8 @@
 #include "../../Common/src/TexturedCube.hpp"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
+#include "TimelineProfiler.hpp"
+#include "Timer.hpp"
 
 namespace Diligent
 {
@@ -186,8 +188,8 @@ void Tutorial06_Multithreading::PopulateInstanceData()
     // Populate instance data buffer
     float fGridSize = static_cast<float>(m_GridSize);
 
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> scale_distr(0.3f, 1.0f);
     std::uniform_real_distribution<float> offset_distr(-0.15f, +0.15f);
@@ -225,78 +227,59 @@ void Tutorial06_Multithreading::PopulateInstanceData()
 
 void Tutorial06_Multithreading::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
+    m_pTaskScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
+    m_ThreadContextStarted.resize(NumThreads + 1);
     m_CmdLists.resize(NumThreads);
+    m_ThreadingStats.ThreadRecordTime.resize(NumThreads + 1);
 }
 
 void Tutorial06_Multithreading::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pTaskScheduler.reset();
+    m_ThreadContextStarted.clear();
     m_CmdLists.clear();
+    m_ThreadingStats.ThreadRecordTime.clear();
 }
 
-void Tutorial06_Multithreading::WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum)
+std::vector<SampleBase::ScalingBenchmarkParam> Tutorial06_Multithreading::GetScalingBenchmarkParams() const
 {
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        pThis->RenderSubset(pDeferredCtx, 1 + ThreadNum);
+    return {
+        GetThreadsBenchmarkParam(m_MaxThreads + 1),
+        {"grid", {8, 16, 32}},
+    };
+}
 
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
+void Tutorial06_Multithreading::SetScalingBenchmarkConfig(const std::vector<int>& Values)
+{
+    VERIFY_EXPR(Values.size() == 2);
 
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
+    const int NumWorkerThreads = clamp(Values[0] - 1, 0, m_MaxThreads);
+    if (NumWorkerThreads != m_NumWorkerThreads)
+    {
+        m_NumWorkerThreads = NumWorkerThreads;
+        StopWorkerThreads();
+        StartWorkerThreads(m_NumWorkerThreads);
+    }
 
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread going through the loop twice in
-        // a row.
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
+    const int GridSize = clamp(Values[1], 1, 32);
+    if (GridSize != m_GridSize)
+    {
+        m_GridSize = GridSize;
+        PopulateInstanceData();
     }
 }
 
-void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+IDeviceContext* Tutorial06_Multithreading::GetThreadContext(Uint32 ThreadId)
 {
+    // Thread 0 is the main thread that uses the immediate context.
+    // Every worker thread uses its own deferred context.
+    IDeviceContext* pCtx = ThreadId == 0 ? m_pImmediateContext.RawPtr() : m_pDeferredContexts[ThreadId - 1].RawPtr();
+    if (m_ThreadContextStarted[ThreadId])
+        return pCtx;
+
+    if (ThreadId != 0)
+        pCtx->Begin(0);
+
     // Deferred contexts start in default state. We must bind everything to the context.
     // Render targets are set and transitioned to correct states by the main thread, here we only verify the states.
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
@@ -317,18 +300,20 @@ void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset
     pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
     pCtx->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
+    // Set the pipeline state
+    pCtx->SetPipelineState(m_pPSO);
+
+    m_ThreadContextStarted[ThreadId] = 1;
+    return pCtx;
+}
+
+void Tutorial06_Multithreading::RenderInstances(IDeviceContext* pCtx, Uint32 StartInst, Uint32 EndInst)
+{
     DrawIndexedAttribs DrawAttrs;     // This is an indexed draw call
     DrawAttrs.IndexType  = VT_UINT32; // Index type
     DrawAttrs.NumIndices = 36;
     DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
 
-    // Set the pipeline state
-    pCtx->SetPipelineState(m_pPSO);
-    Uint32 NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    Uint32 NumInstances = static_cast<Uint32>(m_InstanceData.size());
-    Uint32 SusbsetSize  = NumInstances / NumSubsets;
-    Uint32 StartInst    = SusbsetSize * Subset;
-    Uint32 EndInst      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : NumInstances;
     for (size_t inst = StartInst; inst < EndInst; ++inst)
     {
         const auto& CurrInstData = m_InstanceData[inst];
@@ -369,23 +354,55 @@ void Tutorial06_Multithreading::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
-    {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
-    }
+    const auto NumThreads   = m_pTaskScheduler->GetNumThreads();
+    const auto NumInstances = static_cast<Uint32>(m_InstanceData.size());
+    std::fill(m_ThreadContextStarted.begin(), m_ThreadContextStarted.end(), Uint8{0});
+    std::fill(m_ThreadingStats.ThreadRecordTime.begin(), m_ThreadingStats.ThreadRecordTime.end(), 0.0);
+    m_ThreadingStats.ExecuteTime = 0;
+
+    Timer RecordTimer;
 
-    RenderSubset(m_pImmediateContext, 0);
+    // Split the instances into chunks that are several times smaller than the per-thread share,
+    // so that threads that finish early steal the remaining work.
+    const Uint32 GrainSize = std::max(NumInstances / (NumThreads * 4), 16u);
+    m_pTaskScheduler->ParallelFor(0, NumInstances, GrainSize,
+                                  [this](Uint32 ThreadId, Uint32 StartInst, Uint32 EndInst) {
+                                      TimelineProfiler::CpuScope ProfilerScope{"Record instances"};
 
-    if (!m_WorkerThreads.empty())
+                                      Timer ChunkTimer;
+                                      RenderInstances(GetThreadContext(ThreadId), StartInst, EndInst);
+                                      m_ThreadingStats.ThreadRecordTime[ThreadId] += ChunkTimer.GetElapsedTime();
+                                  });
+
+    if (NumThreads > 1)
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
+        // Finish command lists on the threads that recorded them
+        m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) {
+            if (ThreadId != 0 && m_ThreadContextStarted[ThreadId])
+            {
+                TimelineProfiler::CpuScope ProfilerScope{"Finish command list"};
 
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
+                Timer FinishTimer;
+                m_pDeferredContexts[ThreadId - 1]->FinishCommandList(&m_CmdLists[ThreadId - 1]);
+                m_ThreadingStats.ThreadRecordTime[ThreadId] += FinishTimer.GetElapsedTime();
+            }
+        });
+        m_ThreadingStats.RecordTime = RecordTimer.GetElapsedTime();
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        m_CmdListPtrs.clear();
+        for (auto& pCmdList : m_CmdLists)
+        {
+            if (pCmdList)
+                m_CmdListPtrs.push_back(pCmdList);
+        }
+
+        {
+            TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Command lists"};
+
+            Timer ExecuteTimer;
+            m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+            m_ThreadingStats.ExecuteTime = ExecuteTimer.GetElapsedTime();
+        }
 
         for (auto& cmdList : m_CmdLists)
         {
@@ -395,8 +412,19 @@ void Tutorial06_Multithreading::Render()
             cmdList.Release();
         }
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+        m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) {
+            // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+            // IMPORTANT: we must wait until the command lists are submitted for execution
+            //            because FinishFrame() invalidates all dynamic resources.
+            // IMPORTANT: In Metal backend FinishFrame must be called from the same
+            //            thread that issued rendering commands.
+            if (ThreadId != 0 && m_ThreadContextStarted[ThreadId])
+                m_pDeferredContexts[ThreadId - 1]->FinishFrame();
+        });
+    }
+    else
+    {
+        m_ThreadingStats.RecordTime = RecordTimer.GetElapsedTime();
     }
 }
 
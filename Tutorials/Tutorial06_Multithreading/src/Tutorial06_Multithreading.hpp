@@ -27,13 +27,11 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
-#include <thread>
-#include <mutex>
+#include <memory>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -50,6 +48,10 @@ public:
 
     virtual const Char* GetSampleName() const override final { return "Tutorial06: Multithreaded rendering"; }
 
+    virtual std::vector<ScalingBenchmarkParam> GetScalingBenchmarkParams() const override final;
+    virtual void                               SetScalingBenchmarkConfig(const std::vector<int>& Values) override final;
+    virtual const ThreadingStats*              GetThreadingStats() const override final { return &m_ThreadingStats; }
+
 private:
     void CreatePipelineState(std::vector<StateTransitionDesc>& Barriers);
     void LoadTextures(std::vector<StateTransitionDesc>& Barriers);
@@ -59,16 +61,13 @@ private:
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
-
-    static void WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum);
+    IDeviceContext* GetThreadContext(Uint32 ThreadId);
+    void            RenderInstances(IDeviceContext* pCtx, Uint32 StartInst, Uint32 EndInst);
 
-    Threading::Signal        m_RenderSubsetSignal;
-    Threading::Signal        m_ExecuteCommandListsSignal;
-    Threading::Signal        m_GotoNextFrameSignal;
-    std::atomic_int          m_NumThreadsCompleted;
-    std::atomic_int          m_NumThreadsReady;
-    std::vector<std::thread> m_WorkerThreads;
+    std::unique_ptr<TaskScheduler> m_pTaskScheduler;
+    // Whether the thread has started recording commands in the current frame.
+    // Every element is only accessed by its own thread while rendering.
+    std::vector<Uint8> m_ThreadContextStarted;
 
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
@@ -97,6 +96,9 @@ private:
         int      TextureInd = 0;
     };
     std::vector<InstanceData> m_InstanceData;
+
+    // Recording times of the last frame. ThreadRecordTime[i] is only written by thread i.
+    ThreadingStats m_ThreadingStats;
 };
 
 } // namespace Diligent
@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <limits>
 #include <cstdlib>
+#include <numeric>
 
 #include "Tutorial09_Quads.hpp"
 #include "MapHelper.hpp"
@@ -40,6 +41,10 @@
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
 #include "CommandLineParser.hpp"
+#include "ShaderMacroHelper.hpp"
+#include "RadixSort.hpp"
+#include "TimelineProfiler.hpp"
+#include "Timer.hpp"
 
 namespace Diligent
 {
@@ -69,6 +74,8 @@ Tutorial09_Quads::CommandLineStatus Tutorial09_Quads::ProcessCommandLine(int arg
     {
         m_NumWorkerThreads = clamp(m_NumWorkerThreads, 0, 128);
     }
+    ArgsParser.Parse("gpu_anim", 'g', m_GpuAnimation);
+    ArgsParser.Parse("sort", 's', m_SortByState);
 
     return CommandLineStatus::OK;
 }
@@ -271,6 +278,82 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
         }
 #endif
     }
+
+    if (!m_GpuAnimationSupported)
+        return;
+
+    // GPU animation mode: the compute shader updates the quad states in the structured buffer,
+    // and the vertex shader fetches the state of every instance from the same buffer.
+    CreateUniformBuffer(m_pDevice, sizeof(GpuQuadConstants), "GPU quad constants CB", &m_GpuQuadConstantsCB);
+    Barriers.emplace_back(m_GpuQuadConstantsCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+
+    RefCntAutoPtr<IShader> pVSGpu;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+        ShaderCI.Desc.Name       = "Quad VS GPU";
+        ShaderCI.FilePath        = "quad_gpu.vsh";
+        m_pDevice->CreateShader(ShaderCI, &pVSGpu);
+    }
+
+    RefCntAutoPtr<IShader> pUpdateQuadsCS;
+    {
+        ShaderMacroHelper CSMacros;
+        CSMacros.AddShaderMacro("THREAD_GROUP_SIZE", Uint32{UpdateQuadsGroupSize});
+
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = "Update quads CS";
+        ShaderCI.FilePath        = "update_quads.csh";
+        ShaderCI.Macros          = CSMacros;
+        m_pDevice->CreateShader(ShaderCI, &pUpdateQuadsCS);
+    }
+
+    PSOCreateInfo.PSODesc.Name = "GPU Quads PSO";
+    // The quad attributes are read from the structured buffer, so there is no input layout
+    PSOCreateInfo.GraphicsPipeline.InputLayout = InputLayoutDesc{};
+
+    // clang-format off
+    ShaderResourceVariableDesc GpuVars[] = 
+    {
+        {SHADER_TYPE_PIXEL,  "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_VERTEX, "g_Quads",   SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+    };
+    // clang-format on
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = GpuVars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(GpuVars);
+
+    PSOCreateInfo.pVS = pVSGpu;
+    PSOCreateInfo.pPS = pPSBatched;
+
+    for (int state = 0; state < NumStates; ++state)
+    {
+        PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pGpuPSO[state]);
+        m_pGpuPSO[state]->GetStaticVariableByName(SHADER_TYPE_VERTEX, "QuadConstants")->Set(m_GpuQuadConstantsCB);
+#ifdef DILIGENT_DEBUG
+        if (state > 0)
+        {
+            VERIFY(m_pGpuPSO[state]->IsCompatibleWith(m_pGpuPSO[0]), "PSOs are expected to be compatible");
+        }
+#endif
+    }
+
+    ComputePipelineStateCreateInfo CompPSOCreateInfo;
+    CompPSOCreateInfo.PSODesc.Name         = "Update quads PSO";
+    CompPSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    CompPSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+    // clang-format off
+    ShaderResourceVariableDesc CompVars[] = 
+    {
+        {SHADER_TYPE_COMPUTE, "QuadConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}
+    };
+    // clang-format on
+    CompPSOCreateInfo.PSODesc.ResourceLayout.Variables    = CompVars;
+    CompPSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(CompVars);
+
+    CompPSOCreateInfo.pCS = pUpdateQuadsCS;
+    m_pDevice->CreateComputePipelineState(CompPSOCreateInfo, &m_pUpdateQuadsPSO);
+    m_pUpdateQuadsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "QuadConstants")->Set(m_GpuQuadConstantsCB);
 }
 
 void Tutorial09_Quads::LoadTextures(std::vector<StateTransitionDesc>& Barriers)
@@ -348,19 +431,52 @@ void Tutorial09_Quads::UpdateUI()
             m_NumQuads = clamp(m_NumQuads, 1, MaxQuads);
             InitializeQuads();
         }
-        if (ImGui::InputInt("Batch Size", &m_BatchSize, 1, 5))
         {
-            m_BatchSize = clamp(m_BatchSize, 1, MaxBatchSize);
-            CreateInstanceBuffer();
+            ImGui::ScopedDisabler Disable(!m_GpuAnimationSupported);
+            if (ImGui::Checkbox("GPU animation", &m_GpuAnimation))
+            {
+                // The GPU starts from the current CPU state. When switching back, the CPU
+                // resumes from the state it had when the GPU animation was enabled.
+                if (m_GpuAnimation)
+                    CreateGpuQuadsBuffer();
+                m_GpuElapsedTime    = 0;
+                m_TimingsAccumTime  = 0;
+                m_CpuTimeAccum      = 0;
+                m_GpuTimeAccum      = 0;
+                m_NumCpuTimeSamples = 0;
+                m_NumGpuTimeSamples = 0;
+            }
+            ImGui::HelpMarker("Animate the quads with a compute shader and render every state with a single instanced draw call");
         }
         {
-            ImGui::ScopedDisabler Disable(m_MaxThreads == 0);
+            // Batching and multithreading only apply to the CPU path
+            ImGui::ScopedDisabler Disable(m_GpuAnimation);
+            if (ImGui::InputInt("Batch Size", &m_BatchSize, 1, 5))
+            {
+                m_BatchSize = clamp(m_BatchSize, 1, MaxBatchSize);
+                CreateInstanceBuffer();
+            }
+        }
+        {
+            ImGui::ScopedDisabler Disable(m_MaxThreads == 0 || m_GpuAnimation);
             if (ImGui::SliderInt("Worker Threads", &m_NumWorkerThreads, 0, m_MaxThreads))
             {
                 StopWorkerThreads();
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        {
+            ImGui::ScopedDisabler Disable(m_GpuAnimation);
+            ImGui::Checkbox("Sort by state", &m_SortByState);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Draws: %u, PSO switches: %u", m_NumDraws, m_NumPSOSwitches);
+        ImGui::Text("CPU time: %.3f ms", m_AvgCpuTime * 1000.0);
+        if (m_pGpuTimeQuery)
+            ImGui::Text("GPU time: %.3f ms", m_AvgGpuTime * 1000.0);
+        else
+            ImGui::TextDisabled("GPU time: not supported");
     }
     ImGui::End();
 }
@@ -373,6 +489,16 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
     m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
     m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxThreads);
 
+    const auto& Features    = m_pDevice->GetDeviceInfo().Features;
+    m_GpuAnimationSupported = Features.ComputeShaders != DEVICE_FEATURE_STATE_DISABLED;
+    if (m_GpuAnimation && !m_GpuAnimationSupported)
+    {
+        LOG_WARNING_MESSAGE("GPU animation requires compute shaders that are not supported by this device. Falling back to CPU animation.");
+        m_GpuAnimation = false;
+    }
+    if (Features.TimestampQueries)
+        m_pGpuTimeQuery.reset(new DurationQueryHelper{m_pDevice, 2});
+
     std::vector<StateTransitionDesc> Barriers;
     CreatePipelineStates(Barriers);
     LoadTextures(Barriers);
@@ -390,8 +516,8 @@ void Tutorial09_Quads::InitializeQuads()
 {
     m_Quads.resize(m_NumQuads);
 
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> scale_distr(0.01f, 0.05f);
     std::uniform_real_distribution<float> pos_distr(-0.95f, +0.95f);
@@ -415,12 +541,15 @@ void Tutorial09_Quads::InitializeQuads()
         CurrInst.TextureInd = tex_distr(gen);
         CurrInst.StateInd   = state_distr(gen);
     }
+
+    if (m_GpuAnimation)
+        CreateGpuQuadsBuffer();
 }
 
 void Tutorial09_Quads::UpdateQuads(float elapsedTime)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
     for (int quad = 0; quad < m_NumQuads; ++quad)
@@ -444,79 +573,97 @@ void Tutorial09_Quads::UpdateQuads(float elapsedTime)
 
 void Tutorial09_Quads::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
+    m_pTaskScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
     m_CmdLists.resize(NumThreads);
+    m_Subsets.resize(NumThreads + 1);
+    m_ThreadingStats.ThreadRecordTime.assign(NumThreads + 1, 0.0);
 }
 
 void Tutorial09_Quads::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pTaskScheduler.reset();
     m_CmdLists.clear();
+    m_Subsets.clear();
+    m_ThreadingStats.ThreadRecordTime.clear();
+}
+
+std::vector<SampleBase::ScalingBenchmarkParam> Tutorial09_Quads::GetScalingBenchmarkParams() const
+{
+    return {
+        GetThreadsBenchmarkParam(m_MaxThreads + 1),
+        {"quads", {1000, 10000, MaxQuads}},
+        {"batch", {1, 10, MaxBatchSize}},
+    };
 }
 
-void Tutorial09_Quads::WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum)
+void Tutorial09_Quads::SetScalingBenchmarkConfig(const std::vector<int>& Values)
 {
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx = pThis->m_pDeferredContexts[ThreadNum];
+    VERIFY_EXPR(Values.size() == 3);
 
-    const int NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
+    // Threads only record commands on the CPU path
+    if (m_GpuAnimation)
     {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
+        LOG_WARNING_MESSAGE("GPU animation is disabled in the thread scaling benchmark");
+        m_GpuAnimation = false;
+    }
 
-        pDeferredCtx->Begin(0);
+    const int NumWorkerThreads = clamp(Values[0] - 1, 0, m_MaxThreads);
+    if (NumWorkerThreads != m_NumWorkerThreads)
+    {
+        m_NumWorkerThreads = NumWorkerThreads;
+        StopWorkerThreads();
+        StartWorkerThreads(m_NumWorkerThreads);
+    }
+
+    const int NumQuads = clamp(Values[1], 1, MaxQuads);
+    if (NumQuads != m_NumQuads)
+    {
+        m_NumQuads = NumQuads;
+        InitializeQuads();
+    }
+
+    const int BatchSize = clamp(Values[2], 1, MaxBatchSize);
+    if (BatchSize != m_BatchSize)
+    {
+        m_BatchSize = BatchSize;
+        if (m_BatchSize > 1)
+            CreateInstanceBuffer();
+    }
+}
 
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
+void Tutorial09_Quads::RenderThreadSubset(Uint32 ThreadId)
+{
+    TimelineProfiler::CpuScope ProfilerScope{"Record subset"};
+
+    Timer RecordTimer;
+
+    if (ThreadId == 0)
+    {
+        // The main thread renders the first subset using the immediate context
+        if (m_BatchSize > 1)
+            RenderSubset<true>(m_pImmediateContext, 0);
         else
-            pThis->RenderSubset<false>(pDeferredCtx, 1 + ThreadNum);
+            RenderSubset<false>(m_pImmediateContext, 0);
+        m_ThreadingStats.ThreadRecordTime[0] = RecordTimer.GetElapsedTime();
+        return;
+    }
 
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
+    // Every worker thread uses its own deferred context
+    IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId - 1];
 
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
+    pDeferredCtx->Begin(0);
 
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
+    // Render current subset using the deferred context
+    if (m_BatchSize > 1)
+        RenderSubset<true>(pDeferredCtx, ThreadId);
+    else
+        RenderSubset<false>(pDeferredCtx, ThreadId);
 
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
+    // Finish command list
+    TimelineProfiler::CpuScope FinishScope{"Finish command list"};
+    pDeferredCtx->FinishCommandList(&m_CmdLists[ThreadId - 1]);
 
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
+    m_ThreadingStats.ThreadRecordTime[ThreadId] = RecordTimer.GetElapsedTime();
 }
 
 template <bool UseBatch>
@@ -536,38 +683,87 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
     DrawAttrs.NumVertices = 4;
 
-    Uint32       NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
+    const Uint32 BatchSize    = static_cast<Uint32>(m_BatchSize);
+    const Uint32 NumSubsets   = m_pTaskScheduler->GetNumThreads();
     const Uint32 TotalQuads   = static_cast<Uint32>(m_Quads.size());
-    const Uint32 TotalBatches = (TotalQuads + m_BatchSize - 1) / m_BatchSize;
+    const Uint32 TotalBatches = (TotalQuads + BatchSize - 1) / BatchSize;
     const Uint32 SusbsetSize  = TotalBatches / NumSubsets;
     const Uint32 StartBatch   = SusbsetSize * Subset;
     const Uint32 EndBatch     = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
-    for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
+    const Uint32 StartQuad    = StartBatch * BatchSize;
+    const Uint32 EndQuad      = std::min(EndBatch * BatchSize, TotalQuads);
+
+    auto& Order = m_Subsets[Subset].Order;
+    Order.resize(EndQuad - StartQuad);
+    std::iota(Order.begin(), Order.end(), StartQuad);
+    if (m_SortByState)
     {
-        const Uint32 StartInst = batch * m_BatchSize;
-        const Uint32 EndInst   = std::min(StartInst + static_cast<Uint32>(m_BatchSize), static_cast<Uint32>(m_NumQuads));
+        // The sort is stable, so the draw order is the same in every frame as long as the states do not change.
+        // In batched mode, the texture is selected from the texture array by the shader, so only the state matters.
+        static_assert(NumStates * NumTextures <= 256, "The key does not fit into 8 bits");
+        RadixSort(Order, m_Subsets[Subset].SortScratch, 8, [this](Uint32 Quad) {
+            const auto& QuadData = m_Quads[Quad];
+            return static_cast<Uint32>(UseBatch ? QuadData.StateInd : QuadData.StateInd * NumTextures + QuadData.TextureInd);
+        });
+    }
+
+    int    CurrState      = -1;
+    int    CurrTexture    = -1;
+    Uint32 NumDraws       = 0;
+    Uint32 NumPSOSwitches = 0;
+    for (size_t StartInst = 0; StartInst < Order.size();)
+    {
+        const int StateInd = m_Quads[Order[StartInst]].StateInd;
+
+        // Without sorting, all quads of a batch use the state of the first one.
+        // Sorted batches are split at state boundaries instead.
+        size_t EndInst = std::min(StartInst + BatchSize, Order.size());
+        if (m_SortByState)
+        {
+            for (size_t inst = StartInst + 1; inst < EndInst; ++inst)
+            {
+                if (m_Quads[Order[inst]].StateInd != StateInd)
+                {
+                    EndInst = inst;
+                    break;
+                }
+            }
+        }
 
-        // Set the pipeline state
-        auto StateInd = m_Quads[StartInst].StateInd;
-        pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
+        // Set the pipeline state only when it changes
+        if (StateInd != CurrState)
+        {
+            pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
+            CurrState = StateInd;
+            // Commit the shader resources again after the pipeline state has changed
+            CurrTexture = -1;
+            ++NumPSOSwitches;
+        }
 
+        // Shader resources have been explicitly transitioned to correct states, so
+        // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
+        // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
+        // verify that all resources are in correct states. This mode only has effect
+        // in debug and development builds
         MapHelper<InstanceData> BatchData;
         if (UseBatch)
         {
-            pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            if (CurrTexture < 0)
+            {
+                pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+                CurrTexture = 0;
+            }
             BatchData.Map(pCtx, m_BatchDataBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
         }
 
-        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+        for (size_t inst = StartInst; inst < EndInst; ++inst)
         {
-            const auto& CurrInstData = m_Quads[inst];
-            // Shader resources have been explicitly transitioned to correct states, so
-            // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
-            // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
-            // verify that all resources are in correct states. This mode only has effect
-            // in debug and development builds
-            if (!UseBatch)
+            const auto& CurrInstData = m_Quads[Order[inst]];
+            if (!UseBatch && CurrInstData.TextureInd != CurrTexture)
+            {
                 pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+                CurrTexture = CurrInstData.TextureInd;
+            }
 
             {
                 // clang-format off
@@ -613,9 +809,125 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
         if (UseBatch)
             BatchData.Unmap();
 
-        DrawAttrs.NumInstances = EndInst - StartInst;
+        DrawAttrs.NumInstances = static_cast<Uint32>(EndInst - StartInst);
         pCtx->Draw(DrawAttrs);
+        ++NumDraws;
+
+        StartInst = EndInst;
+    }
+
+    m_Subsets[Subset].NumDraws       = NumDraws;
+    m_Subsets[Subset].NumPSOSwitches = NumPSOSwitches;
+}
+
+void Tutorial09_Quads::CreateGpuQuadsBuffer()
+{
+    VERIFY_EXPR(m_GpuAnimationSupported);
+
+    // Sort the quads by state so that every state can be rendered with a single instanced draw call.
+    // The counting sort keeps the relative order of the quads within every state.
+    m_GpuStateOffsets.fill(0);
+    for (const auto& Quad : m_Quads)
+        ++m_GpuStateOffsets[Quad.StateInd + 1];
+    for (int state = 0; state < NumStates; ++state)
+        m_GpuStateOffsets[state + 1] += m_GpuStateOffsets[state];
+
+    std::array<Uint32, NumStates> NextQuad;
+    std::copy(m_GpuStateOffsets.begin(), m_GpuStateOffsets.begin() + NumStates, NextQuad.begin());
+
+    std::vector<GpuQuadState> GpuQuads(m_Quads.size());
+    for (const auto& Quad : m_Quads)
+    {
+        auto& GpuQuad     = GpuQuads[NextQuad[Quad.StateInd]++];
+        GpuQuad.Pos       = Quad.Pos;
+        GpuQuad.MoveDir   = Quad.MoveDir;
+        GpuQuad.Size      = Quad.Size;
+        GpuQuad.Angle     = Quad.Angle;
+        GpuQuad.RotSpeed  = Quad.RotSpeed;
+        GpuQuad.TexArrInd = static_cast<float>(Quad.TextureInd);
+    }
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name              = "GPU quads buffer";
+    BuffDesc.Usage             = USAGE_DEFAULT;
+    BuffDesc.BindFlags         = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+    BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    BuffDesc.ElementByteStride = sizeof(GpuQuadState);
+    BuffDesc.Size              = sizeof(GpuQuadState) * GpuQuads.size();
+
+    BufferData InitData;
+    InitData.pData    = GpuQuads.data();
+    InitData.DataSize = BuffDesc.Size;
+
+    m_GpuQuadsBuffer.Release();
+    m_pDevice->CreateBuffer(BuffDesc, &InitData, &m_GpuQuadsBuffer);
+
+    m_GpuQuadsSRB.Release();
+    m_pGpuPSO[0]->CreateShaderResourceBinding(&m_GpuQuadsSRB, true);
+    m_GpuQuadsSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TexArraySRV);
+    m_GpuQuadsSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Quads")->Set(m_GpuQuadsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+
+    m_UpdateQuadsSRB.Release();
+    m_pUpdateQuadsPSO->CreateShaderResourceBinding(&m_UpdateQuadsSRB, true);
+    m_UpdateQuadsSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Quads")->Set(m_GpuQuadsBuffer->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+}
+
+void Tutorial09_Quads::RenderGpuQuads()
+{
+    GpuQuadConstants Constants;
+    Constants.NumQuads    = static_cast<Uint32>(m_Quads.size());
+    Constants.ElapsedTime = m_GpuElapsedTime;
+    Constants.UpdateIdx   = m_GpuUpdateIdx;
+    Constants.Seed        = m_RandomSeed;
+
+    m_GpuElapsedTime = 0;
+    ++m_GpuUpdateIdx;
+
+    {
+        TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Update quads"};
+
+        {
+            MapHelper<GpuQuadConstants> ConstData{m_pImmediateContext, m_GpuQuadConstantsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+            *ConstData = Constants;
+        }
+
+        DispatchComputeAttribs DispatchAttrs;
+        DispatchAttrs.ThreadGroupCountX = (Constants.NumQuads + UpdateQuadsGroupSize - 1) / UpdateQuadsGroupSize;
+
+        m_pImmediateContext->SetPipelineState(m_pUpdateQuadsPSO);
+        // The quads buffer is transitioned to the unordered access state here and back to
+        // the shader resource state when the render SRB is committed below.
+        m_pImmediateContext->CommitShaderResources(m_UpdateQuadsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->DispatchCompute(DispatchAttrs);
+    }
+
+    TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Draw quads"};
+
+    auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
+    m_pImmediateContext->SetRenderTargets(1, &pRTV, m_pSwapChain->GetDepthBufferDSV(), RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+    DrawAttribs DrawAttrs;
+    DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
+    DrawAttrs.NumVertices = 4;
+    m_NumDraws            = 0;
+    for (int state = 0; state < NumStates; ++state)
+    {
+        DrawAttrs.NumInstances = m_GpuStateOffsets[state + 1] - m_GpuStateOffsets[state];
+        if (DrawAttrs.NumInstances == 0)
+            continue;
+        ++m_NumDraws;
+
+        {
+            Constants.FirstQuad = m_GpuStateOffsets[state];
+            MapHelper<GpuQuadConstants> ConstData{m_pImmediateContext, m_GpuQuadConstantsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+            *ConstData = Constants;
+        }
+
+        m_pImmediateContext->SetPipelineState(m_pGpuPSO[state]);
+        m_pImmediateContext->CommitShaderResources(m_GpuQuadsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->Draw(DrawAttrs);
     }
+    m_NumPSOSwitches = m_NumDraws;
 }
 
 // Render a frame
@@ -633,26 +945,46 @@ void Tutorial09_Quads::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
+    Timer CpuTimer;
+    if (m_pGpuTimeQuery)
+        m_pGpuTimeQuery->Begin(m_pImmediateContext);
+
+    if (m_GpuAnimation)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        RenderGpuQuads();
     }
-
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
     else
-        RenderSubset<false>(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
+        // Quads are alpha-blended, so the draw order must not change from frame to frame.
+        // Every thread thus renders a fixed subset instead of stealing work from other threads,
+        // and the command lists are executed in the subset order.
+        Timer RecordTimer;
+        m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) { RenderThreadSubset(ThreadId); });
+        m_ThreadingStats.RecordTime  = RecordTimer.GetElapsedTime();
+        m_ThreadingStats.ExecuteTime = 0;
+
+        m_NumDraws       = 0;
+        m_NumPSOSwitches = 0;
+        for (const auto& Subset : m_Subsets)
+        {
+            m_NumDraws += Subset.NumDraws;
+            m_NumPSOSwitches += Subset.NumPSOSwitches;
+        }
+    }
 
+    if (!m_GpuAnimation && !m_CmdLists.empty())
+    {
         m_CmdListPtrs.resize(m_CmdLists.size());
         for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
             m_CmdListPtrs[i] = m_CmdLists[i];
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        {
+            TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Command lists"};
+
+            Timer ExecuteTimer;
+            m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+            m_ThreadingStats.ExecuteTime = ExecuteTimer.GetElapsedTime();
+        }
 
         for (auto& cmdList : m_CmdLists)
         {
@@ -662,9 +994,28 @@ void Tutorial09_Quads::Render()
             cmdList.Release();
         }
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+        m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) {
+            // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+            // IMPORTANT: we must wait until the command lists are submitted for execution
+            //            because FinishFrame() invalidates all dynamic resources.
+            // IMPORTANT: In Metal backend FinishFrame must be called from the same
+            //            thread that issued rendering commands.
+            if (ThreadId != 0)
+                m_pDeferredContexts[ThreadId - 1]->FinishFrame();
+        });
+    }
+
+    double GpuTime = 0;
+    if (m_pGpuTimeQuery && m_pGpuTimeQuery->End(m_pImmediateContext, GpuTime))
+    {
+        m_GpuTimeAccum += GpuTime;
+        ++m_NumGpuTimeSamples;
     }
+
+    // CPU time includes the animation on the CPU path and the time to record and submit the commands
+    m_CpuTimeAccum += m_CpuUpdateTime + CpuTimer.GetElapsedTime();
+    m_CpuUpdateTime = 0;
+    ++m_NumCpuTimeSamples;
 }
 
 void Tutorial09_Quads::CreateInstanceBuffer()
@@ -688,7 +1039,30 @@ void Tutorial09_Quads::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
-    UpdateQuads(static_cast<float>(std::min(ElapsedTime, 0.25)));
+    if (m_GpuAnimation)
+    {
+        // The quads are updated by the compute shader in Render()
+        m_GpuElapsedTime = std::min(m_GpuElapsedTime + static_cast<float>(ElapsedTime), 0.25f);
+    }
+    else
+    {
+        Timer UpdateTimer;
+        UpdateQuads(static_cast<float>(std::min(ElapsedTime, 0.25)));
+        m_CpuUpdateTime = UpdateTimer.GetElapsedTime();
+    }
+
+    m_TimingsAccumTime += ElapsedTime;
+    if (m_TimingsAccumTime >= TimingsUpdateInterval)
+    {
+        m_AvgCpuTime = m_NumCpuTimeSamples > 0 ? m_CpuTimeAccum / m_NumCpuTimeSamples : 0;
+        m_AvgGpuTime = m_NumGpuTimeSamples > 0 ? m_GpuTimeAccum / m_NumGpuTimeSamples : 0;
+
+        m_TimingsAccumTime  = 0;
+        m_CpuTimeAccum      = 0;
+        m_GpuTimeAccum      = 0;
+        m_NumCpuTimeSamples = 0;
+        m_NumGpuTimeSamples = 0;
+    }
 }
 
 } // namespace Diligent
@@ -27,13 +27,13 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
-#include <thread>
-#include <mutex>
+#include <memory>
+#include <array>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "DurationQueryHelper.hpp"
 
 namespace Diligent
 {
@@ -54,6 +54,10 @@ public:
 
     virtual const Char* GetSampleName() const override final { return "Tutorial09: Quads"; }
 
+    virtual std::vector<ScalingBenchmarkParam> GetScalingBenchmarkParams() const override final;
+    virtual void                               SetScalingBenchmarkConfig(const std::vector<int>& Values) override final;
+    virtual const ThreadingStats*              GetThreadingStats() const override final { return &m_ThreadingStats; }
+
 private:
     void CreatePipelineStates(std::vector<StateTransitionDesc>& Barriers);
     void LoadTextures(std::vector<StateTransitionDesc>& Barriers);
@@ -67,19 +71,34 @@ private:
     template <bool UseBatch>
     void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
 
-    static void WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum);
+    void RenderThreadSubset(Uint32 ThreadId);
 
-    Threading::Signal m_RenderSubsetSignal;
-    Threading::Signal m_ExecuteCommandListsSignal;
-    Threading::Signal m_GotoNextFrameSignal;
+    void CreateGpuQuadsBuffer();
+    void RenderGpuQuads();
 
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
+    std::unique_ptr<TaskScheduler> m_pTaskScheduler;
 
-    std::vector<std::thread>                 m_WorkerThreads;
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
+    // Draw order and statistics of a subset. Every subset is only accessed by the thread that renders it.
+    struct SubsetData
+    {
+        // Indices of the quads in the order they are drawn
+        std::vector<Uint32> Order;
+        std::vector<Uint32> SortScratch;
+
+        Uint32 NumDraws       = 0;
+        Uint32 NumPSOSwitches = 0;
+    };
+    std::vector<SubsetData> m_Subsets;
+
+    // When enabled, every subset sorts its quads by state (and texture in non-batched mode) before
+    // drawing them, so that the pipeline state only changes once per state and batches never mix states.
+    bool   m_SortByState    = true;
+    Uint32 m_NumDraws       = 0;
+    Uint32 m_NumPSOSwitches = 0;
+
     static constexpr int          NumStates = 5;
     RefCntAutoPtr<IPipelineState> m_pPSO[2][NumStates];
     RefCntAutoPtr<IBuffer>        m_QuadAttribsCB;
@@ -91,6 +110,24 @@ private:
     RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
     RefCntAutoPtr<ITextureView>           m_TexArraySRV;
 
+    // GPU animation mode: quad states are kept in a structured buffer that is updated by a compute shader,
+    // and the quads of every state are rendered with a single instanced draw call.
+    RefCntAutoPtr<IPipelineState>         m_pGpuPSO[NumStates];
+    RefCntAutoPtr<IPipelineState>         m_pUpdateQuadsPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_GpuQuadsSRB;
+    RefCntAutoPtr<IShaderResourceBinding> m_UpdateQuadsSRB;
+    RefCntAutoPtr<IBuffer>                m_GpuQuadsBuffer;
+    RefCntAutoPtr<IBuffer>                m_GpuQuadConstantsCB;
+    // Quads in the buffer are sorted by state, state i occupies [m_GpuStateOffsets[i], m_GpuStateOffsets[i+1])
+    std::array<Uint32, NumStates + 1> m_GpuStateOffsets = {};
+
+    static constexpr Uint32 UpdateQuadsGroupSize = 64;
+
+    bool   m_GpuAnimationSupported = false;
+    bool   m_GpuAnimation          = false;
+    float  m_GpuElapsedTime        = 0;
+    Uint32 m_GpuUpdateIdx          = 0;
+
     static constexpr int MaxQuads     = 100000;
     static constexpr int MaxBatchSize = 100;
 
@@ -100,6 +137,21 @@ private:
     int m_MaxThreads       = 8;
     int m_NumWorkerThreads = 4;
 
+    // Animation and rendering timings averaged over TimingsUpdateInterval
+    static constexpr double              TimingsUpdateInterval = 0.5;
+    std::unique_ptr<DurationQueryHelper> m_pGpuTimeQuery;
+    double                               m_CpuUpdateTime     = 0;
+    double                               m_CpuTimeAccum      = 0;
+    double                               m_GpuTimeAccum      = 0;
+    double                               m_TimingsAccumTime  = 0;
+    Uint32                               m_NumCpuTimeSamples = 0;
+    Uint32                               m_NumGpuTimeSamples = 0;
+    double                               m_AvgCpuTime        = 0;
+    double                               m_AvgGpuTime        = 0;
+
+    // Recording times of the last frame on the CPU path. ThreadRecordTime[i] is only written by thread i.
+    ThreadingStats m_ThreadingStats;
+
     struct QuadData
     {
         float2 Pos;
@@ -118,6 +170,31 @@ private:
         float2 QuadCenter;
         float  TexArrInd;
     };
+
+    // Must match GpuQuadState in quad_gpu_structures.fxh
+    struct GpuQuadState
+    {
+        float2 Pos;
+        float2 MoveDir;
+        float  Size      = 0;
+        float  Angle     = 0;
+        float  RotSpeed  = 0;
+        float  TexArrInd = 0;
+    };
+
+    // Must match GpuQuadConstants in quad_gpu_structures.fxh
+    struct GpuQuadConstants
+    {
+        Uint32 NumQuads    = 0;
+        Uint32 FirstQuad   = 0;
+        float  ElapsedTime = 0;
+        Uint32 UpdateIdx   = 0;
+
+        Uint32 Seed     = 0;
+        Uint32 Padding0 = 0;
+        Uint32 Padding1 = 0;
+        Uint32 Padding2 = 0;
+    };
 };
 
 } // namespace Diligent
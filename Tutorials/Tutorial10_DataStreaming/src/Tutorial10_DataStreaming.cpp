@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <limits>
 #include <cstdlib>
+#include <numeric>
 
 #include "Tutorial10_DataStreaming.hpp"
 #include "MapHelper.hpp"
@@ -40,90 +41,13 @@
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
 #include "CommandLineParser.hpp"
+#include "TimelineProfiler.hpp"
+#include "RadixSort.hpp"
+#include "Timer.hpp"
 
 namespace Diligent
 {
 
-class StreamingBuffer
-{
-public:
-    StreamingBuffer(IRenderDevice* pDevice, BIND_FLAGS BindFlags, Uint32 Size, size_t NumContexts, const Char* Name) :
-        m_BufferSize{Size},
-        m_MapInfo(NumContexts)
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name           = Name;
-        BuffDesc.Usage          = USAGE_DYNAMIC;
-        BuffDesc.BindFlags      = BindFlags;
-        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        BuffDesc.Size           = Size;
-        pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
-    }
-
-    // Returns offset of the allocated region
-    Uint32 Allocate(IDeviceContext* pCtx, Uint32 Size, size_t CtxNum)
-    {
-        auto& MapInfo = m_MapInfo[CtxNum];
-        // Check if there is enough space in the buffer
-        if (MapInfo.m_CurrOffset + Size > m_BufferSize)
-        {
-            // Unmap the buffer
-            Flush(CtxNum);
-        }
-
-        if (MapInfo.m_MappedData == nullptr)
-        {
-            // If current offset is zero, we are mapping the buffer for the first time after it has been flushed. Use MAP_FLAG_DISCARD flag.
-            // Otherwise use MAP_FLAG_NO_OVERWRITE flag.
-            MapInfo.m_MappedData.Map(pCtx, m_pBuffer, MAP_WRITE, MapInfo.m_CurrOffset == 0 ? MAP_FLAG_DISCARD : MAP_FLAG_NO_OVERWRITE);
-        }
-
-        auto Offset = MapInfo.m_CurrOffset;
-        // Update offset
-        MapInfo.m_CurrOffset += Size;
-        return Offset;
-    }
-
-    void Release(size_t CtxNum)
-    {
-        if (!m_AllowPersistentMap)
-        {
-            m_MapInfo[CtxNum].m_MappedData.Unmap();
-        }
-    }
-
-    void Flush(size_t CtxNum)
-    {
-        m_MapInfo[CtxNum].m_MappedData.Unmap();
-        m_MapInfo[CtxNum].m_CurrOffset = 0;
-    }
-
-    IBuffer* GetBuffer() { return m_pBuffer; }
-    void*    GetMappedCPUAddress(size_t CtxNum)
-    {
-        return m_MapInfo[CtxNum].m_MappedData;
-    }
-
-    void AllowPersistentMapping(bool AllowMapping)
-    {
-        m_AllowPersistentMap = AllowMapping;
-    }
-
-private:
-    RefCntAutoPtr<IBuffer> m_pBuffer;
-    const Uint32           m_BufferSize;
-
-    bool m_AllowPersistentMap = false;
-
-    struct MapInfo
-    {
-        MapHelper<Uint8> m_MappedData;
-        Uint32           m_CurrOffset = 0;
-    };
-    // We need to keep track of mapped data for every context
-    std::vector<MapInfo> m_MapInfo;
-};
-
 SampleBase* CreateSample()
 {
     return new Tutorial10_DataStreaming();
@@ -149,6 +73,7 @@ Tutorial10_DataStreaming::CommandLineStatus Tutorial10_DataStreaming::ProcessCom
     {
         m_NumWorkerThreads = clamp(m_NumWorkerThreads, 0, 128);
     }
+    ArgsParser.Parse("sort", 's', m_SortByState);
 
     return CommandLineStatus::OK;
 }
@@ -251,12 +176,6 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
         ShaderCI.Desc.Name = "Polygon VS Batched";
         ShaderCI.FilePath  = "polygon_batch.vsh";
         m_pDevice->CreateShader(ShaderCI, &pVSBatched);
-
-        // Create dynamic uniform buffer that will store our transformation matrix
-        // Dynamic buffers can be frequently updated by the CPU
-        CreateUniformBuffer(m_pDevice, sizeof(float4x4), "Instance constants CB", &m_PolygonAttribsCB);
-        // Transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
-        Barriers.emplace_back(m_PolygonAttribsCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
     // Create a pixel shader
@@ -273,11 +192,14 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
         m_pDevice->CreateShader(ShaderCI, &pPSBatched);
     }
 
+    // Polygon vertices are transformed on the CPU when batching is disabled
     // clang-format off
     LayoutElement LayoutElem[] =
     {
         // Attribute 0 - PolygonXY
-        LayoutElement{0, 0, 2, VT_FLOAT32, False, LAYOUT_ELEMENT_AUTO_OFFSET, LAYOUT_ELEMENT_AUTO_STRIDE, INPUT_ELEMENT_FREQUENCY_PER_VERTEX}
+        LayoutElement{0, 0, 2, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_VERTEX},
+        // Attribute 1 - PolygonUV
+        LayoutElement{1, 0, 2, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_VERTEX}
     };
     // clang-format on
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElem;
@@ -317,10 +239,6 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     {
         PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
         m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO[0][state]);
-        // Since we did not explicitly specify the type for 'PolygonAttribs' variable, default
-        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-        // change and are bound directly to the pipeline state object.
-        m_pPSO[0][state]->GetStaticVariableByName(SHADER_TYPE_VERTEX, "PolygonAttribs")->Set(m_PolygonAttribsCB);
 
         if (state > 0)
             VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]), "PSOs are expected to be compatible");
@@ -450,11 +368,34 @@ void Tutorial10_DataStreaming::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        ImGui::Checkbox("Sort by state", &m_SortByState);
         if (m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_D3D12 ||
             m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_VULKAN)
         {
-            ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap);
+            // The buffers are recreated by Render()
+            ImGui::Checkbox("Streaming ring", &m_bUseStreamingRing);
+            if (!m_StreamingVB->IsRing())
+                ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap);
+        }
+
+        ImGui::Text("Draws: %u, PSO switches: %u", m_NumDraws, m_NumPSOSwitches);
+
+        const auto& VBStats = m_StreamingVB->GetFrameStats();
+        const auto& IBStats = m_StreamingIB->GetFrameStats();
+        ImGui::Text("Streamed: %.1f KB/frame", static_cast<double>(VBStats.Size + IBStats.Size) / 1024.0);
+        if (m_StreamingVB->IsRing())
+        {
+            ImGui::Text("Ring: %u MB VB, %u MB IB", m_StreamingRingVBSize >> 20, m_StreamingRingIBSize >> 20);
+            ImGui::Text("Wraps: %u, stalls: %u", VBStats.NumWraps + IBStats.NumWraps, VBStats.NumStalls + IBStats.NumStalls);
+        }
+        else
+        {
+            if (m_bUseStreamingRing && m_StreamingRingVBSize == 0)
+                ImGui::TextColored(ImVec4{1, 1, 0.5f, 1}, "Frame data exceeds %u MB ring", MaxStreamingRingSize >> 20);
+            ImGui::Text("Discards: %u", VBStats.NumDiscards + IBStats.NumDiscards);
         }
+        if (VBStats.NumFailures + IBStats.NumFailures > 0)
+            ImGui::TextColored(ImVec4{1, 0.5f, 0.5f, 1}, "Streaming buffer overflow: %u allocations", VBStats.NumFailures + IBStats.NumFailures);
     }
     ImGui::End();
 }
@@ -471,16 +412,17 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
     CreatePipelineStates(Barriers);
     LoadTextures(Barriers);
 
-    m_StreamingVB = std::make_unique<StreamingBuffer>(m_pDevice, BIND_VERTEX_BUFFER, MaxVertsInStreamingBuffer * Uint32{sizeof(float2)}, 1u + InitInfo.NumDeferredCtx, "Streaming vertex buffer");
-    m_StreamingIB = std::make_unique<StreamingBuffer>(m_pDevice, BIND_INDEX_BUFFER, MaxVertsInStreamingBuffer * 3u * Uint32{sizeof(Uint32)}, 1u + InitInfo.NumDeferredCtx, "Streaming index buffer");
-
-    // Transition the buffers to required state
-    Barriers.emplace_back(m_StreamingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
-    Barriers.emplace_back(m_StreamingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    // A fan of N vertices has 3 * (N - 2) indices, so the index buffer can hold the triangles of any set of polygons
+    // that fits into the vertex buffer. Indices are relative to the vertex range of a chunk, so 16 bits are enough.
+    static_assert(MaxVertsInStreamingBuffer <= 65536, "16-bit indices can't address all vertices in the streaming buffer");
 
     InitializePolygonGeometry();
     InitializePolygons();
 
+    // The ring is sized from the geometry of the polygons
+    UpdateStreamingRingSize();
+    CreateStreamingBuffers(Barriers);
+
     m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 
     if (m_BatchSize > 1)
@@ -489,36 +431,131 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
     StartWorkerThreads(m_NumWorkerThreads);
 }
 
-void Tutorial10_DataStreaming::InitializePolygonGeometry()
+void Tutorial10_DataStreaming::CreateStreamingBuffers(std::vector<StateTransitionDesc>& Barriers)
 {
-    m_PolygonGeo.resize(MaxPolygonVerts + 1);
-    for (Uint32 NumVerts = MinPolygonVerts; NumVerts <= MaxPolygonVerts; ++NumVerts)
+    // Release the old buffers first to unmap them
+    m_StreamingVB.reset();
+    m_StreamingIB.reset();
+
+    // The ring keeps the data of several frames, while the dynamic buffer is discarded every time it runs out of space
+    StreamingBuffer::CreateInfo VBCI;
+    VBCI.Name        = "Streaming vertex buffer";
+    VBCI.BindFlags   = BIND_VERTEX_BUFFER;
+    VBCI.Size        = m_StreamingRingVBSize != 0 ? m_StreamingRingVBSize : MaxVertsInStreamingBuffer * Uint32{sizeof(PolygonVertex)};
+    VBCI.NumContexts = 1u + static_cast<Uint32>(m_pDeferredContexts.size());
+    VBCI.UseRing     = m_StreamingRingVBSize != 0;
+    m_StreamingVB    = std::make_unique<StreamingBuffer>(m_pDevice, m_pImmediateContext, VBCI);
+
+    StreamingBuffer::CreateInfo IBCI = VBCI;
+    IBCI.Name                        = "Streaming index buffer";
+    IBCI.BindFlags                   = BIND_INDEX_BUFFER;
+    IBCI.Size                        = m_StreamingRingIBSize != 0 ? m_StreamingRingIBSize : MaxVertsInStreamingBuffer * 3u * Uint32{sizeof(Uint16)};
+    m_StreamingIB                    = std::make_unique<StreamingBuffer>(m_pDevice, m_pImmediateContext, IBCI);
+
+    // Transition the buffers to required state
+    Barriers.emplace_back(m_StreamingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    Barriers.emplace_back(m_StreamingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+}
+
+Uint32 Tutorial10_DataStreaming::GetStreamingRingSize(Uint64 FrameSize) const
+{
+    // A context leaves the tail of its chunk unused when the next allocation does not fit into it, and chunks
+    // never cross the end of the ring. The space lost this way is less than the frame allocates in total plus
+    // a couple of the largest chunks per context, so the ring never runs out of space for a single frame.
+    const Uint64 MaxChunkSize = Uint64{MaxVertsInStreamingBuffer} * sizeof(PolygonVertex);
+    const Uint64 NumContexts  = 1u + m_pDeferredContexts.size();
+    const Uint64 RequiredSize = FrameSize * 2 + (NumContexts + 1) * MaxChunkSize * 2;
+
+    Uint64 RingSize = MinStreamingRingSize;
+    while (RingSize < RequiredSize)
+        RingSize *= 2;
+
+    return RingSize <= MaxStreamingRingSize ? static_cast<Uint32>(RingSize) : 0;
+}
+
+bool Tutorial10_DataStreaming::UpdateStreamingRingSize()
+{
+    Uint32 VBSize = 0;
+    Uint32 IBSize = 0;
+    if (m_bUseStreamingRing &&
+        (m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_D3D12 ||
+         m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_VULKAN))
     {
-        auto& PolygonGeo = m_PolygonGeo[NumVerts];
-        PolygonGeo.Verts.reserve(NumVerts);
-        PolygonGeo.Inds.reserve(size_t{NumVerts - 2} * 3);
-        float ArcLen = PI_F * 2.f / static_cast<float>(NumVerts);
-        float Angle  = ((NumVerts % 2) == 1) ? PI_F / 2.f : PI_F / 2.f - ArcLen / 2.f;
-        for (Uint32 v = 0; v < NumVerts; ++v, Angle += ArcLen)
+        // Batches use the geometry of their first polygon, so the frame never streams more than the vertices of all polygons
+        const Uint64 VertexSize = m_BatchSize > 1 ? Uint64{sizeof(float2)} : Uint64{sizeof(PolygonVertex)};
+        const Uint64 NumIndices = (m_NumPolygonVerts - Uint64{2} * static_cast<Uint64>(m_NumPolygons)) * 3;
+
+        VBSize = GetStreamingRingSize(m_NumPolygonVerts * VertexSize);
+        IBSize = GetStreamingRingSize(NumIndices * sizeof(Uint16));
+        if (VBSize == 0 || IBSize == 0)
         {
-            PolygonGeo.Verts.emplace_back(float2{cosf(Angle), sinf(Angle)});
+            // The frame does not fit into the largest ring
+            VBSize = 0;
+            IBSize = 0;
+        }
+        else
+        {
+            // The ring never shrinks, so that it is not recreated every time the number of polygons changes
+            VBSize = std::max(VBSize, m_StreamingRingVBSize);
+            IBSize = std::max(IBSize, m_StreamingRingIBSize);
+        }
 
-            if (v < NumVerts - 2)
+        if (m_StreamingVB && m_StreamingVB->IsRing())
+        {
+            const Uint32 NumFailures = m_StreamingVB->GetFrameStats().NumFailures + m_StreamingIB->GetFrameStats().NumFailures;
+            if (NumFailures > 0)
             {
-                PolygonGeo.Inds.push_back(0);
-                PolygonGeo.Inds.push_back(v + 1);
-                PolygonGeo.Inds.push_back(v + 2);
+                LOG_WARNING_MESSAGE("The streaming ring is too small for the data of one frame: ", NumFailures,
+                                    " allocations failed. Growing the ring.");
+                if (VBSize == m_StreamingRingVBSize && IBSize == m_StreamingRingIBSize)
+                {
+                    VBSize = VBSize < MaxStreamingRingSize ? VBSize * 2 : 0;
+                    IBSize = VBSize != 0 ? std::min(IBSize * 2, MaxStreamingRingSize) : 0;
+                }
             }
         }
     }
+
+    if (VBSize == m_StreamingRingVBSize && IBSize == m_StreamingRingIBSize && m_StreamingVB)
+        return false;
+
+    m_StreamingRingVBSize = VBSize;
+    m_StreamingRingIBSize = IBSize;
+    return true;
+}
+
+void Tutorial10_DataStreaming::InitializePolygonGeometry()
+{
+    for (Uint32 NumVerts = MinPolygonVerts; NumVerts <= MaxPolygonVerts; ++NumVerts)
+    {
+        float ArcLen = PI_F * 2.f / static_cast<float>(NumVerts);
+        float Angle  = ((NumVerts % 2) == 1) ? PI_F / 2.f : PI_F / 2.f - ArcLen / 2.f;
+        for (Uint32 v = 0; v < NumVerts; ++v, Angle += ArcLen)
+            m_PolygonVerts[NumVerts][v] = float2{cosf(Angle), sinf(Angle)};
+    }
+}
+
+void Tutorial10_DataStreaming::PolygonStates::Resize(size_t NumPolygons)
+{
+    PosX.resize(NumPolygons);
+    PosY.resize(NumPolygons);
+    MoveDirX.resize(NumPolygons);
+    MoveDirY.resize(NumPolygons);
+    Size.resize(NumPolygons);
+    Angle.resize(NumPolygons);
+    RotSpeed.resize(NumPolygons);
+    TextureInd.resize(NumPolygons);
+    StateInd.resize(NumPolygons);
+    NumVerts.resize(NumPolygons);
 }
 
 void Tutorial10_DataStreaming::InitializePolygons()
 {
-    m_Polygons.resize(m_NumPolygons);
+    m_Polygons.Resize(m_NumPolygons);
+    m_NumPolygonVerts = 0;
 
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> scale_distr(0.01f, 0.05f);
     std::uniform_real_distribution<float> pos_distr(-0.95f, +0.95f);
@@ -531,136 +568,164 @@ void Tutorial10_DataStreaming::InitializePolygons()
 
     for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
     {
-        auto& CurrInst     = m_Polygons[Polygon];
-        CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        m_Polygons.Size[Polygon]     = scale_distr(gen);
+        m_Polygons.Angle[Polygon]    = angle_distr(gen);
+        m_Polygons.PosX[Polygon]     = pos_distr(gen);
+        m_Polygons.PosY[Polygon]     = pos_distr(gen);
+        m_Polygons.MoveDirX[Polygon] = move_dir_distr(gen);
+        m_Polygons.MoveDirY[Polygon] = move_dir_distr(gen);
+        m_Polygons.RotSpeed[Polygon] = rot_distr(gen);
         // Texture array index
-        CurrInst.TextureInd = tex_distr(gen);
-        CurrInst.StateInd   = state_distr(gen);
-        CurrInst.NumVerts   = num_verts_distr(gen);
+        m_Polygons.TextureInd[Polygon] = static_cast<Uint8>(tex_distr(gen));
+        m_Polygons.StateInd[Polygon]   = static_cast<Uint8>(state_distr(gen));
+        m_Polygons.NumVerts[Polygon]   = static_cast<Uint8>(num_verts_distr(gen));
+        m_NumPolygonVerts += m_Polygons.NumVerts[Polygon];
     }
 }
 
-std::pair<Diligent::Uint32, Diligent::Uint32> Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum)
+namespace
 {
-    // Request memory for vertices and indices
-    auto  VBOffset   = m_StreamingVB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Verts.size()) * sizeof(float2), CtxNum);
-    auto  IBOffset   = m_StreamingIB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Inds.size()) * sizeof(Uint32), CtxNum);
-    auto* VertexData = reinterpret_cast<float2*>(reinterpret_cast<Uint8*>(m_StreamingVB->GetMappedCPUAddress(CtxNum)) + VBOffset);
-    auto* IndexData  = reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(m_StreamingIB->GetMappedCPUAddress(CtxNum)) + IBOffset);
-    memcpy(VertexData, PolygonGeo.Verts.data(), PolygonGeo.Verts.size() * sizeof(float2));
-    memcpy(IndexData, PolygonGeo.Inds.data(), PolygonGeo.Inds.size() * sizeof(Uint32));
-
-    m_StreamingVB->Release(CtxNum);
-    m_StreamingIB->Release(CtxNum);
-
-    return {VBOffset, IBOffset};
-}
 
-void Tutorial10_DataStreaming::UpdatePolygons(float elapsedTime)
+// Returns the new rotation speed of a polygon that bounced off the border. The value only depends on
+// the seed, the polygon and the update, so the simulation does not depend on how the polygons are
+// distributed between the threads.
+float GetRandomRotSpeed(Uint32 Seed, Uint32 Polygon, Uint32 UpdateIdx)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    Uint32 Hash = Seed ^ (Polygon * 0x9E3779B9u) ^ (UpdateIdx * 0x85EBCA6Bu);
+    Hash ^= Hash >> 16;
+    Hash *= 0x7FEB352Du;
+    Hash ^= Hash >> 15;
+    Hash *= 0x846CA68Bu;
+    Hash ^= Hash >> 16;
+    // Uniform distribution in [-PI/2, +PI/2)
+    return (static_cast<float>(Hash >> 8) / 16777216.f - 0.5f) * PI_F;
+}
 
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
+} // namespace
+
+void Tutorial10_DataStreaming::UpdatePolygons(Uint32 StartPolygon, Uint32 EndPolygon, float ElapsedTime)
+{
+    float* const PosX     = m_Polygons.PosX.data();
+    float* const PosY     = m_Polygons.PosY.data();
+    float* const MoveDirX = m_Polygons.MoveDirX.data();
+    float* const MoveDirY = m_Polygons.MoveDirY.data();
+    float* const Angle    = m_Polygons.Angle.data();
+    float* const RotSpeed = m_Polygons.RotSpeed.data();
+
+    for (Uint32 Polygon = StartPolygon; Polygon < EndPolygon; ++Polygon)
     {
-        auto& CurrInst = m_Polygons[Polygon];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
+        Angle[Polygon] += RotSpeed[Polygon] * ElapsedTime;
+        if (std::abs(PosX[Polygon] + MoveDirX[Polygon] * ElapsedTime) > 0.95f)
         {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
+            MoveDirX[Polygon] *= -1.f;
+            RotSpeed[Polygon] = GetRandomRotSpeed(m_RandomSeed, Polygon, m_PolygonUpdateIdx * 2);
         }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
+        PosX[Polygon] += MoveDirX[Polygon] * ElapsedTime;
+        if (std::abs(PosY[Polygon] + MoveDirY[Polygon] * ElapsedTime) > 0.95f)
         {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
+            MoveDirY[Polygon] *= -1.f;
+            RotSpeed[Polygon] = GetRandomRotSpeed(m_RandomSeed, Polygon, m_PolygonUpdateIdx * 2 + 1);
         }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
+        PosY[Polygon] += MoveDirY[Polygon] * ElapsedTime;
     }
 }
 
 void Tutorial10_DataStreaming::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
+    m_pTaskScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
     m_CmdLists.resize(NumThreads);
+    m_Subsets.resize(NumThreads + 1);
+    m_ThreadingStats.ThreadRecordTime.assign(NumThreads + 1, 0.0);
 }
 
 void Tutorial10_DataStreaming::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
+    m_pTaskScheduler.reset();
+    m_CmdLists.clear();
+    m_Subsets.clear();
+    m_ThreadingStats.ThreadRecordTime.clear();
+}
+
+std::vector<SampleBase::ScalingBenchmarkParam> Tutorial10_DataStreaming::GetScalingBenchmarkParams() const
+{
+    return {
+        GetThreadsBenchmarkParam(m_MaxThreads + 1),
+        {"polygons", {10000, 100000, 1000000}},
+        {"batch", {1, 10, MaxBatchSize}},
+    };
+}
+
+void Tutorial10_DataStreaming::SetScalingBenchmarkConfig(const std::vector<int>& Values)
+{
+    VERIFY_EXPR(Values.size() == 3);
 
-    for (auto& thread : m_WorkerThreads)
+    const int NumWorkerThreads = clamp(Values[0] - 1, 0, m_MaxThreads);
+    if (NumWorkerThreads != m_NumWorkerThreads)
     {
-        thread.join();
+        m_NumWorkerThreads = NumWorkerThreads;
+        StopWorkerThreads();
+        StartWorkerThreads(m_NumWorkerThreads);
+    }
+
+    const int NumPolygons = clamp(Values[1], 1, MaxPolygons);
+    if (NumPolygons != m_NumPolygons)
+    {
+        m_NumPolygons = NumPolygons;
+        InitializePolygons();
+    }
+
+    const int BatchSize = clamp(Values[2], 1, MaxBatchSize);
+    if (BatchSize != m_BatchSize)
+    {
+        m_BatchSize = BatchSize;
+        if (m_BatchSize > 1)
+            CreateInstanceBuffer();
     }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
-    m_CmdLists.clear();
 }
 
-void Tutorial10_DataStreaming::WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum)
+void Tutorial10_DataStreaming::RenderThreadSubset(Uint32 ThreadId)
 {
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
+    TimelineProfiler::CpuScope ProfilerScope{"Record subset"};
+
+    Timer RecordTimer;
+
+    if (ThreadId == 0)
+    {
+        // The main thread renders the first subset using the immediate context
+        if (m_BatchSize > 1)
+            RenderSubset<true>(m_pImmediateContext, 0);
         else
-            pThis->RenderSubset<false>(pDeferredCtx, 1 + ThreadNum);
+            RenderSubset<false>(m_pImmediateContext, 0);
+        m_ThreadingStats.ThreadRecordTime[0] = RecordTimer.GetElapsedTime();
+        return;
+    }
 
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
+    // Every worker thread uses its own deferred context
+    IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId - 1];
 
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
+    pDeferredCtx->Begin(0);
 
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
+    // Render current subset using the deferred context
+    if (m_BatchSize > 1)
+        RenderSubset<true>(pDeferredCtx, ThreadId);
+    else
+        RenderSubset<false>(pDeferredCtx, ThreadId);
+
+    // Finish command list
+    TimelineProfiler::CpuScope FinishScope{"Finish command list"};
+    pDeferredCtx->FinishCommandList(&m_CmdLists[ThreadId - 1]);
+
+    m_ThreadingStats.ThreadRecordTime[ThreadId] = RecordTimer.GetElapsedTime();
+}
+
+template <bool UseBatch>
+Uint32 Tutorial10_DataStreaming::GetStateKey(Uint32 Polygon) const
+{
+    // Instances of a batch share the geometry, so batched polygons are also sorted by the vertex count.
+    // In non-batched mode, every polygon uses its own geometry, but the texture is bound per draw call.
+    return UseBatch ?
+        m_Polygons.StateInd[Polygon] * (MaxPolygonVerts + 1) + m_Polygons.NumVerts[Polygon] :
+        m_Polygons.StateInd[Polygon] * NumTextures + m_Polygons.TextureInd[Polygon];
 }
 
 template <bool UseBatch>
@@ -672,102 +737,226 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     pCtx->SetRenderTargets(1, &pRTV, m_pSwapChain->GetDepthBufferDSV(), RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
     DrawIndexedAttribs DrawAttrs;
-    DrawAttrs.IndexType = VT_UINT32;
+    DrawAttrs.IndexType = VT_UINT16;
     DrawAttrs.Flags     = DRAW_FLAG_VERIFY_ALL;
 
-    Uint32       NumSubsets    = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
-    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
+    const Uint32 BatchSize     = static_cast<Uint32>(m_BatchSize);
+    const Uint32 NumSubsets    = m_pTaskScheduler->GetNumThreads();
+    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.GetCount());
+    const Uint32 TotalBatches  = (TotalPolygons + BatchSize - 1) / BatchSize;
     const Uint32 SusbsetSize   = TotalBatches / NumSubsets;
     const Uint32 StartBatch    = SusbsetSize * Subset;
     const Uint32 EndBatch      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
-    for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
+    const Uint32 StartPolygon  = StartBatch * BatchSize;
+    const Uint32 EndPolygon    = std::min(EndBatch * BatchSize, TotalPolygons);
+
+    auto& Order       = m_Subsets[Subset].Order;
+    auto& BatchStarts = m_Subsets[Subset].BatchStarts;
+    Order.resize(EndPolygon - StartPolygon);
+    std::iota(Order.begin(), Order.end(), StartPolygon);
+    if (m_SortByState)
     {
-        const Uint32 StartInst = batch * m_BatchSize;
-        const Uint32 EndInst   = std::min(StartInst + static_cast<Uint32>(m_BatchSize), static_cast<Uint32>(m_NumPolygons));
+        // Sorted polygons are not contiguous, so the entire subset is updated at once.
+        // Otherwise, every chunk is updated right before its geometry is written.
+        UpdatePolygons(StartPolygon, EndPolygon, m_PolygonUpdateTime);
 
-        // Set pipeline state
-        auto StateInd = m_Polygons[StartInst].StateInd;
-        pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
+        // The sort is stable, so the draw order is the same in every frame as long as the states do not change
+        static_assert(NumStates * (MaxPolygonVerts + 1) <= 256 && NumStates * NumTextures <= 256, "The key does not fit into 8 bits");
+        RadixSort(Order, m_Subsets[Subset].SortScratch, 8, [this](Uint32 Polygon) { return GetStateKey<UseBatch>(Polygon); });
+    }
 
-        const auto&  PolygonGeo = m_PolygonGeo[m_Polygons[StartInst].NumVerts];
-        auto         Offsets    = WritePolygon(PolygonGeo, pCtx, Subset);
-        const Uint64 offsets[]  = {Offsets.first, 0};
-        IBuffer*     pBuffs[]   = {m_StreamingVB->GetBuffer(), m_BatchDataBuffer};
-        pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+    // Without sorting, all polygons in a batch use the state and the geometry of the first one.
+    // Sorted batches are split where the key changes instead.
+    BatchStarts.clear();
+    for (Uint32 BatchStart = 0; BatchStart < Order.size();)
+    {
+        BatchStarts.push_back(BatchStart);
+
+        Uint32 BatchEnd = std::min(BatchStart + BatchSize, static_cast<Uint32>(Order.size()));
+        if (m_SortByState)
+        {
+            const Uint32 Key = GetStateKey<UseBatch>(Order[BatchStart]);
+            for (Uint32 inst = BatchStart + 1; inst < BatchEnd; ++inst)
+            {
+                if (GetStateKey<UseBatch>(Order[inst]) != Key)
+                {
+                    BatchEnd = inst;
+                    break;
+                }
+            }
+        }
+        BatchStart = BatchEnd;
+    }
+    const Uint32 NumBatches = static_cast<Uint32>(BatchStarts.size());
+    BatchStarts.push_back(static_cast<Uint32>(Order.size()));
+
+    // All polygons in a batch use the geometry of the first one. When batching is disabled,
+    // every batch contains a single polygon whose vertices are transformed on the CPU.
+    const Uint32 VertexSize = UseBatch ? Uint32{sizeof(float2)} : Uint32{sizeof(PolygonVertex)};
+
+    int                     CurrState      = -1;
+    IShaderResourceBinding* pCurrSRB       = nullptr;
+    Uint32                  NumDraws       = 0;
+    Uint32                  NumPSOSwitches = 0;
+    for (Uint32 ChunkStart = 0; ChunkStart < NumBatches;)
+    {
+        // Gather as many batches as fit into the streaming buffers, so that their geometry
+        // is allocated at once and the buffers are only bound once for all of them.
+        Uint32 ChunkEnd = ChunkStart;
+        Uint32 NumVerts = 0;
+        Uint32 NumInds  = 0;
+        while (ChunkEnd < NumBatches)
+        {
+            const Uint32 BatchVerts = m_Polygons.NumVerts[Order[BatchStarts[ChunkEnd]]];
+            if (NumVerts + BatchVerts > MaxVertsInStreamingBuffer)
+                break;
+            NumVerts += BatchVerts;
+            NumInds += (BatchVerts - 2) * 3;
+            ++ChunkEnd;
+        }
 
-        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), Offsets.second, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        if (!m_SortByState)
+            UpdatePolygons(StartPolygon + BatchStarts[ChunkStart], StartPolygon + BatchStarts[ChunkEnd], m_PolygonUpdateTime);
 
-        MapHelper<InstanceData> BatchData;
-        if (UseBatch)
+        // Request memory for vertices and indices of the entire chunk and write the geometry directly to the mapped buffers
+        const Uint32 VBOffset = m_StreamingVB->Allocate(pCtx, NumVerts * VertexSize, Subset);
+        const Uint32 IBOffset = m_StreamingIB->Allocate(pCtx, NumInds * Uint32{sizeof(Uint16)}, Subset);
+        if (VBOffset == StreamingBuffer::InvalidOffset || IBOffset == StreamingBuffer::InvalidOffset)
         {
-            pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-            BatchData.Map(pCtx, m_BatchDataBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+            // The ring is sized to fit the data of one frame, so this should never happen.
+            // The failure is reported and Render() grows the ring before the next frame.
+            ChunkStart = ChunkEnd;
+            continue;
         }
+        Uint8* const pVertexData = m_StreamingVB->GetMappedCPUAddress(Subset) + VBOffset;
+        Uint16*      pIndexData  = reinterpret_cast<Uint16*>(m_StreamingIB->GetMappedCPUAddress(Subset) + IBOffset);
 
-        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+        Uint32 BaseVertex = 0;
+        for (Uint32 batch = ChunkStart; batch < ChunkEnd; ++batch)
         {
-            const auto& CurrInstData = m_Polygons[inst];
+            const Uint32  Polygon       = Order[BatchStarts[batch]];
+            const Uint32  PolygonVerts  = m_Polygons.NumVerts[Polygon];
+            const float2* pPolygonVerts = m_PolygonVerts[PolygonVerts];
+            if (UseBatch)
+            {
+                // The polygons are transformed by the vertex shader
+                memcpy(pVertexData + size_t{BaseVertex} * VertexSize, pPolygonVerts, PolygonVerts * sizeof(float2));
+            }
+            else
+            {
+                static constexpr float Sqrt2 = 1.414213562373095f;
+
+                const float  Size     = m_Polygons.Size[Polygon];
+                const float  SinAngle = sinf(m_Polygons.Angle[Polygon]) * Size;
+                const float  CosAngle = cosf(m_Polygons.Angle[Polygon]) * Size;
+                const float2 Center{m_Polygons.PosX[Polygon], m_Polygons.PosY[Polygon]};
+
+                auto* pDstVerts = reinterpret_cast<PolygonVertex*>(pVertexData) + BaseVertex;
+                for (Uint32 v = 0; v < PolygonVerts; ++v)
+                {
+                    const float2& Vert = pPolygonVerts[v];
+                    pDstVerts[v].Pos   = Center + float2{Vert.x * CosAngle - Vert.y * SinAngle, Vert.x * SinAngle + Vert.y * CosAngle};
+                    pDstVerts[v].UV    = Vert * (Sqrt2 * 0.5f) + float2{0.5f, 0.5f};
+                }
+            }
+
+            for (Uint32 v = 0; v < PolygonVerts - 2; ++v)
+            {
+                *(pIndexData++) = static_cast<Uint16>(BaseVertex);
+                *(pIndexData++) = static_cast<Uint16>(BaseVertex + v + 1);
+                *(pIndexData++) = static_cast<Uint16>(BaseVertex + v + 2);
+            }
+            BaseVertex += PolygonVerts;
+        }
+
+        m_StreamingVB->Release(Subset);
+        m_StreamingIB->Release(Subset);
+
+        const Uint64 offsets[] = {VBOffset, 0};
+        IBuffer*     pBuffs[]  = {m_StreamingVB->GetBuffer(), m_BatchDataBuffer};
+        pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), IBOffset, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+        DrawAttrs.FirstIndexLocation = 0;
+        for (Uint32 batch = ChunkStart; batch < ChunkEnd;)
+        {
+            const Uint32 FirstPolygon = Order[BatchStarts[batch]];
+            const int    StateInd     = m_Polygons.StateInd[FirstPolygon];
+
+            // Set the pipeline state only when it changes
+            if (StateInd != CurrState)
+            {
+                pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
+                CurrState = StateInd;
+                // Commit the shader resources again after the pipeline state has changed
+                pCurrSRB = nullptr;
+                ++NumPSOSwitches;
+            }
+
             // Shader resources have been explicitly transitioned to correct states, so
             // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
             // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
             // verify that all resources are in correct states. This mode only has effect
             // in debug and development builds
-            if (!UseBatch)
-                pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            IShaderResourceBinding* pSRB = UseBatch ? m_BatchSRB.RawPtr() : m_SRB[m_Polygons.TextureInd[FirstPolygon]].RawPtr();
+            if (pSRB != pCurrSRB)
+            {
+                pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+                pCurrSRB = pSRB;
+            }
 
+            if (UseBatch)
             {
-                // clang-format off
-                float2x2 ScaleMatr
-                {   
-                    CurrInstData.Size, 0.f,
-                    0.f,               CurrInstData.Size
-                };
-                // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
-                float2x2 RotMatr(cosAngle, -sinAngle,
-                                 sinAngle, cosAngle);
-
-                auto Matr = ScaleMatr * RotMatr;
-
-                float4 PolygonRotationAndScale(Matr.m00, Matr.m10, Matr.m01, Matr.m11);
-
-                if (UseBatch)
+                const Uint32 StartInst = BatchStarts[batch];
+                const Uint32 EndInst   = BatchStarts[batch + 1];
+
+                MapHelper<InstanceData> BatchData(pCtx, m_BatchDataBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+                for (Uint32 inst = StartInst; inst < EndInst; ++inst)
                 {
+                    const Uint32 Polygon  = Order[inst];
+                    const float  Size     = m_Polygons.Size[Polygon];
+                    const float  SinAngle = sinf(m_Polygons.Angle[Polygon]) * Size;
+                    const float  CosAngle = cosf(m_Polygons.Angle[Polygon]) * Size;
+
+                    // Scale and rotation matrix, the same as ScaleMatr * RotMatr
                     auto& CurrPolygon                   = BatchData[inst - StartInst];
-                    CurrPolygon.PolygonRotationAndScale = PolygonRotationAndScale;
-                    CurrPolygon.PolygonCenter           = CurrInstData.Pos;
-                    CurrPolygon.TexArrInd               = static_cast<float>(CurrInstData.TextureInd);
+                    CurrPolygon.PolygonRotationAndScale = float4{CosAngle, SinAngle, -SinAngle, CosAngle};
+                    CurrPolygon.PolygonCenter           = float2{m_Polygons.PosX[Polygon], m_Polygons.PosY[Polygon]};
+                    CurrPolygon.TexArrInd               = static_cast<float>(m_Polygons.TextureInd[Polygon]);
                 }
-                else
+
+                DrawAttrs.NumIndices   = (m_Polygons.NumVerts[FirstPolygon] - 2u) * 3u;
+                DrawAttrs.NumInstances = EndInst - StartInst;
+                ++batch;
+            }
+            else
+            {
+                // The vertices are already transformed, so consecutive polygons with the same state
+                // and texture are drawn with a single draw call.
+                const Uint32 Key = GetStateKey<UseBatch>(FirstPolygon);
+
+                DrawAttrs.NumIndices   = 0;
+                DrawAttrs.NumInstances = 1;
+                do
                 {
-                    struct PolygonAttribs
-                    {
-                        float4 g_PolygonRotationAndScale;
-                        float4 g_PolygonCenter;
-                    };
-
-                    // Map the buffer and write current world-view-projection matrix
-                    MapHelper<PolygonAttribs> InstData(pCtx, m_PolygonAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-
-                    InstData->g_PolygonRotationAndScale = PolygonRotationAndScale;
-                    InstData->g_PolygonCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_PolygonCenter.y         = CurrInstData.Pos.y;
-                }
+                    DrawAttrs.NumIndices += (m_Polygons.NumVerts[Order[BatchStarts[batch]]] - 2u) * 3u;
+                    ++batch;
+                } while (batch < ChunkEnd && GetStateKey<UseBatch>(Order[BatchStarts[batch]]) == Key);
             }
-        }
 
-        if (UseBatch)
-            BatchData.Unmap();
+            pCtx->DrawIndexed(DrawAttrs);
+            DrawAttrs.FirstIndexLocation += DrawAttrs.NumIndices;
+            ++NumDraws;
+        }
 
-        DrawAttrs.NumIndices   = static_cast<Uint32>(PolygonGeo.Inds.size());
-        DrawAttrs.NumInstances = EndInst - StartInst;
-        pCtx->DrawIndexed(DrawAttrs);
+        ChunkStart = ChunkEnd;
     }
 
     m_StreamingVB->Flush(Subset);
     m_StreamingIB->Flush(Subset);
+
+    m_Subsets[Subset].NumDraws       = NumDraws;
+    m_Subsets[Subset].NumPSOSwitches = NumPSOSwitches;
 }
 
 // Render a frame
@@ -785,29 +974,50 @@ void Tutorial10_DataStreaming::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+    // Grow the ring when the polygons need more space or the last frame did not fit
+    if (UpdateStreamingRingSize())
+    {
+        std::vector<StateTransitionDesc> Barriers;
+        CreateStreamingBuffers(Barriers);
+        m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+    }
+
     m_StreamingIB->AllowPersistentMapping(m_bAllowPersistentMap);
     m_StreamingVB->AllowPersistentMapping(m_bAllowPersistentMap);
 
-    if (!m_WorkerThreads.empty())
+    // Polygons are alpha-blended, so the draw order must not change from frame to frame.
+    // Besides, every subset writes to its own streaming buffer context. Every thread thus
+    // renders a fixed subset, and the command lists are executed in the subset order.
+    // The threads also update the polygons of their subsets before writing their geometry.
+    Timer RecordTimer;
+    m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) { RenderThreadSubset(ThreadId); });
+    m_ThreadingStats.RecordTime  = RecordTimer.GetElapsedTime();
+    m_ThreadingStats.ExecuteTime = 0;
+
+    m_PolygonUpdateTime = 0;
+    ++m_PolygonUpdateIdx;
+
+    m_NumDraws       = 0;
+    m_NumPSOSwitches = 0;
+    for (const auto& Subset : m_Subsets)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        m_NumDraws += Subset.NumDraws;
+        m_NumPSOSwitches += Subset.NumPSOSwitches;
     }
 
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
-    else
-        RenderSubset<false>(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
+    if (!m_CmdLists.empty())
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
-
         m_CmdListPtrs.resize(m_CmdLists.size());
         for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
             m_CmdListPtrs[i] = m_CmdLists[i];
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        {
+            TimelineProfiler::GpuScope ProfilerScope{m_pImmediateContext, "Command lists"};
+
+            Timer ExecuteTimer;
+            m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+            m_ThreadingStats.ExecuteTime = ExecuteTimer.GetElapsedTime();
+        }
 
         for (auto& cmdList : m_CmdLists)
         {
@@ -817,9 +1027,20 @@ void Tutorial10_DataStreaming::Render()
             cmdList.Release();
         }
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+        m_pTaskScheduler->RunOnAllThreads([this](Uint32 ThreadId) {
+            // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+            // IMPORTANT: we must wait until the command lists are submitted for execution
+            //            because FinishFrame() invalidates all dynamic resources.
+            // IMPORTANT: In Metal backend FinishFrame must be called from the same
+            //            thread that issued rendering commands.
+            if (ThreadId != 0)
+                m_pDeferredContexts[ThreadId - 1]->FinishFrame();
+        });
     }
+
+    // All commands that use the streamed data have been submitted to the immediate context
+    m_StreamingVB->FinishFrame();
+    m_StreamingIB->FinishFrame();
 }
 
 void Tutorial10_DataStreaming::CreateInstanceBuffer()
@@ -841,7 +1062,8 @@ void Tutorial10_DataStreaming::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
-    UpdatePolygons(static_cast<float>(std::min(ElapsedTime, 0.25)));
+    // Polygons are updated by the worker threads in Render()
+    m_PolygonUpdateTime = std::min(m_PolygonUpdateTime + static_cast<float>(ElapsedTime), 0.25f);
 }
 
 } // namespace Diligent
@@ -27,14 +27,12 @@
 
 #pragma once
 
-#include <atomic>
 #include <memory>
 #include <vector>
-#include <thread>
-#include <mutex>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "StreamingBuffer.hpp"
 
 namespace Diligent
 {
@@ -55,43 +53,73 @@ public:
 
     virtual const Char* GetSampleName() const override final { return "Tutorial10: Streaming"; }
 
+    virtual std::vector<ScalingBenchmarkParam> GetScalingBenchmarkParams() const override final;
+    virtual void                               SetScalingBenchmarkConfig(const std::vector<int>& Values) override final;
+    virtual const ThreadingStats*              GetThreadingStats() const override final { return &m_ThreadingStats; }
+
 private:
     void CreatePipelineStates(std::vector<StateTransitionDesc>& Barriers);
     void LoadTextures(std::vector<StateTransitionDesc>& Barriers);
     void UpdateUI();
 
+    void CreateStreamingBuffers(std::vector<StateTransitionDesc>& Barriers);
     void InitializePolygons();
     void InitializePolygonGeometry();
     void CreateInstanceBuffer();
-    void UpdatePolygons(float elapsedTime);
+    void UpdatePolygons(Uint32 StartPolygon, Uint32 EndPolygon, float ElapsedTime);
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
+    bool   UpdateStreamingRingSize();
+    Uint32 GetStreamingRingSize(Uint64 FrameSize) const;
+
     template <bool UseBatch>
     void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
+    template <bool UseBatch>
+    Uint32 GetStateKey(Uint32 Polygon) const;
 
-    static void WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum);
-
-    Threading::Signal m_RenderSubsetSignal;
-    Threading::Signal m_ExecuteCommandListsSignal;
-    Threading::Signal m_GotoNextFrameSignal;
-
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
+    void RenderThreadSubset(Uint32 ThreadId);
 
-    std::vector<std::thread> m_WorkerThreads;
+    std::unique_ptr<TaskScheduler> m_pTaskScheduler;
 
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
+    // Draw order and statistics of a subset. Every subset is only accessed by the thread that renders it.
+    struct SubsetData
+    {
+        // Indices of the polygons in the order they are drawn
+        std::vector<Uint32> Order;
+        std::vector<Uint32> SortScratch;
+        // Every batch is a range of Order, the last element is the end of the last batch
+        std::vector<Uint32> BatchStarts;
+
+        Uint32 NumDraws       = 0;
+        Uint32 NumPSOSwitches = 0;
+    };
+    std::vector<SubsetData> m_Subsets;
+
+    // When enabled, every subset sorts its polygons by state before drawing them, so that the pipeline
+    // state only changes once per state and batches never mix states or vertex counts.
+    bool   m_SortByState    = true;
+    Uint32 m_NumDraws       = 0;
+    Uint32 m_NumPSOSwitches = 0;
+
     static constexpr const int    NumStates = 5;
     RefCntAutoPtr<IPipelineState> m_pPSO[2][NumStates];
-    RefCntAutoPtr<IBuffer>        m_PolygonAttribsCB;
     RefCntAutoPtr<IBuffer>        m_BatchDataBuffer;
 
-    static constexpr const int             MaxVertsInStreamingBuffer = 1024;
-    std::unique_ptr<class StreamingBuffer> m_StreamingVB;
-    std::unique_ptr<class StreamingBuffer> m_StreamingIB;
+    // The size of the dynamic buffer and the number of vertices every thread allocates at once
+    static constexpr const Uint32    MaxVertsInStreamingBuffer = 16384;
+    std::unique_ptr<StreamingBuffer> m_StreamingVB;
+    std::unique_ptr<StreamingBuffer> m_StreamingIB;
+
+    // The ring grows with the geometry of the frame. Frames that do not fit into the largest
+    // ring are streamed through the dynamic buffer. Zero size means the ring is not used.
+    static constexpr const Uint32 MinStreamingRingSize = 16 << 20;
+    static constexpr const Uint32 MaxStreamingRingSize = 256 << 20;
+    Uint32                        m_StreamingRingVBSize = 0;
+    Uint32                        m_StreamingRingIBSize = 0;
 
     static constexpr int                  NumTextures = 4;
     RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
@@ -99,27 +127,46 @@ private:
     RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
     RefCntAutoPtr<ITextureView>           m_TexArraySRV;
 
-    static constexpr int MaxPolygons  = 100000;
+    static constexpr int MaxPolygons  = 4000000;
     static constexpr int MaxBatchSize = 100;
 
     int m_NumPolygons = 1000;
     int m_BatchSize   = 5;
 
+    // The total number of vertices of all polygons
+    Uint64 m_NumPolygonVerts = 0;
+
     int m_MaxThreads       = 8;
     int m_NumWorkerThreads = 4;
 
-    struct PolygonData
+    // Recording times of the last frame, including the polygon update that the threads do
+    // before streaming the geometry. ThreadRecordTime[i] is only written by thread i.
+    ThreadingStats m_ThreadingStats;
+
+    // Polygon states are stored as a structure of arrays, so that the update
+    // loop only touches the data it needs and can be vectorized.
+    struct PolygonStates
     {
-        float2 Pos;
-        float2 MoveDir;
-        float  Size       = 0;
-        float  Angle      = 0;
-        float  RotSpeed   = 0;
-        int    TextureInd = 0;
-        int    StateInd   = 0;
-        int    NumVerts   = 0;
+        std::vector<float> PosX;
+        std::vector<float> PosY;
+        std::vector<float> MoveDirX;
+        std::vector<float> MoveDirY;
+        std::vector<float> Size;
+        std::vector<float> Angle;
+        std::vector<float> RotSpeed;
+        std::vector<Uint8> TextureInd;
+        std::vector<Uint8> StateInd;
+        std::vector<Uint8> NumVerts;
+
+        void Resize(size_t NumPolygons);
+        size_t GetCount() const { return PosX.size(); }
     };
-    std::vector<PolygonData> m_Polygons;
+    PolygonStates m_Polygons;
+
+    // The time the polygons are advanced by in the next frame. Every worker thread
+    // updates the polygons of its subset right before it writes their geometry.
+    float  m_PolygonUpdateTime = 0;
+    Uint32 m_PolygonUpdateIdx  = 0;
 
     struct InstanceData
     {
@@ -128,16 +175,20 @@ private:
         float  TexArrInd;
     };
 
-    static constexpr const Uint32 MinPolygonVerts = 3;
-    static constexpr const Uint32 MaxPolygonVerts = 10;
-    struct PolygonGeometry
+    // Vertex of a polygon that is transformed on the CPU, used when batching is disabled
+    struct PolygonVertex
     {
-        std::vector<float2> Verts;
-        std::vector<Uint32> Inds;
+        float2 Pos;
+        float2 UV;
     };
-    std::vector<PolygonGeometry> m_PolygonGeo;
-    bool                         m_bAllowPersistentMap = false;
-    std::pair<Uint32, Uint32>    WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum);
+
+    static constexpr const Uint32 MinPolygonVerts = 3;
+    static constexpr const Uint32 MaxPolygonVerts = 10;
+
+    // Unit polygon vertices for every vertex count. Polygons are triangulated as fans.
+    float2 m_PolygonVerts[MaxPolygonVerts + 1][MaxPolygonVerts] = {};
+    bool   m_bAllowPersistentMap                                = false;
+    bool   m_bUseStreamingRing                                  = true;
 };
 
 } // namespace Diligent
@@ -264,8 +264,8 @@ void Tutorial14_ComputeShader::CreateParticleBuffers()
 
     std::vector<ParticleAttribs> ParticleData(m_NumParticles);
 
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    std::mt19937 gen{m_RandomSeed}; // Standard mersenne_twister_engine. Use --seed to change the seed
+                                    // to generate consistent distribution.
 
     std::uniform_real_distribution<float> pos_distr(-1.f, +1.f);
     std::uniform_real_distribution<float> size_distr(0.5f, 1.f);
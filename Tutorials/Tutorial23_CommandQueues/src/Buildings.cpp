@@ -26,9 +26,13 @@
 
 #include <random>
 
+#include "SIMDSupport.hpp"
+
 #include "Buildings.hpp"
 #include "MapHelper.hpp"
+#include "Align.hpp"
 #include "PlatformMisc.hpp"
+#include "TimelineProfiler.hpp"
 
 namespace Diligent
 {
@@ -648,23 +652,63 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
             SliceSize += std::max(1u, TexDesc.Width >> Mip) * std::max(1u, TexDesc.Height >> Mip);
 
-        m_OpaqueTexAtlasPixels.resize(size_t{SliceSize} * size_t{TexDesc.ArraySize});
-        m_GenTexTask.Pixels.resize(SliceSize);
+        m_OpaqueTexAtlasPixels.resize(TexDesc.ArraySize);
+        for (auto& SlicePixels : m_OpaqueTexAtlasPixels)
+            SlicePixels.resize(SliceSize);
+        m_OpaqueTexAtlasSliceGenerations.assign(TexDesc.ArraySize, 0);
         m_OpaqueTexAtlasSliceSize = SliceSize * 4;
 
+#if !USE_STAGING_TEXTURE
+        m_OpaqueTexAtlasUploadSliceSize = 0;
+        for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
+        {
+            const Uint64 Stride = AlignUp(Uint64{std::max(1u, TexDesc.Width >> Mip)} * 4u, Uint64{UploadRowPitchAlignment});
+            m_OpaqueTexAtlasUploadSliceSize += AlignUp(Stride * std::max(1u, TexDesc.Height >> Mip), Uint64{UploadOffsetAlignment});
+        }
+        m_UploadRegions.reserve(size_t{TexDesc.ArraySize} * TexDesc.MipLevels);
+#endif
+
         // Initialize content
         GenerateOpaqueTexture();
+#if !USE_STAGING_TEXTURE
+        // The initial upload of the whole atlas goes through the implicit staging buffer,
+        // so that the upload ring is sized from the transfer rate requested at run time.
+        const bool UseUploadRing = m_UseUploadRing;
+        m_UseUploadRing          = false;
+#endif
         Uint32 Unused;
         UpdateAtlas(pContext, ~0u, Unused);
+#if !USE_STAGING_TEXTURE
+        m_UseUploadRing = UseUploadRing;
+#endif
         pContext->Flush();
 
-        // Begin texture generation in async thread
+        // Begin texture generation in async threads.
+        // Twice as many tasks as threads keep the threads busy between UpdateAtlas() calls;
+        // every task is split into bands of rows, so several threads work on the same slice.
         {
-            m_GenTexTask.ArraySlice = 0;
-            m_GenTexTask.Time       = CurrentTime;
+            const Uint32 NumThreads = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+
+            m_NumGenTexTasks = std::min(NumThreads * 2, TexDesc.ArraySize);
+            m_NumGenTexBands = (TexDesc.Height + GenTexBandRows - 1) / GenTexBandRows;
+            m_GenTexTasks.reset(new GenTexTask[m_NumGenTexTasks]);
 
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::Initial);
+            {
+                std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+                m_GenTexThreadsLooping = true;
+            }
+            for (Uint32 i = 0; i < NumThreads; ++i)
+                m_GenTexThreads.emplace_back(&Buildings::ThreadProc, this);
+
+            for (Uint32 i = 0; i < m_NumGenTexTasks; ++i)
+            {
+                auto& Task = m_GenTexTasks[i];
+                Task.Pixels.resize(SliceSize);
+                Task.ArraySlice   = m_NextGenTexSlice;
+                Task.Time         = CurrentTime;
+                m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
+                QueueGenTexTask(Task);
+            }
         }
     }
 
@@ -682,6 +726,10 @@ void Buildings::Initialize(IRenderDevice* pDevice, IBuffer* pDrawConstants, Uint
     FenceCI.Name = "Upload complete fence";
     FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
     m_Device->CreateFence(FenceCI, &m_UploadCompleteFence);
+#else
+    // Copies from a buffer to a texture are supported by these backends on all queues.
+    const auto DeviceType = m_Device->GetDeviceInfo().Type;
+    m_UseUploadRing       = (DeviceType == RENDER_DEVICE_TYPE_D3D12 || DeviceType == RENDER_DEVICE_TYPE_VULKAN);
 #endif
 }
 
@@ -854,50 +902,62 @@ static constexpr Uint32 NeonLineBorder2    = 4;
 static constexpr Uint32 NeonLineWithBorder = NeonLineBorder1 + NeonLineSize + NeonLineBorder2;
 
 
-static void GenWallTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash)
+// Fills Count pixels with the same color, 4 pixels per store when SIMD is available
+static void FillPixels(Uint32* Dst, Uint32 Count, Uint32 Color)
 {
-    for (Uint32 y = 0; y < H; ++y)
-    {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            Pixels[x + y * W] = WallColor;
-        }
-    }
+    Uint32 x = 0;
+#if SAMPLES_USE_SSE2
+    const __m128i Color4 = _mm_set1_epi32(static_cast<int>(Color));
+    for (; x + 4 <= Count; x += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + x), Color4);
+#elif SAMPLES_USE_NEON
+    const uint32x4_t Color4 = vdupq_n_u32(Color);
+    for (; x + 4 <= Count; x += 4)
+        vst1q_u32(Dst + x, Color4);
+#endif
+    for (; x < Count; ++x)
+        Dst[x] = Color;
 }
 
-static void GenWallAndRightNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
+// The generators below write rows [FirstRow, FirstRow + NumRows) of a W x H texture.
+// Every pattern is made of horizontal spans of a single color.
+
+static void GenWallTexture(Uint32* Pixels, const Uint32 W, const Uint32 FirstRow, const Uint32 NumRows)
 {
-    GenWallTexture(Pixels, W, H, Hash);
+    for (Uint32 y = FirstRow; y < FirstRow + NumRows; ++y)
+        FillPixels(&Pixels[y * W], W, WallColor);
+}
 
+static Uint32 GetNeonColor(const Uint32 Hash2)
+{
     Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
     ColIndex        = ColIndex % _countof(NeonColors);
+    return NeonColors[ColIndex];
+}
+
+static void GenRightNeonLine(Uint32* Pixels, const Uint32 W, const Uint32 FirstRow, const Uint32 NumRows, const Uint32 Hash2)
+{
+    const Uint32 NeonColor = GetNeonColor(Hash2);
+    const Uint32 LineStart = W - NeonLineWithBorder;
 
-    for (Uint32 y = 0; y < H; ++y)
+    for (Uint32 y = FirstRow; y < FirstRow + NumRows; ++y)
     {
-        for (Uint32 x = W - NeonLineWithBorder; x < W; ++x)
-        {
-            const Uint32 lx   = x - (W - NeonLineWithBorder);
-            const auto   col  = (lx >= NeonLineBorder1 && lx < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
+        Uint32* Row = &Pixels[y * W];
+        FillPixels(Row + LineStart, NeonLineBorder1, WallColor);
+        FillPixels(Row + LineStart + NeonLineBorder1, NeonLineSize, NeonColor);
+        FillPixels(Row + LineStart + NeonLineBorder1 + NeonLineSize, NeonLineBorder2, WallColor);
     }
 }
 
-static void GenWallAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
+static void GenTopNeonLine(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 FirstRow, const Uint32 NumRows, const Uint32 Hash2)
 {
-    GenWallTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
+    const Uint32 NeonColor = GetNeonColor(Hash2);
+    const Uint32 LineStart = H - NeonLineWithBorder;
 
-    for (Uint32 y = H - NeonLineWithBorder; y < H; ++y)
+    for (Uint32 y = std::max(FirstRow, LineStart); y < FirstRow + NumRows; ++y)
     {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            const Uint32 ly   = y - (H - NeonLineWithBorder);
-            const auto   col  = (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
+        const Uint32 ly = y - LineStart;
+        FillPixels(&Pixels[y * W], W, (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColor : WallColor);
     }
 }
 
@@ -906,69 +966,55 @@ inline Uint32 Combine(Uint32 Lhs, Uint32 Rhs)
     return Lhs ^ ((Rhs << 8) | (Rhs >> 8));
 }
 
-static void GenWindowsTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash)
+static void GenWindowsTexture(Uint32* Pixels, const Uint32 W, const Uint32 FirstRow, const Uint32 NumRows, const Uint32 Hash)
 {
     const Uint32 WndOffsetX = (WindowWithBorderSizePx - WindowSizePxX) / 2;
     const Uint32 WndOffsetY = (WindowWithBorderSizePx - WindowSizePxY) / 2;
 
-    for (Uint32 y = 0; y < H; ++y)
+    for (Uint32 y = FirstRow; y < FirstRow + NumRows; ++y)
     {
-        for (Uint32 x = 0; x < W; ++x)
+        Uint32*      Row = &Pixels[y * W];
+        const Uint32 ly  = y % WindowWithBorderSizePx;
+        if (ly < WndOffsetY || ly >= WindowSizePxY + WndOffsetY)
         {
-            Uint32 col = WallColor;
-
-            Uint32 lx = x % WindowWithBorderSizePx;
-            Uint32 ly = y % WindowWithBorderSizePx;
-
-            if ((lx >= WndOffsetX && lx < WindowSizePxX + WndOffsetX) &&
-                (ly >= WndOffsetY && ly < WindowSizePxY + WndOffsetY))
-            {
-                Uint32 ColIndex = Combine(0u, (x / WindowWithBorderSizePx) * 0x5a2);
-                ColIndex        = Combine(ColIndex, (y / WindowWithBorderSizePx) * 0x9e3);
-                ColIndex        = Combine(ColIndex, Hash * 0x681);
-
-                col = WindowColors[ColIndex % _countof(WindowColors)];
-            }
-
-            Pixels[x + y * W] = col;
+            FillPixels(Row, W, WallColor);
+            continue;
         }
-    }
-}
-
-static void GenWindowsAndRightNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
-{
-    GenWindowsTexture(Pixels, W, H, Hash);
 
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
-
-    for (Uint32 y = 0; y < H; ++y)
-    {
-        for (Uint32 x = W - NeonLineWithBorder; x < W; ++x)
+        // Each window cell is a wall span, a window span and another wall span
+        for (Uint32 x = 0; x < W; x += WindowWithBorderSizePx)
         {
-            const Uint32 lx   = x - (W - NeonLineWithBorder);
-            const auto   col  = (lx >= NeonLineBorder1 && lx < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
+            Uint32 ColIndex = Combine(0u, (x / WindowWithBorderSizePx) * 0x5a2);
+            ColIndex        = Combine(ColIndex, (y / WindowWithBorderSizePx) * 0x9e3);
+            ColIndex        = Combine(ColIndex, Hash * 0x681);
+
+            const Uint32 CellW   = std::min(WindowWithBorderSizePx, W - x);
+            const Uint32 WndEnd  = std::min(WndOffsetX + WindowSizePxX, CellW);
+            const Uint32 WndBeg  = std::min(WndOffsetX, CellW);
+            FillPixels(Row + x, WndBeg, WallColor);
+            FillPixels(Row + x + WndBeg, WndEnd - WndBeg, WindowColors[ColIndex % _countof(WindowColors)]);
+            FillPixels(Row + x + WndEnd, CellW - WndEnd, WallColor);
         }
     }
 }
 
-static void GenWindowsAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
+// Averages 2x2 blocks with rounding. Alpha is the brightness of self-emission;
+// it is kept only if at least 3 of the 4 source pixels are emissive.
+static Uint32 FilterPixels2x2(Uint32 c0, Uint32 c1, Uint32 c2, Uint32 c3)
 {
-    GenWindowsTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
-
-    for (Uint32 y = H - NeonLineWithBorder; y < H; ++y)
+    Uint32 Result = 0;
+    for (Uint32 Shift = 0; Shift < 32; Shift += 8)
     {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            const Uint32 ly   = y - (H - NeonLineWithBorder);
-            const auto   col  = (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
+        const Uint32 Sum = ((c0 >> Shift) & 0xFF) + ((c1 >> Shift) & 0xFF) + ((c2 >> Shift) & 0xFF) + ((c3 >> Shift) & 0xFF);
+        Result |= ((Sum + 2) >> 2) << Shift;
     }
+
+    // Disable self-emission
+    const Uint32 NumEmissionPix = ((c0 >> 24) != 0) + ((c1 >> 24) != 0) + ((c2 >> 24) != 0) + ((c3 >> 24) != 0);
+    if (NumEmissionPix <= 2)
+        Result &= 0x00FFFFFFu;
+
+    return Result;
 }
 
 static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 SrcH, Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH)
@@ -977,25 +1023,119 @@ static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 S
 
     for (Uint32 y = 0; y < DstH; ++y)
     {
-        for (Uint32 x = 0; x < DstW; ++x)
+        const Uint32* SrcRow0 = &SrcPixels[(y * 2 + 0) * SrcW];
+        const Uint32* SrcRow1 = &SrcPixels[(y * 2 + 1) * SrcW];
+        Uint32*       DstRow  = &DstPixels[y * DstW];
+
+        Uint32 x = 0;
+#if SAMPLES_USE_AVX2
+        for (; x + 8 <= DstW; x += 8)
         {
-            float4 c0  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 0) * SrcW]);
-            float4 c1  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 0) * SrcW]);
-            float4 c2  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 1) * SrcW]);
-            float4 c3  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 1) * SrcW]);
-            float4 col = (c0 + c1 + c2 + c3) * 0.25f;
-
-            // disable self-emission
-            Uint32 NumEmissionPix = (c0.a > 0.f) + (c1.a > 0.f) + (c2.a > 0.f) + (c3.a > 0.f);
-            if (NumEmissionPix <= 2)
-                col.a = 0.f;
-
-            DstPixels[x + y * DstW] = F4Color_To_RGBA8Unorm(col);
+            const __m256 a0 = _mm256_loadu_ps(reinterpret_cast<const float*>(SrcRow0 + x * 2));
+            const __m256 a1 = _mm256_loadu_ps(reinterpret_cast<const float*>(SrcRow0 + x * 2 + 8));
+            const __m256 b0 = _mm256_loadu_ps(reinterpret_cast<const float*>(SrcRow1 + x * 2));
+            const __m256 b1 = _mm256_loadu_ps(reinterpret_cast<const float*>(SrcRow1 + x * 2 + 8));
+
+            // Split even and odd source pixels. The shuffle works within 128-bit lanes, so the destination
+            // pixels come out as 0 1 4 5 | 2 3 6 7 and are reordered before the store.
+            const __m256i c0 = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m256i c1 = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+            const __m256i c2 = _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m256i c3 = _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            const __m256i Zero  = _mm256_setzero_si256();
+            const __m256i Round = _mm256_set1_epi16(2);
+            __m256i       Lo    = _mm256_add_epi16(_mm256_unpacklo_epi8(c0, Zero), _mm256_unpacklo_epi8(c1, Zero));
+            __m256i       Hi    = _mm256_add_epi16(_mm256_unpackhi_epi8(c0, Zero), _mm256_unpackhi_epi8(c1, Zero));
+            Lo                  = _mm256_add_epi16(Lo, _mm256_add_epi16(_mm256_unpacklo_epi8(c2, Zero), _mm256_unpacklo_epi8(c3, Zero)));
+            Hi                  = _mm256_add_epi16(Hi, _mm256_add_epi16(_mm256_unpackhi_epi8(c2, Zero), _mm256_unpackhi_epi8(c3, Zero)));
+            Lo                  = _mm256_srli_epi16(_mm256_add_epi16(Lo, Round), 2);
+            Hi                  = _mm256_srli_epi16(_mm256_add_epi16(Hi, Round), 2);
+            __m256i Avg         = _mm256_packus_epi16(Lo, Hi);
+
+            // Each non-emissive pixel adds -1, keep alpha if at most one pixel is non-emissive
+            const __m256i AlphaMask   = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m256i NumNonEmiss = _mm256_add_epi32(_mm256_add_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(c0, AlphaMask), Zero),
+                                                                          _mm256_cmpeq_epi32(_mm256_and_si256(c1, AlphaMask), Zero)),
+                                                         _mm256_add_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(c2, AlphaMask), Zero),
+                                                                          _mm256_cmpeq_epi32(_mm256_and_si256(c3, AlphaMask), Zero)));
+            const __m256i KeepAlpha   = _mm256_cmpgt_epi32(NumNonEmiss, _mm256_set1_epi32(-2));
+            Avg                       = _mm256_and_si256(Avg, _mm256_or_si256(KeepAlpha, _mm256_set1_epi32(0x00FFFFFF)));
+
+            Avg = _mm256_permute4x64_epi64(Avg, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(DstRow + x), Avg);
         }
+#elif SAMPLES_USE_SSE2
+        for (; x + 4 <= DstW; x += 4)
+        {
+            const __m128 a0 = _mm_loadu_ps(reinterpret_cast<const float*>(SrcRow0 + x * 2));
+            const __m128 a1 = _mm_loadu_ps(reinterpret_cast<const float*>(SrcRow0 + x * 2 + 4));
+            const __m128 b0 = _mm_loadu_ps(reinterpret_cast<const float*>(SrcRow1 + x * 2));
+            const __m128 b1 = _mm_loadu_ps(reinterpret_cast<const float*>(SrcRow1 + x * 2 + 4));
+
+            // Split even and odd source pixels
+            const __m128i c0 = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i c1 = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+            const __m128i c2 = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i c3 = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            const __m128i Zero  = _mm_setzero_si128();
+            const __m128i Round = _mm_set1_epi16(2);
+            __m128i       Lo    = _mm_add_epi16(_mm_unpacklo_epi8(c0, Zero), _mm_unpacklo_epi8(c1, Zero));
+            __m128i       Hi    = _mm_add_epi16(_mm_unpackhi_epi8(c0, Zero), _mm_unpackhi_epi8(c1, Zero));
+            Lo                  = _mm_add_epi16(Lo, _mm_add_epi16(_mm_unpacklo_epi8(c2, Zero), _mm_unpacklo_epi8(c3, Zero)));
+            Hi                  = _mm_add_epi16(Hi, _mm_add_epi16(_mm_unpackhi_epi8(c2, Zero), _mm_unpackhi_epi8(c3, Zero)));
+            Lo                  = _mm_srli_epi16(_mm_add_epi16(Lo, Round), 2);
+            Hi                  = _mm_srli_epi16(_mm_add_epi16(Hi, Round), 2);
+            __m128i Avg         = _mm_packus_epi16(Lo, Hi);
+
+            // Each non-emissive pixel adds -1, keep alpha if at most one pixel is non-emissive
+            const __m128i AlphaMask   = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m128i NumNonEmiss = _mm_add_epi32(_mm_add_epi32(_mm_cmpeq_epi32(_mm_and_si128(c0, AlphaMask), Zero),
+                                                                    _mm_cmpeq_epi32(_mm_and_si128(c1, AlphaMask), Zero)),
+                                                      _mm_add_epi32(_mm_cmpeq_epi32(_mm_and_si128(c2, AlphaMask), Zero),
+                                                                    _mm_cmpeq_epi32(_mm_and_si128(c3, AlphaMask), Zero)));
+            const __m128i KeepAlpha   = _mm_cmpgt_epi32(NumNonEmiss, _mm_set1_epi32(-2));
+            Avg                       = _mm_and_si128(Avg, _mm_or_si128(KeepAlpha, _mm_set1_epi32(0x00FFFFFF)));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(DstRow + x), Avg);
+        }
+#elif SAMPLES_USE_NEON
+        for (; x + 4 <= DstW; x += 4)
+        {
+            // De-interleave even and odd source pixels
+            const uint32x4x2_t a = vld2q_u32(SrcRow0 + x * 2);
+            const uint32x4x2_t b = vld2q_u32(SrcRow1 + x * 2);
+
+            const uint8x16_t c0 = vreinterpretq_u8_u32(a.val[0]);
+            const uint8x16_t c1 = vreinterpretq_u8_u32(a.val[1]);
+            const uint8x16_t c2 = vreinterpretq_u8_u32(b.val[0]);
+            const uint8x16_t c3 = vreinterpretq_u8_u32(b.val[1]);
+
+            uint16x8_t Lo = vaddl_u8(vget_low_u8(c0), vget_low_u8(c1));
+            uint16x8_t Hi = vaddl_u8(vget_high_u8(c0), vget_high_u8(c1));
+            Lo            = vaddq_u16(Lo, vaddl_u8(vget_low_u8(c2), vget_low_u8(c3)));
+            Hi            = vaddq_u16(Hi, vaddl_u8(vget_high_u8(c2), vget_high_u8(c3)));
+            // Rounding shift: (x + 2) >> 2
+            uint32x4_t Avg = vreinterpretq_u32_u8(vcombine_u8(vrshrn_n_u16(Lo, 2), vrshrn_n_u16(Hi, 2)));
+
+            // Each emissive pixel adds -1, keep alpha if at least 3 pixels are emissive
+            const uint32x4_t AlphaMask = vdupq_n_u32(0xFF000000u);
+            const int32x4_t  NumEmiss  = vaddq_s32(vaddq_s32(vreinterpretq_s32_u32(vtstq_u32(a.val[0], AlphaMask)), vreinterpretq_s32_u32(vtstq_u32(a.val[1], AlphaMask))),
+                                                  vaddq_s32(vreinterpretq_s32_u32(vtstq_u32(b.val[0], AlphaMask)), vreinterpretq_s32_u32(vtstq_u32(b.val[1], AlphaMask))));
+            const uint32x4_t KeepAlpha = vcleq_s32(NumEmiss, vdupq_n_s32(-3));
+            Avg                        = vandq_u32(Avg, vorrq_u32(KeepAlpha, vdupq_n_u32(0x00FFFFFFu)));
+
+            vst1q_u32(DstRow + x, Avg);
+        }
+#endif
+        for (; x < DstW; ++x)
+            DstRow[x] = FilterPixels2x2(SrcRow0[x * 2 + 0], SrcRow0[x * 2 + 1], SrcRow1[x * 2 + 0], SrcRow1[x * 2 + 1]);
     }
 }
 
-static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice, Uint32 CurrTime)
+// Generates rows [FirstRow, FirstRow + NumRows) of the most detailed mip level
+static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 FirstRow, Uint32 NumRows, Uint32 Slice, Uint32 CurrTime)
 {
     const Uint32 Hash  = ((Slice * 0xacd) << (CurrTime & 2)) ^ (CurrTime * 0x4c44);
     const Uint32 Hash2 = Slice * 0x79b3;
@@ -1006,19 +1146,58 @@ static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice
 
     switch (TexType)
     {
-        // clang-format off
-        case TexLayerType::Wall:                    GenWallTexture(Pixels, Width, Height, Hash);                           break;
-        case TexLayerType::WallAndRightNeonLine:    GenWallAndRightNeonLineTexture(Pixels, Width, Height, Hash, Hash2);    break;
-        case TexLayerType::WallAndTopNeonLine:      GenWallAndTopNeonLineTexture(Pixels, Width, Height, Hash, Hash2);      break;
-        case TexLayerType::Windows:                 GenWindowsTexture(Pixels, Width, Height, Hash);                        break;
-        case TexLayerType::WindowsAndRightNeonLine: GenWindowsAndRightNeonLineTexture(Pixels, Width, Height, Hash, Hash2); break;
-        case TexLayerType::WindowsAndTopNeonLine:   GenWindowsAndTopNeonLineTexture(Pixels, Width, Height, Hash, Hash2);   break;
-        // clang-format on
+        case TexLayerType::Wall:
+            GenWallTexture(Pixels, Width, FirstRow, NumRows);
+            break;
+
+        case TexLayerType::WallAndRightNeonLine:
+            GenWallTexture(Pixels, Width, FirstRow, NumRows);
+            GenRightNeonLine(Pixels, Width, FirstRow, NumRows, Hash2);
+            break;
+
+        case TexLayerType::WallAndTopNeonLine:
+            GenWallTexture(Pixels, Width, FirstRow, NumRows);
+            GenTopNeonLine(Pixels, Width, Height, FirstRow, NumRows, Hash2);
+            break;
+
+        case TexLayerType::Windows:
+            GenWindowsTexture(Pixels, Width, FirstRow, NumRows, Hash);
+            break;
+
+        case TexLayerType::WindowsAndRightNeonLine:
+            GenWindowsTexture(Pixels, Width, FirstRow, NumRows, Hash);
+            GenRightNeonLine(Pixels, Width, FirstRow, NumRows, Hash2);
+            break;
+
+        case TexLayerType::WindowsAndTopNeonLine:
+            GenWindowsTexture(Pixels, Width, FirstRow, NumRows, Hash);
+            GenTopNeonLine(Pixels, Width, Height, FirstRow, NumRows, Hash2);
+            break;
+
         default:
             UNEXPECTED("Unknown texture layer type");
     }
 }
 
+// Generates mip levels 1..N from level 0; all levels of the slice are packed one after another
+static void GenMipChain(Uint32* Pixels, const TextureDesc& TexDesc)
+{
+    Uint32 SrcOffset = 0;
+    for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
+    {
+        const Uint32* SrcPixels = &Pixels[SrcOffset];
+        const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
+        const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
+        const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
+        Uint32*       DstPixels = &Pixels[DstOffset];
+        const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
+        const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
+
+        GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
+        SrcOffset = DstOffset;
+    }
+}
+
 
 void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb)
 {
@@ -1027,27 +1206,46 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    // Try to read a new texture
-    for (Uint32 i = 0; i < 100; ++i)
+    // Take all finished textures and queue new tasks in their slots
+    for (Uint32 i = 0; i < m_NumGenTexTasks; ++i)
     {
+        auto&      Task     = m_GenTexTasks[i];
         TaskStatus Expected = TaskStatus::TexReady;
-        if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::CopyTex, std::memory_order_acquire, std::memory_order_relaxed))
+        if (Task.Status.compare_exchange_strong(Expected, TaskStatus::CopyTex, std::memory_order_acquire, std::memory_order_relaxed))
         {
-            Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * m_GenTexTask.ArraySlice;
-            memcpy(&m_OpaqueTexAtlasPixels[Offset], m_GenTexTask.Pixels.data(), m_OpaqueTexAtlasSliceSize);
+            // Slices are assigned round-robin, so a slow task may finish after a newer task for the same slice.
+            // Its result is stale and is dropped. Otherwise, swap the buffers instead of copying the pixels;
+            // the task will overwrite the old slice.
+            if (Task.Generation > m_OpaqueTexAtlasSliceGenerations[Task.ArraySlice])
+            {
+                m_OpaqueTexAtlasPixels[Task.ArraySlice].swap(Task.Pixels);
+                m_OpaqueTexAtlasSliceGenerations[Task.ArraySlice] = Task.Generation;
+            }
 
             // Update task parameters
-            m_GenTexTask.ArraySlice = (m_GenTexTask.ArraySlice + 1) % TexDesc.ArraySize;
-            m_GenTexTask.Time       = CurrentTime;
-
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::CopyTex);
-            break;
+            Task.ArraySlice   = m_NextGenTexSlice;
+            Task.Time         = CurrentTime;
+            m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
+            QueueGenTexTask(Task);
         }
     }
 
 #if USE_STAGING_TEXTURE
     m_UploadCompleteFence->Wait(m_UploadCompleteFenceValue);
+#else
+    Uint8* pRingData = nullptr;
+    if (m_UseUploadRing)
+    {
+        // The ring holds a few frames of uploads at the required rate; it only grows when the rate is increased.
+        // Regions that do not fit into the ring are uploaded with implicit staging buffer.
+        const Uint64 FrameSize = std::min(Uint64{RequiredTransferRateMb} << 20, m_OpaqueTexAtlasUploadSliceSize * TexDesc.ArraySize) + m_OpaqueTexAtlasUploadSliceSize;
+        const Uint64 RingSize  = std::min(FrameSize * UploadRingFrames, Uint64{MaxUploadRingSize});
+        if (m_UploadRing.GetSize() < RingSize)
+            m_UploadRing.Create(m_Device, RingSize, m_ImmediateContextMask);
+
+        pRingData = m_UploadRing.Map(pContext);
+        m_UploadRegions.clear();
+    }
 #endif
 
     pContext->BeginDebugGroup("Update textures");
@@ -1068,7 +1266,7 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
     for (Uint32 SliceInd = 0; SliceInd < TexDesc.ArraySize; ++SliceInd)
     {
         Uint32 Slice  = (FirstSlice + SliceInd) % TexDesc.ArraySize;
-        Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
+        Uint32 Offset = 0;
         for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
         {
             const auto W = std::max(1u, TexDesc.Width >> Mipmap);
@@ -1077,7 +1275,7 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 #if USE_STAGING_TEXTURE
             MappedTextureSubresource SubRes;
             pContext->MapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice, MAP_WRITE, MAP_FLAG_DO_NOT_WAIT | MAP_FLAG_DISCARD | MAP_FLAG_NO_OVERWRITE, nullptr, SubRes);
-            memcpy(SubRes.pData, &m_OpaqueTexAtlasPixels[Offset], W * H * 4);
+            memcpy(SubRes.pData, &m_OpaqueTexAtlasPixels[Slice][Offset], W * H * 4);
             pContext->UnmapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice);
 
             CopyTextureAttribs Attribs;
@@ -1089,11 +1287,40 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
             Attribs.DstSlice    = Slice;
             pContext->CopyTexture(Attribs);
 #else
-            TextureSubResData SubRes;
-            SubRes.Stride = Uint64{W} * 4u;
-            SubRes.pData = &m_OpaqueTexAtlasPixels[Offset];
-            Box Region{0u, W, 0u, H};
-            pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
+            const Uint32* pSrcPixels = &m_OpaqueTexAtlasPixels[Slice][Offset];
+
+            UploadRegion RingRegion;
+            if (pRingData != nullptr)
+            {
+                RingRegion.Stride    = AlignUp(Uint64{W} * 4u, Uint64{UploadRowPitchAlignment});
+                RingRegion.SrcOffset = m_UploadRing.Allocate(RingRegion.Stride * H, UploadOffsetAlignment);
+            }
+
+            if (pRingData != nullptr && RingRegion.SrcOffset != UploadRing::InvalidOffset)
+            {
+                Uint8* pDst = pRingData + RingRegion.SrcOffset;
+                if (RingRegion.Stride == W * 4)
+                    memcpy(pDst, pSrcPixels, W * H * 4);
+                else
+                {
+                    for (Uint32 y = 0; y < H; ++y)
+                        memcpy(pDst + y * RingRegion.Stride, pSrcPixels + y * W, W * 4);
+                }
+
+                RingRegion.Slice  = Slice;
+                RingRegion.Mipmap = Mipmap;
+                RingRegion.Width  = W;
+                RingRegion.Height = H;
+                m_UploadRegions.push_back(RingRegion);
+            }
+            else
+            {
+                TextureSubResData SubRes;
+                SubRes.Stride = Uint64{W} * 4u;
+                SubRes.pData  = pSrcPixels;
+                Box Region{0u, W, 0u, H};
+                pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
+            }
 #endif
             CopiedCpuToGpu += W * H * 4;
             Offset += W * H;
@@ -1106,6 +1333,20 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
             break;
     }
 
+#if !USE_STAGING_TEXTURE
+    if (pRingData != nullptr)
+    {
+        // Copy commands are recorded after the ring is unmapped
+        m_UploadRing.Unmap(pContext);
+        for (const auto& RingRegion : m_UploadRegions)
+        {
+            TextureSubResData SubRes{m_UploadRing.GetBuffer(), RingRegion.SrcOffset, RingRegion.Stride};
+            Box               Region{0u, RingRegion.Width, 0u, RingRegion.Height};
+            pContext->UpdateTexture(m_OpaqueTexAtlas, RingRegion.Mipmap, RingRegion.Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
+        }
+    }
+#endif
+
     // Resources must be manually transitioned to required states.
     // Vulkan:     any state supported by transfer queue is allowed.
     // DirectX 12: resource transition from graphics/compute to copy queue requires resource to be in COMMON state.
@@ -1119,85 +1360,125 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 
 #if USE_STAGING_TEXTURE
     pContext->EnqueueSignal(m_UploadCompleteFence, ++m_UploadCompleteFenceValue);
+#else
+    if (pRingData != nullptr)
+        m_UploadRing.FinishFrame(pContext);
 #endif
 }
 
-Buildings::Buildings()
+Buildings::~Buildings()
 {
-    m_GenTexThreadLooping.store(true);
-    m_GenTexThread = std::thread{&Buildings::ThreadProc, this};
+    {
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        m_GenTexThreadsLooping = false;
+    }
+    m_GenTexCondVar.notify_all();
+
+    for (auto& Thread : m_GenTexThreads)
+        Thread.join();
 }
 
-Buildings::~Buildings()
+void Buildings::QueueGenTexTask(GenTexTask& Task)
 {
-    m_GenTexThreadLooping.store(false);
-    m_GenTexThread.join();
+    Task.Generation = ++m_LastGenTexGeneration;
+    Task.NumBandsLeft.store(m_NumGenTexBands, std::memory_order_relaxed);
+
+    const auto OldStatus = Task.Status.exchange(TaskStatus::NewTask, std::memory_order_relaxed);
+    VERIFY_EXPR(OldStatus == TaskStatus::Initial || OldStatus == TaskStatus::CopyTex);
+
+    // Resetting the band counter makes the task available; generator threads that take a band
+    // synchronize with this store and see all task fields.
+    Task.NextBand.store(0, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        m_NumQueuedGenTexBands += m_NumGenTexBands;
+    }
+    m_GenTexCondVar.notify_all();
 }
 
 void Buildings::ThreadProc()
 {
-    while (m_GenTexThreadLooping.load())
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
+
+    if (auto* pProfiler = TimelineProfiler::Get())
+        pProfiler->SetThreadName("Texture generator");
+
+    for (;;)
     {
-        for (Uint32 i = 0; i < 100; ++i)
         {
-            // Check the task status.
-            // If task status is 'NewTask' then change status to GenTex,
-            // invalidate CPU cache to make changes from another thread visible to current thread.
-            TaskStatus Expected = TaskStatus::NewTask;
-            if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::GenTex, std::memory_order_acquire, std::memory_order_relaxed))
+            std::unique_lock<std::mutex> Lock{m_GenTexMtx};
+            m_GenTexCondVar.wait(Lock, [this]() { return m_NumQueuedGenTexBands > 0 || !m_GenTexThreadsLooping; });
+            if (!m_GenTexThreadsLooping)
+                return;
+
+            // Reserve one of the queued bands
+            --m_NumQueuedGenTexBands;
+        }
+
+        // Find the reserved band. Every reservation matches exactly one band of a task in the 'NewTask' state,
+        // so the search always succeeds, but other threads may take the first bands we see.
+        for (Uint32 i = 0;; i = (i + 1) % m_NumGenTexTasks)
+        {
+            auto& Task = m_GenTexTasks[i];
+            if (Task.Status.load(std::memory_order_relaxed) != TaskStatus::NewTask)
+                continue;
+
+            const Uint32 Band = Task.NextBand.fetch_add(1, std::memory_order_acq_rel);
+            if (Band >= m_NumGenTexBands)
+                continue;
+
+            const Uint32 FirstRow = Band * GenTexBandRows;
             {
-                const auto& TexDesc   = m_OpaqueTexAtlas->GetDesc();
-                const auto  Slice     = m_GenTexTask.ArraySlice;
-                Uint32      SrcOffset = 0;
-                GenTexture(&m_GenTexTask.Pixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, m_GenTexTask.Time);
+                TimelineProfiler::CpuScope ProfilerScope{"Generate texture band"};
+                GenTexture(Task.Pixels.data(), TexDesc.Width, TexDesc.Height, FirstRow, std::min(Uint32{GenTexBandRows}, TexDesc.Height - FirstRow), Task.ArraySlice, Task.Time);
+            }
+
+            // The thread that finishes the last band sees the results of all other bands and generates the mip chain.
+            if (Task.NumBandsLeft.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                auto OldStatus = Task.Status.exchange(TaskStatus::GenTex, std::memory_order_relaxed);
+                VERIFY_EXPR(OldStatus == TaskStatus::NewTask);
 
-                for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
                 {
-                    const Uint32* SrcPixels = &m_GenTexTask.Pixels[SrcOffset];
-                    const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-                    const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-                    const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-                    Uint32*       DstPixels = &m_GenTexTask.Pixels[DstOffset];
-                    const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-                    const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-                    GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-                    SrcOffset = DstOffset;
+                    TimelineProfiler::CpuScope ProfilerScope{"Generate mip chain"};
+                    GenMipChain(Task.Pixels.data(), TexDesc);
                 }
+                m_NumGeneratedSlices.fetch_add(1, std::memory_order_relaxed);
 
                 // Change status to 'TexReady' and flush CPU cache to make local changes visible for other threads.
-                const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::TexReady, std::memory_order_release);
+                OldStatus = Task.Status.exchange(TaskStatus::TexReady, std::memory_order_release);
                 VERIFY_EXPR(OldStatus == TaskStatus::GenTex);
-
-                break;
             }
+            break;
         }
-        std::this_thread::sleep_for(std::chrono::microseconds{1});
     }
 }
 
+Buildings::TexGenStats Buildings::QueryTexGenStats()
+{
+    TexGenStats Stats;
+    Stats.NumGeneratedSlices = m_NumGeneratedSlices.exchange(0, std::memory_order_relaxed);
+    Stats.NumSlots           = m_NumGenTexTasks;
+    Stats.SliceSize          = m_OpaqueTexAtlas ? m_OpaqueTexAtlas->GetDesc().Width * m_OpaqueTexAtlas->GetDesc().Height * 4 : 0;
+    for (Uint32 i = 0; i < m_NumGenTexTasks; ++i)
+    {
+        const auto Status = m_GenTexTasks[i].Status.load(std::memory_order_relaxed);
+        if (Status == TaskStatus::NewTask || Status == TaskStatus::GenTex)
+            ++Stats.NumBusySlots;
+    }
+    return Stats;
+}
+
 void Buildings::GenerateOpaqueTexture()
 {
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
     for (Uint32 Slice = 0; Slice < TexDesc.ArraySize; ++Slice)
     {
-        Uint32 SrcOffset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
-        GenTexture(&m_OpaqueTexAtlasPixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, 0u);
-
-        for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
-        {
-            const Uint32* SrcPixels = &m_OpaqueTexAtlasPixels[SrcOffset];
-            const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-            const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-            const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-            Uint32*       DstPixels = &m_OpaqueTexAtlasPixels[DstOffset];
-            const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-            const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-            GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-            SrcOffset = DstOffset;
-        }
+        auto& Pixels = m_OpaqueTexAtlasPixels[Slice];
+        GenTexture(Pixels.data(), TexDesc.Width, TexDesc.Height, 0, TexDesc.Height, Slice, 0u);
+        GenMipChain(Pixels.data(), TexDesc);
     }
 }
 
@@ -28,11 +28,15 @@
 
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 
 #include "Terrain.hpp"
+#include "UploadRing.hpp"
 
 // Single staging texture allocates less memory, but spends more time
-// than when UpdateTexture() is used with implicit staging buffer.
+// than when UpdateTexture() copies from the upload ring or uses implicit staging buffer.
 #define USE_STAGING_TEXTURE 0
 
 namespace Diligent
@@ -41,7 +45,6 @@ namespace Diligent
 class Buildings
 {
 public:
-    Buildings();
     ~Buildings();
 
     void Initialize(IRenderDevice* pDevice, IBuffer* pDrawConstants, Uint64 ImmediateContextMask);
@@ -54,6 +57,15 @@ public:
 
     void UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb);
 
+    struct TexGenStats
+    {
+        Uint32 NumGeneratedSlices = 0; // Since the previous call of QueryTexGenStats()
+        Uint32 NumBusySlots       = 0; // Slots that are queued or being generated
+        Uint32 NumSlots           = 0;
+        Uint32 SliceSize          = 0; // Size of the most detailed mip level of one slice, in bytes
+    };
+    TexGenStats QueryTexGenStats();
+
     Uint32 GetOpaqueTexAtlasDataSize() const
     {
         const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
@@ -64,6 +76,9 @@ private:
     void GenerateOpaqueTexture();
     void ThreadProc();
 
+    struct GenTexTask;
+    void QueueGenTexTask(GenTexTask& Task);
+
     RefCntAutoPtr<IRenderDevice> m_Device;
     Uint64                       m_ImmediateContextMask = 0;
     RefCntAutoPtr<IBuffer>       m_DrawConstants;
@@ -82,8 +97,10 @@ private:
     Uint32      m_m_OpaqueTexAtlasOffset = 0;
 
 
-    std::vector<Uint32> m_OpaqueTexAtlasPixels;
-    Uint32              m_OpaqueTexAtlasSliceSize = 0; // in bytes
+    // Pixels of every array slice with all mip levels
+    std::vector<std::vector<Uint32>> m_OpaqueTexAtlasPixels;
+    std::vector<Uint64>              m_OpaqueTexAtlasSliceGenerations; // generation of the task that produced each slice
+    Uint32                           m_OpaqueTexAtlasSliceSize = 0;    // in bytes
 
     enum class TaskStatus : Uint32
     {
@@ -93,21 +110,62 @@ private:
         CopyTex  = 3,
         Initial  = ~0u,
     };
+    // Ring of texture generation tasks. The render thread is the only producer: it fills
+    // free slots and takes finished slices; generator threads pick up bands of rows of new
+    // tasks in any order, and the thread that finishes the last band builds the mip chain.
+    // Finished pixels are swapped with the atlas slice, so no data is copied.
     struct GenTexTask
     {
         std::atomic<TaskStatus> Status{TaskStatus::Initial}; // protects access to other fields
+        std::atomic<Uint32>     NextBand{0};                 // next band of rows to generate
+        std::atomic<Uint32>     NumBandsLeft{0};             // bands that are not finished yet
         std::vector<Uint32>     Pixels;
         Uint32                  ArraySlice = 0;
         Uint32                  Time       = 0;
+        Uint64                  Generation = 0; // increases with every queued task
     };
-    GenTexTask        m_GenTexTask;
-    std::thread       m_GenTexThread;
-    std::atomic<bool> m_GenTexThreadLooping{false};
+    static constexpr Uint32 GenTexBandRows = 64;
+
+    std::unique_ptr<GenTexTask[]> m_GenTexTasks;
+    Uint32                        m_NumGenTexTasks       = 0;
+    Uint32                        m_NumGenTexBands       = 0;
+    Uint32                        m_NextGenTexSlice      = 0;
+    Uint64                        m_LastGenTexGeneration = 0;
+    std::atomic<Uint32>           m_NumGeneratedSlices{0};
+    std::vector<std::thread>      m_GenTexThreads;
+
+    // Generator threads sleep on the condition variable until new tasks are queued.
+    std::mutex              m_GenTexMtx;
+    std::condition_variable m_GenTexCondVar;
+    Uint32                  m_NumQueuedGenTexBands = 0;     // protected by m_GenTexMtx
+    bool                    m_GenTexThreadsLooping = false; // protected by m_GenTexMtx
 
 #if USE_STAGING_TEXTURE
     RefCntAutoPtr<ITexture> m_OpaqueTexAtlasStaging;
     RefCntAutoPtr<IFence>   m_UploadCompleteFence;
     Uint64                  m_UploadCompleteFenceValue = 0;
+#else
+    // Atlas regions are packed into the upload ring and copied to the texture after the ring is unmapped.
+    // Devices that can not copy from a buffer to a texture use UpdateTexture() with implicit staging buffer.
+    static constexpr Uint32 UploadRingFrames        = 3;
+    static constexpr Uint64 MaxUploadRingSize       = Uint64{64} << 20;
+    static constexpr Uint32 UploadRowPitchAlignment = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+    static constexpr Uint32 UploadOffsetAlignment   = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+    bool       m_UseUploadRing = false;
+    UploadRing m_UploadRing;
+    Uint64     m_OpaqueTexAtlasUploadSliceSize = 0; // slice size with aligned rows, in bytes
+
+    struct UploadRegion
+    {
+        Uint32 Slice     = 0;
+        Uint32 Mipmap    = 0;
+        Uint32 Width     = 0;
+        Uint32 Height    = 0;
+        Uint64 SrcOffset = 0;
+        Uint64 Stride    = 0;
+    };
+    std::vector<UploadRegion> m_UploadRegions;
 #endif
 
 public:
@@ -26,6 +26,7 @@
 
 #include "Profiler.hpp"
 #include "imgui.h"
+#include "TimelineProfiler.hpp"
 
 namespace Diligent
 {
@@ -33,6 +34,23 @@ namespace Diligent
 static constexpr float GraphWidth  = 500.f;
 static constexpr float GraphHeight = 100.f;
 
+static const char* GetPassName(Profiler::PASS_TYPE PassType)
+{
+    switch (PassType)
+    {
+        // clang-format off
+        case Profiler::FRAME:      return "Frame";
+        case Profiler::GRAPHICS_1: return "Graphics pass 1";
+        case Profiler::GRAPHICS_2: return "Graphics pass 2";
+        case Profiler::COMPUTE:    return "Compute pass";
+        case Profiler::TRANSFER:   return "Transfer pass";
+        // clang-format on
+        default:
+            UNEXPECTED("Unknown pass type");
+            return "";
+    }
+}
+
 void Profiler::Initialize(IRenderDevice* pDevice)
 {
     m_Device  = pDevice;
@@ -62,6 +80,14 @@ void Profiler::Initialize(IRenderDevice* pDevice)
 
 void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
 {
+    // Passes are also shown in the trace when the app runs with --trace
+    if (auto* pTimeline = TimelineProfiler::Get())
+    {
+        m_TimelineBeginTime[PassType] = pTimeline->GetTime();
+        if (pContext != nullptr)
+            pTimeline->BeginGpuScope(pContext, GetPassName(PassType));
+    }
+
     if (m_Device == nullptr)
         return;
 
@@ -100,6 +126,13 @@ void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
 
 void Profiler::End(IDeviceContext* pContext, PASS_TYPE PassType)
 {
+    if (auto* pTimeline = TimelineProfiler::Get())
+    {
+        if (pContext != nullptr)
+            pTimeline->EndGpuScope(pContext);
+        pTimeline->AddCpuEvent(GetPassName(PassType), m_TimelineBeginTime[PassType], pTimeline->GetTime());
+    }
+
     if (m_Device == nullptr)
         return;
 
@@ -141,6 +174,15 @@ void Profiler::SetCpuToGpuTransferRate(Uint32 RateInMb)
     m_TempCpuToGpuTransferRateMb = RateInMb;
 }
 
+void Profiler::SetTexGenStats(Uint32 NumGeneratedSlices, Uint32 NumBusySlots, Uint32 NumSlots, Uint32 SliceSize)
+{
+    m_TempGeneratedSlices += NumGeneratedSlices;
+    m_TempBusyTexGenSlots += NumBusySlots;
+    m_TempTexGenStatsFrames += 1;
+    m_NumTexGenSlots        = NumSlots;
+    m_TexGenSliceSize       = SliceSize;
+}
+
 void Profiler::Update(double ElapsedTime)
 {
     if (m_Device == nullptr)
@@ -181,6 +223,21 @@ void Profiler::Update(double ElapsedTime)
     m_AccumTime += ElapsedTime;
     if (m_AccumTime > UpdateInterval)
     {
+        {
+            std::stringstream texgen_ss;
+            texgen_ss.precision(1);
+            texgen_ss.flags(std::ios_base::fixed);
+            texgen_ss << "Texture generation: " << m_TempGeneratedSlices / m_AccumTime << " slices/s, queue occupancy: "
+                      << (m_TempTexGenStatsFrames > 0 ? static_cast<double>(m_TempBusyTexGenSlots) / m_TempTexGenStatsFrames : 0.0)
+                      << " / " << m_NumTexGenSlots;
+            m_TexGenCountersStr = texgen_ss.str();
+            m_TexGenRateMb      = static_cast<double>(m_TempGeneratedSlices) * m_TexGenSliceSize / (1 << 20) / m_AccumTime;
+
+            m_TempGeneratedSlices   = 0;
+            m_TempBusyTexGenSlots   = 0;
+            m_TempTexGenStatsFrames = 0;
+        }
+
         m_AccumTime = 0.0;
 
         auto&       Curr = m_FrameHistory[m_FrameId];
@@ -270,6 +327,7 @@ void Profiler::Update(double ElapsedTime)
         TimeToStr(values1_ss, CompTime);
         TimeToStr(values1_ss, TransfTime);
         ByteSizeToStr(values1_ss, m_TempCpuToGpuTransferRateMb / ElapsedTime);
+        values1_ss << "-" << std::endl;
         m_GpuCountersStr = values1_ss.str();
 
         const auto CpuGfx1Time   = std::chrono::duration_cast<SecondsD>(Curr.Graphics1.CpuTImeEnd - Curr.Graphics1.CpuTImeBegin).count();
@@ -287,6 +345,8 @@ void Profiler::Update(double ElapsedTime)
         TimeToStr(values2_ss, CpuGfx1Time + CpuGfx2Time);
         TimeToStr(values2_ss, CpuCompTime);
         TimeToStr(values2_ss, CpuTransfTime);
+        values2_ss << "-" << std::endl;
+        ByteSizeToStr(values2_ss, m_TexGenRateMb);
         m_CpuCountersStr = values2_ss.str();
     }
 
@@ -394,6 +454,7 @@ void Profiler::UpdateUI()
             params_ss << "Compute pass:" << std::endl;
             params_ss << "Upload pass:" << std::endl;
             params_ss << "Transfer rate:" << std::endl;
+            params_ss << "Generation rate:" << std::endl;
 
             ImGui::TextDisabled("%s", params_ss.str().c_str());
             ImGui::SameLine(0.f, 20.f);
@@ -401,6 +462,8 @@ void Profiler::UpdateUI()
             ImGui::SameLine(0.f, 20.f);
             ImGui::TextDisabled("%s", m_CpuCountersStr.c_str());
         }
+
+        ImGui::TextDisabled("%s", m_TexGenCountersStr.c_str());
     }
     ImGui::End();
 }
@@ -54,6 +54,7 @@ public:
     void Begin(IDeviceContext* pContext, PASS_TYPE Pass);
     void End(IDeviceContext* pContext, PASS_TYPE Pass);
     void SetCpuToGpuTransferRate(Uint32 RateInMb);
+    void SetTexGenStats(Uint32 NumGeneratedSlices, Uint32 NumBusySlots, Uint32 NumSlots, Uint32 SliceSize);
 
     void UpdateUI();
     void Update(double ElapsedTime);
@@ -67,10 +68,21 @@ private:
     static constexpr Uint32 NumFramesPOT   = 3;
     static constexpr float  UpdateInterval = 1.f / 5.f;
 
+    // Begin times of the passes on the timeline profiler's clock
+    std::array<Uint64, TRANSFER + 1> m_TimelineBeginTime = {};
+
     Uint32 m_FrameId : NumFramesPOT;
     Uint32 m_TempCpuToGpuTransferRateMb     = 0;
     bool   m_SupportsTransferQueueProfiling = false;
 
+    // Texture generation counters accumulated over the update interval
+    Uint32 m_TempGeneratedSlices   = 0;
+    Uint32 m_TempBusyTexGenSlots   = 0;
+    Uint32 m_TempTexGenStatsFrames = 0;
+    Uint32 m_NumTexGenSlots        = 0;
+    Uint32 m_TexGenSliceSize       = 0;
+    double m_TexGenRateMb          = 0.0;
+
     struct PassCounters
     {
         RefCntAutoPtr<IQuery> GpuTimeQueryBegin;
@@ -112,6 +124,7 @@ private:
     Graph  m_Graph2;
     String m_GpuCountersStr;
     String m_CpuCountersStr;
+    String m_TexGenCountersStr;
     double m_AccumTime = 0.0;
 };
 
@@ -616,6 +616,10 @@ void Tutorial23_CommandQueues::Render()
 void Tutorial23_CommandQueues::Update(double CurrTime, double ElapsedTime)
 {
     SampleBase::Update(CurrTime, ElapsedTime);
+    {
+        const auto TexGenStats = m_Buildings.QueryTexGenStats();
+        m_Profiler.SetTexGenStats(TexGenStats.NumGeneratedSlices, TexGenStats.NumBusySlots, TexGenStats.NumSlots, TexGenStats.SliceSize);
+    }
     m_Profiler.Update(ElapsedTime);
     UpdateUI();
 
@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "UploadRing.hpp"
+#include "Align.hpp"
+
+namespace Diligent
+{
+
+void UploadRing::Create(IRenderDevice* pDevice, Uint64 Size, Uint64 ImmediateContextMask)
+{
+    // The previous buffer is released by the engine when the GPU stops using it.
+    m_Buffer.Release();
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name                 = "Upload ring";
+    BuffDesc.Usage                = USAGE_STAGING;
+    BuffDesc.CPUAccessFlags       = CPU_ACCESS_WRITE;
+    BuffDesc.Size                 = Size;
+    BuffDesc.ImmediateContextMask = ImmediateContextMask;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_Buffer);
+
+    // Buffer is used in multiple contexts, so disable automatic resource transitions.
+    VERIFY_EXPR((m_Buffer->GetState() & RESOURCE_STATE_COPY_SOURCE) != 0);
+    m_Buffer->SetState(RESOURCE_STATE_UNKNOWN);
+
+    if (!m_Fence)
+    {
+        FenceDesc FenceCI;
+        FenceCI.Name = "Upload ring fence";
+        FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+        pDevice->CreateFence(FenceCI, &m_Fence);
+    }
+
+    m_Size              = Size;
+    m_Head              = 0;
+    m_UsedSize          = 0;
+    m_FrameSize         = 0;
+    m_FirstPendingFrame = 0;
+    m_NumPendingFrames  = 0;
+}
+
+void UploadRing::ReleaseCompletedFrames(Uint64 CompletedValue)
+{
+    while (m_NumPendingFrames > 0)
+    {
+        const auto& Frame = m_PendingFrames[m_FirstPendingFrame];
+        if (Frame.FenceValue > CompletedValue)
+            break;
+
+        VERIFY_EXPR(m_UsedSize >= Frame.Size);
+        m_UsedSize -= Frame.Size;
+        m_FirstPendingFrame = (m_FirstPendingFrame + 1) % MaxPendingFrames;
+        --m_NumPendingFrames;
+    }
+}
+
+void UploadRing::WaitForOldestFrame()
+{
+    VERIFY_EXPR(m_NumPendingFrames > 0);
+    const Uint64 FenceValue = m_PendingFrames[m_FirstPendingFrame].FenceValue;
+    m_Fence->Wait(FenceValue);
+    ReleaseCompletedFrames(FenceValue);
+}
+
+Uint8* UploadRing::Map(IDeviceContext* pContext)
+{
+    VERIFY_EXPR(m_FrameSize == 0);
+
+    ReleaseCompletedFrames(m_Fence->GetCompletedValue());
+    if (m_NumPendingFrames == MaxPendingFrames)
+        WaitForOldestFrame();
+
+    // Staging buffer is not synchronized by the engine, the fence protects regions that are in use.
+    PVoid pData = nullptr;
+    pContext->MapBuffer(m_Buffer, MAP_WRITE, MAP_FLAG_DO_NOT_WAIT, pData);
+    return static_cast<Uint8*>(pData);
+}
+
+void UploadRing::Unmap(IDeviceContext* pContext)
+{
+    pContext->UnmapBuffer(m_Buffer, MAP_WRITE);
+}
+
+Uint64 UploadRing::Allocate(Uint64 Size, Uint64 Alignment)
+{
+    for (;;)
+    {
+        if (m_UsedSize == 0)
+            m_Head = 0;
+
+        // Regions never cross the end of the buffer; the tail of the buffer is skipped instead.
+        Uint64 Offset = AlignUp(m_Head, Alignment);
+        if (Offset + Size > m_Size)
+            Offset = 0;
+
+        const Uint64 AllocSize = (Offset >= m_Head ? Offset - m_Head : m_Size - m_Head) + Size;
+        if (m_UsedSize + AllocSize <= m_Size)
+        {
+            m_Head = Offset + Size;
+            m_UsedSize += AllocSize;
+            m_FrameSize += AllocSize;
+            return Offset;
+        }
+
+        // Regions of the current frame can not be released until the frame is submitted
+        if (m_NumPendingFrames == 0)
+            return InvalidOffset;
+
+        WaitForOldestFrame();
+    }
+}
+
+void UploadRing::FinishFrame(IDeviceContext* pContext)
+{
+    if (m_FrameSize == 0)
+        return;
+
+    pContext->EnqueueSignal(m_Fence, ++m_FenceValue);
+
+    VERIFY_EXPR(m_NumPendingFrames < MaxPendingFrames);
+    auto& Frame      = m_PendingFrames[(m_FirstPendingFrame + m_NumPendingFrames) % MaxPendingFrames];
+    Frame.FenceValue = m_FenceValue;
+    Frame.Size       = m_FrameSize;
+    ++m_NumPendingFrames;
+    m_FrameSize = 0;
+}
+
+} // namespace Diligent
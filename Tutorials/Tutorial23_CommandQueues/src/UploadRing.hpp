@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include "SampleBase.hpp"
+
+namespace Diligent
+{
+
+// Persistent staging buffer that is used as a ring of upload regions.
+// Regions allocated during a frame are tracked with a fence value that is signaled by FinishFrame(),
+// and are recycled when the GPU passes that value. The ring never allocates memory after Create().
+class UploadRing
+{
+public:
+    static constexpr Uint64 InvalidOffset = ~Uint64{0};
+
+    void Create(IRenderDevice* pDevice, Uint64 Size, Uint64 ImmediateContextMask);
+
+    IBuffer* GetBuffer() const { return m_Buffer; }
+    Uint64   GetSize() const { return m_Size; }
+
+    // Maps the buffer for the current frame. Waits for the GPU if too many frames are in flight.
+    Uint8* Map(IDeviceContext* pContext);
+    void   Unmap(IDeviceContext* pContext);
+
+    // Returns the offset of the allocated region. Waits for the GPU if the ring is full;
+    // returns InvalidOffset if the region does not fit even into an empty ring.
+    Uint64 Allocate(Uint64 Size, Uint64 Alignment);
+
+    // Signals the fence after all copies of the current frame were recorded in pContext.
+    void FinishFrame(IDeviceContext* pContext);
+
+private:
+    void ReleaseCompletedFrames(Uint64 CompletedValue);
+    void WaitForOldestFrame();
+
+    RefCntAutoPtr<IBuffer> m_Buffer;
+    RefCntAutoPtr<IFence>  m_Fence;
+    Uint64                 m_FenceValue = 0;
+
+    Uint64 m_Size      = 0;
+    Uint64 m_Head      = 0; // next free byte
+    Uint64 m_UsedSize  = 0; // includes alignment and wrap-around padding
+    Uint64 m_FrameSize = 0; // bytes used by the current frame
+
+    struct PendingFrame
+    {
+        Uint64 FenceValue = 0;
+        Uint64 Size       = 0;
+    };
+    static constexpr Uint32 MaxPendingFrames = 8;
+
+    std::array<PendingFrame, MaxPendingFrames> m_PendingFrames;
+    Uint32                                     m_FirstPendingFrame = 0;
+    Uint32                                     m_NumPendingFrames  = 0;
+};
+
+} // namespace Diligent